@@ -25,19 +25,31 @@ DrawModule::DrawModule(FrameViewer *parent, int length)
     _renderMode=0;
     _drawCurvesArray = new DrawCurves[length+1];
     _dc = _drawCurvesArray;
+    _propagator = new DrawPropagator(_drawCurvesArray);
+    _propagateTimer = 0;
     mutualInit();
 }
 
 DrawModule::~DrawModule()
 {
+    delete _propagator;
 }
 
 void DrawModule::paintGL()
 {
+    if (_propagateTimer && !_propagator->update())
+    {
+        killTimer(_propagateTimer);
+        _propagateTimer = 0;
+    }
+
     if (_dAlpha==0)
     {
         if (_selected)
+        {
+            _selected->calculateDeferredFill();
             _selected->render(_renderMode);
+        }
         if (_currDPath)
             _currDPath->render(_renderMode,false);
         return;
@@ -87,6 +99,8 @@ void DrawModule::mousePressEvent(QMouseEvent *e)
     }
     else if (_toolMode==D_SELECT)   // select
     {
+        // dragging walks and changes the whole chain of the path
+        finishPropagation();
         int which; // 0 for patch, 1 for path, -1 for neither
         void* selected = _dc->pickPrimitive(e->x(), e->y(), &which);
         _dragLoc = unproject(e->x(), e->y(), _parent->_h);
@@ -206,7 +220,8 @@ void DrawModule::frameChange(int i)
                 DrawPath* curr;
                 _dc->startDrawPathIterator();
                 while ((curr=_dc->IterateNext()) != NULL)
-                    if (curr->justDrawn() && !curr->nextC())
+                    if (curr->justDrawn() && !curr->nextC()
+                            && !_propagator->propagating(curr))
                         curr->interpolateForwards(i);
 
                 if (_selected)
@@ -258,16 +273,20 @@ void DrawModule::propagatedStroke()
 
 void DrawModule::corrPropAll()
 {
+    finishPropagation();
     _parent->setCursor(Qt::WaitCursor);
+    std::vector<DrawPath*> uncorr;
     _dc->startDrawPathIterator();
     DrawPath* curr;
     while ((curr=_dc->IterateNext()) != NULL)
-    {
         if (!curr->corrToRoto())
-        {
-            RotoCurves *crc = _parent->roto->_rotoCurvesArray+_frame;
-            curr->correspondRoto2(crc, _parent->_w, _parent->_h);
-        }
+            uncorr.push_back(curr);
+    RotoCurves *crc = _parent->roto->_rotoCurvesArray+_frame;
+    DrawPath::correspondRotos(uncorr, crc, _parent->_w, _parent->_h);
+
+    _dc->startDrawPathIterator();
+    while ((curr=_dc->IterateNext()) != NULL)
+    {
         if (curr->nextC() == NULL || curr->prevC() == NULL)
             propagatePathEverywhere(curr);
     }
@@ -302,43 +321,32 @@ float DrawModule::mapPressure() const
     return res;
 }
 
+// The frames are filled in by _propagator and show up as they are done;
+// optimizeDrawShape(path, last, _frame, lastFrame, false) used to follow.
 void DrawModule::propagatePathEverywhere(DrawPath* path)
 {
-    _parent->setCursor(Qt::WaitCursor);
-    //RotoPath **currRotos = new RotoPath*[path->getNumElements()];
-    bool kosher = true;
-
-    DrawPath* currD;
-    int frame = _frame, shit, i;
+    if (path->nextC()!=NULL || _propagator->propagating(path))
+        return;
 
-    // forwards
-    kosher = path->getCorrRoto()->nextRotosExist();
+    _propagator->propagate(path, _frame);
+    if (_propagator->busy() && !_propagateTimer)
+        _propagateTimer = startTimer(100);
+}
 
-    currD = path;
-    if (path->nextC()==NULL)
-    {
-        while (kosher)
-        {
-            frame++;
-            DrawPath* newPath = new DrawPath();
-            newPath->setFixed(false);
-            newPath->copyLook(path);
-            DrawCurves *ptrDC = _drawCurvesArray + frame;
-            ptrDC->addPath(newPath);
-            newPath->setPrevC(currD);
-            currD->setNextC(newPath);
-            DrawPath::fillForwardInterpolatedCurve(newPath,currD);
-            currD = newPath;
-            kosher = currD->getCorrRoto()->nextRotosExist();
-
-            currD->redoStroke(); // HM?
-            currD->freshenAppearance();
-
-        } // end while
-    }
-    if (frame > _frame && 0) //G!
-        optimizeDrawShape(path, currD, _frame, frame, false);
+void DrawModule::finishPropagation()
+{
+    if (!_propagator->busy())
+        return;
+    _parent->setCursor(Qt::WaitCursor);
+    _propagator->wait();
     _parent->setCursor(Qt::ArrowCursor);
+    _parent->updateGL();
+}
+
+void DrawModule::timerEvent(QTimerEvent *e)
+{
+    if (e->timerId() == _propagateTimer)
+        _parent->updateGL();
 }
 
 void DrawModule::optimizeDrawShape(DrawPath* aPath, DrawPath* bPath, int aFrame, int bFrame, bool pinLast)
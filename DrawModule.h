@@ -4,6 +4,7 @@
 #include "frameviewer.h"
 #include "DrawPath.h"
 #include "DrawCurves.h"
+#include "DrawPropagator.h"
 #include <QObject>
 #include <QGLWidget>
 #include <QMouseEvent>
@@ -29,12 +30,21 @@ public:
 
     void toolChange(DrawTool id);
     void propagatedStroke();
+
+    // hand over every path still being propagated; the roto curves may be
+    // edited again afterwards
+    void finishPropagation();
+    // the DrawCurves of every frame
+    DrawCurves* drawCurves() { return _drawCurvesArray; }
     QRgb getCurrColor();
     void setColor(const Vec3f& col);
 signals:
     void selectChanged();
     void currColorChanged();
 
+protected:
+    virtual void timerEvent(QTimerEvent *e);
+
 private:
     int _mousePressed;
     FrameViewer *_parent;
@@ -57,6 +67,8 @@ private:
     DrawCurves *_dc;
     int _spliceIndex, _spliceFlag; // -1 not active, 1 on curve, 0 off,  -2 for needs correspondences
     DrawCurves *_drawCurvesArray;
+    DrawPropagator *_propagator;
+    int _propagateTimer; // repaints while _propagator is busy, 0 when not
     void propagatePathEverywhere(DrawPath* path);
     void optimizeDrawShape(DrawPath* aPath, DrawPath* bPath, int aFrame, int bFrame, bool pinLast);
     void regeneratePath(DrawPath* path);
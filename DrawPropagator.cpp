@@ -0,0 +1,148 @@
+#include "DrawPropagator.h"
+#include <assert.h>
+
+DrawPropagator::DrawPropagator(DrawCurves *curves, int numWorkers)
+    : _curves(curves)
+    , _running(0)
+    , _quit(false)
+{
+    if (numWorkers <= 0)
+        numWorkers = QThread::idealThreadCount();
+    if (numWorkers <= 0)
+        numWorkers = 1;
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        Worker *w = new Worker(this);
+        _workers.push_back(w);
+        w->start();
+    }
+}
+
+DrawPropagator::~DrawPropagator()
+{
+    wait();
+
+    _mutex.lock();
+    _quit = true;
+    _wake.wakeAll();
+    _mutex.unlock();
+
+    for (unsigned int i = 0; i < _workers.size(); ++i)
+    {
+        _workers[i]->wait();
+        delete _workers[i];
+    }
+}
+
+void DrawPropagator::propagate(DrawPath *path, int frame)
+{
+    assert(!path->nextC() && !propagating(path));
+    if (!path->getCorrRoto() || !path->getCorrRoto()->nextRotosExist())
+        return;
+
+    Chain *c = new Chain;
+    c->source = path;
+    c->frame = frame;
+    c->published = 0;
+
+    // U and V are orthonormal, so each vertex keeps the same offset from
+    // its roto curve on every frame and the rig of path is the rig of all
+    path->getRig(c->rig);
+
+    const DrawPath *prev = path;
+    do
+    {
+        DrawPath *p = new DrawPath();
+        p->setFixed(false);
+        p->copyLook(path);
+        DrawPath::fillForwardCorr(p, prev);
+        c->paths.push_back(p);
+        prev = p;
+    } while (prev->getCorrRoto()->nextRotosExist());
+    c->done.assign(c->paths.size(), false);
+    _chains.push_back(c);
+
+    QMutexLocker lock(&_mutex);
+    for (unsigned int i = 0; i < c->paths.size(); ++i)
+    {
+        Step s = { c, int(i) };
+        _steps.push_back(s);
+    }
+    _wake.wakeAll();
+}
+
+bool DrawPropagator::update()
+{
+    QMutexLocker lock(&_mutex);
+    std::list<Chain*>::iterator it = _chains.begin();
+    while (it != _chains.end())
+    {
+        Chain *c = *it;
+        while (c->published < c->paths.size() && c->done[c->published])
+        {
+            DrawPath *p = c->paths[c->published];
+            DrawPath *prev = c->published ? c->paths[c->published - 1]
+                    : c->source;
+            _curves[c->frame + 1 + c->published].addPath(p);
+            p->setPrevC(prev);
+            prev->setNextC(p);
+            ++c->published;
+        }
+        if (c->published == c->paths.size())
+        {
+            delete c;
+            it = _chains.erase(it);
+        }
+        else
+            ++it;
+    }
+    return !_chains.empty();
+}
+
+void DrawPropagator::wait()
+{
+    while (update())
+    {
+        QMutexLocker lock(&_mutex);
+        if (!_steps.empty() || _running > 0)
+            _stepDone.wait(&_mutex);
+    }
+}
+
+bool DrawPropagator::propagating(const DrawPath *path) const
+{
+    std::list<Chain*>::const_iterator it;
+    for (it = _chains.begin(); it != _chains.end(); ++it)
+        if ((*it)->source == path)
+            return true;
+    return false;
+}
+
+void DrawPropagator::work()
+{
+    QMutexLocker lock(&_mutex);
+    while (!_quit)
+    {
+        if (_steps.empty())
+        {
+            _wake.wait(&_mutex);
+            continue;
+        }
+        Step s = _steps.front();
+        _steps.pop_front();
+        ++_running;
+        lock.unlock();
+
+        // only reads the roto curves, and the path is nobody else's yet
+        DrawPath *p = s.chain->paths[s.index];
+        p->offsetRig(s.chain->rig);
+        p->redoStroke();
+        p->freshenStroke();
+
+        lock.relock();
+        s.chain->done[s.index] = true;
+        --_running;
+        _stepDone.wakeAll();
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef DRAWPROPAGATOR_H
+#define DRAWPROPAGATOR_H
+
+#include <deque>
+#include <list>
+#include <vector>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include "DrawPath.h"
+#include "DrawCurves.h"
+
+// Forward propagation of drawn paths through the tracked roto curves, off
+// the GUI thread.
+//
+// propagate() carries the correspondence of a path forward frame by frame
+// on the calling thread, which only follows the roto curves' next curves,
+// and queues the new path of every frame.  Its vertices keep the offsets
+// they have from the roto curves on the frame it was drawn on, so the
+// workers place and tessellate the frames in any order.  update() hands the
+// finished paths over to their frames in frame order, linked to the path
+// before them; their fills are built by DrawCurves::renderAllPaths the first
+// time the frame is drawn, as the workers have no GL context.
+//
+// Until update() has handed a path over it belongs to the propagator.  The
+// roto curves must not change while busy().
+class DrawPropagator
+{
+public:
+
+    // curves is the array of the video, one DrawCurves per frame.
+    // numWorkers <= 0 means one per core.
+    DrawPropagator(DrawCurves *curves, int numWorkers = 0);
+    ~DrawPropagator();
+
+    // propagate path, on frame, forward while the roto curves it is
+    // corresponded to have next curves.  path has no nextC().
+    void propagate(DrawPath *path, int frame);
+
+    // hand the finished paths over to their frames, true while some are
+    // still to come
+    bool update();
+
+    // update() until every path has been handed over
+    void wait();
+
+    bool busy() const { return !_chains.empty(); }
+
+    // true while path is being propagated, its nextC() is still NULL then
+    bool propagating(const DrawPath *path) const;
+
+private:
+
+    class Worker : public QThread
+    {
+    public:
+        Worker(DrawPropagator *owner) : _owner(owner) {}
+    protected:
+        virtual void run() { _owner->work(); }
+    private:
+        DrawPropagator *_owner;
+    };
+
+    // the paths propagated from one path, paths[i] on frame + 1 + i
+    struct Chain
+    {
+        DrawPath *source;
+        int frame;
+        std::vector<DrawPath*> paths;
+        std::vector<Vec3f> rig;     // source->getRig()
+        std::vector<bool> done;
+        unsigned int published;     // paths handed over
+    };
+
+    struct Step
+    {
+        Chain *chain;
+        int index;
+    };
+
+    void work();
+
+    DrawCurves *_curves;
+    std::vector<Worker*> _workers;
+
+    std::list<Chain*> _chains;  // GUI thread only, done is under _mutex
+    std::deque<Step> _steps;
+    int _running;
+    bool _quit;
+
+    QMutex _mutex;
+    QWaitCondition _wake;
+    QWaitCondition _stepDone;
+};
+
+#endif // DRAWPROPAGATOR_H
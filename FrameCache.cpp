@@ -0,0 +1,322 @@
+#include "FrameCache.h"
+#include <algorithm>
+
+FrameCache::FrameCache(size_t byteBudget, int readAhead, int readBehind)
+    : _decodePos(0)
+    , _length(0)
+    , _bytes(0)
+    , _byteBudget(byteBudget)
+    , _readAhead(readAhead)
+    , _readBehind(readBehind)
+    , _center(-1)
+    , _quit(false)
+    , _hits(0)
+    , _misses(0)
+{
+}
+
+FrameCache::~FrameCache()
+{
+    close();
+}
+
+/**
+ * open	-	open the video file and start the prefetch thread
+ *
+ * @param fileName	-	the name of the video file
+ *
+ * @return True if success. False otherwise
+ */
+bool FrameCache::open(const std::string &fileName)
+{
+    close();
+
+    QMutexLocker dlock(&_decodeMutex);
+    if (!_capture.open(fileName))
+        return false;
+    _length = static_cast<long>(_capture.get(CV_CAP_PROP_FRAME_COUNT));
+    _decodePos = 0;
+    _fileName = fileName;
+
+    _quit = false;
+    start(QThread::LowPriority);
+    return true;
+}
+
+/**
+ * close	-	stop prefetching, release the decoder and drop every frame
+ *
+ */
+void FrameCache::close()
+{
+    stopPrefetch();
+    {
+        QMutexLocker dlock(&_decodeMutex);
+        if (_capture.isOpened())
+            _capture.release();
+        _length = 0;
+        _decodePos = 0;
+        _fileName.clear();
+    }
+    clear();
+}
+
+bool FrameCache::isOpened()
+{
+    QMutexLocker dlock(&_decodeMutex);
+    return _capture.isOpened();
+}
+
+/**
+ * getFrame	-	get a frame by index
+ *
+ * A cached frame is returned right away, a missing one is decoded on the
+ * calling thread.  Either way the prefetch window moves to this frame.
+ *
+ * @param index	-	frame index
+ * @param frame	-	the expected frame, shares data with the cache
+ *
+ * @return True if success. False otherwise
+ */
+bool FrameCache::getFrame(long index, cv::Mat &frame)
+{
+    if (index < 0 || index >= _length)
+        return false;
+
+    if (lookup(index, frame))
+    {
+        prefetch(index);
+        return true;
+    }
+
+    bool re, decoded = false;
+    {
+        QMutexLocker dlock(&_decodeMutex);
+        // the prefetch thread may have decoded it while we waited
+        if (lookup(index, frame))
+            re = true;
+        else
+        {
+            re = decoded = decode(index, frame);
+            if (re)
+                insert(index, frame);
+        }
+    }
+
+    if (decoded)
+    {
+        QMutexLocker lock(&_mutex);
+        ++_misses;
+    }
+
+    if (re)
+        prefetch(index);
+    return re;
+}
+
+/**
+ * prefetch	-	move the prefetch window to a frame
+ *
+ * @param index	-	frame index
+ */
+void FrameCache::prefetch(long index)
+{
+    QMutexLocker lock(&_mutex);
+    _center = index;
+    _wake.wakeOne();
+}
+
+/**
+ * clear	-	drop every cached frame
+ *
+ */
+void FrameCache::clear()
+{
+    QMutexLocker lock(&_mutex);
+    _frames.clear();
+    _lru.clear();
+    _bytes = 0;
+    _center = -1;
+}
+
+void FrameCache::setByteBudget(size_t byteBudget)
+{
+    QMutexLocker lock(&_mutex);
+    _byteBudget = byteBudget;
+    evict();
+}
+
+void FrameCache::setPrefetchWindow(int readAhead, int readBehind)
+{
+    QMutexLocker lock(&_mutex);
+    _readAhead = readAhead;
+    _readBehind = readBehind;
+    _wake.wakeOne();
+}
+
+/**
+ * run	-	prefetch thread, decodes the missing frames of the window
+ *
+ */
+void FrameCache::run()
+{
+    long index;
+    cv::Mat frame;
+
+    QMutexLocker lock(&_mutex);
+    while (!_quit)
+    {
+        if (!nextMissing(&index))
+        {
+            _wake.wait(&_mutex);
+            continue;
+        }
+        lock.unlock();
+
+        bool re;
+        {
+            QMutexLocker dlock(&_decodeMutex);
+            re = contains(index) || decode(index, frame);
+            if (re && !frame.empty())
+                insert(index, frame);
+        }
+        frame.release();
+
+        lock.relock();
+        // the video is shorter than it claims, stop this window
+        if (!re)
+            _center = -1;
+    }
+}
+
+/**
+ * lookup	-	fetch a cached frame and mark it most recently used
+ *
+ * @return True if cached. False otherwise
+ */
+bool FrameCache::lookup(long index, cv::Mat &frame)
+{
+    QMutexLocker lock(&_mutex);
+    std::map<long, CacheEntry>::iterator it = _frames.find(index);
+    if (it == _frames.end())
+        return false;
+    _lru.splice(_lru.begin(), _lru, it->second.lru);
+    frame = it->second.frame;
+    ++_hits;
+    return true;
+}
+
+/**
+ * insert	-	add a decoded frame and evict down to the byte budget
+ *
+ */
+void FrameCache::insert(long index, const cv::Mat &frame)
+{
+    QMutexLocker lock(&_mutex);
+    if (_frames.find(index) != _frames.end())
+        return;
+    _lru.push_front(index);
+    CacheEntry &e = _frames[index];
+    e.frame = frame;
+    e.lru = _lru.begin();
+    _bytes += frame.total() * frame.elemSize();
+    evict();
+}
+
+bool FrameCache::contains(long index)
+{
+    QMutexLocker lock(&_mutex);
+    return _frames.find(index) != _frames.end();
+}
+
+/**
+ * decode	-	decode one frame, seeking only when the decoder is not
+ *              already positioned on it.  Needs _decodeMutex.
+ *
+ */
+bool FrameCache::decode(long index, cv::Mat &frame)
+{
+    frame = cv::Mat();   // never reuse a buffer the cache still holds
+    if (!_capture.isOpened())
+        return false;
+    if (index != _decodePos)
+    {
+        if (!_capture.set(CV_CAP_PROP_POS_FRAMES, index))
+            return false;
+        _decodePos = index;
+    }
+    if (!_capture.read(frame))
+        return false;
+    ++_decodePos;
+    return true;
+}
+
+/**
+ * nextMissing	-	pick the next frame of the window to prefetch.
+ *                  Needs _mutex.
+ *
+ * Frames ahead come first, in order, so the decoder keeps reading
+ * sequentially; frames behind are filled from the lowest one up for the
+ * same reason.
+ *
+ * @return True if there is something to decode. False otherwise
+ */
+bool FrameCache::nextMissing(long *index)
+{
+    if (_center < 0)
+        return false;
+
+    long i;
+    long last = std::min(_center + _readAhead, _length - 1);
+    for (i = _center; i <= last; ++i)
+    {
+        if (_frames.find(i) == _frames.end())
+        {
+            *index = i;
+            return true;
+        }
+    }
+    for (i = std::max(_center - _readBehind, 0L); i < _center; ++i)
+    {
+        if (_frames.find(i) == _frames.end())
+        {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * evict	-	drop least recently used frames until under budget.
+ *              Frames of the prefetch window are pinned, otherwise a
+ *              window larger than the budget would be decoded over and
+ *              over.  Needs _mutex.
+ *
+ */
+void FrameCache::evict()
+{
+    std::list<long>::iterator it = _lru.end();
+    while (_bytes > _byteBudget && it != _lru.begin())
+    {
+        --it;
+        if (_center >= 0 && *it >= _center - _readBehind
+                && *it <= _center + _readAhead)
+            continue;
+        std::map<long, CacheEntry>::iterator e = _frames.find(*it);
+        _bytes -= e->second.frame.total() * e->second.frame.elemSize();
+        _frames.erase(e);
+        it = _lru.erase(it);
+    }
+}
+
+void FrameCache::stopPrefetch()
+{
+    if (!isRunning())
+        return;
+    _mutex.lock();
+    _quit = true;
+    _wake.wakeAll();
+    _mutex.unlock();
+    wait();
+}
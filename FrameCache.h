@@ -0,0 +1,102 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+// Random-access cache of decoded frames in front of a cv::VideoCapture.
+//
+// Frames are kept in an LRU list bounded by a byte budget and keyed by frame
+// index.  A miss is decoded on the caller's thread; every access also moves
+// the prefetch window so the background decoder fills read-ahead and
+// read-behind frames while the caller is busy with the current one.
+//
+// Returned frames share their data with the cache, clone before writing
+// into them.
+class FrameCache : public QThread
+{
+public:
+
+    FrameCache(size_t byteBudget = 512 * 1024 * 1024,
+               int readAhead = 8, int readBehind = 2);
+    ~FrameCache();
+
+    // open the video file, drops every cached frame
+    bool open(const std::string &fileName);
+
+    // stop prefetching and release the decoder
+    void close();
+
+    bool isOpened();
+
+    // number of frames in the video
+    long getLength() const { return _length; }
+
+    // name of the open video, empty if none
+    const std::string &getFileName() const { return _fileName; }
+
+    // get frame #index, decoding it if it is not cached yet
+    bool getFrame(long index, cv::Mat &frame);
+
+    // only warm up the neighbourhood of #index
+    void prefetch(long index);
+
+    // drop every cached frame
+    void clear();
+
+    void setByteBudget(size_t byteBudget);
+    void setPrefetchWindow(int readAhead, int readBehind);
+
+    // statistics
+    long getHits() const { return _hits; }
+    long getMisses() const { return _misses; }
+    size_t getBytes() const { return _bytes; }
+
+protected:
+    virtual void run();  // prefetch thread
+
+private:
+
+    struct CacheEntry
+    {
+        cv::Mat frame;
+        std::list<long>::iterator lru;
+    };
+
+    // the decoder, only touched while holding _decodeMutex
+    cv::VideoCapture _capture;
+    // index of the frame the next _capture.read() returns
+    long _decodePos;
+    long _length;
+    std::string _fileName;
+
+    std::map<long, CacheEntry> _frames;
+    std::list<long> _lru;       // most recently used first
+    size_t _bytes, _byteBudget;
+
+    int _readAhead, _readBehind;
+    long _center;               // prefetch window center, -1 if idle
+    bool _quit;
+
+    long _hits, _misses;
+
+    QMutex _mutex;              // guards the map, LRU list and window
+    QMutex _decodeMutex;        // guards _capture and _decodePos
+    QWaitCondition _wake;
+
+    bool lookup(long index, cv::Mat &frame);
+    void insert(long index, const cv::Mat &frame);
+    bool contains(long index);
+    bool decode(long index, cv::Mat &frame);
+    bool nextMissing(long *index);
+    void evict();
+    void stopPrefetch();
+};
+
+#endif // FRAMECACHE_H
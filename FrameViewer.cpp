@@ -6,24 +6,50 @@
 #include <GL/glu.h>
 #endif
 #include <assert.h>
+#include <string.h>
 #define DEFAULT_WIDTH 620
 #define DEFAULT_HEIGHT 410
 
+// GL 1.2 names missing from some gl.h
+#ifndef GL_BGR
+#define GL_BGR 0x80E0
+#endif
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
 FrameViewer::FrameViewer(QWidget *parent):
     _w(DEFAULT_WIDTH), _h(DEFAULT_HEIGHT),
     QGLWidget(QGLFormat::defaultFormat(),parent)
 {
     roto = NULL;
     _module = NULL;
+    _frames = NULL;
     _zoom = 1.f;
     _center.Set(_w / 2.f, _h / 2.f);
-    QImage buf(DEFAULT_WIDTH,DEFAULT_HEIGHT, QImage::Format_RGB888);
-    _glback = QGLWidget::convertToGLFormat(buf);
+    _newFrame = false;
+    _texture = 0;
+    _texW = _texH = 0;
+    _pbo[0] = _pbo[1] = NULL;
+    _nextPbo = 0;
 }
 
-void FrameViewer::setUpModules(cv::VideoCapture *capture, int videoLength)
+FrameViewer::~FrameViewer()
 {
-    roto = new RotoscopeModule(this, capture, videoLength);
+    makeCurrent();
+    delete _pbo[0];
+    delete _pbo[1];
+    if (_texture)
+        glDeleteTextures(1, &_texture);
+}
+
+void FrameViewer::setUpModules(FrameCache *frames, int videoLength)
+{
+    _frames = frames;
+    roto = new RotoscopeModule(this, frames, videoLength);
     draw = new DrawModule(this, videoLength);
     _module = roto;
 }
@@ -33,15 +59,86 @@ void FrameViewer::changeModules(InterModule *module)
     _module = module;
 }
 
-void FrameViewer::showFrame(long index, QImage &frame)
+void FrameViewer::showFrame(long index, const cv::Mat &frame)
 {
-    QImage buf = frame.scaled(_w,_h);
-    _glback = QGLWidget::convertToGLFormat(buf);
+    _frame = frame;
+    _newFrame = true;
     if(_module!=NULL)
         _module->frameChange((int)index);
     updateGL();
 }
 
+void FrameViewer::showFrame(long index)
+{
+    cv::Mat frame;
+    if (_frames == NULL || !_frames->getFrame(index, frame))
+        return;
+    showFrame(index, frame);
+}
+
+// Copy the new frame into the next pixel buffer and start its upload to
+// the texture; GL swizzles BGR on the way.  Without pixel buffers the
+// frame is uploaded straight from its rows.
+void FrameViewer::uploadFrame()
+{
+    if (!_newFrame)
+        return;
+    _newFrame = false;
+
+    const cv::Mat &f = _frame;
+    const GLenum format = f.channels() == 1 ? GL_LUMINANCE
+            : f.channels() == 4 ? GL_BGRA : GL_BGR;
+    const int rowBytes = f.cols * f.elemSize();
+
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    if (f.cols != _texW || f.rows != _texH)
+    {
+        _texW = f.cols;
+        _texH = f.rows;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, _texW, _texH, 0, format,
+                GL_UNSIGNED_BYTE, NULL);
+    }
+
+    const unsigned char *pixels = f.data;
+    int rowLength = f.step / f.elemSize();
+    QGLBuffer *pbo = _pbo[_nextPbo];
+    _nextPbo = 1 - _nextPbo;
+    if (pbo != NULL)
+    {
+        pbo->bind();
+        // new storage, the old one may still be read by the last upload
+        pbo->allocate(rowBytes * f.rows);
+        unsigned char *dst = (unsigned char*) pbo->map(QGLBuffer::WriteOnly);
+        if (dst != NULL)
+        {
+            if (f.isContinuous())
+                memcpy(dst, f.data, rowBytes * f.rows);
+            else
+                for (int y = 0; y < f.rows; ++y)
+                    memcpy(dst + y * rowBytes, f.ptr<unsigned char>(y), rowBytes);
+            pbo->unmap();
+            pixels = NULL; // offset 0 in the buffer
+            rowLength = 0;
+        }
+        else
+        {
+            pbo->release();
+            pbo = NULL;
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _texW, _texH, format,
+            GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    if (pbo != NULL)
+        pbo->release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // the texture has it now, let the cache drop it
+    _frame.release();
+}
+
 void FrameViewer::initializeGL()
 {
     glClearColor(1.0, 1.0, 1.0, 0.0);
@@ -54,8 +151,27 @@ void FrameViewer::initializeGL()
     glClearStencil(0x0);
     glDisable (GL_STENCIL_TEST);
     glLineStipple(2, 0xAAAA);
-    _backDlist = glGenLists(1);
     glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+
+    glGenTextures(1, &_texture);
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        _pbo[i] = new QGLBuffer(QGLBuffer::PixelUnpackBuffer);
+        _pbo[i]->setUsagePattern(QGLBuffer::StreamDraw);
+    }
+    if (!_pbo[0]->create() || !_pbo[1]->create())
+    {
+        delete _pbo[0];
+        delete _pbo[1];
+        _pbo[0] = _pbo[1] = NULL;
+    }
 }
 
 void FrameViewer::resizeGL(int width, int height)
@@ -64,24 +180,12 @@ void FrameViewer::resizeGL(int width, int height)
     _h = height;
     AbstractPath::_globalh = _h;
     _center.Set(_w / 2.f, _h / 2.f);
-    QImage buf = _glback.scaled(width,height);
-    _glback = QGLWidget::convertToGLFormat(buf);
     glMatrixMode (GL_PROJECTION);
     glLoadIdentity();
     gluOrtho2D(0.0f, (GLfloat) width, 0.0f, (GLfloat) height);
     glMatrixMode (GL_MODELVIEW);
     myGlLoadIdentity();
     glViewport(0, 0, width, height);
-    createDlist();
-}
-
-void FrameViewer::createDlist()
-{
-    glNewList(_backDlist, GL_COMPILE);
-    glClear (GL_COLOR_BUFFER_BIT);
-    glRasterPos2i(0, _h);
-    glDrawPixels(_w, _h, GL_RGBA, GL_UNSIGNED_BYTE, _glback.bits());
-    glEndList();
 }
 
 void FrameViewer::myGlLoadIdentity()
@@ -97,26 +201,28 @@ void FrameViewer::paintGL()
     zoomUpdateGL();
 
     glClear (GL_COLOR_BUFFER_BIT);
-    glPushMatrix();
-    glLoadIdentity(); // we'll do this in GL space
-
-    Vec2f myCenter(_center.x(), float(_h) - _center.y());
-    Vec2f fd(_w, _h); // float dimensions
-    Vec2f lowerLeft(myCenter.x() - fd.x() / (2.f * _zoom),
-            myCenter.y() - fd.y() / (2.f * _zoom));
-    glRasterPos2f(MAX(fd.x() / 2.f - myCenter.x() * _zoom, 0),
-            MAX(fd.y() / 2.f - myCenter.y() * _zoom, 0));
+    uploadFrame();
 
-    glPopMatrix();
-    lowerLeft.Clamp(0, _w, _h);
-    int offset = 4
-            * (int(lowerLeft.y()) * _w + (int) lowerLeft.x());
-
-    assert((int) lowerLeft.y() < _h);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, _w);
-    glDrawPixels(_w - (int) ceil(lowerLeft.x()),
-            _h - (int) ceil(lowerLeft.y()), GL_RGBA,
-            GL_UNSIGNED_BYTE, _glback.bits() + offset);
+    if (_texW > 0)
+    {
+        // the frame stretched over the widget, zoomed and panned with the
+        // curves by the modelview
+        glColor3f(1.f, 1.f, 1.f);
+        glBindTexture(GL_TEXTURE_2D, _texture);
+        glEnable(GL_TEXTURE_2D);
+        glBegin(GL_QUADS);
+        glTexCoord2f(0.f, 0.f);
+        glVertex2f(0.f, 0.f);
+        glTexCoord2f(1.f, 0.f);
+        glVertex2f(_w, 0.f);
+        glTexCoord2f(1.f, 1.f);
+        glVertex2f(_w, _h);
+        glTexCoord2f(0.f, 1.f);
+        glVertex2f(0.f, _h);
+        glEnd();
+        glDisable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
     assert(!glGetError());
 
     if(_module!=NULL)
@@ -170,7 +276,6 @@ void FrameViewer::wheelEvent(QWheelEvent *e)
                     lowerLeft.y() + float(e->y()) / zoomLast);
             //_off = true;
             //_draw->reportZoom(_zoom);
-            glPixelZoom(_zoom, _zoom);
             zoomUpdateGL();
             updateGL();
         }
@@ -181,7 +286,6 @@ void FrameViewer::resetZoom()
 {
     _zoom = 1.f;
     //_draw->reportZoom(_zoom);
-    glPixelZoom(_zoom, _zoom);
     _center.Set(_w / 2.f, _h / 2.f);
     //_off = false;
     myGlLoadIdentity();
@@ -0,0 +1,217 @@
+/*********************************************************************
+ * Convolve.cpp
+ *********************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+#include "Convolve.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define KLT_VLEN 8
+typedef __m256 vfloat;
+#define vzero()         _mm256_setzero_ps()
+#define vset1(a)        _mm256_set1_ps(a)
+#define vload(p)        _mm256_loadu_ps(p)
+#define vstore(p, a)    _mm256_storeu_ps(p, a)
+#define vmuladd(s, a, b) _mm256_add_ps(s, _mm256_mul_ps(a, b))
+#define KLT_ISA "AVX"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KLT_VLEN 4
+typedef __m128 vfloat;
+#define vzero()         _mm_setzero_ps()
+#define vset1(a)        _mm_set1_ps(a)
+#define vload(p)        _mm_loadu_ps(p)
+#define vstore(p, a)    _mm_storeu_ps(p, a)
+#define vmuladd(s, a, b) _mm_add_ps(s, _mm_mul_ps(a, b))
+#define KLT_ISA "SSE2"
+#else
+#define KLT_ISA "scalar"
+#endif
+
+// multiply and add are kept separate (no FMA) so every lane rounds the
+// same way the scalar loops always did
+
+// reversed so that tap m multiplies pixel (i - radius + m)
+static void reverseKernel(const ConvolutionKernel* kernel, float* krev)
+{
+    assert(kernel->width % 2 == 1);
+    for (int m = 0; m < kernel->width; ++m)
+        krev[m] = kernel->data[kernel->width - 1 - m];
+}
+
+static void horizRow(const float* row, const int ncols, const float* krev,
+        const int width, float* out)
+{
+    const int radius = width / 2;
+    const int end = ncols - radius;
+    int i = 0, m;
+
+    if (end <= radius)
+    {
+        memset(out, 0, ncols * sizeof(float));
+        return;
+    }
+
+    /* Zero leftmost columns */
+    for (; i < radius; ++i)
+        out[i] = 0.0f;
+
+    /* Convolve middle columns with kernel */
+#ifdef KLT_VLEN
+    for (; i + KLT_VLEN <= end; i += KLT_VLEN)
+    {
+        const float* p = row + i - radius;
+        vfloat acc = vzero();
+        for (m = 0; m < width; ++m)
+            acc = vmuladd(acc, vload(p + m), vset1(krev[m]));
+        vstore(out + i, acc);
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        const float* p = row + i - radius;
+        float sum = 0.0f;
+        for (m = 0; m < width; ++m)
+            sum += p[m] * krev[m];
+        out[i] = sum;
+    }
+
+    /* Zero rightmost columns */
+    for (; i < ncols; ++i)
+        out[i] = 0.0f;
+}
+
+// rows[m] is the input row (j - radius + m) of output row j
+static void vertRow(const float* const * rows, const int ncols,
+        const float* krev, const int width, float* out)
+{
+    int i = 0, m;
+#ifdef KLT_VLEN
+    for (; i + KLT_VLEN <= ncols; i += KLT_VLEN)
+    {
+        vfloat acc = vzero();
+        for (m = 0; m < width; ++m)
+            acc = vmuladd(acc, vload(rows[m] + i), vset1(krev[m]));
+        vstore(out + i, acc);
+    }
+#endif
+    for (; i < ncols; ++i)
+    {
+        float sum = 0.0f;
+        for (m = 0; m < width; ++m)
+            sum += rows[m][i] * krev[m];
+        out[i] = sum;
+    }
+}
+
+// rows of the horizontal pass, only as many as the vertical kernel spans
+class RowRing
+{
+public:
+    RowRing(const int size, const int ncols) :
+            _size(size), _ncols(ncols), _buf(size * ncols)
+    {
+    }
+    float* row(const int r)
+    {
+        return &_buf[(r % _size) * _ncols];
+    }
+private:
+    int _size, _ncols;
+    std::vector<float> _buf;
+};
+
+void KLTConvolveSeparate(const float* in, int ncols, int nrows,
+        const ConvolutionKernel* horiz, const ConvolutionKernel* vert,
+        float* out)
+{
+    float hrev[MAX_KERNEL_WIDTH], vrev[MAX_KERNEL_WIDTH];
+    const float* rows[MAX_KERNEL_WIDTH];
+    const int vw = vert->width, vr = vert->width / 2;
+    int j, m, next = 0;
+
+    assert(in != out);
+    reverseKernel(horiz, hrev);
+    reverseKernel(vert, vrev);
+
+    /* Zero topmost and bottommost rows */
+    if (nrows - vr <= vr)
+    {
+        memset(out, 0, ncols * nrows * sizeof(float));
+        return;
+    }
+    memset(out, 0, vr * ncols * sizeof(float));
+    memset(out + (nrows - vr) * ncols, 0, vr * ncols * sizeof(float));
+
+    RowRing ring(vw, ncols);
+    for (j = vr; j < nrows - vr; ++j)
+    {
+        for (; next <= j + vr; ++next)
+            horizRow(in + next * ncols, ncols, hrev, horiz->width,
+                    ring.row(next));
+        for (m = 0; m < vw; ++m)
+            rows[m] = ring.row(j - vr + m);
+        vertRow(rows, ncols, vrev, vw, out + j * ncols);
+    }
+}
+
+void KLTConvolveGradients(const float* in, int ncols, int nrows,
+        const ConvolutionKernel* gauss, const ConvolutionKernel* deriv,
+        float* gradx, float* grady)
+{
+    float grev[MAX_KERNEL_WIDTH], drev[MAX_KERNEL_WIDTH];
+    const float* rows[MAX_KERNEL_WIDTH];
+    const int gw = gauss->width, gr = gauss->width / 2;
+    const int dw = deriv->width, dr = deriv->width / 2;
+    const int rmax = gr > dr ? gr : dr;
+    int j, m, next = 0;
+
+    assert(in != gradx && in != grady);
+    reverseKernel(gauss, grev);
+    reverseKernel(deriv, drev);
+
+    // gradx is vertical gauss over the horizontal derivative,
+    // grady vertical derivative over the horizontal gauss
+    RowRing hderiv(2 * rmax + 1, ncols), hgauss(2 * rmax + 1, ncols);
+    for (j = 0; j < nrows; ++j)
+    {
+        const bool xok = j >= gr && j < nrows - gr;
+        const bool yok = j >= dr && j < nrows - dr;
+
+        if (xok || yok)
+        {
+            for (; next <= j + rmax && next < nrows; ++next)
+            {
+                const float* row = in + next * ncols;
+                horizRow(row, ncols, drev, dw, hderiv.row(next));
+                horizRow(row, ncols, grev, gw, hgauss.row(next));
+            }
+        }
+
+        if (xok)
+        {
+            for (m = 0; m < gw; ++m)
+                rows[m] = hderiv.row(j - gr + m);
+            vertRow(rows, ncols, grev, gw, gradx + j * ncols);
+        }
+        else
+            memset(gradx + j * ncols, 0, ncols * sizeof(float));
+
+        if (yok)
+        {
+            for (m = 0; m < dw; ++m)
+                rows[m] = hgauss.row(j - dr + m);
+            vertRow(rows, ncols, drev, dw, grady + j * ncols);
+        }
+        else
+            memset(grady + j * ncols, 0, ncols * sizeof(float));
+    }
+}
+
+const char* KLTConvolveISA()
+{
+    return KLT_ISA;
+}
@@ -0,0 +1,36 @@
+/*********************************************************************
+ * Convolve.h
+ *
+ * Separable convolution engine behind KLT_FloatImage.
+ *
+ * Both passes run over rows: the horizontal pass fills a ring of rows
+ * as tall as the vertical kernel, and each output row is produced from
+ * that ring as soon as its rows are in, so the vertical pass no longer
+ * walks columns with a stride of ncols.  Inner loops are vectorized with
+ * AVX or SSE when the compiler targets them, with a scalar fallback.
+ *
+ * Results match the original horizontal-then-vertical passes exactly:
+ * same summation order, and the borders the kernels do not fit in are
+ * zeroed.
+ *********************************************************************/
+
+#ifndef _CONVOLVE_H_
+#define _CONVOLVE_H_
+
+#include "Kernels.h"
+
+// out = vert * (horiz * in), images are ncols x nrows, row-major
+void KLTConvolveSeparate(const float* in, int ncols, int nrows,
+        const ConvolutionKernel* horiz, const ConvolutionKernel* vert,
+        float* out);
+
+// gradx = gauss * (deriv * in) and grady = deriv * (gauss * in) in one
+// sweep over the image, sharing the horizontal passes
+void KLTConvolveGradients(const float* in, int ncols, int nrows,
+        const ConvolutionKernel* gauss, const ConvolutionKernel* deriv,
+        float* gradx, float* grady);
+
+// name of the instruction set the engine was built for
+const char* KLTConvolveISA();
+
+#endif
@@ -25,6 +25,35 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define DIAG_VLEN 4
+typedef __m256d vdouble;
+#define vload(p)        _mm256_loadu_pd(p)
+#define vstore(p, a)    _mm256_storeu_pd(p, a)
+#define vmuladd(s, a, b) _mm256_add_pd(s, _mm256_mul_pd(a, b))
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIAG_VLEN 2
+typedef __m128d vdouble;
+#define vload(p)        _mm_loadu_pd(p)
+#define vstore(p, a)    _mm_storeu_pd(p, a)
+#define vmuladd(s, a, b) _mm_add_pd(s, _mm_mul_pd(a, b))
+#endif
+
+// r[j] += d[j] * x[j] over one stretch of a diagonal
+static void mulAddStream(double* r, const double* d, const double* x,
+        const uint n)
+{
+    uint j = 0;
+#ifdef DIAG_VLEN
+    for (; j + DIAG_VLEN <= n; j += DIAG_VLEN)
+        vstore(r + j, vmuladd(vload(r + j), vload(d + j), vload(x + j)));
+#endif
+    for (; j < n; ++j)
+        r[j] += d[j] * x[j];
+}
+
 DiagMatrix::DiagMatrix(uint nv, uint width) :
         _nv(nv), _maxWidth(width)
 {
@@ -34,66 +63,29 @@ DiagMatrix::DiagMatrix(uint nv, uint width) :
     _diags = new Ubv[_maxWidth];
 }
 
-// SPEED:  get rid of brackets, use iterators, pointer de-references
+// Each diagonal is streamed twice, reflection first: r[di+dj] picks up the
+// reflected term at dj before the direct one at di+dj, so this adds into
+// every r[i] in the same order as the old interleaved loop and gives the
+// same result bit for bit.
 void DiagMatrix::matVecMult(const double* x, double* r) const
 {
     memset(r, 0, _nv * sizeof(double));
-    uint di = 0, dj, s;
-    // do main diagonal separately because no reflection
-
-    /*
-     uint s=0;
-     const Ubv& d = _diags[di];
-     s = d.size();
-     for (dj=0; dj<s; ++dj)
-     r[dj] += d[dj] * x[di+dj];
-
-     // other diagonals
-     for (di=1; di<_maxWidth; ++di) {
-     const Ubv& d = _diags[di];
-
-     s = d.size();
-     for (dj=0; dj<s; ++dj) {
-     r[dj]    += d[dj] * x[di+dj];
-     r[di+dj] += d[dj] * x[dj];    // reflection
-     }
-     }
-     */
 
-    const Ubv& d = _diags[di];
-    Ubv::const_iterator itj, dend;
-    const double *xptr, *r_xptr;
-    double *rptr, *r_rptr;
-
-    //dend = d.end();
-    s = d.size();
-    dj = 0;
-    rptr = r;
-    xptr = x + di;
-    for (itj = d.begin(); dj < s; ++itj, ++rptr, ++xptr, ++dj)
-        *rptr += *itj * *xptr;
+    // main diagonal separately because no reflection
+    const Ubv& d0 = _diags[0];
+    if (d0.size())
+        mulAddStream(r, &d0[0], x, d0.size());
 
     // other diagonals
-    for (di = 1; di < _maxWidth; ++di)
+    for (uint di = 1; di < _maxWidth; ++di)
     {
         const Ubv& d = _diags[di];
-
-        //dend = d.end();
-        s = d.size();
-        dj = 0;
-        rptr = r;
-        xptr = x + di;
-        r_rptr = r + di;
-        r_xptr = x;
-
-        for (itj = d.begin(); dj < s;
-                ++itj, ++rptr, ++xptr, ++r_rptr, ++r_xptr, ++dj)
-        {
-            *rptr += *itj * *xptr;
-            *r_rptr += *itj * *r_xptr; // reflection
-        }
+        const uint s = d.size();
+        if (!s)
+            continue;
+        mulAddStream(r + di, &d[0], x, s); // reflection
+        mulAddStream(r, &d[0], x + di, s);
     }
-
 }
 
 void DiagMatrix::operator+=(const DiagMatrix &o)
@@ -131,6 +123,15 @@ const double& DiagMatrix::operator ()(const uint i, const uint j) const
     return d[dj];
 }
 
+double DiagMatrix::value(const uint i, const uint j) const
+{
+    assert(i < _nv && j < _nv && j >= i);
+    const uint di = j - i;
+    if (di >= _maxWidth || _diags[di].size() == 0)
+        return 0;
+    return _diags[di][i];
+}
+
 // modification
 double& DiagMatrix::operator ()(const uint i, const uint j)
 {
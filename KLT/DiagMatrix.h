@@ -52,6 +52,21 @@ public:
 
     double& operator ()(const uint i, const uint j);
 
+    // entry (i,j), j >= i, 0 when outside the stored diagonals
+    double value(const uint i, const uint j) const;
+
+    // diagonal di (0 main) as a contiguous run of dim() - di entries, or
+    // NULL if nothing was stored on it
+    const double* diagonal(const uint di) const
+    {
+        return di < _maxWidth && _diags[di].size() ? &_diags[di][0] : NULL;
+    }
+
+    uint maxWidth() const
+    {
+        return _maxWidth;
+    }
+
     void takeF(const int i, const int j, const double f);
     // unknown ordering of i,j
     void takeUnrdF(const int i, const int j, const double f);
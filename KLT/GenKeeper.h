@@ -41,6 +41,10 @@ public:
     {
         return 0;
     }
+    // called once the matrix is built, before precondVec
+    virtual void setupPrecond()
+    {
+    }
     virtual void precondVec(double*)
     {
     }
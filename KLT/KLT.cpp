@@ -116,6 +116,7 @@ KLT_FullPyramid::~KLT_FullPyramid()
 KLT_FullCPyramid::KLT_FullCPyramid()
 {
     img = gradx = grady = NULL;
+    packed = NULL;
     nPyramidLevels = -1;
 }
 
@@ -123,6 +124,7 @@ KLT_FullCPyramid::KLT_FullCPyramid(const QImage im,
         const KLT_TrackingContext* tc)
 {
     img = gradx = grady = NULL;
+    packed = NULL;
     nPyramidLevels = -1;
     initMe(im, tc);
 }
@@ -154,6 +156,7 @@ void KLT_FullCPyramid::initMe(const QImage im, const KLT_TrackingContext* tc)
     }
     nPyramidLevels = tc->nPyramidLevels;
     assert(img && gradx && grady);
+    pack(!tc->packedPyramids);
 }
 
 KLT_FullCPyramid::~KLT_FullCPyramid()
@@ -164,6 +167,49 @@ KLT_FullCPyramid::~KLT_FullCPyramid()
         delete gradx;
         delete grady;
     }
+    delete packed;
+}
+
+void KLT_FullCPyramid::pack(const bool keepPlanes)
+{
+    assert(img && gradx && grady && !packed);
+    packed = new KLT_PackedCPyramid(img, gradx, grady);
+    if (keepPlanes)
+        return;
+
+    delete img;
+    delete gradx;
+    delete grady;
+    img = new KLT_ColorPyramid(packed, 0);
+    gradx = new KLT_ColorPyramid(packed, 3);
+    grady = new KLT_ColorPyramid(packed, 6);
+}
+
+size_t KLT_FullCPyramid::bytes() const
+{
+    if (!img)
+        return 0;
+    return img->bytes() + gradx->bytes() + grady->bytes()
+            + (packed ? packed->bytes() : 0);
+}
+
+void KLT_FullCPyramid::sample(const int level, const int n, const float* xs,
+        const float* ys, Vec3f* col, Vec3f* gx, Vec3f* gy, int* status) const
+{
+    if (packed)
+    {
+        packed->sample(level, n, xs, ys, col, gx, gy, status);
+        return;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        status[i] = img->color(xs[i], ys[i], level, col[i]);
+        if (status[i] == 0)
+        {
+            gradx->color(xs[i], ys[i], level, gx[i]);
+            grady->color(xs[i], ys[i], level, gy[i]);
+        }
+    }
 }
 
 void KLT_FullCPyramid::write(FILE* fp) const
@@ -188,6 +234,7 @@ bool KLT_FullCPyramid::load(FILE* fp, const KLT_TrackingContext* tc)
     img = new KLT_ColorPyramid(fp);
     gradx = new KLT_ColorPyramid(fp);
     grady = new KLT_ColorPyramid(fp);
+    pack(!tc->packedPyramids);
     return true;
 }
 
@@ -269,7 +316,12 @@ void KLT_TrackingContext::mutualInit()
     usePseudo = false;
     printSingulars = false;
     dumpWindows = false;
+    verbose = false;
     D2mode = 0; //  0 for original, 1 for new
+    assemblyThreads = 0;
+    packedPyramids = true;
+    preconditioner = KLT_PRECOND_HB;
+    adaptiveLevels = true;
     // checkWindow(); // not necessary while window is 13
     _stateOk = true;
     //_A = NULL; // DEBUG
@@ -306,7 +358,12 @@ void KLT_TrackingContext::copySettings(const KLT_TrackingContext* o)
     usePseudo = o->usePseudo;
     printSingulars = o->printSingulars;
     dumpWindows = o->dumpWindows;
+    verbose = o->verbose;
     D2mode = o->D2mode; //  0 for original, 1 for new
+    assemblyThreads = o->assemblyThreads;
+    packedPyramids = o->packedPyramids;
+    preconditioner = o->preconditioner;
+    adaptiveLevels = o->adaptiveLevels;
     // checkWindow(); // not necessary while window is 13
     _stateOk = o->_stateOk;
     //_A = NULL; // DEBUG
@@ -921,7 +978,7 @@ void KLT_TrackingContext::projectToTR2(double *x, const double* d,
 }
 
 // PASSED in error is pointer.  NULL for nonlinear.  Otherwise, the actual error
-#define DELETE_SS delete[] p; delete[] r; delete[] d; delete[] Bd; delete[] pn;
+// The vectors come from _solverWork, so repeated solves allocate nothing.
 int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
         const double trustRadius, bool* boundaryHit, double* error2ptr)
 {
@@ -931,8 +988,9 @@ int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
 
     int maxIter = 5000;
     int n = B->numVar(), j = 0;
-    double *p = new double[n], *r = new double[n], *d = new double[n], *Bd =
-            new double[n], *pn = new double[n];
+    double *p = _solverWork.vec(0, n), *r = _solverWork.vec(1, n), *d =
+            _solverWork.vec(2, n), *Bd = _solverWork.vec(3, n), *pn =
+            _solverWork.vec(4, n);
     const double* g = B->g();
     double dBd, rr, alpha, beta, rrn, tmp;
     //double error2;
@@ -964,7 +1022,10 @@ int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
     B->handleConstraints(r);
     vecAssign(n, d, r);
     if (B->precond())
+    {
+        B->setupPrecond();
         B->precondVec(d);
+    }
 
     //vecAssign(n, r, g);
     //B->matVecMult(x, Bd);
@@ -976,8 +1037,6 @@ int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
     {
         vecAssign(n, x, p);
         printf("error2 low %f, inner converge\n", tmp);
-        DELETE_SS
-        ;
         *error2ptr = tmp;
         return 0;
     }
@@ -996,17 +1055,13 @@ int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
             assert(0);
             *boundaryHit = true;
             projectToTR2(x, d, p, trustRadius, n);
-            DELETE_SS
-            ;
             printf("solved in %d  iterations \n", j);
             *error2ptr = tmp;
             return j;
         }
 
         alpha = rr / dBd;
-        vecAssign(n, pn, d);
-        vecTimesScalar(n, pn, alpha);
-        vecAddEqual(n, pn, p);
+        vecAxpy(n, pn, alpha, d, p);
 
         //if (vecSqrLen(n,pn) >= trustRadius*trustRadius) {
 
@@ -1017,15 +1072,12 @@ int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
             *boundaryHit = true;
             projectToTR2(x, d, p, trustRadius, n);
             //sanityCheck(n,x);
-            DELETE_SS
-            ;
             printf("solved in %d  iterations \n", j);
             *error2ptr = tmp;
             return j;
         }
 
-        vecTimesScalar(n, Bd, alpha); // Bd now alpha*Bd
-        vecDiffEqual(n, r, Bd);
+        vecAxpy(n, r, -alpha, Bd, r);
         B->handleConstraints(r);
         //printf("iteration %d, error %f\n",j,vecSqrLen(n,r));
 
@@ -1040,8 +1092,6 @@ int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
             //vecPrint(n,x);
             printf("solved in %d  iterations \n", j);
             printf("%d time taken to solve\n", time.elapsed());
-            DELETE_SS
-            ;
             *error2ptr = tmp;
             return j;
         }
@@ -1051,8 +1101,7 @@ int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
             rrn = vecDot(n, r, r);
             beta = rrn / rr;
             rr = rrn;
-            vecTimesScalar(n, d, beta);
-            vecAddEqual(n, d, r);
+            vecAxpy(n, d, beta, d, r);
         }
         else
         {
@@ -1061,8 +1110,7 @@ int KLT_TrackingContext::steihaugSolver(GenKeeper* B, double* x,
             rrn = vecDot(n, r, Bd);
             beta = rrn / rr;
             rr = rrn;
-            vecTimesScalar(n, d, beta);
-            vecAddEqual(n, d, Bd);
+            vecAxpy(n, d, beta, d, Bd);
         }
 
         vecAssign(n, p, pn);
@@ -58,6 +58,7 @@ typedef SplineKeeper CSplineKeeper;
 #define KLT_LARGE_RESIDUE    -5
 
 #include "Pyramid.h"
+#include "PackedPyramid.h"
 
 enum KLT_ThreadTask
 {
@@ -101,15 +102,44 @@ public:
     bool load(FILE* fp, const KLT_TrackingContext* tc); // will return false if nlevels not same for tc
     void writeImages(char* imgname, char* gxname, char* gyname);
 
+    // build packed once img, gradx and grady are filled in.  Unless
+    // keepPlanes, the planes are freed and img, gradx and grady become
+    // views of packed.
+    void pack(const bool keepPlanes);
+
+    // memory held by the planes and the packed copy
+    size_t bytes() const;
+
+    // colour and both gradients at n locations, see KLT_PackedCPyramid
+    void sample(const int level, const int n, const float* xs,
+            const float* ys, Vec3f* col, Vec3f* gx, Vec3f* gy,
+            int* status) const;
+
     KLT_ColorPyramid* img;
     KLT_ColorPyramid* gradx;
     KLT_ColorPyramid* grady;
+    KLT_PackedCPyramid* packed;
     int nPyramidLevels;
 };
 
 void printDoubleArray(FILE* fp, const double* a, const int nrows,
         const int ncols);
 
+// what one pyramid level of a spline track did, distances in full
+// resolution pixels
+struct KLT_SplineLevelStats
+{
+    int level;
+    int steps;          // trust region steps taken
+    int rejected;       // solved for but not taken
+    int cgIterations;   // of the steihaug solves
+    int msecs;
+    double startRadius, endRadius;  // trust radius
+    double maxStep;     // largest control move of a step taken
+    double theta;       // objective at the end
+    bool skipped;       // not solved, the coarser levels had settled
+};
+
 class KLT_TrackingContext: public QThread
 {
 
@@ -187,7 +217,13 @@ public:
     bool printSingulars;
     bool usePseudo;
     bool dumpWindows;
+    bool verbose; // print every step of the spline solves
     int D2mode;
+    int assemblyThreads; // for createSplineMatrices, 0 for one per core;
+                         // TrackScheduler gives its tracks their share
+    bool packedPyramids; // keep colour pyramids in packed form only
+    int preconditioner;  // KLT_PRECOND_*, for the spline solves
+    bool adaptiveLevels; // spline tolerances by level, see splineTrack
     bool _stateOk;
 
     KLT_ThreadTask _ttask;
@@ -223,6 +259,7 @@ private:
             Vec2f& result) const;
     int steihaugSolver(GenKeeper* im, double* x, const double trustRadius,
             bool* boundaryHit, double* error2ptr = NULL); // returns # iterations
+    SolverWorkspace _solverWork;
     double createTestSolution(const Vec2f* Z, const double* sol,
             const int numVec, const int l, Vec2f* Z2);
     void projectToTR(double *x, const double* d, const double* p,
@@ -340,16 +377,13 @@ private:
     //double *_A, *_b;
     //int _n;
 
-    double mtmtran[18], mtmresult[36]; // prevents PARALLEL
-    mutable double _mstore[50];
 };
 
 inline void KLT_TrackingContext::rmmult(double *rm, double *a, double *b, int n,
         int m, int l) const
 {
-    double z, *q0, *p, *q;
+    double z, q0[50], *p, *q; // on the stack, several threads call this
     int i, j, k;
-    q0 = _mstore;
     //q0=(double *)calloc(m,sizeof(double));
     for (i = 0; i < l; ++i, ++rm)
     {
@@ -368,9 +402,8 @@ inline void KLT_TrackingContext::rmmult(double *rm, double *a, double *b, int n,
 inline void KLT_TrackingContext::rmmultplus(double *rm, double *a, double *b,
         int n, int m, int l) const
 {
-    double z, *q0, *p, *q;
+    double z, q0[50], *p, *q;
     int i, j, k;
-    q0 = _mstore;
     //q0=(double *)calloc(m,sizeof(double));
     for (i = 0; i < l; ++i, ++rm)
     {
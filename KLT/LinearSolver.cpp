@@ -25,15 +25,18 @@
 
 double ConjGrad(int n, implicitMatrix *A, double x[], const double b[],
         double epsilon, // how low should we go?
-        int *steps)
+        int *steps, SolverWorkspace *work)
 {
     int i, iMax;
     double alpha, beta, rSqrLen, rSqrLenOld, u;
 
-    double *r = (double *) malloc(sizeof(double) * n);
-    double *d = (double *) malloc(sizeof(double) * n);
-    double *t = (double *) malloc(sizeof(double) * n);
-    double *temp = (double *) malloc(sizeof(double) * n);
+    SolverWorkspace local;
+    if (!work)
+        work = &local;
+    double *r = work->vec(0, n);
+    double *d = work->vec(1, n);
+    double *t = work->vec(2, n);
+    double *temp = work->vec(3, n);
 
     printf("%d variables, grad norm : %.5f\n", n, sqrt(vecSqrLen(n, b)));
 
@@ -71,17 +74,11 @@ double ConjGrad(int n, implicitMatrix *A, double x[], const double b[],
             //printf("here %f %f\n",rSqrLen, u);
 
             // Take a step along direction d
-            vecAssign(n, temp, d);
-            vecTimesScalar(n, temp, alpha);
-            vecAddEqual(n, x, temp);
+            vecAxpy(n, x, alpha, d, x);
             //printf("next length %f\n",vecSqrLen(n,x));
 
             if (i & 0x3F)
-            {
-                vecAssign(n, temp, t);
-                vecTimesScalar(n, temp, alpha);
-                vecDiffEqual(n, r, temp);
-            }
+                vecAxpy(n, r, -alpha, t, r);
             else
             {
                 // For stability, correct r every 64th iteration
@@ -99,17 +96,9 @@ double ConjGrad(int n, implicitMatrix *A, double x[], const double b[],
 
             // Change direction: d = r + beta * d
             beta = rSqrLen / rSqrLenOld;
-            vecTimesScalar(n, d, beta);
-            vecAddEqual(n, d, r);
+            vecAxpy(n, d, beta, d, r);
         }
 
-    // free memory
-
-    free(r);
-    free(d);
-    free(t);
-    free(temp);
-
     *steps = i;
     return (rSqrLen);
 }
@@ -32,11 +32,31 @@ using namespace std;
 #include <string.h>
 #include <float.h>
 #include <assert.h>
+#include <vector>
 
 // Karen's CGD
 
 #define MAX_STEPS 1000
 
+#define SOLVER_WORKSPACE_VECS 5
+
+// Scratch vectors of a solver, kept from one solve to the next so that the
+// trust-region iterations of a track allocate nothing once warmed up
+class SolverWorkspace
+{
+public:
+        // vector i (< SOLVER_WORKSPACE_VECS) with room for n doubles
+        double* vec(const int i, const int n)
+        {
+                assert(i < SOLVER_WORKSPACE_VECS);
+                if ((int) _v[i].size() < n || _v[i].empty())
+                        _v[i].resize(n > 0 ? n : 1);
+                return &_v[i][0];
+        }
+private:
+        std::vector<double> _v[SOLVER_WORKSPACE_VECS];
+};
+
 // Matrix class the solver will accept
 class implicitMatrix
 {
@@ -65,15 +85,18 @@ public:
 // "epsilon" is the error tolerance
 // "steps", as passed, is the maximum number of steps, or 0 (implying MAX_STEPS)
 // Upon completion, "steps" contains the number of iterations taken
+// "work" holds the scratch vectors, a temporary one if NULL
 double ConjGrad(int n, implicitMatrix *A, double x[], const double b[],
                 double epsilon,	// how low should we go?
-                int *steps);
+                int *steps, SolverWorkspace *work = NULL);
 
 // Some vector helper functions
 void vecAddEqual(const int n, double r[], const double v[]);
 void vecDiffEqual(const int n, double r[], const double v[]);
 void vecAssign(const int n, double v1[], const double v2[]);
 void vecTimesScalar(const int n, double v[], const double s);
+void vecAxpy(const int n, double r[], const double a, const double x[],
+                const double y[]);
 double vecDot(const int n, const double v1[], const double v2[]);
 double vecSqrLen(const int n, const double v[]);
 double vecMax(const int n, const double v[]);
@@ -108,6 +131,14 @@ inline void vecTimesScalar(const int n, double v[], const double s)
                 v[i] *= s;
 }
 
+// r = a * x + y, r may be x or y; rounds as scaling then adding did
+inline void vecAxpy(const int n, double r[], const double a, const double x[],
+                const double y[])
+{
+        for (int i = 0; i < n; ++i)
+                r[i] = a * x[i] + y[i];
+}
+
 inline double vecDot(int n, const double v1[], const double v2[])
 {
         double dot = 0;
@@ -28,7 +28,7 @@ MultiDiagMatrix::MultiDiagMatrix(int numBlocks,
 {
     uint i;
     assert(_maxWidths.size() == _numBlocks && _dims.size() == _numBlocks);
-    _blocks.reserve(numBlocks);
+    _blocks.resize(numBlocks);
     _blockToStartVar.reserve(numBlocks);
 
     _nv = 0;
@@ -123,6 +123,20 @@ const double& MultiDiagMatrix::operator ()(const uint i, const uint j) const
     }
 }
 
+double MultiDiagMatrix::value(const uint i, const uint j) const
+{
+    assert(j >= i);
+    uint bi, bj, blockNum;
+    blockNum = convertToBlock(bi, bj, i, j);
+    const DiagMatrix& block = *(_blocks[blockNum]);
+    if (block.withinBounds(bi, bj)) // part of diagonals
+        return block.value(bi, bj);
+
+    const Ubcv& vi = _junk[i];
+    Ubcv::const_iterator it = vi.find(j - i);
+    return it != vi.end() && it.index() == j - i ? *it : 0;
+}
+
 double& MultiDiagMatrix::operator ()(const uint i, const uint j)
 {
     assert(0);
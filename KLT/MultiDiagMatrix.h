@@ -45,11 +45,29 @@ public:
 
         double& operator ()(const uint i, const uint j);
 
+        // entry (i,j), j >= i, 0 if nothing was stored there
+        double value(const uint i, const uint j) const;
+
         int dim() const
         {
                 return _nv;
         }
 
+        // the banded block of each curve and its first variable; entries
+        // outside the blocks' bands are not part of them
+        uint numBlocks() const
+        {
+                return _numBlocks;
+        }
+        const DiagMatrix& block(const uint b) const
+        {
+                return *_blocks[b];
+        }
+        uint blockStart(const uint b) const
+        {
+                return _blockToStartVar[b];
+        }
+
         void takeF(const int i, const int j, const double f);
         // unknown ordering of i,j
         void takeUnrdF(const int i, const int j, const double f);
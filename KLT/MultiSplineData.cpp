@@ -23,12 +23,21 @@
 #include "MultiSplineData.h"
 #include "MyAssert.h"
 
+#define SNAP_FRESH 4
+
 MultiSplineData::MultiSplineData()
+    : _snapMiddle(1)
 {
     //_edgemins = NULL;
     _z_mutex = new QMutex;
     _z_wait = new QWaitCondition();
     _maskw = _maskh = 0;
+    _generation = 0;
+    _snapGen[0] = _snapGen[1] = _snapGen[2] = 0;
+    _snapWrite = 0;
+    _snapRead = 2;
+    _published = NULL;
+    _publishedArg = NULL;
 }
 
 void MultiSplineData::finishInit()
@@ -505,6 +514,58 @@ int MultiSplineData::c_numVarsOneFrame(const int c) const
     return 2 * (first->finalVariable() - first->beginningVariable() + 1);
 }
 
+double MultiSplineData::estimatedCost() const
+{
+    double cost = 0;
+    int c, t, i;
+    for (c = 0; c < _nCurves; ++c)
+    {
+        // samples are taken every 2 pixels along the curve, the control
+        // polygon length is a cheap upper bound of the curve length
+        double samples = 0;
+        for (t = 0; t <= _numFrames; ++t)
+        {
+            const std::vector<Vec2f>& ctrls = getSpline(c, t)->getControls();
+            for (i = 1; i < (int) ctrls.size(); ++i)
+                samples += Vec2f(ctrls[i], ctrls[i - 1]).Len() * .5;
+        }
+        cost += samples * (_trackWidths[c].x() + _trackWidths[c].y() + 1);
+    }
+    return cost;
+}
+
+void MultiSplineData::publishControls()
+{
+    ZVec& s = _snap[_snapWrite];
+    s.clear();
+    for (int c = 0; c < _nCurves; ++c)
+        for (int t = 1; t < _numFrames; ++t)
+        {
+            int n = tc_numControls(t, c);
+            for (int i = 0; i < n; ++i)
+                s.push_back(_Z[tcn(t, c, i)]);
+        }
+    _snapGen[_snapWrite] = ++_generation;
+
+    int old = _snapMiddle.fetchAndStoreOrdered(_snapWrite | SNAP_FRESH);
+    _snapWrite = old & ~SNAP_FRESH;
+
+    if (_published)
+        _published(_publishedArg);
+}
+
+const ZVec* MultiSplineData::newControls(unsigned int* generation)
+{
+    // only the solver sets SNAP_FRESH, so once seen it stays until the swap
+    if (!(_snapMiddle.fetchAndAddOrdered(0) & SNAP_FRESH))
+        return NULL;
+    int old = _snapMiddle.fetchAndStoreOrdered(_snapRead);
+    _snapRead = old & ~SNAP_FRESH;
+    if (generation)
+        *generation = _snapGen[_snapRead];
+    return &_snap[_snapRead];
+}
+
 void MultiSplineData::transferThreadStuff(MultiSplineData* o)
 {
     delete _z_mutex;
@@ -25,6 +25,7 @@
 #include <QMutex>
 #include <vector>
 #include <QWaitCondition>
+#include <QAtomicInt>
 #include "BezSpline.h"
 #include "ContCorr.h"
 #include "jl_vectors.h"
@@ -147,6 +148,29 @@ public:
 
     void transferThreadStuff(MultiSplineData* o);
 
+    // Control points of the in-betweens for other threads, curve by curve
+    // and frame by frame within a curve, as of the last step the solver
+    // took.  There are three buffers: publishControls() fills the solver's
+    // own and swaps it with the middle one, newControls() swaps the
+    // reader's own with the middle one if that holds a snapshot not taken
+    // yet.  Neither side waits for the other or sees a buffer being filled.
+
+    // solver thread, calls the published callback after
+    void publishControls();
+    // reader thread, the newest snapshot or NULL if there is none since the
+    // last call.  It stays valid until the next call.
+    const ZVec* newControls(unsigned int* generation = NULL);
+    // cb(arg) from the solver thread whenever a snapshot is published
+    void setPublishedCallback(void (*cb)(void*), void* arg)
+    {
+        _published = cb;
+        _publishedArg = arg;
+    }
+
+    // rough amount of work for one solve: curves x frames x samples x window,
+    // used to order components when scheduling them
+    double estimatedCost() const;
+
     void transferEdgeMins(MultiSplineData* o);
 
     const FixedControlV& getFixedLocs() const
@@ -195,6 +219,15 @@ public:
     QMutex* _z_mutex;
     QWaitCondition* _z_wait;
 
+    // see publishControls()
+    ZVec _snap[3];
+    unsigned int _snapGen[3];
+    unsigned int _generation;
+    int _snapWrite, _snapRead;   // solver's and reader's buffer
+    QAtomicInt _snapMiddle;      // the other one, | SNAP_FRESH until taken
+    void (*_published)(void*);
+    void* _publishedArg;
+
     ZVec _Z;       // contains keyframe controls as well
     std::vector<const ContCorr*> _conts; // Corresponders, _numFrames*_nCurves of them, curve-major
     std::vector<BezSpline*> _splines; // (_numFrames+1)*_nCurves of them, curve-major
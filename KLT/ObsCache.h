@@ -56,6 +56,14 @@ public:
     {
         _totalObs += i;
     }
+    int hits() const
+    {
+        return _hits;
+    }
+    int totalObs() const
+    {
+        return _totalObs;
+    }
 
 private:
 
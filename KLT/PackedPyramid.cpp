@@ -0,0 +1,164 @@
+/*********************************************************************
+ * PackedPyramid.cpp
+ *********************************************************************/
+
+#include <assert.h>
+#include "PackedPyramid.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KLT_PACKED_SSE
+#endif
+
+KLT_PackedCPyramid::KLT_PackedCPyramid(const KLT_ColorPyramid* img,
+        const KLT_ColorPyramid* gradx, const KLT_ColorPyramid* grady)
+{
+    KLT_ColorPyramid* cp[3] = { const_cast<KLT_ColorPyramid*>(img),
+            const_cast<KLT_ColorPyramid*>(gradx),
+            const_cast<KLT_ColorPyramid*>(grady) };
+    const KLT_Pyramid* planes[9];
+    int k, i, p;
+    for (k = 0; k < 3; ++k)
+    {
+        planes[3 * k] = cp[k]->r();
+        planes[3 * k + 1] = cp[k]->g();
+        planes[3 * k + 2] = cp[k]->b();
+    }
+
+    _nLevels = planes[0]->getNLevels();
+    _subsampling = planes[0]->getSubsampling();
+    _ncols = new int[_nLevels];
+    _nrows = new int[_nLevels];
+    _data = new float*[_nLevels];
+    for (i = 0; i < _nLevels; ++i)
+    {
+        _ncols[i] = planes[0]->getNCols(i);
+        _nrows[i] = planes[0]->getNRows(i);
+        const int npix = _ncols[i] * _nrows[i];
+        // the vector loads of the last pixel's gy read one float past it
+        float* out = _data[i] = new float[npix * KLT_PACKED_STRIDE + 1];
+        out[npix * KLT_PACKED_STRIDE] = 0;
+        for (k = 0; k < 9; ++k)
+        {
+            const float* in = planes[k]->getFImage(i)->data;
+            for (p = 0; p < npix; ++p)
+                out[p * KLT_PACKED_STRIDE + k] = in[p];
+        }
+    }
+}
+
+KLT_PackedCPyramid::~KLT_PackedCPyramid()
+{
+    for (int i = 0; i < _nLevels; ++i)
+        delete[] _data[i];
+    delete[] _data;
+    delete[] _ncols;
+    delete[] _nrows;
+}
+
+size_t KLT_PackedCPyramid::bytes() const
+{
+    size_t bytes = 0;
+    for (int i = 0; i < _nLevels; ++i)
+        bytes += (size_t(_ncols[i]) * _nrows[i] * KLT_PACKED_STRIDE + 1)
+                * sizeof(float);
+    return bytes;
+}
+
+KLT_Pyramid* KLT_PackedCPyramid::unpack(const int plane) const
+{
+    assert(plane >= 0 && plane < KLT_PACKED_STRIDE);
+    KLT_Pyramid* p = new KLT_Pyramid(_ncols[0], _nrows[0], _subsampling,
+            _nLevels);
+    for (int i = 0; i < _nLevels; ++i)
+    {
+        const int npix = _ncols[i] * _nrows[i];
+        const float* in = _data[i] + plane;
+        float* out = p->getFImage(i)->data;
+        for (int k = 0; k < npix; ++k)
+            out[k] = in[k * KLT_PACKED_STRIDE];
+    }
+    return p;
+}
+
+// Same arithmetic as color(): the rows first, then across.  Where ax or ay
+// is 0 the lerp gives back its first operand, so there is no need for
+// color()'s special cases.
+static inline void lerpTriple(const float* q, const int rowStride,
+        const float ax, const float ay, Vec3f& out)
+{
+#ifdef KLT_PACKED_SSE
+    const __m128 vax = _mm_set1_ps(ax), vay = _mm_set1_ps(ay);
+    __m128 a = _mm_loadu_ps(q);
+    __m128 b = _mm_loadu_ps(q + KLT_PACKED_STRIDE);
+    __m128 c = _mm_loadu_ps(q + rowStride);
+    __m128 d = _mm_loadu_ps(q + rowStride + KLT_PACKED_STRIDE);
+    __m128 d1 = _mm_add_ps(a, _mm_mul_ps(vay, _mm_sub_ps(c, a)));
+    __m128 d2 = _mm_add_ps(b, _mm_mul_ps(vay, _mm_sub_ps(d, b)));
+    __m128 r = _mm_add_ps(d1, _mm_mul_ps(vax, _mm_sub_ps(d2, d1)));
+    float v[4];
+    _mm_storeu_ps(v, r);
+    out.Set(v[0], v[1], v[2]);
+#else
+    float v[3];
+    for (int m = 0; m < 3; ++m)
+    {
+        const float* p = q + m;
+        float d1 = p[0] + ay * (p[rowStride] - p[0]);
+        float d2 = p[KLT_PACKED_STRIDE]
+                + ay * (p[rowStride + KLT_PACKED_STRIDE] - p[KLT_PACKED_STRIDE]);
+        v[m] = d1 + ax * (d2 - d1);
+    }
+    out.Set(v[0], v[1], v[2]);
+#endif
+}
+
+int KLT_PackedCPyramid::color(const float x, const float y, const int level,
+        const int channel, Vec3f& putHere) const
+{
+    assert(level >= 0 && level < _nLevels);
+    const int ncols = _ncols[level], nrows = _nrows[level];
+    if (x < 0 || y < 0)
+        return -1;
+    const int xt = (int) x, yt = (int) y;
+    if (xt > ncols - 2 || yt > nrows - 2)
+        return -1;
+
+    const float* p = _data[level] + (yt * ncols + xt) * KLT_PACKED_STRIDE;
+    lerpTriple(p + channel, ncols * KLT_PACKED_STRIDE, x - xt, y - yt,
+            putHere);
+    return 0;
+}
+
+void KLT_PackedCPyramid::sample(const int level, const int n,
+        const float* xs, const float* ys, Vec3f* col, Vec3f* gx, Vec3f* gy,
+        int* status) const
+{
+    assert(level >= 0 && level < _nLevels);
+    const int ncols = _ncols[level], nrows = _nrows[level];
+    const int rowStride = ncols * KLT_PACKED_STRIDE;
+    const float* base = _data[level];
+
+    for (int i = 0; i < n; ++i)
+    {
+        const float x = xs[i], y = ys[i];
+        if (x < 0 || y < 0)
+        {
+            status[i] = -1;
+            continue;
+        }
+        const int xt = (int) x, yt = (int) y;
+        if (xt > ncols - 2 || yt > nrows - 2)
+        {
+            status[i] = -1;
+            continue;
+        }
+        status[i] = 0;
+
+        const float ax = x - xt, ay = y - yt;
+        const float* p = base + (yt * ncols + xt) * KLT_PACKED_STRIDE;
+        lerpTriple(p, rowStride, ax, ay, col[i]);
+        lerpTriple(p + 3, rowStride, ax, ay, gx[i]);
+        lerpTriple(p + 6, rowStride, ax, ay, gy[i]);
+    }
+}
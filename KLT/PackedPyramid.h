@@ -0,0 +1,80 @@
+/*********************************************************************
+ * PackedPyramid.h
+ *
+ * Colour and gradient pyramids of a frame packed per pixel, for the
+ * tracker's window sampling.
+ *
+ * Each level is one allocation of ncols * nrows pixels of 9 floats,
+ *   r g b  gxr gxg gxb  gyr gyg gyb
+ * so a bilinear lookup of colour and both gradients touches two runs of
+ * 18 floats instead of 36 floats spread over nine images.  sample() takes
+ * a whole strip of locations and interpolates the three triples of a
+ * pixel as one 4-wide vector when SSE is available.
+ *
+ * Results are exactly those of KLT_ColorPyramid::color() on img, gradx
+ * and grady.
+ *
+ * A KLT_FullCPyramid may keep only this copy (see
+ * KLT_TrackingContext::packedPyramids), with img, gradx and grady turned
+ * into views of it: color() then reads the packed pixels, and getFImage()
+ * and friends unpack the planes of a view the first time they are asked
+ * for.
+ *********************************************************************/
+
+#ifndef _PACKEDPYRAMID_H_
+#define _PACKEDPYRAMID_H_
+
+#include <stddef.h>
+#include "Pyramid.h"
+
+#define KLT_PACKED_STRIDE 9
+
+class KLT_PackedCPyramid
+{
+public:
+
+    KLT_PackedCPyramid(const KLT_ColorPyramid* img,
+            const KLT_ColorPyramid* gradx, const KLT_ColorPyramid* grady);
+    ~KLT_PackedCPyramid();
+
+    // n locations (xs[i], ys[i]) at level; status[i] is 0, or -1 if out of
+    // bounds, in which case col, gx and gy of i are left alone
+    void sample(const int level, const int n, const float* xs,
+            const float* ys, Vec3f* col, Vec3f* gx, Vec3f* gy,
+            int* status) const;
+
+    // one triple (0 img, 3 gradx, 6 grady) at one location, as
+    // KLT_ColorPyramid::color()
+    int color(const float x, const float y, const int level,
+            const int channel, Vec3f& putHere) const;
+
+    // a new planar copy of one of the 9 planes
+    KLT_Pyramid* unpack(const int plane) const;
+
+    int getNLevels() const
+    {
+        return _nLevels;
+    }
+    int getNCols(const int r) const
+    {
+        return _ncols[r];
+    }
+    int getNRows(const int r) const
+    {
+        return _nrows[r];
+    }
+    const float* getLevel(const int r) const
+    {
+        return _data[r];
+    }
+
+    size_t bytes() const;
+
+private:
+
+    int _nLevels, _subsampling;
+    int *_ncols, *_nrows;
+    float** _data;
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*********************************************************************
+ * Preconditioner.cpp
+ *********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include "Preconditioner.h"
+#include "MyAssert.h"
+
+Preconditioner* Preconditioner::create(const int type)
+{
+    switch (type)
+    {
+    case KLT_PRECOND_BLOCK_JACOBI:
+        return new BlockJacobiPreconditioner();
+    case KLT_PRECOND_IC:
+        return new ICPreconditioner();
+    default:
+        return NULL;
+    }
+}
+
+//------- block Jacobi -----------------------------------
+
+// Blocks that are not positive definite (a fixed or unseen point) fall
+// back to their diagonal, or to nothing
+void BlockJacobiPreconditioner::factor(const MultiDiagMatrix& A)
+{
+    const uint n = _n = A.dim();
+    _inv.resize(3 * ((n + 1) / 2));
+    for (uint i = 0, k = 0; i < n; i += 2, k += 3)
+    {
+        const double a = A.value(i, i);
+        const double b = i + 1 < n ? A.value(i, i + 1) : 0;
+        const double c = i + 1 < n ? A.value(i + 1, i + 1) : 1;
+        const double det = a * c - b * b;
+        if (a > 0 && c > 0 && det > 1e-12 * a * c)
+        {
+            _inv[k] = c / det;
+            _inv[k + 1] = -b / det;
+            _inv[k + 2] = a / det;
+        }
+        else
+        {
+            _inv[k] = a > 0 ? 1. / a : 1.;
+            _inv[k + 1] = 0;
+            _inv[k + 2] = c > 0 ? 1. / c : 1.;
+        }
+    }
+}
+
+void BlockJacobiPreconditioner::apply(double* v) const
+{
+    for (uint i = 0, k = 0; i < _n; i += 2, k += 3)
+    {
+        if (i + 1 == _n)
+        {
+            v[i] *= _inv[k];
+            break;
+        }
+        const double x = v[i], y = v[i + 1];
+        v[i] = _inv[k] * x + _inv[k + 1] * y;
+        v[i + 1] = _inv[k + 1] * x + _inv[k + 2] * y;
+    }
+}
+
+//------- incomplete Cholesky -----------------------------------
+
+// A pivot that goes non-positive restarts the block with the diagonal
+// raised by shift times itself (Manteuffel).  Past a large shift the rows
+// that still break down are dropped to the identity instead.
+void ICPreconditioner::factor(const MultiDiagMatrix& A)
+{
+    _bands.resize(A.numBlocks());
+    for (uint b = 0; b < A.numBlocks(); ++b)
+    {
+        Band& band = _bands[b];
+        band.start = A.blockStart(b);
+        double shift = 0;
+        while (!factorBand(A.block(b), shift, shift > 1e3, &band))
+            shift = shift == 0 ? 1e-3 : 2 * shift;
+        if (shift > 0)
+            printf("IC breakdown in block %d, shifted by %g\n", b, shift);
+    }
+}
+
+bool ICPreconditioner::factorBand(const DiagMatrix& A, const double shift,
+        const bool force, Band* b)
+{
+    const uint n = A.dim(), w = A.maxWidth();
+    uint i, k, m;
+    b->n = n;
+    b->width = w;
+    b->used.assign(w, 0);
+    for (k = 0; k < w; ++k)
+        b->used[k] = A.diagonal(k) != NULL;
+    b->u.assign(size_t(w) * n, 0.);
+
+    const double* a0 = A.diagonal(0);
+    double* u = &b->u[0];
+    for (i = 0; i < n; ++i)
+    {
+        // a variable nothing constrains is left as it is
+        if (!a0 || a0[i] <= 0)
+        {
+            u[i] = 1;
+            continue;
+        }
+        for (k = 0; k < w && i + k < n; ++k)
+        {
+            if (!b->used[k])
+                continue;
+            const uint j = i + k;
+            double s = A.diagonal(k)[i];
+            if (k == 0)
+                s *= 1 + shift;
+            // U(m,i) U(m,j) over the rows m < i both are in the band of
+            for (m = j + 1 > w ? j + 1 - w : 0; m < i; ++m)
+            {
+                const uint ki = i - m, kj = j - m;
+                if (b->used[ki] && b->used[kj])
+                    s -= u[ki * n + m] * u[kj * n + m];
+            }
+            if (k == 0)
+            {
+                if (!(s > 1e-12 * a0[i]))
+                {
+                    if (!force)
+                        return false;
+                    u[i] = 1;
+                    break;
+                }
+                u[i] = sqrt(s);
+            }
+            else
+                u[k * n + i] = s / u[i];
+        }
+    }
+    return true;
+}
+
+// U'U z = v: forward with U', then back with U, in place, per block
+void ICPreconditioner::apply(double* v) const
+{
+    for (uint bi = 0; bi < _bands.size(); ++bi)
+    {
+        const Band& b = _bands[bi];
+        const uint n = b.n, w = b.width;
+        const double* u = &b.u[0];
+        double* x = v + b.start;
+        int i;
+        uint k;
+
+        for (i = 0; i < (int) n; ++i)
+        {
+            x[i] /= u[i];
+            for (k = 1; k < w && i + k < n; ++k)
+                if (b.used[k])
+                    x[i + k] -= u[k * n + i] * x[i];
+        }
+        for (i = n - 1; i >= 0; --i)
+        {
+            double s = x[i];
+            for (k = 1; k < w && i + k < n; ++k)
+                if (b.used[k])
+                    s -= u[k * n + i] * x[i + k];
+            x[i] = s / u[i];
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/*********************************************************************
+ * Preconditioner.h
+ *
+ * Preconditioners for the conjugate-gradient solves of the spline
+ * tracker, on the banded MultiDiagMatrix of a SplineKeeper.
+ *
+ *   KLT_PRECOND_HB            hierarchical basis of HB_Sweep, which does
+ *                             not look at the matrix (SplineKeeper keeps it)
+ *   KLT_PRECOND_BLOCK_JACOBI  inverse of the 2x2 block of each control
+ *                             point's x and y
+ *   KLT_PRECOND_IC            incomplete Cholesky of each curve's banded
+ *                             block, keeping the stored diagonals and
+ *                             dropping the entries outside the bands.
+ *                             A full band holds all its own fill, so this
+ *                             is then the exact factor of the block.
+ *
+ * The last two are factored from the matrix once it is built, by
+ * factor(), before the solve applies them.
+ *********************************************************************/
+
+#ifndef _PRECONDITIONER_H_
+#define _PRECONDITIONER_H_
+
+#include <vector>
+#include "MultiDiagMatrix.h"
+
+enum KLT_PreconditionerType
+{
+    KLT_PRECOND_NONE = 0,
+    KLT_PRECOND_HB,
+    KLT_PRECOND_BLOCK_JACOBI,
+    KLT_PRECOND_IC
+};
+
+class Preconditioner
+{
+public:
+    virtual ~Preconditioner()
+    {
+    }
+
+    // a new preconditioner of the given type, NULL for NONE and HB
+    static Preconditioner* create(const int type);
+
+    virtual void factor(const MultiDiagMatrix& A) = 0;
+
+    // v = M^-1 v
+    virtual void apply(double* v) const = 0;
+};
+
+class BlockJacobiPreconditioner: public Preconditioner
+{
+public:
+    BlockJacobiPreconditioner() :
+            _n(0)
+    {
+    }
+    void factor(const MultiDiagMatrix& A);
+    void apply(double* v) const;
+
+private:
+    uint _n;
+    std::vector<double> _inv; // a b c of each symmetric inverse [a b; b c]
+};
+
+class ICPreconditioner: public Preconditioner
+{
+public:
+    void factor(const MultiDiagMatrix& A);
+    void apply(double* v) const;
+
+private:
+
+    // upper factor U of one block, U'U ~ A, stored by diagonal like
+    // DiagMatrix: U(i, i+k) at u[k * n + i]
+    struct Band
+    {
+        uint start, n, width;
+        std::vector<char> used;   // diagonals A stores
+        std::vector<double> u;
+    };
+
+    // false on a breakdown, unless force
+    static bool factorBand(const DiagMatrix& A, const double shift,
+            const bool force, Band* b);
+
+    std::vector<Band> _bands;
+};
+
+#endif
@@ -36,6 +36,7 @@
 #include "base.h"
 #include "Error.h"
 #include "Pyramid.h"
+#include "PackedPyramid.h"
 
 #define max(a,b)        ((a) > (b) ? (a) : (b))
 #define min(a,b)        ((a) < (b) ? (a) : (b))
@@ -272,13 +273,45 @@ KLT_Pyramid::KLT_Pyramid(FILE* fp)
 }
 
 KLT_ColorPyramid::KLT_ColorPyramid(int basecols, int baserows, int subsampling,
-        int nlevel)
+        int nlevel) :
+        _packed(NULL), _channel(-1)
 {
     _r = new KLT_Pyramid(basecols, baserows, subsampling, nlevel);
     _g = new KLT_Pyramid(basecols, baserows, subsampling, nlevel);
     _b = new KLT_Pyramid(basecols, baserows, subsampling, nlevel);
 }
 
+KLT_ColorPyramid::KLT_ColorPyramid(const KLT_PackedCPyramid* packed,
+        const int channel) :
+        _r(NULL), _g(NULL), _b(NULL), _packed(packed), _channel(channel)
+{
+    assert(channel == 0 || channel == 3 || channel == 6);
+}
+
+void KLT_ColorPyramid::unpack() const
+{
+    if (!_packed)
+        return;
+    QMutexLocker lock(&_unpackMutex);
+    if (_r)
+        return;
+    _r = _packed->unpack(_channel);
+    _g = _packed->unpack(_channel + 1);
+    _b = _packed->unpack(_channel + 2);
+}
+
+size_t KLT_ColorPyramid::bytes() const
+{
+    QMutexLocker lock(&_unpackMutex);
+    if (!_r)
+        return 0;
+    size_t bytes = 0;
+    for (int i = 0; i < _r->getNLevels(); ++i)
+        bytes += 3 * size_t(_r->getNCols(i)) * _r->getNRows(i)
+                * sizeof(float);
+    return bytes;
+}
+
 KLT_ColorPyramid::~KLT_ColorPyramid()
 {
     delete _r;
@@ -325,6 +358,8 @@ void KLT_ColorPyramid::smoothAndComputePyramid(const QImage im,
 int KLT_ColorPyramid::color(const float x, const float y, const int level,
         Vec3f& putHere) const
 {
+    if (_packed)
+        return _packed->color(x, y, level, _channel, putHere);
     if (x < 0 || y < 0)
         return -1;
     int xt = (int) x; /* coordinates of top-left corner */
@@ -373,13 +408,15 @@ int KLT_ColorPyramid::color(const float x, const float y, const int level,
 
 void KLT_ColorPyramid::write(FILE* fp) const
 {
+    unpack();
     assert(_r && _g && _b);
     _r->write(fp);
     _g->write(fp);
     _b->write(fp);
 }
 
-KLT_ColorPyramid::KLT_ColorPyramid(FILE* fp)
+KLT_ColorPyramid::KLT_ColorPyramid(FILE* fp) :
+        _packed(NULL), _channel(-1)
 {
     _r = new KLT_Pyramid(fp);
     _g = new KLT_Pyramid(fp);
@@ -389,6 +426,7 @@ KLT_ColorPyramid::KLT_ColorPyramid(FILE* fp)
 #define BRACK(a) min(max(((int)(a)),0), 255)
 void KLT_ColorPyramid::writeImages(char* name) const
 {
+    unpack();
     int nlevels = _r->getNLevels();
     for (int t = 0; t < nlevels; t++)
     {
@@ -413,6 +451,7 @@ void KLT_ColorPyramid::writeImages(char* name) const
 
 void KLT_ColorPyramid::writeDerivImages(char* name) const
 {
+    unpack();
     int nlevels = _r->getNLevels();
     for (int t = 0; t < nlevels; t++)
     {
@@ -484,6 +523,8 @@ void KLT_Pyramid::writeDerivImages(char* name) const
 
 int KLT_ColorPyramid::getNLevels() const
 {
+    if (_packed)
+        return _packed->getNLevels();
     assert(
             (_r->getNLevels() == _g->getNLevels())
                     && (_g->getNLevels() == _b->getNLevels()));
@@ -26,6 +26,7 @@
 #ifndef _PYRAMID_H_
 #define _PYRAMID_H_
 
+#include <QMutex>
 #include "klt_util.h"
 #include "jl_vectors.h"
 
@@ -84,6 +85,11 @@ public:
         return nLevels;
     }
 
+    int getSubsampling() const
+    {
+        return subsampling;
+    }
+
 private:
     int subsampling;
     int nLevels;
@@ -97,12 +103,18 @@ private:
     void setupStructure(int basencols, int basenrows);
 };
 
+class KLT_PackedCPyramid;
+
 class KLT_ColorPyramid
 {
 public:
 
     KLT_ColorPyramid(int basecols, int baserows, int subsampling, int nlevel);
     KLT_ColorPyramid(FILE* fp);
+    // view of the triple at channel (0 img, 3 gradx, 6 grady) of packed
+    // storage, which must outlive it.  color() reads the packed pixels; the
+    // r, g and b planes are only unpacked if somebody asks for them.
+    KLT_ColorPyramid(const KLT_PackedCPyramid* packed, const int channel);
     ~KLT_ColorPyramid();
 
     void smoothAndComputePyramid(const QImage im, const Kernels* kern,
@@ -114,25 +126,36 @@ public:
 
     KLT_Pyramid* r()
     {
+        unpack();
         return _r;
     }
     KLT_Pyramid* g()
     {
+        unpack();
         return _g;
     }
     KLT_Pyramid* b()
     {
+        unpack();
         return _b;
     }
 
     int getNLevels() const;
 
+    // bytes of the r, g and b planes held, 0 for a view nobody unpacked
+    size_t bytes() const;
+
     void write(FILE* fp) const;
     void writeImages(char* name) const;
     void writeDerivImages(char* name) const;
 
 private:
-    KLT_Pyramid *_r, *_g, *_b;
+    void unpack() const;
+
+    mutable KLT_Pyramid *_r, *_g, *_b;
+    const KLT_PackedCPyramid* _packed;
+    int _channel;
+    mutable QMutex _unpackMutex;
 };
 
 #endif
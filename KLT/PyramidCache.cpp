@@ -0,0 +1,282 @@
+/*********************************************************************
+ * PyramidCache.cpp
+ *********************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include "PyramidCache.h"
+
+#define PYRAMID_CACHE_ALIGN 64
+#define PYRAMID_HASH_SPAN (1 << 20)
+
+static const char pyramidMagic[4] = { 'K', 'L', 'T', 'P' };
+
+static qint64 alignUp(const qint64 n)
+{
+    return (n + PYRAMID_CACHE_ALIGN - 1) & ~(qint64) (PYRAMID_CACHE_ALIGN - 1);
+}
+
+// bytes of all blocks of np pyramids, header included
+static qint64 fileSize(const PyramidFileHeader* h, const int np)
+{
+    qint64 size = sizeof(PyramidFileHeader);
+    int cols = h->basecols, rows = h->baserows;
+    for (int i = 0; i < h->nLevels; ++i)
+    {
+        size += np * alignUp(qint64(cols) * rows * sizeof(float));
+        cols /= h->subsampling;
+        rows /= h->subsampling;
+    }
+    return size;
+}
+
+PyramidCache::PyramidCache() :
+        _nLevels(-1), _subsampling(-1), _smoothSigma(0), _pyramidSigma(0),
+        _gradSigma(0), _packedOnly(false)
+{
+}
+
+void PyramidCache::setDirectory(const QString& dir)
+{
+    _dir = dir;
+    updatePath();
+}
+
+// the first and last megabyte plus the size, so a cache directory stays
+// valid when the video is moved or renamed, and opening is not slowed
+// down by reading all of it
+bool PyramidCache::setVideo(const std::string& fileName)
+{
+    _videoHash.clear();
+    QFile f(QString::fromLocal8Bit(fileName.c_str()));
+    if (f.open(QIODevice::ReadOnly))
+    {
+        const qint64 size = f.size();
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(QByteArray::number(size));
+        hash.addData(f.read(PYRAMID_HASH_SPAN));
+        if (size > PYRAMID_HASH_SPAN)
+        {
+            f.seek(qMax(size - PYRAMID_HASH_SPAN, qint64(PYRAMID_HASH_SPAN)));
+            hash.addData(f.read(PYRAMID_HASH_SPAN));
+        }
+        _videoHash = QString(hash.result().toHex()).left(16);
+    }
+    updatePath();
+    return !_videoHash.isEmpty();
+}
+
+void PyramidCache::setSettings(const KLT_TrackingContext* tc)
+{
+    _nLevels = tc->nPyramidLevels;
+    _subsampling = tc->subsampling;
+    _smoothSigma = tc->smooth_sigma_fact;
+    _pyramidSigma = tc->pyramid_sigma_fact;
+    _gradSigma = tc->grad_sigma;
+    _packedOnly = tc->packedPyramids;
+    updatePath();
+}
+
+void PyramidCache::updatePath()
+{
+    _path.clear();
+    if (_videoHash.isEmpty() || _nLevels <= 0 || _dir.isEmpty())
+        return;
+
+    QString key = QString("l%1_s%2_sm%3_py%4_g%5").arg(_nLevels).arg(
+            _subsampling).arg(_smoothSigma).arg(_pyramidSigma).arg(_gradSigma);
+    QString path = _dir + "/" + _videoHash + "/" + key;
+    if (QDir().mkpath(path))
+        _path = path;
+}
+
+QString PyramidCache::fileName(const int frame, const int kind) const
+{
+    return _path + (kind ? "/c" : "/e") + QString::number(frame) + ".kpc";
+}
+
+bool PyramidCache::load(const int frame, KLT_FullCPyramid* pyr) const
+{
+    assert(!pyr->img);
+    QFile f;
+    PyramidFileHeader h;
+    uchar* m = map(f, frame, 1, &h);
+    if (!m)
+        return false;
+
+    pyr->img = new KLT_ColorPyramid(h.basecols, h.baserows, h.subsampling,
+            h.nLevels);
+    pyr->gradx = new KLT_ColorPyramid(h.basecols, h.baserows, h.subsampling,
+            h.nLevels);
+    pyr->grady = new KLT_ColorPyramid(h.basecols, h.baserows, h.subsampling,
+            h.nLevels);
+    pyr->nPyramidLevels = h.nLevels;
+    KLT_Pyramid* p[9] = { pyr->img->r(), pyr->img->g(), pyr->img->b(),
+            pyr->gradx->r(), pyr->gradx->g(), pyr->gradx->b(),
+            pyr->grady->r(), pyr->grady->g(), pyr->grady->b() };
+    copyOut(m, p, 9);
+    f.unmap(m);
+    pyr->pack(!_packedOnly);
+    return true;
+}
+
+bool PyramidCache::load(const int frame, KLT_FullPyramid* pyr) const
+{
+    assert(!pyr->img);
+    QFile f;
+    PyramidFileHeader h;
+    uchar* m = map(f, frame, 0, &h);
+    if (!m)
+        return false;
+
+    pyr->img = new KLT_Pyramid(h.basecols, h.baserows, h.subsampling,
+            h.nLevels);
+    pyr->gradx = new KLT_Pyramid(h.basecols, h.baserows, h.subsampling,
+            h.nLevels);
+    pyr->grady = new KLT_Pyramid(h.basecols, h.baserows, h.subsampling,
+            h.nLevels);
+    pyr->nPyramidLevels = h.nLevels;
+    KLT_Pyramid* p[3] = { pyr->img, pyr->gradx, pyr->grady };
+    copyOut(m, p, 3);
+    f.unmap(m);
+    return true;
+}
+
+// from the packed copy if there is one, so views are not unpacked for it
+bool PyramidCache::store(const int frame, const KLT_FullCPyramid* pyr) const
+{
+    if (!pyr->img)
+        return false;
+    if (pyr->packed)
+        return write(frame, 1, NULL, 9, pyr->packed);
+    const KLT_Pyramid* p[9] = { pyr->img->r(), pyr->img->g(), pyr->img->b(),
+            pyr->gradx->r(), pyr->gradx->g(), pyr->gradx->b(),
+            pyr->grady->r(), pyr->grady->g(), pyr->grady->b() };
+    return write(frame, 1, p, 9, NULL);
+}
+
+bool PyramidCache::store(const int frame, const KLT_FullPyramid* pyr) const
+{
+    if (!pyr->img)
+        return false;
+    const KLT_Pyramid* p[3] = { pyr->img, pyr->gradx, pyr->grady };
+    return write(frame, 0, p, 3, NULL);
+}
+
+// Opens and maps a cache file, NULL if it is missing, truncated or was
+// written for other settings.  f holds the mapping until it is unmapped.
+uchar* PyramidCache::map(QFile& f, const int frame, const int kind,
+        PyramidFileHeader* h) const
+{
+    if (!enabled())
+        return NULL;
+    f.setFileName(fileName(frame, kind));
+    if (!f.open(QIODevice::ReadOnly) || f.size() < qint64(sizeof(*h)))
+        return NULL;
+    uchar* m = f.map(0, f.size());
+    if (!m)
+        return NULL;
+
+    memcpy(h, m, sizeof(*h));
+    if (memcmp(h->magic, pyramidMagic, 4) || h->version != PYRAMID_CACHE_VERSION
+            || h->kind != kind || h->frame != frame || h->nLevels != _nLevels
+            || h->subsampling != _subsampling
+            || h->smoothSigma != _smoothSigma
+            || h->pyramidSigma != _pyramidSigma
+            || h->gradSigma != _gradSigma || h->basecols <= 0
+            || h->baserows <= 0
+            || f.size() != fileSize(h, kind ? 9 : 3))
+    {
+        f.unmap(m);
+        return NULL;
+    }
+    return m;
+}
+
+void PyramidCache::copyOut(const uchar* m, KLT_Pyramid* const* p,
+        const int np)
+{
+    qint64 offset = sizeof(PyramidFileHeader);
+    for (int k = 0; k < np; ++k)
+        for (int i = 0; i < p[k]->getNLevels(); ++i)
+        {
+            const qint64 bytes = qint64(p[k]->getNCols(i)) * p[k]->getNRows(i)
+                    * sizeof(float);
+            memcpy(p[k]->getFImage(i)->data, m + offset, bytes);
+            offset += alignUp(bytes);
+        }
+}
+
+// The np planes come from p, or from packed if it is given.  Written to a
+// temporary file and renamed into place, so a reader never sees half a
+// file; if another worker got there first its copy is kept.
+bool PyramidCache::write(const int frame, const int kind,
+        const KLT_Pyramid* const* p, const int np,
+        const KLT_PackedCPyramid* packed) const
+{
+    if (!enabled())
+        return false;
+
+    PyramidFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, pyramidMagic, 4);
+    h.version = PYRAMID_CACHE_VERSION;
+    h.kind = kind;
+    h.frame = frame;
+    h.nLevels = packed ? packed->getNLevels() : p[0]->getNLevels();
+    h.subsampling = _subsampling;
+    h.basecols = packed ? packed->getNCols(0) : p[0]->getNCols(0);
+    h.baserows = packed ? packed->getNRows(0) : p[0]->getNRows(0);
+    h.smoothSigma = _smoothSigma;
+    h.pyramidSigma = _pyramidSigma;
+    h.gradSigma = _gradSigma;
+    if (h.nLevels != _nLevels)
+        return false;
+
+    const QString name = fileName(frame, kind);
+    QTemporaryFile tmp(name + ".XXXXXX");
+    tmp.setAutoRemove(false);
+    if (!tmp.open())
+        return false;
+
+    static const char zeros[PYRAMID_CACHE_ALIGN] = { 0 };
+    std::vector<float> plane;
+    bool ok = tmp.write((const char*) &h, sizeof(h)) == sizeof(h);
+    for (int k = 0; ok && k < np; ++k)
+        for (int i = 0; ok && i < h.nLevels; ++i)
+        {
+            const float* data;
+            qint64 npix;
+            if (packed)
+            {
+                npix = qint64(packed->getNCols(i)) * packed->getNRows(i);
+                plane.resize(npix);
+                const float* in = packed->getLevel(i) + k;
+                for (qint64 j = 0; j < npix; ++j)
+                    plane[j] = in[j * KLT_PACKED_STRIDE];
+                data = &plane[0];
+            }
+            else
+            {
+                npix = qint64(p[k]->getNCols(i)) * p[k]->getNRows(i);
+                data = p[k]->getFImage(i)->data;
+            }
+            const qint64 bytes = npix * sizeof(float);
+            ok = tmp.write((const char*) data, bytes) == bytes
+                    && tmp.write(zeros, alignUp(bytes) - bytes)
+                            == alignUp(bytes) - bytes;
+        }
+    tmp.close();
+
+    if (!ok || !QFile::rename(tmp.fileName(), name))
+    {
+        QFile::remove(tmp.fileName());
+        return ok && QFile::exists(name);
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+/*********************************************************************
+ * PyramidCache.h
+ *
+ * Persistent on-disk cache of the colour and edge pyramids of a video.
+ *
+ * Files live in <dir>/<video hash>/<settings key>/, one per frame and
+ * kind (c<frame>.kpc for KLT_FullCPyramid, e<frame>.kpc for
+ * KLT_FullPyramid).  The settings key holds every KLT_TrackingContext
+ * parameter the pyramids depend on, so changing any of them simply
+ * misses the cache.
+ *
+ * File layout, native endianness:
+ *   PyramidFileHeader                     64 bytes
+ *   float blocks, each 64-byte aligned    for img, gradx, grady in turn;
+ *                                         per channel (r,g,b or grey);
+ *                                         per level, finest first
+ * Every block offset follows from the header, so the file can be mapped
+ * and read in place; load() maps it and copies each level out.
+ *********************************************************************/
+
+#ifndef _PYRAMIDCACHE_H_
+#define _PYRAMIDCACHE_H_
+
+#include <string>
+#include <QString>
+#include <QFile>
+#include "KLT.h"
+
+#define PYRAMID_CACHE_VERSION 1
+
+struct PyramidFileHeader
+{
+    char magic[4];          // "KLTP"
+    int version;            // PYRAMID_CACHE_VERSION
+    int kind;               // 0 grey (KLT_FullPyramid), 1 colour
+    int frame;
+    int nLevels;
+    int subsampling;
+    int basecols;
+    int baserows;
+    float smoothSigma;
+    float pyramidSigma;
+    float gradSigma;
+    int pad[5];
+};
+
+class PyramidCache
+{
+public:
+
+    PyramidCache();
+
+    // root of the cache, empty by default: nothing deletes from the cache
+    // and a long clip's pyramids take hundreds of gigabytes, so it is only
+    // used where the caller asks for it
+    void setDirectory(const QString& dir);
+
+    // identify the video, returns false if it cannot be read
+    bool setVideo(const std::string& fileName);
+
+    // remember the parameters the pyramids are built with
+    void setSettings(const KLT_TrackingContext* tc);
+
+    bool enabled() const
+    {
+        return !_path.isEmpty();
+    }
+
+    // fill an empty pyramid from the cache, false on a miss
+    bool load(const int frame, KLT_FullCPyramid* pyr) const;
+    bool load(const int frame, KLT_FullPyramid* pyr) const;
+
+    // save a built pyramid, false if it could not be written
+    bool store(const int frame, const KLT_FullCPyramid* pyr) const;
+    bool store(const int frame, const KLT_FullPyramid* pyr) const;
+
+private:
+
+    QString fileName(const int frame, const int kind) const;
+    bool write(const int frame, const int kind, const KLT_Pyramid* const* p,
+            const int np, const KLT_PackedCPyramid* packed) const;
+    uchar* map(QFile& f, const int frame, const int kind,
+            PyramidFileHeader* h) const;
+    static void copyOut(const uchar* m, KLT_Pyramid* const* p, const int np);
+    void updatePath();
+
+    QString _dir, _videoHash, _path;
+    int _nLevels, _subsampling;
+    float _smoothSigma, _pyramidSigma, _gradSigma;
+    bool _packedOnly;   // colour pyramids loaded keep no planes
+};
+
+#endif
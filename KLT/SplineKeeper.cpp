@@ -25,7 +25,7 @@
 // SPEED 1: overarching, both kltSpline and here, replace double* work with ublas vectors
 #include "MyAssert.h"
 
-SplineKeeper::SplineKeeper(MultiSplineData* mts) :
+SplineKeeper::SplineKeeper(MultiSplineData* mts, const int precondType) :
         _mts(mts)
 {
     //  _fp = fopen("J.dat","w"); row=1;
@@ -35,8 +35,9 @@ SplineKeeper::SplineKeeper(MultiSplineData* mts) :
     _jcheck = new BuildingSplineKeeper(_nv);
 #endif
 
-    _precond = true;
-    if (precond())
+    _precond = precondType != KLT_PRECOND_NONE;
+    _factored = Preconditioner::create(precondType);
+    if (precondType == KLT_PRECOND_HB)
     {
         vector<int>* fixers = new vector<int> [mts->_nCurves];
         int* numvars = new int[mts->_nCurves];
@@ -68,6 +69,7 @@ SplineKeeper::SplineKeeper(SplineKeeper* other)
     _mts = other->_mts;
     mutualInit();
     _sweeper = NULL;
+    _factored = NULL;
 #ifdef _CHECKJ_
     _jcheck = new BuildingSplineKeeper(other->_jcheck);
 #endif
@@ -490,7 +492,7 @@ const double* SplineKeeper::g() const
 void SplineKeeper::handleConstraints(double* r)
 {
     int index;
-    if (!precond())
+    if (!_sweeper)
     {
         const FixedControlV& V = _mts->getFixedLocs();
         for (FixedControlV::const_iterator i = V.begin(); i != V.end(); ++i)
@@ -508,6 +510,13 @@ bool SplineKeeper::precond() const
     return _precond;
 }
 
+// the hierarchical basis does not depend on the matrix
+void SplineKeeper::setupPrecond()
+{
+    if (_factored)
+        _factored->factor(*_mat);
+}
+
 SplineKeeper::~SplineKeeper()
 {
     if (_mat)
@@ -516,6 +525,7 @@ SplineKeeper::~SplineKeeper()
     //delete[] _crapg;
     if (_sweeper)
         delete _sweeper;
+    delete _factored;
 
 #ifdef _CHECKJ_
     delete _jcheck;
@@ -34,6 +34,7 @@
 
 #include "DiagMatrix.h"
 #include "MultiDiagMatrix.h"
+#include "Preconditioner.h"
 
 //#define _CHECKJ_
 #ifdef _CHECKJ_
@@ -54,7 +55,8 @@ class SplineKeeper: public GenKeeper
 
 public:
 
-    SplineKeeper(MultiSplineData* mts);
+    // precondType is a KLT_PreconditionerType
+    SplineKeeper(MultiSplineData* mts, const int precondType = KLT_PRECOND_HB);
 
     SplineKeeper(SplineKeeper* other);
 
@@ -75,10 +77,19 @@ public:
     void handleConstraints(double* r);
 
     bool precond() const;
+    void setupPrecond();
     void precondVec(double* v)
     {
-        _sweeper->sweepUp(v);
-        _sweeper->sweepDown(v);
+        if (_sweeper)
+        {
+            _sweeper->sweepUp(v);
+            _sweeper->sweepDown(v);
+        }
+        else
+        {
+            _factored->apply(v);
+            handleConstraints(v);
+        }
     }
 
     // Variable numbers in vars (full-2, but each represents a pair), 3 jacobians in J[24], 3 residual r's,
@@ -126,7 +137,8 @@ private:
     int _vars[8];   // temp
     double _J[16];  // temp
     bool _precond;
-    HB_Sweep* _sweeper;
+    HB_Sweep* _sweeper;          // KLT_PRECOND_HB
+    Preconditioner* _factored;   // the ones built from _mat
 
 #ifdef _CHECKJ_
     BuildingSplineKeeper* _jcheck;
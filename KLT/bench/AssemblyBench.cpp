@@ -0,0 +1,176 @@
+/*********************************************************************
+ * AssemblyBench.cpp
+ *
+ * Times createSplineMatrices in whole spline tracks on the three ways a
+ * KLT_FullCPyramid can hold its data:
+ *   planar       img, gradx and grady only, sampled through color()
+ *   packed       the planes and the interleaved copy, sampled from the
+ *                copy as the tracker did before packedPyramids
+ *   packed only  the interleaved copy, the default
+ * The clip is synthetic: a textured disc moving over a textured ground,
+ * with one curve around it keyframed on the first and last frame and
+ * in-betweens that lag behind the disc.  Each layout tracks the same
+ * component from the same in-betweens; reports the assembly time, the
+ * whole solve and the memory the pyramids take, and checks the solves
+ * agree.
+ *
+ *   AssemblyBench [ncols nrows frames threads]
+ *********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <QImage>
+#include <QTime>
+#include "KLT.h"
+#include "MultiSplineData.h"
+#include "PackedPyramid.h"
+#include "RotoCurves.h"
+#include "RotoPath.h"
+#include "TrackGraph.h"
+
+#define RADIUS 60.f
+#define SPEED 4.f
+#define KAPPA 0.5523f
+
+static const char* names[3] = { "planar", "packed", "packed only" };
+
+static QImage frameImage(const int ncols, const int nrows, const float cx,
+        const float cy)
+{
+    QImage im(ncols, nrows, QImage::Format_RGB32);
+    for (int y = 0; y < nrows; ++y)
+        for (int x = 0; x < ncols; ++x)
+        {
+            const float dx = x - cx, dy = y - cy;
+            const bool in = dx * dx + dy * dy < RADIUS * RADIUS;
+            // the texture moves with the disc inside it
+            const int u = in ? int(dx) + 1000 : x, v = in ? int(dy) + 1000 : y;
+            const int n = (u * 73 + v * 151 + ((u * v) >> 3)) & 63;
+            im.setPixel(x, y, in ? qRgb(200 + n, 80 + n, 40) :
+                    qRgb(40 + n, 90, 120 + n));
+        }
+    return im;
+}
+
+// a circle of four segments around (cx, cy)
+static std::vector<Vec2f> circle(const float cx, const float cy)
+{
+    static const float pts[13][2] = { { 1, 0 }, { 1, KAPPA }, { KAPPA, 1 },
+            { 0, 1 }, { -KAPPA, 1 }, { -1, KAPPA }, { -1, 0 }, { -1, -KAPPA },
+            { -KAPPA, -1 }, { 0, -1 }, { KAPPA, -1 }, { 1, -KAPPA }, { 1, 0 } };
+    std::vector<Vec2f> ctrls(13);
+    for (int i = 0; i < 13; ++i)
+        ctrls[i].Set(cx + RADIUS * pts[i][0], cy + RADIUS * pts[i][1]);
+    return ctrls;
+}
+
+static KLT_FullCPyramid* pyramid(const QImage& im,
+        const KLT_TrackingContext* tc, const int layout)
+{
+    KLT_FullCPyramid* p = new KLT_FullCPyramid(im, tc);
+    if (layout == 0)
+    {
+        delete p->packed;
+        p->packed = NULL;
+    }
+    return p;
+}
+
+int main(int argc, char** argv)
+{
+    int ncols = 1280, nrows = 720, frames = 24, threads = 1, i, f;
+    if (argc == 5)
+    {
+        ncols = atoi(argv[1]);
+        nrows = atoi(argv[2]);
+        frames = atoi(argv[3]);
+        threads = atoi(argv[4]);
+    }
+
+    std::vector<QImage> images(frames + 1);
+    for (f = 0; f <= frames; ++f)
+        images[f] = frameImage(ncols, nrows, ncols / 3.f + SPEED * f,
+                nrows / 2.f);
+
+    // keyframes on the disc, in-betweens where it was a third of the way
+    // back, linked as a project file links them
+    RotoCurves* curves = new RotoCurves[frames + 1];
+    RotoPath* prev = NULL;
+    for (f = 0; f <= frames; ++f)
+    {
+        const bool key = f == 0 || f == frames;
+        const float cx = ncols / 3.f + SPEED * (key ? f : f * 2 / 3.f);
+        RotoPath* p = curves[f].addPathFromCtrls(circle(cx, nrows / 2.f),
+                key);
+        if (prev)
+        {
+            prev->setNextC(p);
+            prev->buildINextCorrs();
+            p->setPrevC(prev);
+            p->buildIPrevCorrs();
+        }
+        prev = p;
+    }
+    PathV toTrack(1, prev);
+    TrackGraph ccomp;
+    prev->buildccomp(&ccomp, &toTrack);
+
+    KLT_TrackingContext settings;
+    settings.useEdges = false;
+    settings.assemblyThreads = threads;
+
+    printf("%dx%d, %d frames, %d assembly threads\n", ncols, nrows, frames,
+            threads);
+    double sums[3];
+    for (int layout = 0; layout < 3; ++layout)
+    {
+        KLT_TrackingContext* tc = new KLT_TrackingContext();
+        tc->copySettings(&settings);
+        tc->packedPyramids = layout == 2;
+
+        const KLT_FullCPyramid** pyrms = new const KLT_FullCPyramid*[frames
+                + 1];
+        const KLT_FullPyramid** pyrmsE =
+                new const KLT_FullPyramid*[frames + 1];
+        size_t bytes = 0;
+        for (f = 0; f <= frames; ++f)
+        {
+            KLT_FullCPyramid* p = pyramid(images[f], tc, layout);
+            bytes += p->bytes();
+            pyrms[f] = p;
+            pyrmsE[f] = NULL;
+        }
+
+        MultiSplineData* mts = new MultiSplineData();
+        mts->_numFrames = frames;
+        ccomp.buildMulti(mts);
+        tc->setupSplineTrack(pyrms, pyrmsE, mts, false);
+
+        QTime t;
+        t.start();
+        tc->runNoThread();
+        const int total = t.elapsed();
+
+        sums[layout] = 0;
+        for (i = 0; i < mts->size_Z(); ++i)
+            sums[layout] += mts->_Z[i].x() + mts->_Z[i].y();
+        printf("%-12s assembly %7d ms  solve %7d ms  pyramids %7.1f MB\n",
+                names[layout], tc->assemblyMsecs(), total,
+                bytes / 1048576.);
+
+        for (f = 0; f <= frames; ++f)
+            delete pyrms[f];
+        delete[] pyrms;
+        delete[] pyrmsE;
+        delete mts;
+        delete tc;
+    }
+
+    const bool match = sums[0] == sums[1] && sums[0] == sums[2];
+    printf("checksums %.9g %.9g %.9g  %s\n", sums[0], sums[1], sums[2],
+            match ? "match" : "DIFFER");
+    delete[] curves;
+    return match ? 0 : 1;
+}
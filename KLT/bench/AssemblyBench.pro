@@ -0,0 +1,72 @@
+#-------------------------------------------------
+#
+# Benchmark of createSplineMatrices in whole
+# spline tracks on each colour pyramid layout
+#
+#-------------------------------------------------
+
+# the roto sources still call GL for drawing, so libGL is linked, but no
+# context is ever created
+TARGET = AssemblyBench
+TEMPLATE = app
+QT += core gui
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += .. ../../roto
+
+SOURCES += \
+    AssemblyBench.cpp \
+    ../BezSpline.cpp \
+    ../ContCorr.cpp \
+    ../MultiSplineData.cpp \
+    ../../roto/AbstractPath.cpp \
+    ../../roto/GeigerCorresponder.cpp \
+    ../../roto/RotoCorresponder.cpp \
+    ../../roto/RotoPath.cpp \
+    ../../roto/RotoRegion.cpp \
+    ../../roto/TrackGraph.cpp \
+    ../../roto/FitCurves.c \
+    ../../roto/GGVecLib.c \
+    ../../roto/RotoCurves.cpp \
+    ../../roto/RotoIndex.cpp \
+    ../../roto/MatteRaster.cpp \
+    ../Error.c \
+    ../MySparseMat.cpp \
+    ../LinearSolver.cpp \
+    ../KLT.cpp \
+    ../Keeper.cpp \
+    ../MultiKeeper.cpp \
+    ../Kernels.cpp \
+    ../Convolve.cpp \
+    ../PyramidCache.cpp \
+    ../PackedPyramid.cpp \
+    ../klt_util.cpp \
+    ../Pyramid.cpp \
+    ../kltSpline.cpp \
+    ../HB_Sweep.cpp \
+    ../SplineKeeper.cpp \
+    ../ObsCache.cpp \
+    ../HB_OneCurve.cpp \
+    ../MultiDiagMatrix.cpp \
+    ../DiagMatrix.cpp \
+    ../Preconditioner.cpp
+
+unix {
+    LIBS   += -lGL -lGLU
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv
+}
+
+win32 {
+INCLUDEPATH += \
+        D:\OpenCV-2.4.9\build\include \
+        D:\boost_1_58_0
+LIBS += -LD:\OpenCV-2.4.9\build\x64\vc12\lib \
+        -L"D:\boost_1_58_0\lib64-msvc-12.0" \
+        -lopencv_core249d \
+        -lopencv_highgui249d \
+        -lopencv_imgproc249d \
+        -lopencv_calib3d249d \
+        -lopengl32 -lglu32
+}
@@ -0,0 +1,168 @@
+/*********************************************************************
+ * ConvolveBench.cpp
+ *
+ * Times the convolution engine against the original scalar passes of
+ * KLT_FloatImage (kept below as reference) on a 1080p float image, for
+ * the smoothing pass and the gradient pair, and checks both agree.
+ *
+ *   ConvolveBench [ncols nrows iterations]
+ *********************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "Kernels.h"
+#include "Convolve.h"
+
+/* ---------------- reference: the original scalar passes ---------------- */
+
+static void refHoriz(const float* data, int ncols, int nrows,
+        const ConvolutionKernel* kernel, float* imgout)
+{
+    const float *ptrrow = data, *ppp;
+    float *ptrout = imgout;
+    float sum;
+    int radius = kernel->width / 2;
+    int i, j, k;
+
+    for (j = 0; j < nrows; j++)
+    {
+        for (i = 0; i < radius; i++)
+            *ptrout++ = 0.0;
+        for (; i < ncols - radius; i++)
+        {
+            ppp = ptrrow + i - radius;
+            sum = 0.0;
+            for (k = kernel->width - 1; k >= 0; k--)
+                sum += *ppp++ * kernel->data[k];
+            *ptrout++ = sum;
+        }
+        for (; i < ncols; i++)
+            *ptrout++ = 0.0;
+        ptrrow += ncols;
+    }
+}
+
+static void refVert(const float* data, int ncols, int nrows,
+        const ConvolutionKernel* kernel, float* imgout)
+{
+    const float *ptrcol = data, *ppp;
+    float *ptrout = imgout;
+    float sum;
+    int radius = kernel->width / 2;
+    int i, j, k;
+
+    for (i = 0; i < ncols; i++)
+    {
+        for (j = 0; j < radius; j++)
+        {
+            *ptrout = 0.0;
+            ptrout += ncols;
+        }
+        for (; j < nrows - radius; j++)
+        {
+            ppp = ptrcol + ncols * (j - radius);
+            sum = 0.0;
+            for (k = kernel->width - 1; k >= 0; k--)
+            {
+                sum += *ppp * kernel->data[k];
+                ppp += ncols;
+            }
+            *ptrout = sum;
+            ptrout += ncols;
+        }
+        for (; j < nrows; j++)
+        {
+            *ptrout = 0.0;
+            ptrout += ncols;
+        }
+        ptrcol++;
+        ptrout -= nrows * ncols - 1;
+    }
+}
+
+static void refSeparate(const float* in, int ncols, int nrows,
+        const ConvolutionKernel* h, const ConvolutionKernel* v, float* out)
+{
+    std::vector<float> tmp(ncols * nrows);
+    refHoriz(in, ncols, nrows, h, &tmp[0]);
+    refVert(&tmp[0], ncols, nrows, v, out);
+}
+
+/* ---------------------------------------------------------------------- */
+
+static double now()
+{
+    return double(clock()) / CLOCKS_PER_SEC;
+}
+
+static float maxDiff(const std::vector<float>& a, const std::vector<float>& b)
+{
+    float d = 0;
+    for (unsigned int i = 0; i < a.size(); ++i)
+        d = fabs(a[i] - b[i]) > d ? fabs(a[i] - b[i]) : d;
+    return d;
+}
+
+int main(int argc, char** argv)
+{
+    int ncols = 1920, nrows = 1080, iters = 10, i;
+    if (argc == 4)
+    {
+        ncols = atoi(argv[1]);
+        nrows = atoi(argv[2]);
+        iters = atoi(argv[3]);
+    }
+
+    std::vector<float> img(ncols * nrows);
+    srand(1);
+    for (i = 0; i < ncols * nrows; ++i)
+        img[i] = float(rand() % 256);
+
+    // the sigmas KLT_TrackingContext uses by default
+    Kernels smooth(1.3f), grad(1.f);
+    std::vector<float> a(ncols * nrows), b(ncols * nrows);
+    std::vector<float> ax(ncols * nrows), ay(ncols * nrows);
+    std::vector<float> bx(ncols * nrows), by(ncols * nrows);
+    double t, tref, tnew;
+
+    printf("%dx%d, %d iterations, engine built for %s\n", ncols, nrows,
+            iters, KLTConvolveISA());
+
+    t = now();
+    for (i = 0; i < iters; ++i)
+        refSeparate(&img[0], ncols, nrows, smooth.gauss(), smooth.gauss(),
+                &a[0]);
+    tref = (now() - t) / iters;
+    t = now();
+    for (i = 0; i < iters; ++i)
+        KLTConvolveSeparate(&img[0], ncols, nrows, smooth.gauss(),
+                smooth.gauss(), &b[0]);
+    tnew = (now() - t) / iters;
+    printf("smooth     : reference %7.2f ms  engine %7.2f ms  x%.2f  "
+            "max diff %g\n", 1000 * tref, 1000 * tnew, tref / tnew,
+            maxDiff(a, b));
+
+    t = now();
+    for (i = 0; i < iters; ++i)
+    {
+        refSeparate(&img[0], ncols, nrows, grad.gaussDeriv(), grad.gauss(),
+                &ax[0]);
+        refSeparate(&img[0], ncols, nrows, grad.gauss(), grad.gaussDeriv(),
+                &ay[0]);
+    }
+    tref = (now() - t) / iters;
+    t = now();
+    for (i = 0; i < iters; ++i)
+        KLTConvolveGradients(&img[0], ncols, nrows, grad.gauss(),
+                grad.gaussDeriv(), &bx[0], &by[0]);
+    tnew = (now() - t) / iters;
+    printf("gradients  : reference %7.2f ms  engine %7.2f ms  x%.2f  "
+            "max diff %g / %g\n", 1000 * tref, 1000 * tnew, tref / tnew,
+            maxDiff(ax, bx), maxDiff(ay, by));
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Microbenchmark of the KLT convolution engine
+# against the original scalar passes
+#
+#-------------------------------------------------
+
+TARGET = ConvolveBench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    ConvolveBench.cpp \
+    ../Convolve.cpp \
+    ../Kernels.cpp \
+    ../Error.c
+
+HEADERS += \
+    ../Convolve.h \
+    ../Kernels.h
@@ -0,0 +1,200 @@
+/*********************************************************************
+ * PyramidBench.cpp
+ *
+ * Times the image term of createSplineMatrices on the three ways a
+ * KLT_FullCPyramid can hold its data:
+ *   planar       img, gradx and grady as nine planes, color() three times
+ *   packed       the interleaved copy, sample() over a strip
+ *   packed only  img, gradx and grady as views of the interleaved copy,
+ *                color() three times as code outside the tracker does
+ * Each curve sample reads a strip of locations in frame t and the same
+ * strip moved a little in frame t+1, at every level, as the assembly
+ * loop does.  Reports the memory each layout takes and checks all three
+ * agree.
+ *
+ *   PyramidBench [ncols nrows levels strips]
+ *********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "Pyramid.h"
+#include "PackedPyramid.h"
+
+#define STRIP 21
+
+static double now()
+{
+    return double(clock()) / CLOCKS_PER_SEC;
+}
+
+static KLT_ColorPyramid* randomPyramid(int ncols, int nrows, int levels)
+{
+    KLT_ColorPyramid* p = new KLT_ColorPyramid(ncols, nrows, 2, levels);
+    KLT_Pyramid* planes[3] = { p->r(), p->g(), p->b() };
+    for (int c = 0; c < 3; ++c)
+        for (int l = 0; l < levels; ++l)
+        {
+            KLT_FloatImage* f = planes[c]->getFImage(l);
+            for (int i = 0; i < f->ncols * f->nrows; ++i)
+                f->data[i] = float(rand() % 256);
+        }
+    return p;
+}
+
+struct Frame
+{
+    KLT_ColorPyramid *img, *gradx, *grady;
+    KLT_PackedCPyramid* packed;
+    KLT_ColorPyramid *vimg, *vgradx, *vgrady;
+};
+
+static double sum(const Vec3f* c, const Vec3f* gx, const Vec3f* gy,
+        const int* status)
+{
+    double s = 0;
+    for (int j = 0; j < STRIP; ++j)
+        if (status[j] == 0)
+            s += c[j].r() + c[j].g() + c[j].b() + gx[j].r() + gx[j].g()
+                    + gx[j].b() + gy[j].r() + gy[j].g() + gy[j].b();
+    return s;
+}
+
+static double viaColor(const KLT_ColorPyramid* img,
+        const KLT_ColorPyramid* gradx, const KLT_ColorPyramid* grady,
+        const int level, const float* xs, const float* ys)
+{
+    Vec3f c[STRIP], gx[STRIP], gy[STRIP];
+    int status[STRIP];
+    for (int j = 0; j < STRIP; ++j)
+    {
+        status[j] = img->color(xs[j], ys[j], level, c[j]);
+        gradx->color(xs[j], ys[j], level, gx[j]);
+        grady->color(xs[j], ys[j], level, gy[j]);
+    }
+    return sum(c, gx, gy, status);
+}
+
+static double viaSample(const KLT_PackedCPyramid* packed, const int level,
+        const float* xs, const float* ys)
+{
+    Vec3f c[STRIP], gx[STRIP], gy[STRIP];
+    int status[STRIP];
+    packed->sample(level, STRIP, xs, ys, c, gx, gy, status);
+    return sum(c, gx, gy, status);
+}
+
+// seconds for every strip at every level, layout 0 planar, 1 packed,
+// 2 packed only; *total gets the sum of what was read
+static double run(const Frame* f, const std::vector<float>& xs,
+        const std::vector<float>& ys, const std::vector<float>& dx,
+        const std::vector<float>& dy, const int levels, const int strips,
+        const int layout, double* total)
+{
+    float x0[STRIP], y0[STRIP], x1[STRIP], y1[STRIP];
+    const double t = now();
+    for (int l = 0; l < levels; ++l)
+    {
+        const float scale = 1.f / (1 << l);
+        for (int i = 0; i < strips; ++i)
+        {
+            for (int j = 0; j < STRIP; ++j)
+            {
+                x0[j] = xs[i * STRIP + j] * scale;
+                y0[j] = ys[i * STRIP + j] * scale;
+                x1[j] = (xs[i * STRIP + j] + dx[i]) * scale;
+                y1[j] = (ys[i * STRIP + j] + dy[i]) * scale;
+            }
+            if (layout == 0)
+                *total += viaColor(f[0].img, f[0].gradx, f[0].grady, l, x0,
+                        y0) + viaColor(f[1].img, f[1].gradx, f[1].grady, l,
+                        x1, y1);
+            else if (layout == 1)
+                *total += viaSample(f[0].packed, l, x0, y0)
+                        + viaSample(f[1].packed, l, x1, y1);
+            else
+                *total += viaColor(f[0].vimg, f[0].vgradx, f[0].vgrady, l,
+                        x0, y0) + viaColor(f[1].vimg, f[1].vgradx,
+                        f[1].vgrady, l, x1, y1);
+        }
+    }
+    return now() - t;
+}
+
+int main(int argc, char** argv)
+{
+    int ncols = 1920, nrows = 1080, levels = 4, strips = 100000, i, j;
+    if (argc == 5)
+    {
+        ncols = atoi(argv[1]);
+        nrows = atoi(argv[2]);
+        levels = atoi(argv[3]);
+        strips = atoi(argv[4]);
+    }
+
+    srand(1);
+    Frame f[2];
+    for (i = 0; i < 2; ++i)
+    {
+        f[i].img = randomPyramid(ncols, nrows, levels);
+        f[i].gradx = randomPyramid(ncols, nrows, levels);
+        f[i].grady = randomPyramid(ncols, nrows, levels);
+        f[i].packed = new KLT_PackedCPyramid(f[i].img, f[i].gradx,
+                f[i].grady);
+        f[i].vimg = new KLT_ColorPyramid(f[i].packed, 0);
+        f[i].vgradx = new KLT_ColorPyramid(f[i].packed, 3);
+        f[i].vgrady = new KLT_ColorPyramid(f[i].packed, 6);
+    }
+
+    // strips along a curve segment, partly off the edge now and then
+    std::vector<float> xs(strips * STRIP), ys(strips * STRIP);
+    std::vector<float> dx(strips), dy(strips);
+    for (i = 0; i < strips; ++i)
+    {
+        const float bx = float(rand() % (ncols + 20) - 10);
+        const float by = float(rand() % (nrows + 20) - 10);
+        for (j = 0; j < STRIP; ++j)
+        {
+            xs[i * STRIP + j] = bx + 0.7f * j + 0.3f;
+            ys[i * STRIP + j] = by + 0.4f * j + 0.2f;
+        }
+        dx[i] = float(rand() % 100) / 50.f - 1.f;
+        dy[i] = float(rand() % 100) / 50.f - 1.f;
+    }
+
+    const size_t planar = f[0].img->bytes() + f[0].gradx->bytes()
+            + f[0].grady->bytes();
+    const size_t packed = f[0].packed->bytes();
+    printf("%dx%d, %d levels, %d strips of %d per frame pair\n", ncols,
+            nrows, levels, strips, STRIP);
+    printf("bytes per frame: planar %.1f MB  planar+packed %.1f MB  "
+            "packed only %.1f MB\n", planar / 1048576., (planar + packed)
+            / 1048576., packed / 1048576.);
+
+    double splanar = 0, spacked = 0, sviews = 0;
+    const double tplanar = run(f, xs, ys, dx, dy, levels, strips, 0, &splanar);
+    const double tpacked = run(f, xs, ys, dx, dy, levels, strips, 1, &spacked);
+    const double tviews = run(f, xs, ys, dx, dy, levels, strips, 2, &sviews);
+
+    printf("planar color() x3     : %8.1f ms\n", 1000 * tplanar);
+    printf("packed sample()       : %8.1f ms  x%.2f\n", 1000 * tpacked,
+            tplanar / tpacked);
+    printf("packed only color() x3: %8.1f ms  x%.2f\n", 1000 * tviews,
+            tplanar / tviews);
+    printf("checksums %.6g %.6g %.6g  %s\n", splanar, spacked, sviews,
+            splanar == spacked && splanar == sviews ? "match" : "DIFFER");
+
+    for (i = 0; i < 2; ++i)
+    {
+        delete f[i].vimg;
+        delete f[i].vgradx;
+        delete f[i].vgrady;
+        delete f[i].packed;
+        delete f[i].img;
+        delete f[i].gradx;
+        delete f[i].grady;
+    }
+    return splanar == spacked && splanar == sviews ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Microbenchmark of the colour pyramid layouts
+# on the tracker's window sampling
+#
+#-------------------------------------------------
+
+TARGET = PyramidBench
+TEMPLATE = app
+QT += core gui
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    PyramidBench.cpp \
+    ../PackedPyramid.cpp \
+    ../Pyramid.cpp \
+    ../klt_util.cpp \
+    ../Convolve.cpp \
+    ../Kernels.cpp \
+    ../Error.c
+
+HEADERS += \
+    ../PackedPyramid.h \
+    ../Pyramid.h \
+    ../klt_util.h \
+    ../Convolve.h \
+    ../Kernels.h
@@ -19,6 +19,7 @@
 
  */
 
+#include <QElapsedTimer>
 #include "KLT.h"
 #include "MyAssert.h"
 
@@ -87,16 +88,55 @@ void KLT_TrackingContext::splineTrack(const KLT_FullCPyramid** pyrms,
     _mts->takeControls(&(_mts->_Z));
     _mts->discretizeAll(2, RESAMPLE_CONSISTENTLY); // comment out if RESAMPLE wanted     2 sampling not usual
 
+    // With adaptiveLevels each level starts from the trust radius the one
+    // above ended with, and once a level other than the first takes its
+    // steps without a rejected one and moves the curves by less than level
+    // 0 would bother with, the coarser levels have found the solution and
+    // the finer ones are skipped.  A level whose steps were all rejected
+    // has moved nothing and settles nothing.
+    _levelStats.clear();
+    double trustRadius = 10.; // initial trust radius.
+    bool settled = false;
     for (int r = mylevels - 1; r >= 0; r--)
     {
+        KLT_SplineLevelStats stats;
+        memset(&stats, 0, sizeof(stats));
+        stats.level = r;
+        if (settled)
+        {
+            stats.skipped = true;
+            _levelStats.push_back(stats);
+            printf("\nLevel %d skipped\n", r);
+            continue;
+        }
+
         if (useEdges)
         {
             initSplineEdgeMins(pyrmsE, r);
         }
         printf("\nLevel %d\n", r);
 
-        safeSplineTrack(pyrms, pyrmsE, r);
-
+        QElapsedTimer levelTime;
+        levelTime.start();
+        stats.startRadius = trustRadius;
+        safeSplineTrack(pyrms, pyrmsE, r, &trustRadius, &stats);
+        stats.endRadius = trustRadius;
+        stats.msecs = (int) levelTime.elapsed();
+        _levelStats.push_back(stats);
+        printf("Level %d: %d steps, %d rejected, %d cg iterations, %d ms\n",
+                r, stats.steps, stats.rejected, stats.cgIterations,
+                stats.msecs);
+
+        if (adaptiveLevels && r > 0)
+        {
+            settled = r < mylevels - 1 && stats.steps > 0
+                    && stats.rejected == 0
+                    && stats.maxStep < splineTolerance(0);
+            trustRadius = MIN(10.,
+                    MAX(2. * trustRadius, 4. * splineTolerance(r - 1)));
+        }
+        else
+            trustRadius = 10.;
     }
     //fclose(fpo);
 
@@ -140,6 +180,7 @@ void KLT_TrackingContext::doOneStep(CSplineKeeper* keep, double* x)
     ZVec Z2 = _mts->_Z;
     _mts->createTestSol(&Z2, x, &(_mts->_Z));
     _mts->_z_mutex->unlock();
+    _mts->publishControls();
 
     /*FILE* fp = fopen("x.txt", "w");
      for (int i=0; i<keep->numVar(); ++i) {
@@ -156,7 +197,7 @@ void KLT_TrackingContext::doSplineShapeInterp()
     useEdges = false;
 
     double* x = new double[_mts->numVars()];
-    CSplineKeeper *keep = new CSplineKeeper(_mts);
+    CSplineKeeper *keep = new CSplineKeeper(_mts, preconditioner);
     ZVec Z2;
 
     // first: D2 + D1
@@ -206,13 +247,22 @@ void KLT_TrackingContext::doSplineShapeInterp()
     delete keep;
 }
 
+double KLT_TrackingContext::splineTolerance(const int level) const
+{
+    if (!adaptiveLevels)
+        return level == 0 ? .1 : .5;  // .25 : 1
+    // a tenth of a pixel of the level
+    return .1 * pow(double(subsampling), level);
+}
+
 void KLT_TrackingContext::safeSplineTrack(const KLT_FullCPyramid** pyrms,
-        const KLT_FullPyramid** pyrmsE, const int level)
+        const KLT_FullPyramid** pyrmsE, const int level, double* trustRadius,
+        KLT_SplineLevelStats* stats)
 {
     bool res = true;
     while (1)
     {
-        res = innerSplineTrack(pyrms, pyrmsE, level);
+        res = innerSplineTrack(pyrms, pyrmsE, level, trustRadius, stats);
 
         if (res)
             break;
@@ -230,7 +280,8 @@ void KLT_TrackingContext::safeSplineTrack(const KLT_FullCPyramid** pyrms,
 
 #define IST2_DELETE   delete[] x; delete keep1; delete keep2; //if (imgKeep) delete imgKeep; if (edgeKeep) delete edgeKeep;
 bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
-        const KLT_FullPyramid** pyrmsE, const int level)
+        const KLT_FullPyramid** pyrmsE, const int level, double* radius,
+        KLT_SplineLevelStats* stats)
 {
     int iteration = 0;
 
@@ -241,9 +292,9 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
     //Vec2f* Z2 = new Vec2f[sizeZ];
     //memcpy(Z2, _mts->_Z, sizeZ*sizeof(Vec2f));
     ZVec Z2 = _mts->_Z;
-    double trustRadius = 10.; // initial trust radius.
-    CSplineKeeper *keep1 = new CSplineKeeper(_mts), *keep2 = new CSplineKeeper(
-            _mts);
+    double trustRadius = *radius;
+    CSplineKeeper *keep1 = new CSplineKeeper(_mts, preconditioner), *keep2 =
+            new CSplineKeeper(_mts, preconditioner);
     /*CSplineKeeper *imgKeep = NULL, *edgeKeep = NULL;
      if (useImage)
      imgKeep = new CSplineKeeper(keep1);
@@ -251,11 +302,8 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
      edgeKeep = new CSplineKeeper(keep1);*/
     double *x = new double[keep1->numVar()];
 
-    double prec;
-    if (level == 0)
-        prec = .1;  // .25
-    else
-        prec = 0.5;  // 1
+    const double prec = splineTolerance(level);
+    const double stepTol = adaptiveLevels ? prec : .1;
     double currTheta, newTheta;
     //keep1->printCurves(mt->_Z);
     currTheta = createSplineMatrices(pyrms, pyrmsE, &(_mts->_Z), level,
@@ -278,12 +326,13 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
     int maxIterations = 1000;
     do
     {
-        fprintf(stdout, "starting iteration %d\n", iteration);
+        if (verbose)
+            fprintf(stdout, "starting iteration %d\n", iteration);
 
         double ro = 0, maxStep = 10.; // 10 is just to force into loop initially
 
         bool boundaryHit;
-        while (maxStep > .1 && trustRadius >= prec && iteration <= maxIterations)
+        while (maxStep > stepTol && trustRadius >= prec && iteration <= maxIterations)
         {
 
             /*memset(x,0,sizeof(double)*keep1->numVar());
@@ -300,6 +349,7 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
 #endif
 
             int numIter = steihaugSolver(keep1, x, trustRadius, &boundaryHit); // stei, remember to clear x
+            stats->cgIterations += numIter;
 
             //fprintf(fpo,"level: %d iter: %3d numIter: %4d\n",level,iteration,numIter);
             //fflush(fpo);
@@ -329,7 +379,8 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
             if (_stateOk)
             {
                 maxStep = _mts->createTestSol(&(_mts->_Z), x, &Z2); // write to Z2
-                printf("max step %f\n", maxStep);
+                if (verbose)
+                    printf("max step %f\n", maxStep);
                 assert(maxStep < trustRadius + .00001);
             }
 
@@ -342,13 +393,14 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
             if (_stateOk)
             {
                 ro = keep1->calculateRo(x, newTheta, currTheta);
-                printf("ro: %f\n", ro);
-
-                printf("old %f, new %f\n", currTheta, newTheta);
+                if (verbose)
+                    printf("ro: %f\nold %f, new %f\n", ro, currTheta,
+                            newTheta);
                 if (ro < .25) // .25 otherwise , or 0
                 {
                     trustRadius *= .25;
-                    printf("reducing trustRadius to %f\n", trustRadius);
+                    if (verbose)
+                        printf("reducing trustRadius to %f\n", trustRadius);
                 }
                 else if (ro > .75 && boundaryHit) // add ro > .75 &&
                     trustRadius = MIN(2. * trustRadius, 10.);
@@ -359,13 +411,18 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
             {
                 if (ro <= 0) // don't take step
                 {
-                    printf("Not taking step\n");
+                    if (verbose)
+                        printf("Not taking step\n");
                     keep2->refresh();
+                    stats->rejected++;
                 }
                 else // step is fine
                 {
                     iteration++;
-                    printf("Taking step, iteration %d\n\n", iteration);
+                    stats->steps++;
+                    stats->maxStep = MAX(stats->maxStep, maxStep);
+                    if (verbose)
+                        printf("Taking step, iteration %d\n\n", iteration);
                     CSplineKeeper* kswap = keep1;
                     keep1 = keep2;
                     keep2 = kswap;
@@ -376,10 +433,13 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
                     //memcpy(_mts->_Z,Z2,sizeZ*sizeof(Vec2f));
                 }
                 _mts->_z_mutex->unlock();
+                if (ro > 0)
+                    _mts->publishControls();
             }
             else // don't apply update, get outta here
             {
                 _mts->_z_mutex->unlock();
+                *radius = trustRadius;
                 IST2_DELETE
                 ;
                 return false;
@@ -387,17 +447,20 @@ bool KLT_TrackingContext::innerSplineTrack(const KLT_FullCPyramid** pyrms,
 
         } // while loop
 
-        if (trustRadius < prec || maxStep < .1 || iteration > maxIterations)
+        if (trustRadius < prec || maxStep < stepTol || iteration > maxIterations)
             toContinue = false;
         else
             toContinue = true;
-        printf("\n\n");
+        if (verbose)
+            printf("\n\n");
 
     } while (toContinue);
 
     if (iteration == maxIterations)
         printf("Hit max number of iterations\n");
 
+    *radius = trustRadius;
+    stats->theta = currTheta;
     IST2_DELETE
     ;
     return true;
@@ -409,7 +472,53 @@ bool fequal(const double a, const double b)
     return (fabs(a - b) < .0001);
 }
 
-#define DELETE_CSM  delete[] theta; delete[] thetas; delete[] thetas1;  delete[] thetas0; delete[] thetaE; delete imgKeep; delete edgeKeep; delete D0Keep; delete D1Keep;
+// window locations across a curve sample and the colour and gradients there
+struct SampleStrip
+{
+    void resize(const int n)
+    {
+        x.resize(n);
+        y.resize(n);
+        col.resize(n);
+        gx.resize(n);
+        gy.resize(n);
+        status.resize(n);
+    }
+    void sample(const KLT_FullCPyramid* pyr, const int level)
+    {
+        if (x.empty())
+            return;
+        pyr->sample(level, x.size(), &x[0], &y[0], &col[0], &gx[0], &gy[0],
+                &status[0]);
+    }
+    std::vector<float> x, y;
+    std::vector<Vec3f> col, gx, gy;
+    std::vector<int> status;
+};
+
+class KLT_TrackingContext::AssemblyThread: public QThread
+{
+public:
+    AssemblyThread(KLT_TrackingContext* tc, const KLT_FullCPyramid** pyrms,
+            const KLT_FullPyramid** pyrmsE, const int level,
+            SplineAssembly* a) :
+            _tc(tc), _pyrms(pyrms), _pyrmsE(pyrmsE), _level(level), _a(a)
+    {
+    }
+protected:
+    virtual void run()
+    {
+        _tc->assembleSplineRange(_pyrms, _pyrmsE, _level, _a);
+    }
+private:
+    KLT_TrackingContext* _tc;
+    const KLT_FullCPyramid** _pyrms;
+    const KLT_FullPyramid** _pyrmsE;
+    int _level;
+    SplineAssembly* _a;
+};
+
+#define DELETE_CSM  delete[] theta; delete[] thetas; delete[] thetas1;  delete[] thetas0; delete[] thetaE; delete imgKeep; delete edgeKeep; delete D0Keep; delete D1Keep; delete[] parts;
 
 double KLT_TrackingContext::createSplineMatrices(const KLT_FullCPyramid** pyrms,
         const KLT_FullPyramid** pyrmsE, ZVec* Z, const int level,
@@ -428,10 +537,221 @@ double KLT_TrackingContext::createSplineMatrices(const KLT_FullCPyramid** pyrms,
     time9.restart();
 #endif
 
+    int numFrames = _mts->_numFrames;
+    double invcw, invew, invd0, invd1, invd2;
+    int i, k;
+
+    double *theta = new double[numFrames], *thetaE = new double[numFrames],
+            *thetas = new double[numFrames], *thetas1 = new double[numFrames],
+            *thetas0 = new double[numFrames];
+    memset(theta, 0, numFrames * sizeof(double)); // image term
+    memset(thetas, 0, numFrames * sizeof(double)); //2nd deriv term
+    memset(thetas1, 0, numFrames * sizeof(double));
+    memset(thetas0, 0, numFrames * sizeof(double));
+    memset(thetaE, 0, numFrames * sizeof(double));
+
+    _mts->takeControls(Z);
+    _mts->discretizeAll(2, REEVALUATE, true); // or RESAMPLE
+
+#ifdef _TIME_
+    tt9 += time9.elapsed();
+#endif
+
+    // split the frames into contiguous shares, one per thread, each
+    // accumulating into keepers of its own
+    int nparts = assemblyThreads > 0 ?
+            assemblyThreads : QThread::idealThreadCount();
+    nparts = MAX(1, MIN(nparts, numFrames));
+    SplineAssembly* parts = new SplineAssembly[nparts];
+    for (k = 0; k < nparts; ++k)
+    {
+        SplineAssembly& a = parts[k];
+        memset(&a, 0, sizeof(SplineAssembly));
+        a.t0 = numFrames * k / nparts;
+        a.t1 = numFrames * (k + 1) / nparts;
+        a.imgKeep = new CSplineKeeper(keep);
+        a.edgeKeep = new CSplineKeeper(keep);
+        a.D0Keep = new CSplineKeeper(keep);
+        a.D1Keep = new CSplineKeeper(keep);
+        a.D2Keep = k == 0 ? keep : new CSplineKeeper(keep); // keep is already refreshed
+        a.theta = theta;
+        a.thetaE = thetaE;
+        a.thetas = thetas;
+        a.thetas1 = thetas1;
+        a.thetas0 = thetas0;
+    }
+
+    std::vector<AssemblyThread*> threads;
+    for (k = 1; k < nparts; ++k)
+    {
+        threads.push_back(
+                new AssemblyThread(this, pyrms, pyrmsE, level, parts + k));
+        threads.back()->start();
+    }
+    assembleSplineRange(pyrms, pyrmsE, level, parts);
+    for (k = 0; k < int(threads.size()); ++k)
+    {
+        threads[k]->wait();
+        delete threads[k];
+    }
+
+    // reduce everything into the first share
+    CSplineKeeper *imgKeep = parts[0].imgKeep, *edgeKeep = parts[0].edgeKeep,
+            *D0Keep = parts[0].D0Keep, *D1Keep = parts[0].D1Keep;
+    int imgCompCount = parts[0].imgCompCount, edgeCompCount =
+            parts[0].edgeCompCount, smooth0Count = parts[0].smooth0Count,
+            smooth1Count = parts[0].smooth1Count, smooth2Count =
+                    parts[0].smooth2Count;
+    for (k = 1; k < nparts; ++k)
+    {
+        SplineAssembly& a = parts[k];
+        imgKeep->addMat(a.imgKeep);
+        edgeKeep->addMat(a.edgeKeep);
+        D0Keep->addMat(a.D0Keep);
+        D1Keep->addMat(a.D1Keep);
+        keep->addMat(a.D2Keep);
+        imgCompCount += a.imgCompCount;
+        edgeCompCount += a.edgeCompCount;
+        smooth0Count += a.smooth0Count;
+        smooth1Count += a.smooth1Count;
+        smooth2Count += a.smooth2Count;
+        for (i = 0; i < 5; ++i)
+        {
+            parts[0].hits[i] += a.hits[i];
+            parts[0].obs[i] += a.obs[i];
+        }
+        delete a.imgKeep;
+        delete a.edgeKeep;
+        delete a.D0Keep;
+        delete a.D1Keep;
+        delete a.D2Keep;
+    }
+
+    static const char* cacheNames[5] = { "Image", "D0", "D1", "D2", "E" };
+    for (i = 0; i < 5; ++i)
+        printf("%s hit rate %.5f\n", cacheNames[i],
+                double(parts[0].hits[i]) / double(parts[0].obs[i]));
+#ifdef _TIME_
+    if (tt2 == 0)
+    time2.start();
+    else
+    time2.restart();
+#endif
+
+    if (smooth2Count > 0)
+    {
+        invd2 = _mts->_numFrames * smooth2Deriv / double(smooth2Count);
+        printf("invd2 %f\n", invd2);
+        keep->scalarMult(invd2);
+    }
+    else
+        invd2 = 0;
+
+    if (smooth0Count > 0)
+    {
+        invd0 = _mts->_numFrames * smooth0Deriv / double(smooth0Count);
+        D0Keep->scalarMult(invd0);
+        keep->addMat(D0Keep);
+    }
+    else
+        invd0 = 0;
+
+    if (smooth1Count > 0)
+    {
+        invd1 = _mts->_numFrames * smooth1Deriv / double(smooth1Count);
+        D1Keep->scalarMult(invd1);
+        keep->addMat(D1Keep);
+    }
+    else
+        invd1 = 0;
+
+    if (imgCompCount > 0)
+    {
+        invcw = _mts->_numFrames * 1. / double(imgCompCount);
+        imgKeep->scalarMult(invcw);
+        keep->addMat(imgKeep);
+    }
+    else
+    {
+        printf("No image count\n");
+        invcw = 0;
+    }
+    if (edgeCompCount > 0)
+    {
+        invew = edgeWeight / double(edgeCompCount);
+        edgeKeep->scalarMult(invew);
+        keep->addMat(edgeKeep);
+    }
+    else
+    {
+        printf("No edge count\n");
+        invew = 0;
+    }
+
+#ifdef _TIME_
+    tt2 += time2.elapsed();
+#endif
+
+    //keep->outputMat("B.dat");
+    //keep->shit();
+    //std::exit(0);
+
+#ifdef _TIME_
+    if (tt11 == 0)
+    time11.start();
+    else
+    time11.restart();
+#endif
+
+    double thetaSum = 0;
+    for (i = 0; i < numFrames; ++i)
+        thetaSum += theta[i] * invcw + thetas1[i] * invd1 + thetas[i] * invd2
+                + thetas0[i] * invd0 + thetaE[i] * invew;
+
+    if (_stateOk)
+    {
+        fprintf(stdout, "%9f = ", thetaSum);
+
+        for (i = 0; i < numFrames; ++i)
+            fprintf(stdout, "%.3f + ", theta[i] * invcw);  // image
+        fprintf(stdout, "\nD2          ");
+        for (i = 0; i < numFrames; ++i)
+            fprintf(stdout, "%.3f + ", thetas[i] * invd2);  // D2
+        fprintf(stdout, "\nD1          ");
+        for (i = 0; i < numFrames; ++i)
+            fprintf(stdout, "%.3f + ", thetas1[i] * invd1);  // D1
+        fprintf(stdout, "\nD0          ");
+        for (i = 0; i < numFrames; ++i)
+            fprintf(stdout, "%.3f + ", thetas0[i] * invd0);  // D0
+        fprintf(stdout, "\nEdge        ");
+        for (i = 0; i < numFrames - 1; ++i)
+            fprintf(stdout, "%.3f + ", thetaE[i] * invew);  // Edge
+        printf("\n");
+    }
+
+    //std::exit(0);
+#ifdef _TIME_
+    tt11 += time11.elapsed();
+#endif
+
+    tt1 += time1.elapsed();
+
+    DELETE_CSM
+    ;
+    return thetaSum;
+}
+
+// Jacobian and residual terms of frames a->t0 .. a->t1-1 into the keepers
+// of a.  Runs on several threads at once: only reads _mts and the pyramids,
+// and writes the shared theta arrays at frames of its own share only.
+void KLT_TrackingContext::assembleSplineRange(const KLT_FullCPyramid** pyrms,
+        const KLT_FullPyramid** pyrmsE, const int level, SplineAssembly* a)
+{
     int numFrames = _mts->_numFrames;
     int n, c, j, validPoint, di, t;
+    const int t0 = a->t0, t1 = a->t1;
     Vec2f loc;
-    Vec3f col1, col, dummy;
+    Vec3f col1, col;
     double K[16], K1[16], grad[24], grad1[24];
     double G_t[6], G_t1[6]; // 3x2 Jacobian matrices
     int vars[4], vars1[4]; // full-2, but 1 per pair
@@ -440,7 +760,7 @@ double KLT_TrackingContext::createSplineMatrices(const KLT_FullCPyramid** pyrms,
     int ds1num;
     float invsubs = 1. / float(pow2(level));
     float subs = float(pow2(level));
-    double invcw, invew, invd0, invd1, invd2;
+    SampleStrip strip0, strip1; // frames t and t+1
     //SamplePreComp snum, snum1;
 
     // for sample-based schemes
@@ -450,40 +770,20 @@ double KLT_TrackingContext::createSplineMatrices(const KLT_FullCPyramid** pyrms,
     bool D1_parameter_based = false;
     bool checkOk;
 
-    double *theta = new double[numFrames], *thetaE = new double[numFrames],
-            *thetas = new double[numFrames], *thetas1 = new double[numFrames],
-            *thetas0 = new double[numFrames];
-    memset(theta, 0, numFrames * sizeof(double)); // image term
-    memset(thetas, 0, numFrames * sizeof(double)); //2nd deriv term
-    memset(thetas1, 0, numFrames * sizeof(double));
-    memset(thetas0, 0, numFrames * sizeof(double));
-    memset(thetaE, 0, numFrames * sizeof(double));
-
+    double *theta = a->theta, *thetaE = a->thetaE, *thetas = a->thetas,
+            *thetas1 = a->thetas1, *thetas0 = a->thetas0;
     int imgCompCount = 0, edgeCompCount = 0, smooth0Count = 0, smooth1Count = 0,
             smooth2Count = 0;
     int stride = pow2(level); // careful
-    /*if (imgKeep)
-     imgKeep->refresh();
-     if (edgeKeep)
-     edgeKeep->refresh();*/
-    //printf("Here 1\n");
-    CSplineKeeper *imgKeep = new CSplineKeeper(keep), *edgeKeep =
-            new CSplineKeeper(keep), *D0Keep = new CSplineKeeper(keep),
-            *D1Keep = new CSplineKeeper(keep); // D2Keep is just keep, which is already refreshed
+    CSplineKeeper *imgKeep = a->imgKeep, *edgeKeep = a->edgeKeep, *D0Keep =
+            a->D0Keep, *D1Keep = a->D1Keep, *keep = a->D2Keep;
 
     ObsCache imgCache(imgKeep), D0Cache(D0Keep), D1Cache(D1Keep), D2Cache(keep),
             ECache(edgeKeep);
 
-    _mts->takeControls(Z);
-    _mts->discretizeAll(2, REEVALUATE, true); // or RESAMPLE
-
-#ifdef _TIME_
-    tt9 += time9.elapsed();
-#endif
-
     for (c = 0; c < _mts->_nCurves && _stateOk; c++) // iterate over curves
     {
-        for (t = 0; t < _mts->_numFrames && _stateOk; ++t) // ONE,_numFrames-1,  -1, shouldn't be there
+        for (t = t0; t < t1 && _stateOk; ++t) // ONE,_numFrames-1,  -1, shouldn't be there
         { //_mts->discretize(t, c, pow2(level));
 
             un = _mts->getNumSamples(t, c) - 1;
@@ -563,8 +863,24 @@ double KLT_TrackingContext::createSplineMatrices(const KLT_FullCPyramid** pyrms,
                     if (n == un || ds1num == un1)
                         continue;
 
-                    for (j = _mts->_trackWidths[c].x();
-                            j <= _mts->_trackWidths[c].y(); ++j)
+                    // the whole strip across the curve is sampled at once
+                    const int jlo = _mts->_trackWidths[c].x();
+                    const int jhi = _mts->_trackWidths[c].y();
+                    strip0.resize(jhi - jlo + 1);
+                    strip1.resize(jhi - jlo + 1);
+                    for (j = jlo; j <= jhi; ++j)
+                    {
+                        splineLoc(ds1, j, invsubs, &loc);
+                        strip1.x[j - jlo] = loc.x();
+                        strip1.y[j - jlo] = loc.y();
+                        splineLoc(ds, j, invsubs, &loc);
+                        strip0.x[j - jlo] = loc.x();
+                        strip0.y[j - jlo] = loc.y();
+                    }
+                    strip1.sample(pyrms[t + 1], level);
+                    strip0.sample(pyrms[t], level);
+
+                    for (j = jlo; j <= jhi; ++j)
                     {
 
 #ifdef _TIME_
@@ -574,35 +890,24 @@ double KLT_TrackingContext::createSplineMatrices(const KLT_FullCPyramid** pyrms,
                         time7.restart();
 #endif
 
-                        validPoint = 0;
-                        splineLoc(ds1, j, invsubs, &loc);
-                        //printf("n: %d aloc: %f %f ",n,loc.x(), loc.y());
-                        di = pyrms[t + 1]->img->color(loc.x(), loc.y(), level,
-                                col1);
-                        validPoint = MIN(di, validPoint);
-                        pyrms[t + 1]->gradx->color(loc.x(), loc.y(), level,
-                                dummy);
-                        G_t1[0] = dummy.r();
-                        G_t1[2] = dummy.g();
-                        G_t1[4] = dummy.b();
-                        pyrms[t + 1]->grady->color(loc.x(), loc.y(), level,
-                                dummy);
-                        G_t1[1] = dummy.r();
-                        G_t1[3] = dummy.g();
-                        G_t1[5] = dummy.b();
-
-                        splineLoc(ds, j, invsubs, &loc);
-                        //printf("bloc: %f %f\n",loc.x(), loc.y());
-                        di = pyrms[t]->img->color(loc.x(), loc.y(), level, col);
-                        validPoint = MIN(di, validPoint);
-                        pyrms[t]->gradx->color(loc.x(), loc.y(), level, dummy);
-                        G_t[0] = dummy.r();
-                        G_t[2] = dummy.g();
-                        G_t[4] = dummy.b();
-                        pyrms[t]->grady->color(loc.x(), loc.y(), level, dummy);
-                        G_t[1] = dummy.r();
-                        G_t[3] = dummy.g();
-                        G_t[5] = dummy.b();
+                        const int s = j - jlo;
+                        validPoint = MIN(strip1.status[s], 0);
+                        col1 = strip1.col[s];
+                        G_t1[0] = strip1.gx[s].r();
+                        G_t1[2] = strip1.gx[s].g();
+                        G_t1[4] = strip1.gx[s].b();
+                        G_t1[1] = strip1.gy[s].r();
+                        G_t1[3] = strip1.gy[s].g();
+                        G_t1[5] = strip1.gy[s].b();
+
+                        validPoint = MIN(strip0.status[s], validPoint);
+                        col = strip0.col[s];
+                        G_t[0] = strip0.gx[s].r();
+                        G_t[2] = strip0.gx[s].g();
+                        G_t[4] = strip0.gx[s].b();
+                        G_t[1] = strip0.gy[s].r();
+                        G_t[3] = strip0.gy[s].g();
+                        G_t[5] = strip0.gy[s].b();
 
                         if (validPoint == 0)
                         {
@@ -1299,120 +1604,19 @@ double KLT_TrackingContext::createSplineMatrices(const KLT_FullCPyramid** pyrms,
     D1Cache.writeBack();
     D2Cache.writeBack();
     ECache.writeBack();
-    printf("Image hit rate %.5f\n", imgCache.hitRate());
-    printf("D0 hit rate %.5f\n", D0Cache.hitRate());
-    printf("D1 hit rate %.5f\n", D1Cache.hitRate());
-    printf("D2 hit rate %.5f\n", D2Cache.hitRate());
-    printf("E hit rate %.5f\n", ECache.hitRate());
-#ifdef _TIME_
-    if (tt2 == 0)
-    time2.start();
-    else
-    time2.restart();
-#endif
-
-    if (smooth2Count > 0)
-    {
-        invd2 = _mts->_numFrames * smooth2Deriv / double(smooth2Count);
-        printf("invd2 %f\n", invd2);
-        keep->scalarMult(invd2);
-    }
-    else
-        invd2 = 0;
-
-    if (smooth0Count > 0)
-    {
-        invd0 = _mts->_numFrames * smooth0Deriv / double(smooth0Count);
-        D0Keep->scalarMult(invd0);
-        keep->addMat(D0Keep);
-    }
-    else
-        invd0 = 0;
-
-    if (smooth1Count > 0)
-    {
-        invd1 = _mts->_numFrames * smooth1Deriv / double(smooth1Count);
-        D1Keep->scalarMult(invd1);
-        keep->addMat(D1Keep);
-    }
-    else
-        invd1 = 0;
 
-    if (imgCompCount > 0)
-    {
-        invcw = _mts->_numFrames * 1. / double(imgCompCount);
-        imgKeep->scalarMult(invcw);
-        keep->addMat(imgKeep);
-    }
-    else
-    {
-        printf("No image count\n");
-        invcw = 0;
-    }
-    if (edgeCompCount > 0)
-    {
-        invew = edgeWeight / double(edgeCompCount);
-        edgeKeep->scalarMult(invew);
-        keep->addMat(edgeKeep);
-    }
-    else
+    a->imgCompCount = imgCompCount;
+    a->edgeCompCount = edgeCompCount;
+    a->smooth0Count = smooth0Count;
+    a->smooth1Count = smooth1Count;
+    a->smooth2Count = smooth2Count;
+    const ObsCache* caches[5] = { &imgCache, &D0Cache, &D1Cache, &D2Cache,
+            &ECache };
+    for (int i = 0; i < 5; ++i)
     {
-        printf("No edge count\n");
-        invew = 0;
+        a->hits[i] = caches[i]->hits();
+        a->obs[i] = caches[i]->totalObs();
     }
-
-#ifdef _TIME_
-    tt2 += time2.elapsed();
-#endif
-
-    //keep->outputMat("B.dat");
-    //keep->shit();
-    //std::exit(0);
-
-#ifdef _TIME_
-    if (tt11 == 0)
-    time11.start();
-    else
-    time11.restart();
-#endif
-
-    double thetaSum = 0;
-    int i;
-    for (i = 0; i < numFrames; ++i)
-        thetaSum += theta[i] * invcw + thetas1[i] * invd1 + thetas[i] * invd2
-                + thetas0[i] * invd0 + thetaE[i] * invew;
-
-    if (_stateOk)
-    {
-        fprintf(stdout, "%9f = ", thetaSum);
-
-        for (i = 0; i < numFrames; ++i)
-            fprintf(stdout, "%.3f + ", theta[i] * invcw);  // image
-        fprintf(stdout, "\nD2          ");
-        for (i = 0; i < numFrames; ++i)
-            fprintf(stdout, "%.3f + ", thetas[i] * invd2);  // D2
-        fprintf(stdout, "\nD1          ");
-        for (i = 0; i < numFrames; ++i)
-            fprintf(stdout, "%.3f + ", thetas1[i] * invd1);  // D1
-        fprintf(stdout, "\nD0          ");
-        for (i = 0; i < numFrames; ++i)
-            fprintf(stdout, "%.3f + ", thetas0[i] * invd0);  // D0
-        fprintf(stdout, "\nEdge        ");
-        for (i = 0; i < numFrames - 1; ++i)
-            fprintf(stdout, "%.3f + ", thetaE[i] * invew);  // Edge
-        printf("\n");
-    }
-
-    //std::exit(0);
-#ifdef _TIME_
-    tt11 += time11.elapsed();
-#endif
-
-    tt1 += time1.elapsed();
-
-    DELETE_CSM
-    ;
-    return thetaSum;
 }
 
 void KLT_TrackingContext::putGradOnJ(Ubcv& J1, Ubcv& J2, Ubcv& J3,
@@ -29,17 +29,38 @@ private:
 
 void splineTrack(const KLT_FullCPyramid** pyrms, const KLT_FullPyramid** pyrmsE, bool redo);
 
+// trustRadius is the one to start with and is left as the solve ended
 void safeSplineTrack(const KLT_FullCPyramid** pyrms,
-        const KLT_FullPyramid** pyrmsE, const int level);
+        const KLT_FullPyramid** pyrmsE, const int level,
+        double* trustRadius, KLT_SplineLevelStats* stats);
 
 bool innerSplineTrack(const KLT_FullCPyramid** pyrms,
-        const KLT_FullPyramid** pyrmsE, const int level);
+        const KLT_FullPyramid** pyrmsE, const int level,
+        double* trustRadius, KLT_SplineLevelStats* stats);
+
+// a level's solve stops once steps or the trust radius fall below this
+double splineTolerance(const int level) const;
 
 double createSplineMatrices(const KLT_FullCPyramid** pyrms,
         const KLT_FullPyramid** pyrmsE, ZVec* Z, const int level,
         CSplineKeeper* keep/*,
          CSplineKeeper *imgKeep, CSplineKeeper *edgeKeep*/);
 
+// one thread's share of createSplineMatrices: frames t0..t1-1 into keepers
+// of its own, reduced once every share is done
+struct SplineAssembly
+{
+    int t0, t1;
+    CSplineKeeper *imgKeep, *edgeKeep, *D0Keep, *D1Keep, *D2Keep;
+    double *theta, *thetaE, *thetas, *thetas1, *thetas0; // shared
+    int imgCompCount, edgeCompCount, smooth0Count, smooth1Count, smooth2Count;
+    int hits[5], obs[5]; // image, D0, D1, D2, edge caches
+};
+class AssemblyThread;
+
+void assembleSplineRange(const KLT_FullCPyramid** pyrms,
+        const KLT_FullPyramid** pyrmsE, const int level, SplineAssembly* a);
+
 void initSplineEdgeMins(const KLT_FullPyramid** pyrmsE, const int level);
 
 void putGradOnJ(Ubcv& J1, Ubcv& J2, Ubcv& J3, const double grad[24],
@@ -73,3 +94,20 @@ FILE* fpo;
 
 public:
 MultiSplineData* _mts;
+
+// the levels of the last splineTrack, coarsest first
+const std::vector<KLT_SplineLevelStats>& levelStats() const
+{
+    return _levelStats;
+}
+
+// milliseconds the last splineTrack spent in createSplineMatrices
+int assemblyMsecs() const
+{
+    return tt1;
+}
+
+private:
+std::vector<KLT_SplineLevelStats> _levelStats;
+
+public:
@@ -31,6 +31,7 @@
 #include "base.h"
 #include "Error.h"
 #include "klt_util.h"
+#include "Convolve.h"
 
 /*
  float _KLTComputeSmoothSigma(  // add to tracking context class
@@ -220,132 +221,24 @@ void KLT_FloatImage::convolveSeparate(const ConvolutionKernel* horiz_kernel,
 {
     assert(imgout->ncols == ncols && imgout->nrows == nrows);
 
-    // Create temporary image
-    KLT_FloatImage* tmpimg = new KLT_FloatImage(ncols, nrows);
-
-    // Do convolution
-    convolveImageHoriz(horiz_kernel, tmpimg);
-
-    tmpimg->convolveImageVert(vert_kernel, imgout);
-
-    // Free memory
-    delete tmpimg;
-}
-
-void KLT_FloatImage::convolveImageHoriz(const ConvolutionKernel* kernel,
-        KLT_FloatImage* imgout) const
-{
-
-    float *ptrrow = data; /* Points to row's first pixel */
-    float *ptrout = imgout->data, /* Points to next output pixel */
-    *ppp;
-    float sum;
-    int radius = kernel->width / 2;
-    int i, j, k;
-
-    /* Kernel width must be odd */
-    assert(kernel->width % 2 == 1);
-
-    /* Must read from and write to different images */
-    assert(this != imgout);
-
-    /* Output image must be large enough to hold result */
-    assert(imgout->ncols >= ncols);
-    assert(imgout->nrows >= nrows);
-
-    /* For each row, do ... */
-    for (j = 0; j < nrows; j++)
-    {
-
-        /* Zero leftmost columns */
-        for (i = 0; i < radius; i++)
-            *ptrout++ = 0.0;
-
-        /* Convolve middle columns with kernel */
-        for (; i < ncols - radius; i++)
-        {
-            ppp = ptrrow + i - radius;
-            sum = 0.0;
-            for (k = kernel->width - 1; k >= 0; k--)
-                sum += *ppp++ * kernel->data[k];
-            *ptrout++ = sum;
-        }
-
-        /* Zero rightmost columns */
-        for (; i < ncols; i++)
-            *ptrout++ = 0.0;
-
-        ptrrow += ncols;
-    }
-}
-
-void KLT_FloatImage::convolveImageVert(const ConvolutionKernel* kernel,
-        KLT_FloatImage* imgout) const
-{
-    float *ptrcol = data; /* Points to row's first pixel */
-    float *ptrout = imgout->data, /* Points to next output pixel */
-    *ppp;
-    float sum;
-    int radius = kernel->width / 2;
-    int i, j, k;
-
-    /* Kernel width must be odd */
-    assert(kernel->width % 2 == 1);
-
     /* Must read from and write to different images */
     assert(this != imgout);
 
-    /* Output image must be large enough to hold result */
-    assert(imgout->ncols >= ncols);
-    assert(imgout->nrows >= nrows);
-
-    /* For each column, do ... */
-    for (i = 0; i < ncols; i++)
-    {
-
-        /* Zero topmost rows */
-        for (j = 0; j < radius; j++)
-        {
-            *ptrout = 0.0;
-            ptrout += ncols;
-        }
-
-        /* Convolve middle rows with kernel */
-        for (; j < nrows - radius; j++)
-        {
-            ppp = ptrcol + ncols * (j - radius);
-            sum = 0.0;
-            for (k = kernel->width - 1; k >= 0; k--)
-            {
-                sum += *ppp * kernel->data[k];
-                ppp += ncols;
-            }
-            *ptrout = sum;
-            ptrout += ncols;
-        }
-
-        /* Zero bottommost rows */
-        for (; j < nrows; j++)
-        {
-            *ptrout = 0.0;
-            ptrout += ncols;
-        }
-
-        ptrcol++;
-        ptrout -= nrows * ncols - 1;
-    }
+    KLTConvolveSeparate(data, ncols, nrows, horiz_kernel, vert_kernel,
+            imgout->data);
 }
 
 void KLT_FloatImage::computeGradients(Kernels* kern, KLT_FloatImage* gradx,
         KLT_FloatImage* grady) const
 {
-    assert(gradx->ncols >= ncols);
-    assert(gradx->nrows >= nrows);
-    assert(grady->ncols >= ncols);
-    assert(grady->nrows >= nrows);
-
-    convolveSeparate(kern->gaussDeriv(), kern->gauss(), gradx);
-    convolveSeparate(kern->gauss(), kern->gaussDeriv(), grady);
+    assert(gradx->ncols == ncols);
+    assert(gradx->nrows == nrows);
+    assert(grady->ncols == ncols);
+    assert(grady->nrows == nrows);
+
+    // both share the horizontal passes over each row
+    KLTConvolveGradients(data, ncols, nrows, kern->gauss(),
+            kern->gaussDeriv(), gradx->data, grady->data);
 }
 
 /*********************************************************************
@@ -72,12 +72,6 @@ public:
     float *data;
 
 private:
-    void convolveImageVert(const ConvolutionKernel* kernel,
-            KLT_FloatImage* imgout) const;
-
-    void convolveImageHoriz(const ConvolutionKernel* kernel,
-            KLT_FloatImage* imgout) const;
-
     void convolveSeparate(const ConvolutionKernel* horiz_kernel,
             const ConvolutionKernel* vert_kernel, KLT_FloatImage* imgout) const;
 };
@@ -3,11 +3,15 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QTime>
+#include <QTimer>
+#include <QEventLoop>
 #include <QHBoxLayout>
 #include <QIcon>
 #include <QColorDialog>
 #include "RotoscopeModule.h"
 #include "DrawModule.h"
+#include "RotoProject.h"
+#include "ProjectFile.h"
 #include <QDebug>
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -15,12 +19,16 @@ MainWindow::MainWindow(QWidget *parent) :
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    progressDialog = 0;
+    project = new ProjectFile;
+    projectTimer = 0;
     setupVideoProcessor();
     setupToolBox();
 }
 
 MainWindow::~MainWindow()
 {
+    delete project;
     delete ui;
 }
 
@@ -78,6 +86,193 @@ void MainWindow::on_actionOpen_triggered()
     enableVideoUI(false);
 }
 
+// Into the open project if there is one, which only writes the frames that
+// changed.  npr-track reads and writes both formats; the text .roto one
+// has no strokes.
+void MainWindow::on_actionSave_triggered()
+{
+    QString fileName = project->fileName();
+    if(fileName.isEmpty())
+        fileName = QFileDialog::getSaveFileName(this,
+                                                tr("Save Project"),
+                                                ".",
+                                                tr("Projects (*.nprp);;Roto Projects (*.roto)"));
+    if(fileName.isEmpty())
+        return;
+
+    RotoProjectInfo info;
+    info.width = ui->frameWidget->_w;
+    info.height = ui->frameWidget->_h;
+    info.frames = (int)video->getLength();
+    RotoCurves *roto = ui->frameWidget->roto->_rotoCurvesArray;
+    DrawCurves *draw = ui->frameWidget->draw->drawCurves();
+    ui->frameWidget->draw->finishPropagation();
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok;
+    if(fileName.endsWith(".roto"))
+    {
+        finishProjectLoad();
+        ok = saveRotoProject(fileName.toStdString(), roto, info);
+    }
+    else
+        ok = project->save(fileName, roto, draw, info);
+    QApplication::restoreOverrideCursor();
+    if(!ok)
+        QMessageBox::warning(this, tr("Save Project"),
+                             tr("Could not write %1").arg(fileName));
+}
+
+// The frame shown is read at once and the others a few at a time while the
+// window is idle, so a long project opens without waiting for all of it.
+// The project's curves take the place of the ones there are.
+void MainWindow::on_actionOpenProject_triggered()
+{
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    tr("Open Project"),
+                                                    ".",
+                                                    tr("Projects (*.nprp *.roto)"));
+    if(fileName.isEmpty())
+        return;
+
+    finishProjectLoad();
+    ui->frameWidget->draw->finishPropagation();
+    if(hasCurves())
+    {
+        if(QMessageBox::question(this, tr("Open Project"),
+                tr("Opening a project drops the curves there are now. Go on?"),
+                QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)
+            return;
+        // fresh modules, as for a video just opened
+        setupFrameViewer();
+    }
+    project->close();
+    RotoCurves *roto = ui->frameWidget->roto->_rotoCurvesArray;
+    const int length = (int)video->getLength();
+    RotoProjectInfo info;
+    bool ok;
+    if(ProjectFile::isProjectFile(fileName))
+    {
+        ok = project->open(fileName, &info);
+        if(ok && info.frames > length)
+        {
+            project->close();
+            ok = false;
+        }
+        if(ok)
+        {
+            loadProjectFrame(ui->frameSpinBox->value());
+            projectTimer = startTimer(0);
+        }
+    }
+    else
+        ok = loadRotoProject(fileName.toStdString(), roto, length, &info);
+
+    if(!ok)
+        QMessageBox::warning(this, tr("Open Project"),
+                             tr("Could not read %1 for this video").arg(fileName));
+    ui->frameWidget->updateGL();
+}
+
+// The video as it is now, magnified or not
+void MainWindow::on_actionSaveVideo_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    tr("Save Video"),
+                                                    ".",
+                                                    tr("Video Files (*.avi)"));
+    if(fileName.isEmpty())
+        return;
+    if(!video->setOutput(fileName.toStdString()))
+    {
+        QMessageBox::warning(this, tr("Save Video"),
+                             tr("Could not write %1").arg(fileName));
+        return;
+    }
+    video->writeOutput();
+}
+
+void MainWindow::on_actionMotionMagnify_triggered()
+{
+    magnify(true);
+}
+
+void MainWindow::on_actionColorMagnify_triggered()
+{
+    magnify(false);
+}
+
+// The magnified video replaces the one open, as opening a video does, so
+// the curves drawn on the old frames go with it.
+void MainWindow::magnify(bool motion)
+{
+    if(hasCurves() && QMessageBox::question(this, tr("Magnify"),
+            tr("Magnifying replaces the video and drops its curves. Go on?"),
+            QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)
+        return;
+
+    finishProjectLoad();
+    ui->frameWidget->draw->finishPropagation();
+    QTime t;
+    t.start();
+    const bool ok = motion ? video->motionMagnify() : video->colorMagnify();
+    const int msecs = t.elapsed();
+    if(!ok)
+        return;
+
+    setupFrameViewer();
+    updateTimeLabel();
+    const long frames = video->getLength();
+    ui->statusBar->showMessage(
+                tr("%1 frames magnified in %2 s, %3 fps")
+                .arg(frames).arg(msecs / 1000.0, 0, 'f', 1)
+                .arg(frames * 1000.0 / qMax(msecs, 1), 0, 'f', 1));
+}
+
+bool MainWindow::hasCurves()
+{
+    const int length = (int)video->getLength();
+    RotoCurves *roto = ui->frameWidget->roto->_rotoCurvesArray;
+    DrawCurves *draw = ui->frameWidget->draw->drawCurves();
+    for(int i = 0; i <= length; ++i)
+        if(roto[i].getNumCurves() || draw[i].getNumCurves())
+            return true;
+    return false;
+}
+
+void MainWindow::loadProjectFrame(long index)
+{
+    if(project->isOpen())
+        project->loadFrame((int)index, ui->frameWidget->roto->_rotoCurvesArray,
+                           ui->frameWidget->draw->drawCurves());
+}
+
+// the tools may look at any frame
+void MainWindow::finishProjectLoad()
+{
+    if(!projectTimer)
+        return;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    while(project->loadSome(64, ui->frameWidget->roto->_rotoCurvesArray,
+                            ui->frameWidget->draw->drawCurves()))
+        ;
+    QApplication::restoreOverrideCursor();
+    killTimer(projectTimer);
+    projectTimer = 0;
+}
+
+void MainWindow::timerEvent(QTimerEvent *e)
+{
+    if(e->timerId() != projectTimer)
+        return;
+    if(!project->loadSome(16, ui->frameWidget->roto->_rotoCurvesArray,
+                          ui->frameWidget->draw->drawCurves()))
+    {
+        killTimer(projectTimer);
+        projectTimer = 0;
+    }
+}
+
 void MainWindow::on_btnPlay_clicked()
 {
     bool isStop = video->isStop();
@@ -139,6 +334,7 @@ void MainWindow::on_loopCheckBox_clicked(bool checked)
 
 void MainWindow::on_buttonGroupR_buttonClicked(QAbstractButton *button)
 {
+    finishProjectLoad();
     RotoscopeModule *roto = ui->frameWidget->roto;
     if (button == ui->pbMenuEditR)
         roto->toolChange(T_MANUAL);
@@ -157,6 +353,7 @@ void MainWindow::on_buttonGroupR_buttonClicked(QAbstractButton *button)
 
 void MainWindow::on_buttonGroupD_buttonClicked(QAbstractButton *button)
 {
+    finishProjectLoad();
     DrawModule *draw = ui->frameWidget->draw;
     if (button == ui->pbDrawD)
         draw->toolChange(D_DRAW);
@@ -172,6 +369,10 @@ void MainWindow::on_functionToolBox_currentChanged(int index)
 {
     RotoscopeModule *roto = ui->frameWidget->roto;
     DrawModule *draw = ui->frameWidget->draw;
+    finishProjectLoad();
+    // the roto curves may be edited once off the draw page
+    if(index!=3 && draw)
+        draw->finishPropagation();
     if(index==0)
         ui->frameWidget->changeModules(roto);
     else if(index==3)
@@ -208,18 +409,26 @@ void MainWindow::drawModuleCurrColorChanged()
 //Slots For VideoProcessor
 void MainWindow::showFrame(long index, cv::Mat frame)
 {
-    cv::Mat temp; // make the same cv::Mat
-    cvtColor(frame, temp,CV_BGR2RGB); // cvtColor Makes a copt, that what i need
-    QImage img = QImage((const unsigned char*)(temp.data),
-                        temp.cols, temp.rows, temp.step, QImage::Format_RGB888);
-    ui->frameWidget->showFrame(index,img);
+    // BGR straight from the video, the viewer swizzles it on upload
+    loadProjectFrame(index);
+    ui->frameWidget->showFrame(index, frame);
 }
 
 void MainWindow::sleep(int msecs)
 {
-    QTime dieTime = QTime::currentTime().addMSecs(msecs);
-    while(QTime::currentTime() < dieTime)
-        QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+    if (msecs <= 0) {
+        QCoreApplication::processEvents();
+        return;
+    }
+    // an event loop of its own until the timer fires, so the UI keeps
+    // running without spinning a core
+    QEventLoop loop;
+#if QT_VERSION >= 0x050000
+    QTimer::singleShot(msecs, Qt::PreciseTimer, &loop, SLOT(quit()));
+#else
+    QTimer::singleShot(msecs, &loop, SLOT(quit()));
+#endif
+    loop.exec();
 }
 
 void MainWindow::updateBtn()
@@ -246,6 +455,15 @@ void MainWindow::updateProgressBar()
 
     // update the time label
     updateTimeLabel();
+
+    // how playback keeps up
+    if (!video->isStop()) {
+        PlaybackStats stats = video->getPlaybackStats();
+        ui->statusBar->showMessage(
+                    tr("%1 fps, %2 late, %3 dropped, decode %4 ms, present %5 ms")
+                    .arg(stats.fps, 0, 'f', 1).arg(stats.late).arg(stats.dropped)
+                    .arg(stats.decodeMs, 0, 'f', 1).arg(stats.presentMs, 0, 'f', 1));
+    }
 }
 
 void MainWindow::updateProcessProgress(const std::string &message, int value)
@@ -269,6 +487,8 @@ void MainWindow::updateProcessProgress(const std::string &message, int value)
 
 void MainWindow::closeProgressDialog()
 {
+    if(!progressDialog)
+        return;
     progressDialog->close();
     progressDialog = 0;
 }
@@ -320,16 +540,19 @@ void MainWindow::setupFrameViewer()
     QSize videoAreaSize(frameSize.width,frameSize.height+50);
     ui->videoArea->setMinimumSize(videoAreaSize);
 
-    //Show the first video frmae
-    cv::Mat firstFrame;
-    if(video->getNextFrame(firstFrame))
-        showFrame(0, firstFrame);
-
     //Set up maximum frame number
     long videoLength = video->getLength();
     ui->frameSpinBox->setMaximum(videoLength-1);
     ui->labelOrgFrameNumber->setText(QString::number(videoLength));
-    ui->frameWidget->setUpModules(video->getClonedCapture(),(int)videoLength);
+    // the project was for the curves of the video before
+    if(projectTimer)
+        killTimer(projectTimer);
+    projectTimer = 0;
+    project->close();
+    ui->frameWidget->setUpModules(video->getFrameCache(),(int)videoLength);
+
+    //Show the first video frmae
+    ui->frameWidget->showFrame(0);
     connect(ui->frameWidget->roto, SIGNAL(enablePbCopySplinesAcrossTime(bool)),
             this, SLOT(enablePbCopySplinesAcrossTime(bool)));
     connect(ui->frameWidget->draw, SIGNAL(selectChanged()),
@@ -382,6 +605,10 @@ void MainWindow::enableVideoUI(bool vi)
     ui->frameSpinBox->setEnabled(vi);
     ui->functionToolBox->setEnabled(vi);
     ui->pageRotoscoping->setEnabled(vi);
+    ui->actionSave->setEnabled(vi);
+    ui->actionOpenProject->setEnabled(vi);
+    ui->actionSaveVideo->setEnabled(vi);
+    ui->menuMagnify->setEnabled(vi);
     if(!vi){
         ui->progressSlider->setValue(0);
     }
@@ -15,6 +15,7 @@ class MainWindow;
 }
 
 class VideoProcessor;
+class ProjectFile;
 
 class MainWindow : public QMainWindow
 {
@@ -26,6 +27,11 @@ public:
 
 private slots:
     void on_actionOpen_triggered();
+    void on_actionSave_triggered();
+    void on_actionOpenProject_triggered();
+    void on_actionSaveVideo_triggered();
+    void on_actionMotionMagnify_triggered();
+    void on_actionColorMagnify_triggered();
     void on_btnPlay_clicked();
     void on_btnStop_clicked();
     void on_progressSlider_valueChanged(int value);
@@ -49,6 +55,9 @@ private slots:
     void closeProgressDialog();                 // canceling the process
     void pickColor();
 
+protected:
+    void timerEvent(QTimerEvent *e);
+
 private:
     Ui::MainWindow *ui;
     QProgressDialog *progressDialog;            // Process progress
@@ -62,6 +71,13 @@ private:
     VideoProcessor *video;                      // video processor instance
     void setupVideoProcessor();
     bool loadFile(const QString &fileName);     // load file
+    bool hasCurves();                           // any roto or draw path
+    void magnify(bool motion);                  // magnify the video
+
+    ProjectFile *project;                       // project read frame by frame
+    int projectTimer;                           // reads the rest, 0 when done
+    void loadProjectFrame(long index);
+    void finishProjectLoad();
 };
 
 #endif // MAINWINDOW_H
@@ -28,11 +28,20 @@ SOURCES += \
     MainWindow.cpp \
     RotoscopeModule.cpp \
     VideoProcessor.cpp \
+    TemporalFilter.cpp \
+    FrameCache.cpp \
+    TrackScheduler.cpp \
+    RotoTracker.cpp \
+    DrawPropagator.cpp \
+    ProjectFile.cpp \
+    RotoProject.cpp \
     roto/FitCurves.c \
     roto/GGVecLib.c \
     InterModule.cpp \
     RangeDialog.cpp \
     roto/RotoCurves.cpp \
+    roto/RotoIndex.cpp \
+    roto/MatteRaster.cpp \
     KLT/Error.c \
     KLT/MySparseMat.cpp \
     KLT/LinearSolver.cpp \
@@ -40,6 +49,9 @@ SOURCES += \
     KLT/Keeper.cpp \
     KLT/MultiKeeper.cpp \
     KLT/Kernels.cpp \
+    KLT/Convolve.cpp \
+    KLT/PyramidCache.cpp \
+    KLT/PackedPyramid.cpp \
     KLT/klt_util.cpp \
     KLT/Pyramid.cpp \
     KLT/kltSpline.cpp \
@@ -49,6 +61,7 @@ SOURCES += \
     KLT/HB_OneCurve.cpp \
     KLT/MultiDiagMatrix.cpp \
     KLT/DiagMatrix.cpp \
+    KLT/Preconditioner.cpp \
     DrawModule.cpp \
     roto/DrawPath.cpp \
     roto/Stroke.cpp \
@@ -56,7 +69,8 @@ SOURCES += \
     roto/Texture.cpp \
     roto/DrawContCorr.cpp \
     roto/DrawCorresponder.cpp \
-    roto/DrawCurves.cpp
+    roto/DrawCurves.cpp \
+    roto/StrokeBatch.cpp
 
 HEADERS  += \
     KLT/BezSpline.h \
@@ -81,12 +95,21 @@ HEADERS  += \
     roto/RotoPath.h \
     roto/RotoRegion.h \
     roto/TrackGraph.h \
+    roto/MatteRaster.h \
     InterModule.h \
     MainWindow.h \
     RotoscopeModule.h \
     VideoProcessor.h \
+    TemporalFilter.h \
+    FrameCache.h \
+    TrackScheduler.h \
+    RotoTracker.h \
+    DrawPropagator.h \
+    ProjectFile.h \
+    RotoProject.h \
     RangeDialog.h \
     roto/RotoCurves.h \
+    roto/RotoIndex.h \
     KLT/KLT.h \
     KLT/Error.h \
     KLT/MySparseMat.h \
@@ -103,8 +126,12 @@ HEADERS  += \
     KLT/MyIMatrix.h \
     KLT/Pyramid.h \
     KLT/MultiDiagMatrix.h \
+    KLT/Preconditioner.h \
     KLT/klt_util.h \
     KLT/Kernels.h \
+    KLT/Convolve.h \
+    KLT/PyramidCache.h \
+    KLT/PackedPyramid.h \
     KLT/kltSpline.h \
     KLT/base.h \
     DrawModule.h \
@@ -117,7 +144,8 @@ HEADERS  += \
     roto/Bitmap.h \
     roto/DrawContCorr.h \
     roto/DrawCorresponder.h \
-    roto/DrawCurves.h
+    roto/DrawCurves.h \
+    roto/StrokeBatch.h
 
 FORMS    += \
     MainWindow.ui \
@@ -126,6 +154,10 @@ FORMS    += \
 RESOURCES += \
     npr-2015.qrc
 
+# KLT/Convolve.cpp and KLT/DiagMatrix.cpp use AVX when the compiler targets
+# it, SSE2 otherwise
+#QMAKE_CXXFLAGS += -mavx
+
 unix {
     LIBS   += -lGL -lGLU
     CONFIG += link_pkgconfig
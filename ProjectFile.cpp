@@ -0,0 +1,663 @@
+#include "ProjectFile.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <QDir>
+#include <QFileInfo>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const char projectMagic[4] = { 'N', 'P', 'R', 'P' };
+
+namespace
+{
+
+template<class T>
+void put(std::vector<char>* out, const T& v)
+{
+    const char* p = (const char*) &v;
+    out->insert(out->end(), p, p + sizeof(T));
+}
+
+// values of a record in turn; reading past its end only clears ok()
+class RecordReader
+{
+public:
+    RecordReader(const uchar* p, qint64 size) :
+            _p(p), _end(p + size), _ok(true)
+    {
+    }
+
+    template<class T>
+    T get()
+    {
+        T v = T();
+        if (_end - _p < (qint64) sizeof(T))
+            _ok = false;
+        else
+        {
+            memcpy(&v, _p, sizeof(T));
+            _p += sizeof(T);
+        }
+        return v;
+    }
+
+    // room for n more items of bytes each, for counts read from the file
+    bool has(int n, int bytes) const
+    {
+        return _ok && n >= 0 && n <= (_end - _p) / bytes;
+    }
+
+    bool ok() const
+    {
+        return _ok;
+    }
+
+private:
+    const uchar *_p, *_end;
+    bool _ok;
+};
+
+// place of p in the record of frame it was read from, of size paths; -1
+// if it was not read from that record
+int recordIndex(const AbstractPath* p, const int frame, const int size)
+{
+    const int* doc = p->getPtrDoc();
+    return doc[0] == frame && doc[1] >= 0 && doc[1] < size ? doc[1] : -1;
+}
+
+// what was written to f is on the disk, not only with the system
+bool syncFile(QFile& f)
+{
+    if (!f.flush())
+        return false;
+#ifdef _WIN32
+    return _commit(f.handle()) == 0;
+#else
+    return fsync(f.handle()) == 0;
+#endif
+}
+
+// from takes the place of to in one step; until then to is the old file
+bool replaceFile(const QString& from, const QString& to)
+{
+#ifdef _WIN32
+    return MoveFileExW(
+            (const wchar_t*) QDir::toNativeSeparators(from).utf16(),
+            (const wchar_t*) QDir::toNativeSeparators(to).utf16(),
+            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(QFile::encodeName(from).constData(),
+            QFile::encodeName(to).constData()) != 0)
+        return false;
+    // the directory holds the new name on the disk too
+    const int dir = ::open(
+            QFile::encodeName(QFileInfo(to).absolutePath()).constData(),
+            O_RDONLY);
+    if (dir >= 0)
+    {
+        fsync(dir);
+        ::close(dir);
+    }
+    return true;
+#endif
+}
+
+} // namespace
+
+ProjectFile::ProjectFile() :
+        _map(NULL), _size(0), _nextToLoad(0)
+{
+    memset(&_header, 0, sizeof(_header));
+}
+
+ProjectFile::~ProjectFile()
+{
+    close();
+}
+
+bool ProjectFile::isProjectFile(const QString& fileName)
+{
+    QFile f(fileName);
+    char magic[4];
+    return f.open(QIODevice::ReadOnly) && f.read(magic, 4) == 4
+            && memcmp(magic, projectMagic, 4) == 0;
+}
+
+bool ProjectFile::open(const QString& fileName, RotoProjectInfo* info)
+{
+    close();
+    _fileName = fileName;
+    if (!map())
+    {
+        close();
+        return false;
+    }
+
+    memcpy(&_header, _map, sizeof(_header));
+    const qint64 tableBytes = qint64(_header.frames)
+            * sizeof(ProjectFileEntry);
+    if (memcmp(_header.magic, projectMagic, 4) != 0
+            || _header.version != PROJECT_FILE_VERSION || _header.frames <= 0
+            || _header.table < (qint64) sizeof(_header)
+            || _header.table + tableBytes > _size)
+    {
+        printf("%s: not a project file of version %d\n",
+                fileName.toLocal8Bit().constData(), PROJECT_FILE_VERSION);
+        close();
+        return false;
+    }
+
+    _table.resize(_header.frames);
+    memcpy(&_table[0], _map + _header.table, tableBytes);
+    for (int f = 0; f < _header.frames; ++f)
+    {
+        const ProjectFileEntry& e = _table[f];
+        if (e.size < 0 || (e.size > 0 && (e.offset < (qint64) sizeof(_header)
+                || e.offset + e.size > _header.table)))
+        {
+            printf("%s: frame %d is damaged\n",
+                    fileName.toLocal8Bit().constData(), f);
+            close();
+            return false;
+        }
+    }
+
+    _loaded.assign(_header.frames, false);
+    _rotoPrev.assign(_header.frames, std::vector<int>());
+    _drawPrev.assign(_header.frames, std::vector<int>());
+    _nextToLoad = 0;
+
+    info->width = _header.width;
+    info->height = _header.height;
+    info->frames = _header.frames;
+    return true;
+}
+
+void ProjectFile::close()
+{
+    unmap();
+    _fileName.clear();
+    _table.clear();
+    _loaded.clear();
+    _damaged.clear();
+    _rotoPrev.clear();
+    _drawPrev.clear();
+    _nextToLoad = 0;
+}
+
+bool ProjectFile::map()
+{
+    _file.setFileName(_fileName);
+    if (!_file.open(QIODevice::ReadOnly))
+        return false;
+    _size = _file.size();
+    if (_size < (qint64) sizeof(ProjectFileHeader))
+        return false;
+    _map = _file.map(0, _size);
+    return _map != NULL;
+}
+
+void ProjectFile::unmap()
+{
+    if (_map)
+        _file.unmap(_map);
+    _map = NULL;
+    _file.close();
+}
+
+bool ProjectFile::loadFrame(int frame, RotoCurves* roto, DrawCurves* draw)
+{
+    if (loaded(frame))
+        return true;
+    // not tried again if damaged
+    _loaded[frame] = true;
+
+    const ProjectFileEntry& e = _table[frame];
+    if (e.size == 0)
+        return true;
+    std::vector<RotoPath*> paths;
+    std::vector<DrawPath*> draws;
+    if (!readFrame(_map + e.offset, e.size, frame, roto, draw, &paths,
+            &draws))
+    {
+        // nothing of the record is kept but its bytes, for save()
+        for (unsigned int i = 0; i < draws.size(); ++i)
+            draw[frame].deletePath(draws[i]);
+        for (unsigned int i = 0; i < paths.size(); ++i)
+            roto[frame].deletePath(paths[i]);
+        _rotoPrev[frame].clear();
+        _drawPrev[frame].clear();
+        _damaged[frame].assign(_map + e.offset, _map + e.offset + e.size);
+        printf("%s: frame %d is damaged\n",
+                _fileName.toLocal8Bit().constData(), frame);
+        return false;
+    }
+    return true;
+}
+
+bool ProjectFile::loadSome(int count, RotoCurves* roto, DrawCurves* draw)
+{
+    const int frames = _loaded.size();
+    for (; count > 0 && _nextToLoad < frames; ++_nextToLoad)
+    {
+        if (_loaded[_nextToLoad])
+            continue;
+        loadFrame(_nextToLoad, roto, draw);
+        --count;
+    }
+    return _nextToLoad < frames;
+}
+
+// Paths go in the order of the frame's lists, so documentSelf() gives the
+// place a path is referred to by.
+void ProjectFile::writeFrame(RotoCurves* roto, DrawCurves* draw,
+        const int frame, std::vector<char>* out)
+{
+    out->clear();
+    RotoCurves& rc = roto[frame];
+    const int numDraws = draw ? draw[frame].getNumCurves() : 0;
+    if (rc.getNumCurves() == 0 && numDraws == 0)
+        return;
+
+    put(out, int(rc.getNumCurves()));
+    RotoPathList::const_iterator c;
+    for (c = rc.begin(); c != rc.end(); ++c)
+    {
+        RotoPath* rp = *c;
+        const BezSpline* bez = rp->getBez();
+        put(out, int(rp->prevC() ? rp->prevC()->getPtrDoc()[1] : -1));
+        put(out, int(rp->fixed()));
+        put(out, int(bez->numCtrls()));
+        for (int i = 0; i < bez->numCtrls(); ++i)
+        {
+            put(out, bez->getCtrl(i)->x());
+            put(out, bez->getCtrl(i)->y());
+        }
+    }
+
+    put(out, numDraws);
+    if (numDraws == 0)
+        return;
+    DrawCurves& dc = draw[frame];
+    DrawPath* dp;
+    dc.startDrawPathIterator();
+    while ((dp = dc.IterateNext()) != NULL)
+    {
+        const int n = dp->getNumElements();
+        const Vec3f color = dp->getColor(), fill = dp->getFillColor();
+        put(out, int(dp->prevC() ? dp->prevC()->getPtrDoc()[1] : -1));
+        put(out, int(dp->fixed()));
+        put(out, int(dp->filled()));
+        put(out, color.r());
+        put(out, color.g());
+        put(out, color.b());
+        put(out, fill.r());
+        put(out, fill.g());
+        put(out, fill.b());
+        put(out, dp->getThicknessOffset());
+        put(out, n);
+        for (int i = 0; i < n; ++i)
+        {
+            const Vec2f loc = dp->getElement(i);
+            put(out, loc.x());
+            put(out, loc.y());
+            put(out, dp->getThick(i));
+        }
+
+        // only a correspondence wholly to this frame's roto paths is kept
+        const DrawContCorr* corr = dp->getCorrRoto();
+        bool keep = corr && corr->getNumSamples() == n;
+        for (int i = 0; keep && i < n; ++i)
+            keep = corr->getSampleRoto(i)->getPtrDoc()[0] == frame;
+        put(out, keep ? n : 0);
+        for (int i = 0; keep && i < n; ++i)
+        {
+            put(out, int(corr->getSampleRoto(i)->getPtrDoc()[1]));
+            put(out, corr->getSampleRotoT(i));
+        }
+    }
+}
+
+// Paths are added as they are read, to paths and draws, and documented
+// with their place in the record for link().
+bool ProjectFile::readFrame(const uchar* p, qint64 size, const int frame,
+        RotoCurves* roto, DrawCurves* draw, std::vector<RotoPath*>* paths,
+        std::vector<DrawPath*>* draws)
+{
+    RecordReader r(p, size);
+
+    const int numPaths = r.get<int>();
+    if (!r.has(numPaths, 3 * sizeof(int)))
+        return false;
+    std::vector<Vec2f> ctrls;
+    for (int i = 0; i < numPaths; ++i)
+    {
+        const int prev = r.get<int>(), fixed = r.get<int>();
+        const int numCtrls = r.get<int>();
+        if (!r.has(numCtrls, 2 * sizeof(float)) || numCtrls < 4
+                || (numCtrls - 1) % 3 != 0)
+            return false;
+        ctrls.resize(numCtrls);
+        for (int j = 0; j < numCtrls; ++j)
+        {
+            const float x = r.get<float>();
+            ctrls[j].Set(x, r.get<float>());
+        }
+        RotoPath* rp = roto[frame].addPathFromCtrls(ctrls, fixed != 0);
+        rp->setPtrDoc(frame, i);
+        paths->push_back(rp);
+        _rotoPrev[frame].push_back(prev);
+    }
+
+    const int numDraws = r.get<int>();
+    if (!r.has(numDraws, 11 * sizeof(float)))
+        return false;
+    std::vector<float> t;
+    std::vector<RotoPath*> ptrs;
+    float look[7];
+    for (int i = 0; i < numDraws; ++i)
+    {
+        const int prev = r.get<int>(), fixed = r.get<int>();
+        const int filled = r.get<int>();
+        for (int j = 0; j < 7; ++j)
+            look[j] = r.get<float>();
+        const int n = r.get<int>();
+        if (!r.has(n, 3 * sizeof(float)))
+            return false;
+
+        DrawPath* dp = draw ? new DrawPath() : NULL;
+        if (dp)
+        {
+            dp->setLook(Vec3f(look[0], look[1], look[2]), filled != 0,
+                    Vec3f(look[3], look[4], look[5]), look[6]);
+            dp->initHertzStroke();
+        }
+        for (int j = 0; j < n; ++j)
+        {
+            const float x = r.get<float>(), y = r.get<float>();
+            const float thick = r.get<float>();
+            if (dp)
+                dp->addVertex(x, y, thick);
+        }
+
+        const int numCorr = r.get<int>();
+        if (!r.has(numCorr, sizeof(int) + sizeof(float))
+                || (numCorr != 0 && numCorr != n))
+        {
+            delete dp;
+            return false;
+        }
+        t.resize(numCorr);
+        ptrs.resize(numCorr);
+        bool ok = true;
+        for (int j = 0; j < numCorr; ++j)
+        {
+            const int which = r.get<int>();
+            t[j] = r.get<float>();
+            ok = ok && which >= 0 && which < numPaths;
+            ptrs[j] = ok ? (*paths)[which] : NULL;
+        }
+
+        if (!dp)
+            continue;
+        if (numCorr > 0 && ok)
+        {
+            dp->setCorrRoto(new DrawContCorr(&t[0], &ptrs[0], numCorr));
+            for (int j = 0; j < numCorr; ++j)
+                ptrs[j]->addCorrDraw(dp);
+        }
+        dp->setFixed(fixed != 0);
+        dp->freshenStroke();
+        dp->setPtrDoc(frame, i);
+        draw[frame].addPath(dp);
+        draws->push_back(dp);
+        _drawPrev[frame].push_back(prev);
+    }
+    if (!r.ok())
+        return false;
+
+    if (frame > 0 && _loaded[frame - 1])
+        link(frame, roto, draw);
+    if (frame + 1 < (int) _loaded.size() && _loaded[frame + 1])
+        link(frame + 1, roto, draw);
+    return true;
+}
+
+// Paths read from the file keep their place in its record until the next
+// save, which reads every frame first, so the path a record refers to is
+// found by that place.  Paths deleted since are no longer in the frame and
+// paths drawn since have no place; only free paths are linked.
+void ProjectFile::link(const int frame, RotoCurves* roto, DrawCurves* draw)
+{
+    const std::vector<int>& rotoPrev = _rotoPrev[frame];
+    std::vector<RotoPath*> before(_rotoPrev[frame - 1].size(),
+            (RotoPath*) NULL);
+    RotoPathList::const_iterator c;
+    int i;
+    for (c = roto[frame - 1].begin(); c != roto[frame - 1].end(); ++c)
+        if ((i = recordIndex(*c, frame - 1, before.size())) >= 0)
+            before[i] = *c;
+    for (c = roto[frame].begin(); c != roto[frame].end(); ++c)
+    {
+        if ((i = recordIndex(*c, frame, rotoPrev.size())) < 0
+                || rotoPrev[i] < 0 || rotoPrev[i] >= (int) before.size()
+                || !before[rotoPrev[i]])
+            continue;
+        RotoPath *a = before[rotoPrev[i]], *b = *c;
+        // only identical segment counts have a correspondence
+        if (!a->nextC() && !b->prevC() && a->getNumSegs() == b->getNumSegs())
+        {
+            a->setNextC(b);
+            a->buildINextCorrs();
+            b->setPrevC(a);
+            b->buildIPrevCorrs();
+        }
+    }
+
+    if (!draw)
+        return;
+    const std::vector<int>& drawPrev = _drawPrev[frame];
+    std::vector<DrawPath*> drawBefore(_drawPrev[frame - 1].size(),
+            (DrawPath*) NULL);
+    DrawPath* dp;
+    draw[frame - 1].startDrawPathIterator();
+    while ((dp = draw[frame - 1].IterateNext()) != NULL)
+        if ((i = recordIndex(dp, frame - 1, drawBefore.size())) >= 0)
+            drawBefore[i] = dp;
+    draw[frame].startDrawPathIterator();
+    while ((dp = draw[frame].IterateNext()) != NULL)
+    {
+        if ((i = recordIndex(dp, frame, drawPrev.size())) < 0
+                || drawPrev[i] < 0 || drawPrev[i] >= (int) drawBefore.size()
+                || !drawBefore[drawPrev[i]])
+            continue;
+        DrawPath* a = drawBefore[drawPrev[i]];
+        if (!a->nextC() && !dp->prevC())
+        {
+            a->setNextC(dp);
+            dp->setPrevC(a);
+        }
+    }
+}
+
+bool ProjectFile::save(const QString& fileName, RotoCurves* roto,
+        DrawCurves* draw, const RotoProjectInfo& info)
+{
+    if (isOpen())
+        while (loadSome(info.frames, roto, draw))
+            ;
+
+    int f;
+    for (f = 0; f < info.frames; ++f)
+    {
+        roto[f].setFrame(f);
+        roto[f].documentSelf();
+        if (draw)
+        {
+            draw[f].setFrame(f);
+            draw[f].documentSelf();
+        }
+    }
+    std::vector<std::vector<char> > records(info.frames);
+    for (f = 0; f < info.frames; ++f)
+        writeFrame(roto, draw, f, &records[f]);
+
+    // a damaged frame goes back as it was in the file, unless paths were
+    // drawn on it since
+    std::map<int, std::vector<char> >::iterator d = _damaged.begin();
+    while (d != _damaged.end())
+    {
+        if (d->first < info.frames && records[d->first].empty())
+        {
+            records[d->first] = d->second;
+            ++d;
+        }
+        else
+        {
+            printf("%s: damaged frame %d replaced\n",
+                    fileName.toLocal8Bit().constData(), d->first);
+            _damaged.erase(d++);
+        }
+    }
+
+    if (!isOpen() || fileName != _fileName || info.frames != _header.frames
+            || info.width != _header.width || info.height != _header.height)
+        return writeAll(fileName, records, info);
+
+    std::vector<int> changed;
+    qint64 added = 0, dead = _header.dead;
+    for (f = 0; f < info.frames; ++f)
+    {
+        const ProjectFileEntry& e = _table[f];
+        const qint64 size = records[f].size();
+        if (size == e.size && (size == 0
+                || memcmp(_map + e.offset, &records[f][0], size) == 0))
+            continue;
+        changed.push_back(f);
+        added += size;
+        dead += e.size;
+    }
+    if (changed.empty())
+        return true;
+
+    const qint64 tableBytes = qint64(info.frames) * sizeof(ProjectFileEntry);
+    dead += tableBytes;
+    if (2 * dead > _size + added + tableBytes)
+        return writeAll(fileName, records, info);
+    return append(records, changed);
+}
+
+// into a new file first, on the disk before it takes the place of
+// fileName, so fileName is the old file or the new one whenever it stops
+bool ProjectFile::writeAll(const QString& fileName,
+        const std::vector<std::vector<char> >& records,
+        const RotoProjectInfo& info)
+{
+    const QString tmpName = fileName + ".tmp";
+    QFile tmp(tmpName);
+    if (!tmp.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    ProjectFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, projectMagic, 4);
+    h.version = PROJECT_FILE_VERSION;
+    h.width = info.width;
+    h.height = info.height;
+    h.frames = info.frames;
+
+    std::vector<ProjectFileEntry> table(info.frames);
+    qint64 pos = sizeof(h);
+    bool ok = tmp.write((const char*) &h, sizeof(h)) == sizeof(h);
+    for (int f = 0; ok && f < info.frames; ++f)
+    {
+        const qint64 size = records[f].size();
+        table[f].offset = size ? pos : 0;
+        table[f].size = size;
+        ok = size == 0 || tmp.write(&records[f][0], size) == size;
+        pos += size;
+    }
+    h.table = pos;
+    const qint64 tableBytes = qint64(info.frames) * sizeof(ProjectFileEntry);
+    ok = ok && tmp.write((const char*) &table[0], tableBytes) == tableBytes
+            && tmp.seek(0) && tmp.write((const char*) &h, sizeof(h)) == sizeof(h)
+            && syncFile(tmp);
+    tmp.close();
+
+    unmap();
+    if (!ok || !replaceFile(tmpName, fileName))
+    {
+        QFile::remove(tmpName);
+        // the open file is untouched if it was not fileName
+        if (!_fileName.isEmpty() && !map())
+            close();
+        return false;
+    }
+
+    // every frame is in memory now
+    _fileName = fileName;
+    _header = h;
+    _table.swap(table);
+    _loaded.assign(info.frames, true);
+    _rotoPrev.assign(info.frames, std::vector<int>());
+    _drawPrev.assign(info.frames, std::vector<int>());
+    _nextToLoad = info.frames;
+    if (!map())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// the changed records and a new table after the end of the open file, then
+// the header pointing at it
+bool ProjectFile::append(const std::vector<std::vector<char> >& records,
+        const std::vector<int>& changed)
+{
+    ProjectFileHeader h = _header;
+    std::vector<ProjectFileEntry> table(_table);
+    unmap();
+
+    QFile f(_fileName);
+    bool ok = f.open(QIODevice::ReadWrite);
+    qint64 pos = f.size();
+    ok = ok && f.seek(pos);
+    for (unsigned int i = 0; ok && i < changed.size(); ++i)
+    {
+        const std::vector<char>& rec = records[changed[i]];
+        const qint64 size = rec.size();
+        h.dead += table[changed[i]].size;
+        table[changed[i]].offset = size ? pos : 0;
+        table[changed[i]].size = size;
+        ok = size == 0 || f.write(&rec[0], size) == size;
+        pos += size;
+    }
+    const qint64 tableBytes = qint64(h.frames) * sizeof(ProjectFileEntry);
+    h.dead += tableBytes;
+    h.table = pos;
+    // the records and the table are on the disk before the header refers
+    // to them
+    ok = ok && f.write((const char*) &table[0], tableBytes) == tableBytes
+            && syncFile(f) && f.seek(0)
+            && f.write((const char*) &h, sizeof(h)) == sizeof(h)
+            && syncFile(f);
+    f.close();
+
+    if (!map())
+    {
+        close();
+        return false;
+    }
+    if (!ok)
+        return false;
+    _header = h;
+    _table.swap(table);
+    return true;
+}
@@ -0,0 +1,134 @@
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <map>
+#include <vector>
+#include <QFile>
+#include <QString>
+#include "RotoProject.h"
+#include "RotoCurves.h"
+#include "DrawCurves.h"
+
+// Roto and draw curves of a whole video in one binary file, read a frame at
+// a time from a mapping of it.
+//
+// File layout, native endianness:
+//   ProjectFileHeader      64 bytes
+//   frame records          in the order they were saved
+//   ProjectFileEntry[N]    the table, where the record of each frame is
+//
+// A frame's record holds its roto paths (bezier controls and whether they
+// are fixed) and its draw paths (vertices, thickness, look and the roto
+// sample each vertex is corresponded to).  Paths refer to the path they
+// continue by its place in the frame before, so a record only changes with
+// its own frame.  Joints are made again from the controls on loading, as
+// for the text format, and correspondences from the segments.
+//
+// Saving to the open file appends the records that differ from the ones in
+// it and a new table, syncs them to the disk, then rewrites the header to
+// point at that table; a save cut short leaves the header on the previous
+// one.  Once more than half the file is records and tables nothing refers
+// to, the file is written again from scratch into a new one, synced, that
+// replaces it in one rename.
+
+#define PROJECT_FILE_VERSION 1
+
+struct ProjectFileHeader
+{
+    char magic[4];          // "NPRP"
+    int version;            // PROJECT_FILE_VERSION
+    int width;
+    int height;
+    int frames;
+    int pad0;
+    qint64 table;           // offset of the table
+    qint64 dead;            // bytes the table does not refer to
+    int pad[6];
+};
+
+struct ProjectFileEntry
+{
+    qint64 offset;          // record of the frame, 0 if it has no paths
+    qint64 size;
+};
+
+class ProjectFile
+{
+public:
+
+    ProjectFile();
+    ~ProjectFile();
+
+    // true if fileName starts like a project file
+    static bool isProjectFile(const QString& fileName);
+
+    // map fileName and read its table, the frames are read by loadFrame().
+    // False if it is not a project file or is damaged.
+    bool open(const QString& fileName, RotoProjectInfo* info);
+    void close();
+
+    bool isOpen() const
+    {
+        return _map != NULL;
+    }
+    const QString& fileName() const
+    {
+        return _fileName;
+    }
+
+    // read frame into roto[frame] and draw[frame] unless done already.  The
+    // paths are added to those there and linked to the frames either side
+    // read before.  roto and draw hold the frames of the project.  Nothing
+    // of a damaged frame is added; save() writes its record back as it was
+    // unless paths are drawn on the frame.
+    bool loadFrame(int frame, RotoCurves* roto, DrawCurves* draw);
+    bool loaded(int frame) const
+    {
+        return !isOpen() || _loaded[frame];
+    }
+
+    // loadFrame() of up to count frames not read yet, first ones first;
+    // true while some are left
+    bool loadSome(int count, RotoCurves* roto, DrawCurves* draw);
+
+    // every frame of the curves into fileName.  Frames of the open file not
+    // read yet are read first.  Into the open file only the frames that
+    // changed are written; otherwise the new file is the open one after.
+    bool save(const QString& fileName, RotoCurves* roto, DrawCurves* draw,
+            const RotoProjectInfo& info);
+
+private:
+
+    bool map();
+    void unmap();
+    bool writeAll(const QString& fileName,
+            const std::vector<std::vector<char> >& records,
+            const RotoProjectInfo& info);
+    bool append(const std::vector<std::vector<char> >& records,
+            const std::vector<int>& changed);
+
+    static void writeFrame(RotoCurves* roto, DrawCurves* draw, int frame,
+            std::vector<char>* out);
+    bool readFrame(const uchar* p, qint64 size, int frame, RotoCurves* roto,
+            DrawCurves* draw, std::vector<RotoPath*>* paths,
+            std::vector<DrawPath*>* draws);
+    void link(int frame, RotoCurves* roto, DrawCurves* draw);
+
+    QString _fileName;
+    QFile _file;
+    uchar* _map;
+    qint64 _size;
+    ProjectFileHeader _header;
+    std::vector<ProjectFileEntry> _table;
+
+    // which frames were read and, for each path of a frame's record, the
+    // place in the record before of the path it continues, to link frames
+    // read apart
+    std::vector<bool> _loaded;
+    std::vector<std::vector<int> > _rotoPrev, _drawPrev;
+    // records that could not be read, as they are in the file
+    std::map<int, std::vector<char> > _damaged;
+    int _nextToLoad;  // loadSome() has gone through the frames before
+};
+
+#endif // PROJECTFILE_H
@@ -0,0 +1,86 @@
+#include "RotoProject.h"
+#include <stdio.h>
+#include <fstream>
+#include <map>
+
+bool saveRotoProject(const std::string &fileName, RotoCurves *curves,
+        const RotoProjectInfo &info)
+{
+    std::ofstream fp(fileName.c_str());
+    if (!fp)
+        return false;
+    fp.precision(9);   // round trips a float
+
+    int i, labelNum = 0;
+    for (i = 0; i < info.frames; ++i)
+        curves[i].clearXMLLabels();
+    for (i = 0; i < info.frames; ++i)
+        curves[i].createXMLLabels(labelNum);
+
+    fp << "<RotoProject: version " << ROTO_PROJECT_VERSION
+       << " width " << info.width << " height " << info.height
+       << " frames " << info.frames << " >" << std::endl;
+    for (i = 0; i < info.frames; ++i)
+    {
+        if (curves[i].getNumCurves() > 0)
+            curves[i].saveRotoXML(fp, i);
+    }
+    return fp.good();
+}
+
+bool loadRotoProject(const std::string &fileName, RotoCurves *curves,
+        int maxFrames, RotoProjectInfo *info)
+{
+    std::ifstream fp(fileName.c_str());
+    std::string tok, w, h, n, end;
+    int version;
+    if (!(fp >> tok >> w >> version) || tok != "<RotoProject:"
+            || w != "version")
+        return false;
+    if (version > ROTO_PROJECT_VERSION)
+    {
+        printf("%s: project version %d is too new\n", fileName.c_str(),
+                version);
+        return false;
+    }
+    if (!(fp >> w >> info->width >> h >> info->height >> n >> info->frames
+            >> end) || w != "width" || h != "height" || n != "frames"
+            || end != ">")
+        return false;
+
+    // last path of each label and its frame
+    std::map<int, std::pair<int, RotoPath*> > last;
+    int prevFrame = -1;
+    while (fp >> std::ws, !fp.eof())
+    {
+        int frame;
+        std::streampos at = fp.tellg();
+        if (!(fp >> tok) || tok != "<RotoFrame:" || !(fp >> frame)
+                || frame <= prevFrame || frame >= maxFrames)
+            return false;
+        fp.seekg(at);
+
+        RotoCurves *rc = curves + frame;
+        if (!rc->loadRotoXML(fp, &frame))
+            return false;
+        prevFrame = frame;
+
+        RotoPathList::const_iterator c;
+        for (c = rc->begin(); c != rc->end(); ++c)
+        {
+            RotoPath *rp = *c;
+            std::pair<int, RotoPath*> &prev = last[rp->xmlLabel()];
+            // only identical segment counts have a correspondence
+            if (prev.second && prev.first == frame - 1
+                    && prev.second->getNumSegs() == rp->getNumSegs())
+            {
+                prev.second->setNextC(rp);
+                prev.second->buildINextCorrs();
+                rp->setPrevC(prev.second);
+                rp->buildIPrevCorrs();
+            }
+            prev = std::make_pair(frame, rp);
+        }
+    }
+    return true;
+}
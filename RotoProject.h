@@ -0,0 +1,32 @@
+#ifndef ROTOPROJECT_H
+#define ROTOPROJECT_H
+
+#include <string>
+#include "RotoCurves.h"
+
+// Roto curves of a whole video as text:
+//
+//   <RotoProject: version 1 width W height H frames N >
+//   <RotoFrame: ...>   one block per frame with paths, see saveRotoXML
+//
+// W x H is the image the path coordinates refer to.  A path and its
+// counterparts in later frames share a label; on loading, paths of the
+// same label in consecutive frames are linked again.
+
+#define ROTO_PROJECT_VERSION 1
+
+struct RotoProjectInfo
+{
+    int width, height, frames;
+};
+
+// curves holds info.frames RotoCurves
+bool saveRotoProject(const std::string &fileName, RotoCurves *curves,
+        const RotoProjectInfo &info);
+
+// curves must hold maxFrames empty RotoCurves, frames beyond them are an
+// error
+bool loadRotoProject(const std::string &fileName, RotoCurves *curves,
+        int maxFrames, RotoProjectInfo *info);
+
+#endif // ROTOPROJECT_H
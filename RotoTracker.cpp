@@ -0,0 +1,344 @@
+#include "RotoTracker.h"
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+RotoTracker::RotoTracker(FrameCache *frames, RotoCurves *curves,
+        int numWorkers)
+    : _curves(curves)
+    , _maskW(0)
+    , _maskH(0)
+    , _windowFrames(0)
+    , _windowOverlap(0)
+    , _notified(0)
+{
+    _scheduler = new TrackScheduler(frames, numWorkers);
+    _scheduler->setFinishedCallback(notify, this);
+}
+
+RotoTracker::~RotoTracker()
+{
+    // waits for the running solves; contexts never started are deleted by
+    // the scheduler, so only the track data is left to free
+    delete _scheduler;
+
+    std::list<TrackGraph*>::iterator tgc;
+    for (tgc = _ccompV.begin(); tgc != _ccompV.end(); ++tgc)
+        delete *tgc;
+    std::list<MultiSplineData*>::iterator mtc;
+    for (mtc = _trackDataV.begin(); mtc != _trackDataV.end(); ++mtc)
+        delete *mtc;
+    // a whole span has one window queued at a time
+    std::list<Window>::iterator wc;
+    for (wc = _windowV.begin(); wc != _windowV.end(); ++wc)
+        delete wc->whole;
+}
+
+void RotoTracker::track(const PathV &toTrack, int aFrame, int bFrame,
+        const KLT_TrackingContext *settings, bool doInterp,
+        bool useExistingInbetweens)
+{
+    printf("toTrack size %d, a %d b %d\n", int(toTrack.size()), aFrame,
+            bFrame);
+    PathV paths = toTrack;
+    std::vector<bool> done(paths.size(), false);
+    PathV::const_iterator c2;
+    PathV::iterator c;
+
+    // interpolate somehow
+    if (doInterp && !useExistingInbetweens)
+    {
+        for (c2 = paths.begin(); c2 != paths.end(); ++c2)
+        {
+            keyframeSedInterp((*c2)->prevC(), aFrame, *c2, bFrame,
+                    settings->pinLast);
+        }
+        printf("Interpolated\n");
+    }
+
+    // build & reconcile joints
+    if (doInterp && !useExistingInbetweens)
+        RotoPath::buildBackReconcileJoints(paths, bFrame, aFrame);
+    printf("Joints done\n");
+
+    int i = 0;
+    for (c = paths.begin(); c != paths.end(); ++c, ++i)
+    {
+        if (!done[i])
+        {
+            // get a full list beg to end of linked up paths (stop at already interpolated ones,
+            // ones not in toTrack list)
+            TrackGraph* ccomp = new TrackGraph();
+            (*c)->buildccomp(ccomp, &paths);
+
+            // Let done know these are processed
+            for (c2 = ccomp->paths()->begin(); c2 != ccomp->paths()->end();
+                    ++c2)
+            {
+                PathV::const_iterator which = std::find(paths.begin(),
+                        paths.end(), *c2);
+                assert(which != paths.end());
+                done[which - paths.begin()] = true;
+            }
+
+            Window w;
+            w.bFrame = bFrame;
+            w.frames = _windowFrames;
+            w.overlap = _windowOverlap;
+            if (_windowFrames > 0 && bFrame - aFrame > _windowFrames)
+            {
+                w.whole = ccomp;
+                w.end = aFrame + _windowFrames;
+                queueTrack(ccomp->earlier(bFrame - w.end), aFrame, w.end,
+                        settings, doInterp, w);
+            }
+            else
+            {
+                w.whole = NULL;
+                w.end = bFrame;
+                queueTrack(ccomp, aFrame, bFrame, settings, doInterp, w);
+            }
+        }
+    }
+}
+
+void RotoTracker::setWindow(int frames, int overlap)
+{
+    _windowFrames = frames > 0 ? std::max(frames, 3) : 0;
+    _windowOverlap = std::max(1, std::min(overlap, _windowFrames - 2));
+}
+
+// ccomp tracked from aFrame to bFrame, which is window's end; ccomp is the
+// tracker's from here on
+void RotoTracker::queueTrack(TrackGraph *ccomp, int aFrame, int bFrame,
+        const KLT_TrackingContext *settings, bool doInterp,
+        const Window &window)
+{
+    MultiSplineData* mts = new MultiSplineData();
+
+    // start multiTrack
+    mts->_numFrames = bFrame - aFrame;
+    printf("started multi\n");
+
+    ccomp->buildMulti(mts);
+
+    addMasksToMulti(mts, ccomp->getKey0Paths(), aFrame);
+    mts->setPublishedCallback(notify, this);
+
+    // pyramids for the span, built on the worker pool and kept resident
+    // until the track is done
+    _scheduler->setSettings(settings);
+    _scheduler->acquireSpan(aFrame, bFrame, settings->useImage,
+            settings->useEdges);
+
+    // track
+    // pyrms and pyrmsE get deleted by longCurveTrack2
+    const KLT_FullCPyramid** pyrms =
+            new const KLT_FullCPyramid *[mts->_numFrames + 1];
+    const KLT_FullPyramid** pyrmsE =
+            new const KLT_FullPyramid *[mts->_numFrames + 1];
+
+    for (int j = 0; j <= mts->_numFrames; j++)
+    {
+        int a = aFrame + j;
+        if (settings->useImage)
+            pyrms[j] = _scheduler->colorPyramid(a);
+        else
+            pyrms[j] = NULL;
+
+        if (settings->useEdges)
+            pyrmsE[j] = _scheduler->edgePyramid(a);
+        else
+            pyrmsE[j] = NULL;
+    }
+
+    KLT_TrackingContext* tc = new KLT_TrackingContext(); // transfer global track settings
+    tc->copySettings(settings);
+    tc->setupSplineTrack(pyrms, pyrmsE, mts, doInterp);
+
+    _ccompV.push_back(ccomp);
+    _trackDataV.push_back(mts);
+    _TCV.push_back(tc);
+    _windowV.push_back(window);
+
+    // started by the scheduler once the span's pyramids are in
+    _scheduler->addTrack(tc, aFrame, bFrame, mts->estimatedCost());
+    _scheduler->releaseSpan(aFrame, bFrame);
+}
+
+// the window after window, from the in-betweens it left; these are the
+// starting point, so there is no interpolating again
+void RotoTracker::queueNextWindow(const Window &window,
+        const KLT_TrackingContext *settings)
+{
+    Window next = window;
+    int aFrame = window.end - window.overlap;
+    next.end = std::min(aFrame + window.frames, window.bFrame);
+    if (settings->verbose)
+        printf("window %d %d of %d\n", aFrame, next.end, window.bFrame);
+    queueTrack(window.whole->earlier(window.bFrame - next.end), aFrame,
+            next.end, settings, false, next);
+}
+
+bool RotoTracker::update()
+{
+    // anything published from here on signals again
+    _notified.fetchAndStoreOrdered(0);
+
+    std::list<TrackGraph*>::iterator tgc;
+    std::list<MultiSplineData*>::iterator mtc;
+    std::list<KLT_TrackingContext*>::iterator kc;
+    std::list<Window>::iterator wc;
+    for (tgc = _ccompV.begin(), mtc = _trackDataV.begin(), kc = _TCV.begin(),
+            wc = _windowV.begin();
+            tgc != _ccompV.end() && mtc != _trackDataV.end()
+                    && kc != _TCV.end() && wc != _windowV.end();)
+    {
+        if (_scheduler->collectFinished(*kc))
+        {
+            // the solver is done with the splines, which are sampled the
+            // way the tracker samples them
+            if ((*kc)->_stateOk)
+                (*tgc)->copyLocs(*mtc);
+            addLevelStats(*kc);
+
+            // the next window goes to the end of the lists, to be collected
+            // in a later update
+            if (wc->whole)
+            {
+                if (wc->end < wc->bFrame && (*kc)->_stateOk)
+                    queueNextWindow(*wc, *kc);
+                else
+                    delete wc->whole;
+            }
+
+            delete *tgc;
+            tgc = _ccompV.erase(tgc);
+            delete *mtc;
+            mtc = _trackDataV.erase(mtc);
+            delete *kc;
+            kc = _TCV.erase(kc);
+            wc = _windowV.erase(wc);
+        }
+        else
+        {
+            const ZVec *ctrls = (*mtc)->newControls();
+            if (ctrls)
+                (*tgc)->copyControls(*mtc, *ctrls);
+            ++tgc;
+            ++mtc;
+            ++kc;
+            ++wc;
+        }
+    }
+
+    assert(_ccompV.size() == _trackDataV.size()
+            && _ccompV.size() == _TCV.size()
+            && _ccompV.size() == _windowV.size());
+    return !_ccompV.empty();
+}
+
+void RotoTracker::addLevelStats(const KLT_TrackingContext *tc)
+{
+    const std::vector<KLT_SplineLevelStats> &stats = tc->levelStats();
+    for (unsigned int i = 0; i < stats.size(); ++i)
+    {
+        const KLT_SplineLevelStats &s = stats[i];
+        // components may solve different numbers of levels, so match by
+        // level, keeping the totals coarsest first
+        unsigned int k = 0;
+        while (k < _levelTotals.size() && _levelTotals[k].level > s.level)
+            ++k;
+        if (k == _levelTotals.size() || _levelTotals[k].level != s.level)
+        {
+            LevelTotal t;
+            memset(&t, 0, sizeof(t));
+            t.level = s.level;
+            _levelTotals.insert(_levelTotals.begin() + k, t);
+        }
+        LevelTotal &t = _levelTotals[k];
+        if (s.skipped)
+        {
+            t.skipped++;
+            continue;
+        }
+        t.solved++;
+        t.steps += s.steps;
+        t.rejected += s.rejected;
+        t.cgIterations += s.cgIterations;
+        t.msecs += s.msecs;
+    }
+}
+
+void RotoTracker::notify(void *self)
+{
+    RotoTracker *t = static_cast<RotoTracker*>(self);
+    if (t->_notified.testAndSetOrdered(0, 1))
+        emit t->progress();
+}
+
+void RotoTracker::wait()
+{
+    while (update())
+        _scheduler->waitForFinished();
+}
+
+void RotoTracker::keyframeSedInterp(RotoPath* aPath, int aFrame,
+        RotoPath *bPath, int bFrame, bool pinLast)
+{
+    assert(aPath && bPath);
+    int numFrames = bFrame - aFrame;
+    assert(numFrames > 0);
+    int t;
+
+    bPath->setLowHeight(aPath->lowHeight());
+    bPath->setHighHeight(aPath->highHeight());
+    bPath->setTrackEdges(aPath->trackEdges());
+    printf("KeyframeSedInterp\n");
+
+    RotoPath* prev = aPath;
+    for (t = 1; t < numFrames; ++t)
+    {
+        RotoPath *newpath = new RotoPath(*aPath);
+        newpath->setFixed(false);
+        newpath->buildTouched(false);
+
+        RotoCurves *curve = _curves + aFrame + t;
+        curve->addPath(newpath);
+
+        newpath->setPrevC(prev);
+        prev->setNextC(newpath);
+        if (t == numFrames - 1 && pinLast)
+        {
+            newpath->takeNextCont(aPath);
+            newpath->buildIPrevCorrs();
+        }
+        else
+        {
+            newpath->buildINextCorrs();
+            newpath->buildIPrevCorrs();
+        }
+        prev = newpath;
+    }
+
+    bPath->setPrevC(prev);
+    prev->setNextC(bPath);
+    aPath->buildINextCorrs();
+    assert(aPath->nextC());
+}
+
+void RotoTracker::addMasksToMulti(MultiSplineData* mts, const PathV& key0,
+        const int frame0)
+{
+    PathV currPaths = key0;
+    PathV::iterator c;
+    mts->setMaskDims(_maskW, _maskH);
+    for (int i = 0; i < mts->_numFrames + 1; ++i) // iterate over frames
+    {
+        RotoCurves* curve = _curves + frame0 + i;
+        unsigned char* mask = curve->makeCummMask(currPaths);
+        mts->addMask(mask);
+        for (c = currPaths.begin(); c != currPaths.end(); ++c) // advance paths 1 frame
+            (*c) = (*c)->nextC();
+    }
+}
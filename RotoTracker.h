@@ -0,0 +1,144 @@
+#ifndef ROTOTRACKER_H
+#define ROTOTRACKER_H
+
+#include <list>
+#include <QObject>
+#include <QAtomicInt>
+#include "RotoPath.h"
+#include "RotoCurves.h"
+#include "TrackGraph.h"
+#include "KLT.h"
+#include "FrameCache.h"
+#include "TrackScheduler.h"
+
+// Keyframe-to-keyframe spline tracking over the roto curves of a video.
+//
+// This is the engine behind RotoscopeModule's tracking and the npr-track
+// batch tool; it needs no GL context and no widgets.  track() splits the
+// paths into connected components and queues one solve per component on
+// the TrackScheduler; update() copies the locations tracked so far back
+// into the paths and retires the finished components.  The caller decides
+// when to call it, on progress() in the GUI or from wait().
+//
+// Spans longer than the window set by setWindow() are tracked a window at a
+// time, so the size of a solve does not grow with the span.  Each window
+// starts on the last frame of the one before, less the overlap, which is
+// held where that one left it, and ends on a frame held where the
+// interpolation put it or, for the last window, on bFrame.  The frames of
+// the overlap are solved again by the next window.  A window goes into the
+// paths when it finishes and the next one is queued from update().
+//
+// Windowing costs accuracy: the end of every window but the last is pinned
+// where the interpolation put it, and only the overlap lets the next
+// window correct it, so a short overlap leaves those frames wherever the
+// interpolation got them wrong.  Whole spans, the default, hold only the
+// keyframes.
+//
+// The solvers never hand their state over under a lock: each component
+// publishes its control points after every step it takes, and update()
+// only takes the newest of those, so it never waits on a solve.
+class RotoTracker : public QObject
+{
+    Q_OBJECT
+public:
+
+    // one pyramid level over the components finished so far, from their
+    // KLT_TrackingContext::levelStats()
+    struct LevelTotal
+    {
+        int level;
+        int solved, skipped;
+        int steps, rejected, cgIterations;
+        long msecs;
+    };
+
+    // curves is the array of the video, one RotoCurves per frame.
+    // numWorkers <= 0 means one per core.
+    RotoTracker(FrameCache *frames, RotoCurves *curves, int numWorkers = 0);
+    ~RotoTracker();
+
+    // size of the image the path coordinates refer to, for the masks
+    void setMaskSize(int w, int h)
+    {
+        _maskW = w;
+        _maskH = h;
+    }
+
+    // track spans longer than frames in windows of frames frames that
+    // overlap by overlap frames, 1 to frames - 2; 0 frames for whole spans,
+    // the default.  A large overlap, a quarter of frames or more, keeps
+    // the pinned window ends away from the frames each window keeps
+    void setWindow(int frames, int overlap);
+
+    // track the paths toTrack of frame bFrame back to their counterparts in
+    // aFrame.  With doInterp and not useExistingInbetweens the in-betweens
+    // are created first by interpolating from the prevC() of each path,
+    // which must be set; otherwise the existing in-betweens are the
+    // starting point.  settings are copied, so they may change afterwards.
+    void track(const PathV &toTrack, int aFrame, int bFrame,
+            const KLT_TrackingContext *settings, bool doInterp = true,
+            bool useExistingInbetweens = false);
+
+    // copy the tracked locations into the paths of the components that
+    // moved since the last call and retire finished components, true while
+    // some are still running
+    bool update();
+
+    // update() until every component has finished
+    void wait();
+
+    bool busy() const { return !_ccompV.empty(); }
+
+    TrackScheduler *scheduler() { return _scheduler; }
+
+    // coarsest level first
+    const std::vector<LevelTotal> &levelTotals() const
+    {
+        return _levelTotals;
+    }
+    void clearLevelTotals() { _levelTotals.clear(); }
+
+signals:
+    // a component took a step or finished since the last update().  From a
+    // worker thread, and only once until update() is called.
+    void progress();
+
+private:
+
+    static void notify(void *self);
+    void addLevelStats(const KLT_TrackingContext *tc);
+
+    // a component being tracked a window at a time
+    struct Window
+    {
+        TrackGraph *whole;  // NULL when it is tracked in one go
+        int bFrame;         // of the whole span
+        int end;            // of the window running
+        int frames, overlap;
+    };
+
+    void queueTrack(TrackGraph *ccomp, int aFrame, int bFrame,
+            const KLT_TrackingContext *settings, bool doInterp,
+            const Window &window);
+    void queueNextWindow(const Window &window,
+            const KLT_TrackingContext *settings);
+
+    void keyframeSedInterp(RotoPath *aPath, int aFrame, RotoPath *bPath,
+            int bFrame, bool pinLast);
+    void addMasksToMulti(MultiSplineData *mts, const PathV &key0,
+            const int frame0);
+
+    RotoCurves *_curves;
+    TrackScheduler *_scheduler;
+    int _maskW, _maskH;
+    int _windowFrames, _windowOverlap;
+    QAtomicInt _notified;   // progress() sent and no update() since
+    std::vector<LevelTotal> _levelTotals;
+
+    std::list<TrackGraph*> _ccompV;
+    std::list<KLT_TrackingContext*> _TCV;
+    std::list<MultiSplineData*> _trackDataV;
+    std::list<Window> _windowV;
+};
+
+#endif // ROTOTRACKER_H
@@ -4,10 +4,10 @@
 #include <QDebug>
 
 RotoscopeModule::RotoscopeModule(FrameViewer *parent,
-                                 cv::VideoCapture *capture, int length)
+                                 FrameCache *frames, int length)
 {
     _parent = parent;
-    _capture = capture;
+    _frames = frames;
     _currPath = NULL;
     _ctrlDrag = NULL;
     _dragCtrlNum = -1;
@@ -22,19 +22,15 @@ RotoscopeModule::RotoscopeModule(FrameViewer *parent,
     _showTrackPoints = true;
     _toolMode = T_MANUAL;
     _rotoCurvesArray = new RotoCurves[length+1];
-    _Cpyrms = new KLT_FullCPyramid[length+1];
-    _pyrmsE = new KLT_FullPyramid[length+1];
+    _tracker = new RotoTracker(frames, _rotoCurvesArray);
+    connect(_tracker, SIGNAL(progress()), this, SLOT(trackProgress()));
     _currRC = _rotoCurvesArray;
     mutualInit();
 }
 
 RotoscopeModule::~RotoscopeModule()
 {
-    if(_capture!=NULL)
-    {
-        _capture->release();
-        delete _capture;
-    }
+    delete _tracker;
 }
 
 void RotoscopeModule::frameChange(int i)
@@ -62,52 +58,21 @@ void RotoscopeModule::frameChange(int i)
     }
 }
 
-void RotoscopeModule::paintGL()
+// queued from the solvers' threads
+void RotoscopeModule::trackProgress()
 {
-    if (_tracking)
+    if (!_tracking)
+        return;
+    if (!_tracker->update())
     {
-        list<TrackGraph*>::iterator tgc;
-        list<MultiSplineData*>::iterator mtc;
-        list<KLT_TrackingContext*>::iterator kc;
-        for (tgc = _ccompV.begin(), mtc = _trackDataV.begin(), kc = _TCV.begin();
-                tgc != _ccompV.end() && mtc != _trackDataV.end()
-                        && kc != _TCV.end();)
-        {
-
-            (*mtc)->_z_mutex->lock();
-            if ((*kc)->_stateOk)
-                (*tgc)->copyLocs(*mtc);
-
-            (*mtc)->_z_mutex->unlock();
-
-            (*kc)->quit();
-            if ((*kc)->isFinished())
-            {
-                delete *tgc;
-                tgc = _ccompV.erase(tgc);
-                delete *mtc;
-                mtc = _trackDataV.erase(mtc);
-                delete *kc;
-                kc = _TCV.erase(kc);
-            }
-            else
-            {
-                ++tgc;
-                ++mtc;
-                ++kc;
-            }
-
-            if (_ccompV.size() == 0)
-            {
-                assert(_trackDataV.size() == 0 && _TCV.size() == 0);
-                killTimer (_trackingTimer);
-                _tracking = false;
-                emit enablePbCopySplinesAcrossTime(false);
-                break;
-            }
-        }
+        _tracking = false;
+        emit enablePbCopySplinesAcrossTime(false);
     }
+    _parent->updateGL();
+}
 
+void RotoscopeModule::paintGL()
+{
     // paint older paths
     _currRC->renderAllPaths(_showTrackPoints, _visEffort);
     if (_currPath)
@@ -168,7 +133,11 @@ void RotoscopeModule::mousePressEvent(QMouseEvent *e)
     }
     else if (_toolMode == T_SELECT)  // select
     {
-        RotoPath* pick = _currRC->pickPrimitive(e->x(), e->y());
+        // 5 pixels on the screen, whatever the zoom
+        Vec2f loc = unproject(e->x(), e->y(), _parent->_h);
+        float radius = sqrtf(loc.distanceTo2(
+                unproject(e->x() + 5, e->y(), _parent->_h)));
+        RotoPath* pick = _currRC->pickPrimitive(loc, radius);
         if (pick)
         {
             if (_shift) // multiple selection
@@ -522,203 +491,14 @@ void RotoscopeModule::rejig(PathV* paths, int frame, bool startOver)
 void RotoscopeModule::performTracks(const int aFrame, const int bFrame, bool doInterp,
         bool useExistingInbetweens)
 {
-    printf("toTrack size %d, a %d b %d\n", _toTrack.size(), aFrame, bFrame);
-    bool* done = new bool[_toTrack.size()];
-    memset(done, 0, _toTrack.size() * sizeof(bool));
-    PathV::const_iterator c2;
-    PathV::iterator c;
-
-    // interpolate somehow
-    if (doInterp && !useExistingInbetweens)
-    {
-        for (c2 = _toTrack.begin(); c2 != _toTrack.end(); ++c2)
-        {
-            keyframeSedInterp((*c2)->prevC(), aFrame, *c2, bFrame);
-        }
-        printf("Interpolated\n");
-    }
-
-    // build & reconcile joints
-    if (doInterp && !useExistingInbetweens)
-        RotoPath::buildBackReconcileJoints(_toTrack, bFrame, aFrame);
-    //ccomp->buildBackReconcileJoints(bFrame, aFrame);
-    printf("Joints done\n");
-
-    int i = 0, j;
-    RotoscopeModule *_is = this;
-    for (c = _toTrack.begin(); c != _toTrack.end(); ++c, ++i)
-    {
-        if (!done[i])
-        {
-            // get a full list beg to end of linked up paths (stop at already interpolated ones,
-            // ones not in toTrack list)
-            TrackGraph* ccomp = new TrackGraph();
-            MultiSplineData* mts = new MultiSplineData();
-
-            (*c)->buildccomp(ccomp, &_toTrack);
-
-            // start multiTrack
-            mts->_numFrames = bFrame - aFrame;
-            printf("started multi\n");
-
-            ccomp->buildMulti(mts);
-
-            addMasksToMulti(mts, ccomp->getKey0Paths(), aFrame);
-
-            // track
-            // pyrms and pyrmsE get deleted by longCurveTrack2
-            const KLT_FullCPyramid** pyrms =
-                    new const KLT_FullCPyramid *[mts->_numFrames + 1];
-            const KLT_FullPyramid** pyrmsE =
-                    new const KLT_FullPyramid *[mts->_numFrames + 1];
-
-            int _startF = 0;
-            for (j = 0; j <= mts->_numFrames; j++)
-            {
-                int a = aFrame + j;
-                QImage img = getImage();
-                if (_is->globalTC.useImage)
-                {
-                    KLT_FullCPyramid *fp = _Cpyrms + a - _startF;
-                    if (!fp->img)
-                    {
-                        fp->initMe(img, &globalTC);
-                        printf("Calculated frame %d\n", a);
-                    }
-                    pyrms[j] = fp;
-                    assert(pyrms[j]);
-                }
-                else
-                    pyrms[j] = NULL;
-
-                if (_is->globalTC.useEdges)
-                {
-                    KLT_FullPyramid *fp = _pyrmsE + a - _startF;
-                    if (!fp->img)
-                    {
-                        fp->initMeFromEdges(img, &globalTC);
-                        printf("Calculated edge frame %d\n", a);
-                    }
-                    pyrmsE[j] = fp;
-                    assert(pyrmsE[j]);
-                }
-                else
-                    pyrmsE[j] = NULL;
-            }
-            assert(setImageIndex(0));   //Back to head
-
-            RotoscopeModule *_is = this;
-            KLT_TrackingContext* tc = new KLT_TrackingContext(); // transfer global track settings
-            tc->copySettings(&(_is->globalTC));
-            tc->setupSplineTrack(pyrms, pyrmsE, mts, doInterp);
-
-            _ccompV.push_back(ccomp);
-            _trackDataV.push_back(mts);
-            _TCV.push_back(tc);
-
-            tc->start(); // ONE
-
-            if (!_tracking)
-            {
-                _tracking = true;
-                emit enablePbCopySplinesAcrossTime(false);
-                _trackingTimer = startTimer(200);
-            }
-
-            // Let done know these are processed
-            for (c2 = ccomp->paths()->begin(); c2 != ccomp->paths()->end();
-                    ++c2)
-            {
-                PathV::const_iterator which = find(_toTrack.begin(),
-                        _toTrack.end(), *c2);
-                assert(which != _toTrack.end());
-                done[which - _toTrack.begin()] = true;
-            }
-        }
-    }
-
+    _tracker->setMaskSize(_parent->_w, _parent->_h);
+    _tracker->track(_toTrack, aFrame, bFrame, &globalTC, doInterp,
+            useExistingInbetweens);
     _toTrack.clear();
-    delete[] done;
-}
-
-void RotoscopeModule::keyframeSedInterp(RotoPath* aPath, int aFrame, RotoPath *bPath,
-        int bFrame)
-{
-    assert(aPath && bPath);
-    assert (_propMode);
-    int numFrames = bFrame - aFrame;
-    assert(numFrames > 0);
-    int t;
-
-    bPath->setLowHeight(aPath->lowHeight());
-    bPath->setHighHeight(aPath->highHeight());
-    bPath->setTrackEdges(aPath->trackEdges());
-    printf("KeyframeSedInterp\n");
-
-    RotoPath* prev = aPath;
-    for (t = 1; t < numFrames; ++t)
-    {
-        RotoPath *newpath = new RotoPath(*aPath);
-        //newpath->setCan(t);
-        newpath->setFixed(false);
-        newpath->buildTouched(false);
-
-        int a = aFrame + t;
-        RotoCurves *curve = _rotoCurvesArray + a;
-        curve->addPath(newpath);
-
-        newpath->setPrevC(prev);
-        prev->setNextC(newpath);
-        if (t == 0)
-            newpath->buildINextCorrs();
-        else if (t == numFrames - 1 && globalTC.pinLast)
-        {
-            //newpath->_nextCoors = aPath->_nextCoors;
-            newpath->takeNextCont(aPath);
-            newpath->buildIPrevCorrs();
-        }
-        else
-        {
-            newpath->buildINextCorrs();
-            newpath->buildIPrevCorrs();
-        }
-        prev = newpath;
-    }
-
-    bPath->setPrevC(prev);
-    prev->setNextC(bPath);
-    //aPath->forgetNextCont();
-    aPath->buildINextCorrs();
-    assert(aPath->nextC());
-}
 
-void RotoscopeModule::addMasksToMulti(MultiSplineData* mts, const PathV& key0,
-        const int frame0)
-{
-    PathV currPaths = key0;
-    PathV::iterator c;
-    mts->setMaskDims(_parent->_w, _parent->_h);
-    for (int i = 0; i < mts->_numFrames + 1; ++i) // iterate over frames
+    if (!_tracking && _tracker->busy())
     {
-        RotoCurves* curve = _rotoCurvesArray + frame0 + i;
-        unsigned char* mask = curve->makeCummMask(currPaths);
-        mts->addMask(mask);
-        for (c = currPaths.begin(); c != currPaths.end(); ++c) // advance paths 1 frame
-            (*c) = (*c)->nextC();
+        _tracking = true;
+        emit enablePbCopySplinesAcrossTime(false);
     }
 }
-
-QImage RotoscopeModule::getImage()
-{
-    cv::Mat frame, temp;
-    _capture->read(frame);
-    cvtColor(frame, temp,CV_BGR2RGB); // cvtColor Makes a copt, that what i need
-    QImage img = QImage((const unsigned char*)(temp.data),
-                        temp.cols, temp.rows, temp.step, QImage::Format_RGB888);
-    return img;
-}
-
-bool RotoscopeModule::setImageIndex(int index)
-{
-    return _capture->set(CV_CAP_PROP_POS_FRAMES, index);
-}
@@ -4,6 +4,8 @@
 #include "RotoPath.h"
 #include "RotoCurves.h"
 #include "KLT.h"
+#include "FrameCache.h"
+#include "RotoTracker.h"
 #include <QGLWidget>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -17,7 +19,7 @@ class RotoscopeModule : public InterModule
 {
     Q_OBJECT
 public:
-    RotoscopeModule(FrameViewer *parent, cv::VideoCapture *capture, int length);
+    RotoscopeModule(FrameViewer *parent, FrameCache *frames, int length);
     ~RotoscopeModule();
     virtual void paintGL();
     virtual void mousePressEvent(QMouseEvent *e);
@@ -39,6 +41,9 @@ public:
 signals:
     void enablePbCopySplinesAcrossTime(bool enable);
 
+private slots:
+    void trackProgress();
+
 private:
     FrameViewer *_parent;
     RotoPath *_currPath;
@@ -54,20 +59,11 @@ private:
     int _nowFrame, _length;
     int _lastFrameTouched, _changeLastFrameTouched;
 
-    std::list<TrackGraph*> _ccompV;
-    std::list<KLT_TrackingContext*> _TCV;
-    std::list<MultiSplineData*> _trackDataV;
-    KLT_FullCPyramid *_Cpyrms;
-    KLT_FullPyramid *_pyrmsE;
+    RotoTracker *_tracker;
     PathV _toTrack;
     bool _tracking;
-    int _trackingTimer;
     void performTracks(const int aFrame, const int bFrame, bool doInterp=true, bool useExistingInbetweens=false);
-    void keyframeSedInterp(RotoPath* aPath, int aFrame, RotoPath *bPath, int bFrame);
-    void addMasksToMulti(MultiSplineData* mts, const PathV& key0, const int frame0);
-    cv::VideoCapture *_capture;
-    QImage getImage();
-    bool setImageIndex(int index);
+    FrameCache *_frames;
 
     bool _isCorrShow;
     bool _manualStage;
@@ -0,0 +1,270 @@
+#include "TemporalFilter.h"
+#include <math.h>
+#include <algorithm>
+#include <QThread>
+
+// rows of a frame one thread filters at a time
+#define TF_BAND_ROWS 16
+
+class TemporalFilter::BandThread : public QThread
+{
+public:
+    BandThread(TemporalFilter *filter, QAtomicInt *next)
+        : _filter(filter), _next(next) {}
+    virtual void run() { _filter->runTask(_next); }
+private:
+    TemporalFilter *_filter;
+    QAtomicInt *_next;
+};
+
+TemporalFilter::TemporalFilter()
+    : _type(IIR)
+    , _fl(0.05)
+    , _fh(0.4)
+    , _rate(30)
+    , _window(0)
+    , _threads(0)
+    , _count(0)
+    , _emitted(0)
+    , _tapsN(0)
+    , _task(RUN_IIR)
+    , _in(0)
+    , _iirOut(0)
+    , _rows(0)
+{
+}
+
+void TemporalFilter::setIIR(double fl, double fh)
+{
+    _type = IIR;
+    _fl = fl;
+    _fh = fh;
+    reset();
+}
+
+void TemporalFilter::setIdeal(double fl, double fh, double rate, int window)
+{
+    _type = IDEAL;
+    _fl = fl;
+    _fh = fh;
+    _rate = rate;
+    _window = std::max(window, 1);
+    reset();
+}
+
+void TemporalFilter::setThreads(int n)
+{
+    _threads = n;
+}
+
+void TemporalFilter::reset()
+{
+    _count = _emitted = 0;
+    _low1.release();
+    _low2.release();
+    _ring.clear();
+    _tapsN = 0;
+}
+
+/**
+ * push	-	filter the next frames of the stream
+ *
+ * IIR frames come out as they go in.  IDEAL keeps the last window of
+ * frames and the ones of this call; once the window is full, each new
+ * frame lets out the one half a window back.
+ *
+ * @param frames	-	next frames, CV_32F
+ * @param out		-	filtered frames are appended to it
+ */
+void TemporalFilter::push(const std::vector<cv::Mat> &frames,
+                          std::vector<cv::Mat> &out)
+{
+    if (frames.empty())
+        return;
+    const int n = frames.size();
+
+    if (_type == IIR) {
+        if (_count == 0) {
+            // both averages start at the first frame
+            frames[0].copyTo(_low1);
+            frames[0].copyTo(_low2);
+        }
+        std::vector<cv::Mat> res(n);
+        for (int i = 0; i < n; ++i)
+            res[i].create(frames[i].size(), frames[i].type());
+        _in = &frames;
+        _iirOut = &res;
+        runBands(RUN_IIR, frames[0].rows);
+        out.insert(out.end(), res.begin(), res.end());
+        _count += n;
+        _emitted += n;
+        return;
+    }
+
+    // room for the window and every frame of this call, frame f stays at
+    // f % size
+    const int size = _window + n;
+    if ((int) _ring.size() < size) {
+        std::vector<cv::Mat> ring(size);
+        for (int f = std::max(0, _count - (int) _ring.size()); f < _count; ++f)
+            ring[f % size] = _ring[f % _ring.size()];
+        _ring.swap(ring);
+    }
+
+    _idealOut.clear();
+    const int half = _window / 2;
+    for (int i = 0; i < n; ++i) {
+        const int t = _count++;
+        frames[i].copyTo(_ring[t % _ring.size()]);
+        if (t == _window - 1)
+            idealOut(t, _window, 0, half, out);
+        else if (t >= _window)
+            idealOut(t, _window, half, half, out);
+    }
+    if (!_idealOut.empty()) {
+        makeTaps(_window);
+        runBands(RUN_IDEAL, frames[0].rows);
+        _idealOut.clear();
+    }
+}
+
+/**
+ * flush	-	append the frames still held back at the end of the stream
+ *
+ * The rest of the last window comes out; a stream shorter than the window
+ * is filtered as one window of its own length.
+ *
+ * @param out	-	filtered frames are appended to it
+ */
+void TemporalFilter::flush(std::vector<cv::Mat> &out)
+{
+    if (_type == IIR || pending() == 0)
+        return;
+
+    _idealOut.clear();
+    const int last = _count - 1;
+    if (_count < _window)
+        idealOut(last, _count, 0, _count - 1, out);
+    else
+        idealOut(last, _window, _window / 2 + 1, _window - 1, out);
+    makeTaps(_idealN);
+    runBands(RUN_IDEAL, _ring[last % _ring.size()].rows);
+    _idealOut.clear();
+}
+
+// queue the frames at fromPos..toPos of the window of n frames ending at
+// frame last, and append them to out
+void TemporalFilter::idealOut(int last, int n, int fromPos, int toPos,
+                              std::vector<cv::Mat> &out)
+{
+    const cv::Mat &like = _ring[last % _ring.size()];
+    _idealN = n;
+    for (int pos = fromPos; pos <= toPos; ++pos) {
+        Output o;
+        o.dst.create(like.size(), like.type());
+        o.pos = pos;
+        o.last = last;
+        _idealOut.push_back(o);
+        out.push_back(o.dst);
+        ++_emitted;
+    }
+}
+
+/**
+ * makeTaps	-	ideal band-pass over n frames as a circular filter
+ *
+ * Keeping DFT bins k with fl <= k * rate / n <= fh and transforming back
+ * is the circular convolution with the inverse DFT of that mask,
+ * taps[d] = 1/n sum_k mask[k] cos(2 pi k d / n).
+ *
+ * @param n	-	window length
+ */
+void TemporalFilter::makeTaps(int n)
+{
+    if (_tapsN == n)
+        return;
+    _tapsN = n;
+    _taps.assign(n, 0.f);
+    for (int k = 0; k < n; ++k) {
+        // bin k and its mirror n - k are the same frequency
+        const double f = std::min(k, n - k) * _rate / n;
+        if (f < _fl || f > _fh)
+            continue;
+        for (int d = 0; d < n; ++d)
+            _taps[d] += float(cos(2 * M_PI * k * d / n) / n);
+    }
+}
+
+void TemporalFilter::runBands(Task task, int rows)
+{
+    _task = task;
+    _rows = rows;
+    const int bands = (rows + TF_BAND_ROWS - 1) / TF_BAND_ROWS;
+    int numThreads = _threads > 0 ? _threads : QThread::idealThreadCount();
+    numThreads = std::max(1, std::min(numThreads, bands));
+
+    QAtomicInt next(0);
+    std::vector<BandThread*> threads;
+    for (int t = 1; t < numThreads; ++t) {
+        threads.push_back(new BandThread(this, &next));
+        threads.back()->start();
+    }
+    runTask(&next);
+    for (unsigned int t = 0; t < threads.size(); ++t) {
+        threads[t]->wait();
+        delete threads[t];
+    }
+}
+
+void TemporalFilter::runTask(QAtomicInt *next)
+{
+    int band;
+    while ((band = next->fetchAndAddOrdered(1)) * TF_BAND_ROWS < _rows) {
+        const int r0 = band * TF_BAND_ROWS;
+        const int r1 = std::min(r0 + TF_BAND_ROWS, _rows);
+        if (_task == RUN_IIR)
+            iirRows(r0, r1);
+        else
+            idealRows(r0, r1);
+    }
+}
+
+// each frame of the chunk in turn over the same rows, so the state of the
+// band stays in cache
+void TemporalFilter::iirRows(int r0, int r1)
+{
+    const float fl = _fl, fh = _fh;
+    const int len = _low1.cols * _low1.channels();
+    for (unsigned int i = 0; i < _in->size(); ++i) {
+        for (int r = r0; r < r1; ++r) {
+            const float *x = (*_in)[i].ptr<float>(r);
+            float *low1 = _low1.ptr<float>(r), *low2 = _low2.ptr<float>(r);
+            float *y = (*_iirOut)[i].ptr<float>(r);
+            for (int c = 0; c < len; ++c) {
+                low1[c] += fh * (x[c] - low1[c]);
+                low2[c] += fl * (x[c] - low2[c]);
+                y[c] = low1[c] - low2[c];
+            }
+        }
+    }
+}
+
+void TemporalFilter::idealRows(int r0, int r1)
+{
+    const int n = _idealN, size = _ring.size();
+    for (unsigned int o = 0; o < _idealOut.size(); ++o) {
+        Output &out = _idealOut[o];
+        const int first = out.last - n + 1;
+        const int len = out.dst.cols * out.dst.channels();
+        for (int r = r0; r < r1; ++r) {
+            float *y = out.dst.ptr<float>(r);
+            std::fill(y, y + len, 0.f);
+            for (int j = 0; j < n; ++j) {
+                const float g = _taps[(out.pos - j + n) % n];
+                const float *x = _ring[(first + j) % size].ptr<float>(r);
+                for (int c = 0; c < len; ++c)
+                    y[c] += g * x[c];
+            }
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef TEMPORALFILTER_H
+#define TEMPORALFILTER_H
+
+#include <vector>
+#include <QAtomicInt>
+#include <opencv2/core/core.hpp>
+
+// Temporal band-pass of a stream of frames for Eulerian magnification,
+// in memory bounded by a chunk of frames instead of the whole clip.
+//
+// Frames go in and come out in order through push(); each pixel is
+// filtered along time on its own, so every frame is cut into bands of rows
+// filtered on several threads.
+//
+//   IIR    the difference of two running averages, as EVM does for motion;
+//          two frames of state and no delay.
+//   IDEAL  the ideal band-pass of EVM's colour magnification, a DFT over a
+//          sliding window of frames; output lags half a window.  Bin k is
+//          kept whole when fl <= k * rate / n <= fh.  The mask of the old
+//          createIdealBandpassFilter, laid over the packed spectrum
+//          column by column, could keep half of an edge bin, so the two
+//          differ at the band edges even over a whole-clip window.
+class TemporalFilter
+{
+public:
+
+    enum Type { IIR, IDEAL };
+
+    TemporalFilter();
+
+    // IIR band-pass, fl and fh the share of each new frame in the slow and
+    // the fast running average, 0 < fl < fh <= 1
+    void setIIR(double fl, double fh);
+
+    // ideal band-pass of fl to fh Hz at rate frames per second, over a
+    // window of that many frames
+    void setIdeal(double fl, double fh, double rate, int window);
+
+    // filter the rows of a frame on up to n threads, 0 for one per core
+    void setThreads(int n);
+
+    Type type() const { return _type; }
+
+    // forget the frames pushed so far
+    void reset();
+
+    // filter the next frames of the stream, CV_32F of any number of
+    // channels and all of the same size; the filtered frames that are ready
+    // are appended to out, oldest first
+    void push(const std::vector<cv::Mat> &frames, std::vector<cv::Mat> &out);
+
+    // append the frames still held back at the end of the stream
+    void flush(std::vector<cv::Mat> &out);
+
+    // number of frames pushed and not out yet
+    int pending() const { return _count - _emitted; }
+
+private:
+
+    // what the row bands are doing
+    enum Task { RUN_IIR, RUN_IDEAL };
+
+    struct Output
+    {
+        cv::Mat dst;
+        int pos, last; // place in the window and its newest frame
+    };
+
+    class BandThread;
+
+    void runBands(Task task, int rows);
+    void runTask(QAtomicInt *next);
+    void iirRows(int r0, int r1);
+    void idealRows(int r0, int r1);
+    void idealOut(int last, int n, int fromPos, int toPos,
+                  std::vector<cv::Mat> &out);
+    void makeTaps(int n);
+
+    Type _type;
+    double _fl, _fh, _rate;
+    int _window, _threads;
+
+    int _count, _emitted; // frames pushed and frames out
+
+    // IIR state
+    cv::Mat _low1, _low2;
+
+    // IDEAL state, frame f is at _ring[f % _ring.size()]
+    std::vector<cv::Mat> _ring;
+    std::vector<float> _taps; // _taps[d], d = (out - in) mod n
+    int _tapsN;
+
+    // current task
+    Task _task;
+    const std::vector<cv::Mat> *_in;
+    std::vector<cv::Mat> *_iirOut;
+    std::vector<Output> _idealOut;
+    int _idealN; // window length of _idealOut
+    int _rows;
+};
+
+#endif // TEMPORALFILTER_H
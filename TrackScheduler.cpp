@@ -0,0 +1,522 @@
+#include "TrackScheduler.h"
+#include <algorithm>
+#include <opencv2/imgproc/imgproc.hpp>
+
+static size_t pyramidBytes(const KLT_Pyramid *p)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < p->getNLevels(); ++i)
+        bytes += size_t(p->getNCols(i)) * p->getNRows(i) * sizeof(float);
+    return bytes;
+}
+
+// edge pyramids are 3 planes per level
+static size_t pyramidBytes(const KLT_FullCPyramid *cpyr,
+        const KLT_FullPyramid *epyr)
+{
+    size_t bytes = 0;
+    if (cpyr)
+        bytes += cpyr->bytes();
+    if (epyr && epyr->img)
+        bytes += 3 * pyramidBytes(epyr->img);
+    return bytes;
+}
+
+TrackScheduler::TrackScheduler(FrameCache *frames, int numWorkers)
+    : _frames(frames)
+    , _finishedCb(NULL)
+    , _finishedArg(NULL)
+    , _quit(false)
+    , _bytes(0)
+    , _budget(size_t(2047) << 20)
+{
+    _settings = new Settings;
+    _settings->generation = 0;
+    _settings->refs = 1;
+    _settings->diskCache.setVideo(_frames->getFileName());
+
+    if (numWorkers <= 0)
+        numWorkers = QThread::idealThreadCount();
+    if (numWorkers <= 0)
+        numWorkers = 1;
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        Worker *w = new Worker(this);
+        _workers.push_back(w);
+        w->start();
+    }
+}
+
+TrackScheduler::~TrackScheduler()
+{
+    _mutex.lock();
+    _quit = true;
+    _wake.wakeAll();
+    _mutex.unlock();
+
+    // a running solve cannot be interrupted, this waits for it
+    for (unsigned int i = 0; i < _workers.size(); ++i)
+    {
+        _workers[i]->wait();
+        delete _workers[i];
+    }
+
+    // tracks never started go back to nobody
+    std::list<TrackJob>::iterator it;
+    for (it = _trackJobs.begin(); it != _trackJobs.end(); ++it)
+        delete it->tc;
+    std::deque<PyramidJob>::iterator pj;
+    for (pj = _pyramidJobs.begin(); pj != _pyramidJobs.end(); ++pj)
+        unref(pj->settings);
+    unref(_settings);
+
+    while (!_resident.empty())
+        drop(_resident.begin());
+}
+
+void TrackScheduler::setSettings(const KLT_TrackingContext *tc)
+{
+    QMutexLocker lock(&_mutex);
+    const KLT_TrackingContext &old = _settings->tc;
+    const bool changed = tc->nPyramidLevels != old.nPyramidLevels
+            || tc->subsampling != old.subsampling
+            || tc->smooth_sigma_fact != old.smooth_sigma_fact
+            || tc->pyramid_sigma_fact != old.pyramid_sigma_fact
+            || tc->grad_sigma != old.grad_sigma;
+
+    // jobs queued already keep building with the settings they were
+    // queued with
+    Settings *s = newSettings();
+    if (changed)
+        ++s->generation;
+    s->tc.copySettings(tc);
+    s->diskCache.setSettings(tc);
+    unref(_settings);
+    _settings = s;
+
+    // idle pyramids built with other settings are of no use any more; the
+    // ones in use go once they are not
+    if (changed)
+        evict(0);
+}
+
+void TrackScheduler::setCacheDirectory(const QString &dir)
+{
+    QMutexLocker lock(&_mutex);
+    Settings *s = newSettings();
+    s->diskCache.setDirectory(dir);
+    unref(_settings);
+    _settings = s;
+}
+
+void TrackScheduler::acquireSpan(int aFrame, int bFrame, bool useImage,
+        bool useEdges)
+{
+    QMutexLocker lock(&_mutex);
+    const int generation = _settings->generation;
+    Span span = { generation, aFrame, bFrame };
+    _spans.push_back(span);
+    retain(generation, aFrame, bFrame);
+
+    for (int frame = aFrame; frame <= bFrame; ++frame)
+    {
+        // only pyramids created here need building, the others are built
+        // or on their way for an earlier span.  A frame that failed is
+        // tried again once nothing refers to it any more.
+        Resident &r = _resident[Key(generation, frame)];
+        if (r.failed)
+            continue;
+        PyramidJob job;
+        job.settings = _settings;
+        job.frame = frame;
+        job.cpyr = NULL;
+        job.epyr = NULL;
+        if (useImage && !r.cpyr)
+            job.cpyr = r.cpyr = new KLT_FullCPyramid();
+        if (useEdges && !r.epyr)
+            job.epyr = r.epyr = new KLT_FullPyramid();
+        if (!job.cpyr && !job.epyr)
+            continue;
+
+        ++_settings->refs;
+        _pyramidJobs.push_back(job);
+        _pendingFrames.insert(Key(generation, frame));
+        _wake.wakeOne();
+    }
+}
+
+void TrackScheduler::releaseSpan(int aFrame, int bFrame)
+{
+    QMutexLocker lock(&_mutex);
+    std::list<Span>::iterator it = _spans.end();
+    do
+    {
+        assert(it != _spans.begin());
+        --it;
+    } while (it->aFrame != aFrame || it->bFrame != bFrame);
+    const int generation = it->generation;
+    _spans.erase(it);
+    release(generation, aFrame, bFrame);
+}
+
+const KLT_FullCPyramid *TrackScheduler::colorPyramid(int frame)
+{
+    QMutexLocker lock(&_mutex);
+    std::map<Key, Resident>::const_iterator it =
+            _resident.find(Key(spanGeneration(frame, frame), frame));
+    assert(it != _resident.end() && it->second.refs > 0);
+    return it->second.cpyr;
+}
+
+const KLT_FullPyramid *TrackScheduler::edgePyramid(int frame)
+{
+    QMutexLocker lock(&_mutex);
+    std::map<Key, Resident>::const_iterator it =
+            _resident.find(Key(spanGeneration(frame, frame), frame));
+    assert(it != _resident.end() && it->second.refs > 0);
+    return it->second.epyr;
+}
+
+void TrackScheduler::addTrack(KLT_TrackingContext *tc, int aFrame,
+        int bFrame, double cost)
+{
+    QMutexLocker lock(&_mutex);
+    TrackJob job;
+    job.tc = tc;
+    job.generation = spanGeneration(aFrame, bFrame);
+    job.aFrame = aFrame;
+    job.bFrame = bFrame;
+    job.cost = cost;
+    retain(job.generation, aFrame, bFrame);
+
+    // every worker may be solving at once, so a solve assembling on a
+    // thread per core would run workers times cores threads
+    if (tc->assemblyThreads <= 0)
+        tc->assemblyThreads = std::max(1,
+                QThread::idealThreadCount() / int(_workers.size()));
+
+    // the pyramids of a frame that failed are gone, it must not run
+    for (int frame = aFrame; frame <= bFrame; ++frame)
+        if (_resident[Key(job.generation, frame)].failed)
+        {
+            job.tc->_stateOk = false;
+            finishTrack(job);
+            return;
+        }
+
+    _trackJobs.push_back(job);
+    _wake.wakeOne();
+}
+
+void TrackScheduler::setMemoryBudget(size_t bytes)
+{
+    QMutexLocker lock(&_mutex);
+    _budget = bytes;
+    evict(_budget);
+}
+
+size_t TrackScheduler::residentBytes()
+{
+    QMutexLocker lock(&_mutex);
+    std::map<Key, Resident>::iterator it;
+    for (it = _resident.begin(); it != _resident.end(); ++it)
+        if (_pendingFrames.find(it->first) == _pendingFrames.end())
+            measure(it->second);
+    return _bytes;
+}
+
+bool TrackScheduler::collectFinished(const KLT_TrackingContext *tc)
+{
+    QMutexLocker lock(&_mutex);
+    std::set<const KLT_TrackingContext*>::iterator it = _finished.find(tc);
+    if (it == _finished.end())
+        return false;
+    _finished.erase(it);
+    return true;
+}
+
+bool TrackScheduler::waitForFinished(unsigned long msecs)
+{
+    QMutexLocker lock(&_mutex);
+    if (!_finished.empty())
+        return true;
+    return _trackDone.wait(&_mutex, msecs);
+}
+
+void TrackScheduler::work()
+{
+    QMutexLocker lock(&_mutex);
+    while (!_quit)
+    {
+        if (!_pyramidJobs.empty())
+        {
+            PyramidJob job = _pyramidJobs.front();
+            _pyramidJobs.pop_front();
+            lock.unlock();
+
+            buildPyramids(job);
+
+            lock.relock();
+            const Key key(job.settings->generation, job.frame);
+            unref(job.settings);
+            _pendingFrames.erase(_pendingFrames.find(key));
+            if ((job.cpyr && !job.cpyr->img) || (job.epyr && !job.epyr->img))
+                failFrame(key, job);
+            // the last job of the frame measures it
+            std::map<Key, Resident>::iterator it = _resident.find(key);
+            if (it != _resident.end()
+                    && _pendingFrames.find(key) == _pendingFrames.end())
+            {
+                Resident &r = it->second;
+                measure(r);
+                // released while being built, and failed or with settings
+                // changed since
+                if (r.refs == 0
+                        && (r.failed || key.first != _settings->generation))
+                    drop(it);
+            }
+            evict(_budget);
+            // tracks waiting on this frame may be ready now
+            _wake.wakeAll();
+            continue;
+        }
+
+        TrackJob job;
+        if (nextReadyTrack(&job))
+        {
+            lock.unlock();
+
+            job.tc->runNoThread();
+
+            lock.relock();
+            finishTrack(job);
+            continue;
+        }
+
+        _wake.wait(&_mutex);
+    }
+}
+
+// Without _mutex; job.settings stays as it is while the job holds it.
+void TrackScheduler::buildPyramids(const PyramidJob &job)
+{
+    const KLT_TrackingContext *settings = &job.settings->tc;
+    const PyramidCache &diskCache = job.settings->diskCache;
+
+    if (job.cpyr && !job.cpyr->img && diskCache.load(job.frame, job.cpyr))
+        printf("Loaded frame %d\n", job.frame);
+    if (job.epyr && !job.epyr->img && diskCache.load(job.frame, job.epyr))
+        printf("Loaded edge frame %d\n", job.frame);
+
+    if ((!job.cpyr || job.cpyr->img) && (!job.epyr || job.epyr->img))
+        return;
+
+    QImage img = frameImage(job.frame);
+    if (img.isNull())
+        return;
+
+    if (job.cpyr && !job.cpyr->img)
+    {
+        job.cpyr->initMe(img, settings);
+        diskCache.store(job.frame, job.cpyr);
+        printf("Calculated frame %d\n", job.frame);
+    }
+    if (job.epyr && !job.epyr->img)
+    {
+        job.epyr->initMeFromEdges(img, settings);
+        diskCache.store(job.frame, job.epyr);
+        printf("Calculated edge frame %d\n", job.frame);
+    }
+}
+
+// Needs _mutex.  Takes the costliest track whose frames all have pyramids.
+bool TrackScheduler::nextReadyTrack(TrackJob *job)
+{
+    std::list<TrackJob>::iterator it, best = _trackJobs.end();
+    for (it = _trackJobs.begin(); it != _trackJobs.end(); ++it)
+    {
+        std::multiset<Key>::const_iterator p =
+                _pendingFrames.lower_bound(Key(it->generation, it->aFrame));
+        if (p != _pendingFrames.end() && p->first == it->generation
+                && p->second <= it->bFrame)
+            continue;
+        if (best == _trackJobs.end() || it->cost > best->cost)
+            best = it;
+    }
+    if (best == _trackJobs.end())
+        return false;
+    *job = *best;
+    _trackJobs.erase(best);
+    return true;
+}
+
+// Needs _mutex.  Hands a track back to its owner, run or not.
+void TrackScheduler::finishTrack(const TrackJob &job)
+{
+    _finished.insert(job.tc);
+    release(job.generation, job.aFrame, job.bFrame);
+    _trackDone.wakeAll();
+    if (_finishedCb)
+        _finishedCb(_finishedArg);
+}
+
+// Needs _mutex.  The pyramids job made for key could not be built: they
+// are freed, and the tracks waiting for them finish without running.
+// Pyramids of the frame built or being built by other jobs stay, tracks may
+// be running on them.
+void TrackScheduler::failFrame(const Key &key, const PyramidJob &job)
+{
+    printf("Cannot read frame %d\n", key.second);
+    Resident &r = _resident[key];
+    r.failed = true;
+    if (job.cpyr && !job.cpyr->img)
+    {
+        assert(r.cpyr == job.cpyr);
+        delete r.cpyr;
+        r.cpyr = NULL;
+    }
+    if (job.epyr && !job.epyr->img)
+    {
+        assert(r.epyr == job.epyr);
+        delete r.epyr;
+        r.epyr = NULL;
+    }
+
+    std::list<TrackJob> failed;
+    std::list<TrackJob>::iterator it = _trackJobs.begin();
+    while (it != _trackJobs.end())
+    {
+        if (it->generation == key.first && it->aFrame <= key.second
+                && key.second <= it->bFrame)
+        {
+            it->tc->_stateOk = false;
+            failed.push_back(*it);
+            it = _trackJobs.erase(it);
+        }
+        else
+            ++it;
+    }
+    for (it = failed.begin(); it != failed.end(); ++it)
+        finishTrack(*it);
+
+    // with nothing waiting for it the next span tries again
+    std::map<Key, Resident>::iterator r2 = _resident.find(key);
+    if (r2 != _resident.end() && r2->second.refs == 0
+            && _pendingFrames.find(key) == _pendingFrames.end())
+        drop(r2);
+}
+
+// Needs _mutex.  The generation of the last acquired span holding
+// aFrame..bFrame.
+int TrackScheduler::spanGeneration(int aFrame, int bFrame) const
+{
+    std::list<Span>::const_reverse_iterator it;
+    for (it = _spans.rbegin(); it != _spans.rend(); ++it)
+        if (it->aFrame <= aFrame && bFrame <= it->bFrame)
+            return it->generation;
+    assert(!"frames of no acquired span");
+    return _settings->generation;
+}
+
+// Needs _mutex.
+void TrackScheduler::retain(int generation, int aFrame, int bFrame)
+{
+    for (int frame = aFrame; frame <= bFrame; ++frame)
+    {
+        const Key key(generation, frame);
+        std::map<Key, Resident>::iterator it = _resident.find(key);
+        if (it == _resident.end())
+            it = _resident.insert(std::make_pair(key, Resident())).first;
+        else if (it->second.refs == 0)
+            _idle.erase(it->second.idle);
+        ++it->second.refs;
+    }
+}
+
+// Needs _mutex.  Frames nothing refers to any more become idle, or go at
+// once if they failed or are of old settings.
+void TrackScheduler::release(int generation, int aFrame, int bFrame)
+{
+    for (int frame = aFrame; frame <= bFrame; ++frame)
+    {
+        const Key key(generation, frame);
+        std::map<Key, Resident>::iterator it = _resident.find(key);
+        assert(it != _resident.end() && it->second.refs > 0);
+        Resident &r = it->second;
+        if (--r.refs > 0)
+            continue;
+        if (_pendingFrames.find(key) == _pendingFrames.end())
+            measure(r);
+        r.idle = _idle.insert(_idle.end(), key);
+        if ((r.failed || generation != _settings->generation)
+                && _pendingFrames.find(key) == _pendingFrames.end())
+            drop(it);
+    }
+    evict(_budget);
+}
+
+// Needs _mutex.  Frees idle frames, oldest first, down to budget bytes, or
+// all of them for a budget of 0.  Frames whose pyramids are still being
+// built are left for later.
+void TrackScheduler::evict(size_t budget)
+{
+    std::list<Key>::iterator it = _idle.begin();
+    while ((budget == 0 || _bytes > budget) && it != _idle.end())
+    {
+        Key key = *it++;
+        if (_pendingFrames.find(key) == _pendingFrames.end())
+            drop(_resident.find(key));
+    }
+}
+
+// Needs _mutex, and the pyramids of r not being built.  Planes of views
+// unpack under a lock of their own, so tracks may be running on them.
+void TrackScheduler::measure(Resident &r)
+{
+    _bytes -= r.bytes;
+    r.bytes = pyramidBytes(r.cpyr, r.epyr);
+    _bytes += r.bytes;
+}
+
+// Needs _mutex, or the workers gone.
+void TrackScheduler::drop(std::map<Key, Resident>::iterator it)
+{
+    Resident &r = it->second;
+    if (r.refs == 0)
+        _idle.erase(r.idle);
+    delete r.cpyr;
+    delete r.epyr;
+    _bytes -= r.bytes;
+    _resident.erase(it);
+}
+
+// Needs _mutex.  A copy of the current settings, to be changed before it is
+// made current.
+TrackScheduler::Settings *TrackScheduler::newSettings()
+{
+    Settings *s = new Settings;
+    s->tc.copySettings(&_settings->tc);
+    s->diskCache = _settings->diskCache;
+    s->generation = _settings->generation;
+    s->refs = 1;
+    return s;
+}
+
+// Needs _mutex, or the workers gone.
+void TrackScheduler::unref(Settings *s)
+{
+    if (--s->refs == 0)
+        delete s;
+}
+
+QImage TrackScheduler::frameImage(int frame)
+{
+    cv::Mat mat, temp;
+    if (!_frames->getFrame(frame, mat))
+        return QImage();
+    cv::cvtColor(mat, temp, CV_BGR2RGB);
+    QImage img((const unsigned char*)(temp.data),
+               temp.cols, temp.rows, temp.step, QImage::Format_RGB888);
+    return img.copy();  // temp dies with this scope
+}
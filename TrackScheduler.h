@@ -0,0 +1,200 @@
+#ifndef TRACKSCHEDULER_H
+#define TRACKSCHEDULER_H
+
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <climits>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include "KLT.h"
+#include "PyramidCache.h"
+#include "FrameCache.h"
+
+// Bounded worker pool for RotoTracker::track.
+//
+// Building the pyramids of a frame and solving one connected component are
+// both jobs for the same pool, so there are never more busy threads than
+// workers.  Pyramid jobs go first since they unblock everything else; a
+// tracking job waits until every frame of its span has pyramids, and among
+// the ready ones the costliest starts first so the long solves are not left
+// for the end.  While the pyramids of a new span are being built, workers
+// that are not needed for them keep solving the spans queued earlier.
+//
+// With a cache directory set, pyramids are looked up in a PyramidCache on
+// disk before being built, and stored there once built, so reopening a
+// video skips rebuilding them.  There is none by default.
+//
+// The scheduler also owns the pyramids.  A frame stays resident while a span
+// or a queued or running track refers to it; once nothing does it becomes
+// idle, and idle frames are freed oldest first whenever the pyramids take
+// more than the memory budget.  A freed frame comes back from the disk cache,
+// or is rebuilt, the next time a span needs it.
+//
+// Each pyramid is kept with the generation of the settings it was built
+// with, which changes whenever setSettings() changes how pyramids are made.
+// A span only uses pyramids of the generation it was acquired in, so the
+// tracks still running on old pyramids keep them while new spans get new
+// ones.  A frame that cannot be decoded fails the tracks that need it; the
+// next span to acquire it once they are gone tries again.
+class TrackScheduler
+{
+public:
+
+    // numWorkers <= 0 means one per core
+    TrackScheduler(FrameCache *frames, int numWorkers = 0);
+    ~TrackScheduler();
+
+    // settings the pyramids are built with, from the next acquireSpan() on;
+    // pyramids already queued are built with the ones they were queued with
+    void setSettings(const KLT_TrackingContext *tc);
+
+    // directory of the on-disk pyramid cache, empty to turn it off
+    void setCacheDirectory(const QString &dir);
+
+    // keep frames aFrame..bFrame resident and queue building the pyramids
+    // they lack, colour ones if useImage and edge ones if useEdges.
+    // Balanced by releaseSpan(); spans are released last acquired first.
+    // Its pyramids are built with the settings at the time.
+    void acquireSpan(int aFrame, int bFrame, bool useImage, bool useEdges);
+    void releaseSpan(int aFrame, int bFrame);
+
+    // pyramids of a frame of the last acquired span holding it, NULL if not
+    // asked for or if the frame could not be read.  They may still be being
+    // built; a track waits for them.
+    const KLT_FullCPyramid *colorPyramid(int frame);
+    const KLT_FullPyramid *edgePyramid(int frame);
+
+    // queue a prepared tracking context (setupSplineTrack done) for frames
+    // aFrame..bFrame of an acquired span, cost as given by
+    // MultiSplineData::estimatedCost().  The frames stay resident until it
+    // has run.  If one of them cannot be read it finishes without running,
+    // with _stateOk false.
+    void addTrack(KLT_TrackingContext *tc, int aFrame, int bFrame,
+            double cost);
+
+    // soft limit on the memory taken by pyramids, frames in use are never
+    // freed whatever it is.  Planes a packed-only pyramid unpacks while in
+    // use count from when it is released, or residentBytes() is asked.
+    void setMemoryBudget(size_t bytes);
+    size_t residentBytes();
+
+    // true once tc has finished running, and forgets it.  The caller then
+    // owns tc again and may delete it.
+    bool collectFinished(const KLT_TrackingContext *tc);
+
+    // block until a track has finished and not been collected yet, or
+    // msecs have passed.  False on a timeout.
+    bool waitForFinished(unsigned long msecs = ULONG_MAX);
+
+    // cb(arg) from a worker whenever a track has finished.  Set it before
+    // adding tracks.
+    void setFinishedCallback(void (*cb)(void*), void *arg)
+    {
+        _finishedCb = cb;
+        _finishedArg = arg;
+    }
+
+    int numWorkers() const { return _workers.size(); }
+
+private:
+
+    class Worker : public QThread
+    {
+    public:
+        Worker(TrackScheduler *owner) : _owner(owner) {}
+    protected:
+        virtual void run() { _owner->work(); }
+    private:
+        TrackScheduler *_owner;
+    };
+
+    // what pyramids are built with and cached under.  Never changed once
+    // made, so a worker reads the one of its job without the lock; a change
+    // of settings makes a new one.
+    struct Settings
+    {
+        KLT_TrackingContext tc;
+        PyramidCache diskCache;
+        int generation;                 // of the pyramids built with it
+        int refs;                       // the scheduler's and the jobs'
+    };
+
+    typedef std::pair<int, int> Key;    // generation, frame
+
+    struct PyramidJob
+    {
+        Settings *settings;
+        int frame;
+        KLT_FullCPyramid *cpyr;
+        KLT_FullPyramid *epyr;
+    };
+
+    struct TrackJob
+    {
+        KLT_TrackingContext *tc;
+        int generation;
+        int aFrame, bFrame;
+        double cost;
+    };
+
+    struct Span
+    {
+        int generation;
+        int aFrame, bFrame;
+    };
+
+    struct Resident
+    {
+        Resident() : cpyr(NULL), epyr(NULL), refs(0), bytes(0),
+                failed(false) {}
+        KLT_FullCPyramid *cpyr;
+        KLT_FullPyramid *epyr;
+        int refs;                       // spans and tracks using it
+        size_t bytes;
+        bool failed;                    // the frame could not be read
+        std::list<Key>::iterator idle;  // valid while refs == 0
+    };
+
+    void work();
+    void buildPyramids(const PyramidJob &job);
+    bool nextReadyTrack(TrackJob *job);
+    void finishTrack(const TrackJob &job);
+    void failFrame(const Key &key, const PyramidJob &job);
+    int spanGeneration(int aFrame, int bFrame) const;
+    QImage frameImage(int frame);
+
+    void retain(int generation, int aFrame, int bFrame);
+    void release(int generation, int aFrame, int bFrame);
+    void evict(size_t budget);
+    void measure(Resident &r);
+    void drop(std::map<Key, Resident>::iterator it);
+    Settings *newSettings();
+    void unref(Settings *s);
+
+    FrameCache *_frames;
+    Settings *_settings;                // for the jobs queued from now on
+    std::vector<Worker*> _workers;
+
+    std::deque<PyramidJob> _pyramidJobs;
+    std::multiset<Key> _pendingFrames;    // queued or being built
+    std::list<TrackJob> _trackJobs;
+    std::list<Span> _spans;             // acquired, oldest first
+    std::set<const KLT_TrackingContext*> _finished;
+    void (*_finishedCb)(void*);
+    void *_finishedArg;
+    bool _quit;
+
+    std::map<Key, Resident> _resident;
+    std::list<Key> _idle;               // unused frames, oldest first
+    size_t _bytes, _budget;
+
+    QMutex _mutex;
+    QWaitCondition _wake;
+    QWaitCondition _trackDone;
+};
+
+#endif // TRACKSCHEDULER_H
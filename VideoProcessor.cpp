@@ -18,6 +18,12 @@
 //
 
 #include "VideoProcessor.h"
+#include <math.h>
+#include <cstdio>
+#include <deque>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
 
 VideoProcessor::VideoProcessor(QObject *parent)
   : QObject(parent)
@@ -29,7 +35,6 @@ VideoProcessor::VideoProcessor(QObject *parent)
   , modify(false)
   , curPos(0)
   , curIndex(0)
-  , curLevel(0)
   , digits(0)
   , extension(".avi")
   , levels(4)
@@ -41,7 +46,12 @@ VideoProcessor::VideoProcessor(QObject *parent)
   , delta(0)
   , exaggeration_factor(2.0)
   , lambda(0)
+  , spatialType(LAPLACIAN)
+  , chunkSize(8)
+  , idealWindow(32)
+  , playStats()
   , _loop(false)
+  , framePos(0)
 {
     connect(this, SIGNAL(revert()), this, SLOT(revertVideo()));
 }
@@ -79,17 +89,17 @@ long VideoProcessor::getNumberOfPlayedFrames()
     return curPos;
 }
 
-cv::VideoCapture *VideoProcessor::getClonedCapture()
+/**
+ * getFrameCache	-	get the decoded-frame cache
+ *
+ * the roto and draw modules read frames through the same cache,
+ * so a frame decoded for one of them is free for the others
+ *
+ * @return the frame cache of the input video
+ */
+FrameCache *VideoProcessor::getFrameCache()
 {
-    cv::VideoCapture *cloneCapture = new cv::VideoCapture();
-    if (cloneCapture->isOpened()){
-        cloneCapture->release();
-    }
-    if(cloneCapture->open(inputFile)){
-        return cloneCapture;
-    } else {
-        return NULL;
-    }
+    return &cache;
 }
 
 /**
@@ -114,9 +124,7 @@ cv::Size VideoProcessor::getFrameSize()
  */
 long VideoProcessor::getFrameNumber()
 {
-    long f = static_cast<long>(capture.get(CV_CAP_PROP_POS_FRAMES));
-
-    return f;
+    return framePos;
 }
 
 /**
@@ -126,7 +134,9 @@ long VideoProcessor::getFrameNumber()
  */
 double VideoProcessor::getPositionMS()
 {
-    double t = capture.get(CV_CAP_PROP_POS_MSEC);
+    if (rate <= 0)
+        return 0;
+    double t = 1000.0 * framePos / rate;
 
     return t;
 }
@@ -185,78 +195,6 @@ void VideoProcessor::calculateLength()
     tempCapture.release();
 }
 
-/**
- * concat	-	concat all the frames into a single large Mat
- *              where each column is a reshaped single frame
- *
- * @param frames	-	frames of the video sequence
- * @param dst		-	destinate concatnate image
- */
-void VideoProcessor::concat(const std::vector<cv::Mat> &frames,
-                            cv::Mat &dst)
-{
-    cv::Size frameSize = frames.at(0).size();
-    cv::Mat temp(frameSize.width*frameSize.height, length-1, CV_32FC3);
-    for (int i = 0; i < length-1; ++i) {
-        // get a frame if any
-        cv::Mat input = frames.at(i);
-        // reshape the frame into one column
-        cv::Mat reshaped = input.reshape(3, input.cols*input.rows).clone();
-        cv::Mat line = temp.col(i);
-        // save the reshaped frame to one column of the destinate big image
-        reshaped.copyTo(line);
-    }
-    temp.copyTo(dst);
-}
-
-/**
- * deConcat	-	de-concat the concatnate image into frames
- *
- * @param src       -   source concatnate image
- * @param framesize	-	frame size
- * @param frames	-	destinate frames
- */
-void VideoProcessor::deConcat(const cv::Mat &src,
-                              const cv::Size &frameSize,
-                              std::vector<cv::Mat> &frames)
-{
-    for (int i = 0; i < length-1; ++i) {    // get a line if any
-        cv::Mat line = src.col(i).clone();
-        cv::Mat reshaped = line.reshape(3, frameSize.height).clone();
-        frames.push_back(reshaped);
-    }
-}
-
-/**
- * createIdealBandpassFilter	-	create a 1D ideal band-pass filter
- *
- * @param filter    -	destinate filter
- * @param fl        -	low cut-off
- * @param fh		-	high cut-off
- * @param rate      -   sampling rate(i.e. video frame rate)
- */
-void VideoProcessor::createIdealBandpassFilter(cv::Mat &filter, double fl, double fh, double rate)
-{
-    int width = filter.cols;
-    int height = filter.rows;
-
-    fl = 2 * fl * width / rate;
-    fh = 2 * fh * width / rate;
-
-    double response;
-
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            // filter response
-            if (j >= fl && j <= fh)
-                response = 1.0f;
-            else
-                response = 0.0f;
-            filter.at<float>(i, j) = response;
-        }
-    }
-}
-
 /**
  * getCodec	-	get the codec of input video
  *
@@ -324,9 +262,10 @@ bool VideoProcessor::setInput(const std::string &fileName)
     if (isOpened()){
         capture.release();
     }
+    framePos = 0;
 
     // Open the video file
-    if(capture.open(fileName)){
+    if(capture.open(fileName) && cache.open(fileName)){
         // read parameters
         length = capture.get(CV_CAP_PROP_FRAME_COUNT);
         rate = getFrameRate();
@@ -485,10 +424,10 @@ bool VideoProcessor::jumpTo(long index)
     }
 
     cv::Mat frame;
-    bool re = capture.set(CV_CAP_PROP_POS_FRAMES, index);
+    bool re = cache.getFrame(index, frame);
 
     if (re){
-        capture.read(frame);
+        framePos = index + 1;
         emit showFrame(index,frame);
     }
 
@@ -506,7 +445,11 @@ bool VideoProcessor::jumpTo(long index)
  */
 bool VideoProcessor::jumpToMS(double pos)
 {
-    return capture.set(CV_CAP_PROP_POS_MSEC, pos);
+    long index = static_cast<long>(pos * rate / 1000.0);
+    if (index < 0 || index >= length)
+        return false;
+    framePos = index;
+    return true;
 }
 
 
@@ -519,7 +462,9 @@ void VideoProcessor::close()
     rate = 0;
     length = 0;
     modify = 0;
+    framePos = 0;
     capture.release();
+    cache.close();
     writer.release();
     tempWriter.release();
 }
@@ -561,13 +506,16 @@ bool VideoProcessor::isOpened()
 /**
  * getNextFrame	-	get the next frame if any
  *
- * @param frame	-	the expected frame
+ * @param frame	-	the expected frame, shared with the frame cache
  *
  * @return True if success. False otherwise
  */
 bool VideoProcessor::getNextFrame(cv::Mat &frame)
 {
-    return capture.read(frame);
+    if (!cache.getFrame(framePos, frame))
+        return false;
+    ++framePos;
+    return true;
 }
 
 void VideoProcessor::setLoop(bool loop)
@@ -594,15 +542,59 @@ void VideoProcessor::writeNextFrame(cv::Mat &frame)
     }
 }
 
+// frames decoded ahead of playback
+#define PLAYBACK_RING 8
+
+struct VideoProcessor::PlaybackRing
+{
+    QMutex mutex;
+    QWaitCondition changed;
+
+    struct Slot
+    {
+        long index;
+        cv::Mat frame;
+    };
+    // frame n put is in slot n % PLAYBACK_RING
+    Slot frames[PLAYBACK_RING];
+    // frames taken and put so far
+    long head, tail;
+    // index of the frame the decoder reads next
+    long next;
+    // bumped when the ring is emptied to skip ahead; frames read before
+    // are thrown away
+    int generation;
+    // past the last frame, and playback over
+    bool ended, quit;
+
+    // time spent getting frames from the cache
+    double decodeMs;
+    long decoded;
+};
+
+class VideoProcessor::PlaybackThread : public QThread
+{
+public:
+    PlaybackThread(VideoProcessor *vp, PlaybackRing *ring)
+        : _vp(vp), _ring(ring) {}
+    virtual void run() { _vp->playbackDecode(_ring); }
+private:
+    VideoProcessor *_vp;
+    PlaybackRing *_ring;
+};
+
 /**
  * playIt	-	play the frames of the sequence
  *
+ * A thread reads frames ahead into a small ring while this one shows them
+ * at the frame rate: frame n is due n / rate seconds after the first by a
+ * monotonic clock, whatever reading and showing them took.  A frame more
+ * than a frame late is dropped if a later one is ready; if reading is far
+ * behind too, it skips ahead to the frame due now.  In between frames the UI runs in
+ * sleep().  A negative delay plays as fast as frames come.
  */
 void VideoProcessor::playIt()
 {
-    // current frame
-    cv::Mat input;
-
     // if no capture device has been set
     if (!isOpened())
         return;
@@ -613,36 +605,170 @@ void VideoProcessor::playIt()
     // update buttons
     emit updateBtn();
 
-    while (!isStop()) {
+    PlaybackRing ring;
+    ring.head = ring.tail = 0;
+    ring.next = framePos;
+    ring.generation = 0;
+    ring.ended = ring.quit = false;
+    ring.decodeMs = 0;
+    ring.decoded = 0;
+    PlaybackThread decoder(this, &ring);
+    decoder.start();
+
+    playStats = PlaybackStats();
+    const bool paced = delay >= 0;
+    const double interval = 1000.0 / (rate > 0 ? rate : 25.0);
+    QElapsedTimer clock;
+    clock.start();
+    long base = -1, last = -1;    // frame due at baseTime, and the last one
+    double baseTime = 0, firstTime = 0, presentMs = 0;
 
-        // read next frame if any
-        if (!getNextFrame(input))
+    while (!isStop()) {
+        long index;
+        cv::Mat input;
         {
-            if(_loop)
-            {
-                jumpTo(0);
-                curPos = 0;
+            QMutexLocker lock(&ring.mutex);
+            while (ring.head == ring.tail && !ring.ended)
+                ring.changed.wait(&ring.mutex);
+            if (ring.head == ring.tail)
+                break;
+            PlaybackRing::Slot &slot = ring.frames[ring.head % PLAYBACK_RING];
+            index = slot.index;
+            input = slot.frame;
+            slot.frame.release();
+            ++ring.head;
+            ring.changed.wakeAll();
+            playStats.decodeMs = ring.decoded ? ring.decodeMs / ring.decoded : 0;
+        }
+
+        double now = clock.nsecsElapsed() / 1e6;
+        if (base < 0 || index < last) {
+            // first frame, or looped back to the start
+            base = index;
+            baseTime = now;
+        }
+        last = index;
+        const double due = baseTime + (index - base) * interval;
+
+        if (paced && now > due + interval) {
+            const long target = std::min(base + (long) ((now - baseTime) / interval),
+                                         length - 1);
+            QMutexLocker lock(&ring.mutex);
+            if (target - ring.next > PLAYBACK_RING) {
+                for (; ring.head < ring.tail; ++ring.head)
+                    ring.frames[ring.head % PLAYBACK_RING].frame.release();
+                ring.next = target;
+                ring.ended = false;
+                ++ring.generation;
+                ring.changed.wakeAll();
+            }
+            // late frames are shown only while no later one is ready
+            if (ring.head != ring.tail) {
+                ++playStats.dropped;
                 continue;
             }
-            break;
         }
 
-        curPos = capture.get(CV_CAP_PROP_POS_FRAMES);
+        // wait for the frame's time, or at least let the UI run
+        emit sleep(paced && due > now ? (int) (due - now + 0.5) : 0);
+        if (isStop())
+            break;
+        now = clock.nsecsElapsed() / 1e6;
+        if (paced && now > due + interval / 2)
+            ++playStats.late;
+
+        framePos = index + 1;
+        curPos = getFrameNumber();
 
         // display input frame
-        emit showFrame(curPos,input);
+        emit showFrame(curPos, input);
 
         // update the progress bar
         emit updateProgressBar();
 
-        // introduce a delay
-        emit sleep(delay);
+        const double shown = clock.nsecsElapsed() / 1e6;
+        if (playStats.presented++ == 0)
+            firstTime = now;
+        presentMs += shown - now;
+        playStats.presentMs = presentMs / playStats.presented;
+        if (shown > firstTime)
+            playStats.fps = (playStats.presented - 1) * 1000.0 / (shown - firstTime);
     }
+
+    {
+        QMutexLocker lock(&ring.mutex);
+        ring.quit = true;
+        ring.changed.wakeAll();
+    }
+    decoder.wait();
+
     if (!isStop()){
         emit revert();
     }
 }
 
+/**
+ * getPlaybackStats	-	statistics of the current or last play
+ *
+ * @return frames shown, late and dropped, and the time reading and
+ *         showing them took
+ */
+PlaybackStats VideoProcessor::getPlaybackStats() const
+{
+    return playStats;
+}
+
+// The decoder side of playIt(): the frames from ring->next on, through
+// the cache so its own read-ahead keeps going, back to the first if the
+// video loops.
+void VideoProcessor::playbackDecode(PlaybackRing *ring)
+{
+    cv::Mat frame;
+    QElapsedTimer timer;
+    for (;;) {
+        long f;
+        int generation;
+        {
+            QMutexLocker lock(&ring->mutex);
+            while (!ring->quit && ring->tail - ring->head >= PLAYBACK_RING)
+                ring->changed.wait(&ring->mutex);
+            if (ring->quit)
+                return;
+            f = ring->next++;
+            generation = ring->generation;
+        }
+
+        timer.start();
+        const bool ok = cache.getFrame(f, frame);
+        const double ms = timer.nsecsElapsed() / 1e6;
+
+        QMutexLocker lock(&ring->mutex);
+        ring->decodeMs += ms;
+        ++ring->decoded;
+        if (ring->quit)
+            return;
+        if (generation != ring->generation)
+            continue;
+        if (ok) {
+            PlaybackRing::Slot &slot = ring->frames[ring->tail % PLAYBACK_RING];
+            slot.index = f;
+            slot.frame = frame;
+            ++ring->tail;
+        } else if (_loop && f > 0) {
+            ring->next = 0;
+            continue;
+        } else {
+            // wait for playback to end, or to skip back into the video
+            ring->ended = true;
+            ring->changed.wakeAll();
+            while (!ring->quit && generation == ring->generation)
+                ring->changed.wait(&ring->mutex);
+            continue;
+        }
+        ring->changed.wakeAll();
+    }
+}
+
 /**
  * pauseIt	-	pause playing
  *
@@ -653,30 +779,92 @@ void VideoProcessor::pauseIt()
     emit updateBtn();
 }
 
+struct VideoProcessor::ExportJob
+{
+    QMutex mutex;
+    QWaitCondition changed;
+
+    // frames read and not written yet
+    std::deque<cv::Mat> decoded;
+
+    // frames read and written
+    long read, written;
+    // most frames read and not written yet
+    long limit;
+    // no frame left to read, and stop now
+    bool ended, cancelled;
+};
+
+class VideoProcessor::ExportThread : public QThread
+{
+public:
+    enum Role { DECODE, ENCODE };
+    ExportThread(VideoProcessor *vp, ExportJob *job, Role role)
+        : _vp(vp), _job(job), _role(role) {}
+    virtual void run()
+    {
+        if (_role == DECODE)
+            _vp->exportDecode(_job);
+        else
+            _vp->exportEncode(_job);
+    }
+private:
+    VideoProcessor *_vp;
+    ExportJob *_job;
+    Role _role;
+};
+
 /**
  * writeOutput	-	write the processed result
  *
+ * A decoder thread reads the frames a few ahead of an encoder thread that
+ * writes them.  Meanwhile this thread reports the progress at every frame
+ * written, and at least every 100 ms, so the window keeps drawing and the
+ * progress dialog can stop the pipeline.
  */
 void VideoProcessor::writeOutput()
 {
-    cv::Mat input;
-
-    // if no capture device has been set
-    if (!isOpened() || !writer.isOpened())
+    // if no capture device or output has been set
+    if (!isOpened() || outputFile.length() == 0
+            || (!extension.length() && !writer.isOpened()))
         return;
 
     // save the current position
     long pos = curPos;
 
-    // jump to the first frame
-    jumpTo(0);
-
-    while (getNextFrame(input)) {
+    ExportJob job;
+    job.read = job.written = 0;
+    job.limit = 8;
+    job.ended = job.cancelled = false;
 
-        // write output sequence
-        if (outputFile.length()!=0)
-            writeNextFrame(input);
+    stop = false;
+    ExportThread decoder(this, &job, ExportThread::DECODE);
+    ExportThread encoder(this, &job, ExportThread::ENCODE);
+    decoder.start();
+    encoder.start();
+
+    const std::string message = "Writing...";
+    QMutexLocker lock(&job.mutex);
+    while (!(job.ended && job.written == job.read)) {
+        const long written = job.written;
+        lock.unlock();
+        emit updateProcessProgress(message,
+                                   written * 100 / std::max(length, 1L));
+        lock.relock();
+        if (isStop()) {
+            job.cancelled = true;
+            job.changed.wakeAll();
+            break;
+        }
+        if (job.written == written)
+            job.changed.wait(&job.mutex, 100);
     }
+    lock.unlock();
+
+    decoder.wait();
+    encoder.wait();
+    stop = true;
+    emit closeProgressDialog();
 
     // set the modify flag to false
     modify = false;
@@ -688,6 +876,526 @@ void VideoProcessor::writeOutput()
     jumpTo(pos);
 }
 
+void VideoProcessor::exportDecode(ExportJob *job)
+{
+    cv::Mat frame;
+    for (long f = 0; ; ++f) {
+        {
+            QMutexLocker lock(&job->mutex);
+            while (!job->cancelled && f - job->written >= job->limit)
+                job->changed.wait(&job->mutex);
+            if (job->cancelled)
+                return;
+        }
+
+        const bool ok = cache.getFrame(f, frame);
+
+        QMutexLocker lock(&job->mutex);
+        if (!ok) {
+            job->ended = true;
+            job->changed.wakeAll();
+            return;
+        }
+        job->decoded.push_back(frame);
+        ++job->read;
+        job->changed.wakeAll();
+    }
+}
+
+void VideoProcessor::exportEncode(ExportJob *job)
+{
+    for (;;) {
+        cv::Mat frame;
+        {
+            QMutexLocker lock(&job->mutex);
+            while (!job->cancelled && !job->ended && job->decoded.empty())
+                job->changed.wait(&job->mutex);
+            if (job->cancelled || job->decoded.empty())
+                return;
+            frame = job->decoded.front();
+            job->decoded.pop_front();
+        }
+
+        // write output sequence
+        writeNextFrame(frame);
+
+        QMutexLocker lock(&job->mutex);
+        ++job->written;
+        job->changed.wakeAll();
+    }
+}
+
+namespace {
+
+// chunks of frames handed from one stage of the magnification to the next,
+// at most limit of them waiting; once closed, put() fails and take() fails
+// when the queue is empty
+class ChunkQueue
+{
+public:
+
+    ChunkQueue(unsigned int limit) : _limit(limit), _closed(false) {}
+
+    bool put(std::vector<cv::Mat> &chunk)
+    {
+        QMutexLocker lock(&_mutex);
+        while (!_closed && _chunks.size() >= _limit)
+            _changed.wait(&_mutex);
+        if (_closed)
+            return false;
+        _chunks.push_back(std::vector<cv::Mat>());
+        _chunks.back().swap(chunk);
+        _changed.wakeAll();
+        return true;
+    }
+
+    bool take(std::vector<cv::Mat> &chunk)
+    {
+        QMutexLocker lock(&_mutex);
+        while (!_closed && _chunks.empty())
+            _changed.wait(&_mutex);
+        if (_chunks.empty())
+            return false;
+        chunk.swap(_chunks.front());
+        _chunks.pop_front();
+        _changed.wakeAll();
+        return true;
+    }
+
+    void close()
+    {
+        QMutexLocker lock(&_mutex);
+        _closed = true;
+        _changed.wakeAll();
+    }
+
+private:
+    unsigned int _limit;
+    bool _closed;
+    std::deque<std::vector<cv::Mat> > _chunks;
+    QMutex _mutex;
+    QWaitCondition _changed;
+};
+
+} // namespace
+
+struct VideoProcessor::MagnifyJob
+{
+    enum Stage { DECOMPOSE, RECONSTRUCT };
+
+    Stage stage;
+    // size of every pyramid level, the frame's first
+    std::vector<cv::Size> sizes;
+    // levels filtered, the others are not amplified
+    std::vector<int> active;
+
+    // frames read, CV_8UC3 and shared with the frame cache
+    std::vector<cv::Mat> frames;
+    // bands[level][i] of frames[i], only for the active levels
+    std::vector<std::vector<cv::Mat> > bands;
+    // filtered[level][i] of sources[i]
+    std::vector<std::vector<cv::Mat> > filtered;
+    std::vector<cv::Mat> sources;
+    // magnified sources, CV_8UC3
+    std::vector<cv::Mat> out;
+};
+
+class VideoProcessor::StageThread : public QThread
+{
+public:
+    StageThread(VideoProcessor *vp, MagnifyJob *job, QAtomicInt *next)
+        : _vp(vp), _job(job), _next(next) {}
+    virtual void run() { _vp->runStage(_job, _next); }
+private:
+    VideoProcessor *_vp;
+    MagnifyJob *_job;
+    QAtomicInt *_next;
+};
+
+// reads the video from the first frame into chunks of up to size frames
+class VideoProcessor::DecodeThread : public QThread
+{
+public:
+    DecodeThread(VideoProcessor *vp, int size, ChunkQueue *queue)
+        : _vp(vp), _size(size), _queue(queue) {}
+    virtual void run()
+    {
+        std::vector<cv::Mat> chunk;
+        cv::Mat frame;
+        for (long f = 0; _vp->cache.getFrame(f, frame); ++f) {
+            chunk.push_back(frame);
+            if ((int) chunk.size() == _size && !_queue->put(chunk))
+                return;
+        }
+        if (!chunk.empty())
+            _queue->put(chunk);
+        _queue->close();
+    }
+private:
+    VideoProcessor *_vp;
+    int _size;
+    ChunkQueue *_queue;
+};
+
+// writes the magnified chunks in order
+class VideoProcessor::EncodeThread : public QThread
+{
+public:
+    EncodeThread(VideoProcessor *vp, ChunkQueue *queue)
+        : _vp(vp), _queue(queue) {}
+    virtual void run()
+    {
+        std::vector<cv::Mat> chunk;
+        while (_queue->take(chunk)) {
+            for (unsigned int i = 0; i < chunk.size(); ++i)
+                _vp->writeProcessed(chunk[i]);
+        }
+    }
+private:
+    VideoProcessor *_vp;
+    ChunkQueue *_queue;
+};
+
+/**
+ * motionMagnify	-	motion magnification
+ *
+ * The bands of a Laplacian pyramid of every frame are band-passed along
+ * time by the IIR filter and amplified at most alpha times, less for the
+ * bands of wavelength under lambda_c.
+ *
+ * @return True if the whole video was magnified. False otherwise
+ */
+bool VideoProcessor::motionMagnify()
+{
+    spatialType = LAPLACIAN;
+    const cv::Size size = getFrameSize();
+    delta = lambda_c / 8.0 / (1.0 + alpha);
+    // representative wavelength of the coarsest band, 3 is experimental
+    lambda = sqrt((double) size.width * size.width
+                  + (double) size.height * size.height) / 3;
+
+    temporal.resize(levels + 1);
+    for (int l = 0; l <= levels; ++l)
+        temporal[l].setIIR(fl, fh);
+    return streamMagnify("Motion Magnifying...");
+}
+
+/**
+ * colorMagnify	-	color magnification
+ *
+ * The band fl..fh Hz of the coarsest level of a Gaussian pyramid of every
+ * frame is amplified alpha times, with the ideal band-pass over a sliding
+ * window of idealWindow frames.
+ *
+ * @return True if the whole video was magnified. False otherwise
+ */
+bool VideoProcessor::colorMagnify()
+{
+    spatialType = GAUSSIAN;
+    temporal.resize(levels + 1);
+    temporal[levels].setIdeal(fl, fh, rate, std::min<long>(idealWindow, length));
+    return streamMagnify("Color Magnifying...");
+}
+
+/**
+ * amplification	-	amplification of a pyramid level
+ *
+ * Motion is amplified alpha times down to the wavelength lambda_c and less
+ * and less below it, as in figure 6 of the EVM paper, boosted by
+ * exaggeration_factor for better visualization.  The finest band and the
+ * low-pass residual are left alone.
+ *
+ * @param level	-	pyramid level, 0 the finest
+ *
+ * @return the factor the band of level is amplified by
+ */
+float VideoProcessor::amplification(int level) const
+{
+    if (spatialType == GAUSSIAN)
+        return level == levels ? alpha : 0.f;
+    if (level == 0 || level == levels)
+        return 0.f;
+
+    // the wavelength halves at every finer level
+    const float lambdaLevel = lambda / (1 << (levels - level));
+    const float currAlpha = (lambdaLevel / delta / 8 - 1) * exaggeration_factor;
+    return std::max(0.f, std::min(alpha, currAlpha));
+}
+
+/**
+ * amplify	-	amplify a band and add it to the others
+ *
+ * @param src	-	band of level, filtered
+ * @param dst	-	sum of the amplified bands, the size of src
+ * @param level	-	pyramid level of src
+ */
+void VideoProcessor::amplify(const cv::Mat &src, cv::Mat &dst, int level) const
+{
+    if (dst.empty())
+        dst = src * amplification(level);
+    else
+        cv::scaleAdd(src, amplification(level), dst, dst);
+}
+
+/**
+ * attenuate	-	attenuate I, Q channels
+ *
+ * The chrominance of the YIQ colour space is scaled by chromAttenuation;
+ * as YIQ is linear, that is a single 3x3 transform of the BGR channels.
+ *
+ * @param src	-	BGR image, CV_32FC3
+ * @param dst	-	attenuated image
+ */
+void VideoProcessor::attenuate(cv::Mat &src, cv::Mat &dst) const
+{
+    // BGR to YIQ
+    const cv::Matx33f yiq(0.114f,  0.587f,  0.299f,
+                          -0.322f, -0.274f, 0.596f,
+                          0.312f, -0.523f,  0.211f);
+    const cv::Matx33f scale = cv::Matx33f::diag(
+                cv::Vec3f(1.f, chromAttenuation, chromAttenuation));
+    const cv::Matx33f m = yiq.inv() * scale * yiq;
+    cv::transform(src, dst, cv::Mat(m));
+}
+
+/**
+ * streamMagnify	-	magnify the temporal band of the whole video
+ *
+ * A pipeline of three threads: one decodes chunks of chunkSize frames,
+ * this one decomposes them into pyramid levels, pushes the levels through
+ * their temporal filters and puts the amplified bands back onto the
+ * frames, and one encodes the magnified chunks; up to two chunks wait
+ * between stages.  Decomposing and reconstructing run on a thread per core
+ * over the frames of the chunk, filtering over the rows of each level.
+ * Only the levels amplified are built and filtered.  No more than a few
+ * chunks and the filters' windows of frames are ever held, whatever the
+ * length of the video.  Stopped halfway, the input is kept as it was.
+ *
+ * @param message	-	progress label
+ *
+ * @return True if the whole video was magnified. False otherwise
+ */
+bool VideoProcessor::streamMagnify(const std::string &message)
+{
+    // if no capture device has been set
+    if (!isOpened())
+        return false;
+
+    // without an output the result replaces the input, as a temp video
+    const bool toOutput = outputFile.length() != 0
+            && (extension.length() || writer.isOpened());
+    if (!toOutput && !createTemp())
+        return false;
+
+    // save the current position
+    long pos = curPos;
+
+    MagnifyJob job;
+    job.sizes.push_back(getFrameSize());
+    for (int l = 0; l < levels; ++l) {
+        const cv::Size &s = job.sizes.back();
+        job.sizes.push_back(cv::Size((s.width + 1) / 2, (s.height + 1) / 2));
+    }
+    for (int l = 0; l <= levels; ++l) {
+        if (amplification(l) != 0.f)
+            job.active.push_back(l);
+    }
+    job.bands.resize(levels + 1);
+    job.filtered.resize(levels + 1);
+
+    stop = false;
+    fnumber = 0;
+
+    ChunkQueue decoded(2), encoded(2);
+    DecodeThread decoder(this, chunkSize, &decoded);
+    EncodeThread encoder(this, &encoded);
+    decoder.start();
+    encoder.start();
+
+    std::deque<cv::Mat> waiting;     // frames not out of the filters yet
+    bool more = true;
+    while (more && !isStop()) {
+        more = decoded.take(job.frames);
+        if (more) {
+            for (unsigned int a = 0; a < job.active.size(); ++a)
+                job.bands[job.active[a]].assign(job.frames.size(), cv::Mat());
+            job.stage = MagnifyJob::DECOMPOSE;
+            runFrames(&job, job.frames.size());
+            waiting.insert(waiting.end(), job.frames.begin(), job.frames.end());
+        }
+
+        int n = 0;
+        for (unsigned int a = 0; a < job.active.size(); ++a) {
+            const int l = job.active[a];
+            job.filtered[l].clear();
+            if (more)
+                temporal[l].push(job.bands[l], job.filtered[l]);
+            else
+                temporal[l].flush(job.filtered[l]);
+            job.bands[l].clear();
+            n = job.filtered[l].size();
+        }
+        if (job.active.empty())
+            n = waiting.size();
+
+        job.sources.assign(waiting.begin(), waiting.begin() + n);
+        waiting.erase(waiting.begin(), waiting.begin() + n);
+        job.out.assign(n, cv::Mat());
+        job.stage = MagnifyJob::RECONSTRUCT;
+        runFrames(&job, n);
+        encoded.put(job.out);
+
+        fnumber += n;
+        emit updateProcessProgress(message, fnumber * 100 / std::max(length, 1L));
+    }
+    decoded.close();
+    encoded.close();
+    decoder.wait();
+    encoder.wait();
+    for (unsigned int l = 0; l < temporal.size(); ++l)
+        temporal[l].reset();
+
+    const bool finished = !isStop();
+    if (finished) {
+        emit revert();
+    }
+    emit closeProgressDialog();
+
+    if (toOutput) {
+        writer.release();
+    } else {
+        // release the temp writer
+        tempWriter.release();
+        if (finished) {
+            // change the video to the processed video
+            setInput(tempFile);
+            modify = true;
+        } else {
+            // drop the part written
+            std::remove(tempFile.c_str());
+            tempFileList.pop_back();
+            tempFile = inputFile;
+        }
+    }
+
+    // jump back to the original position
+    jumpTo(pos);
+    return finished;
+}
+
+void VideoProcessor::runFrames(MagnifyJob *job, int count)
+{
+    int numThreads = std::max(1, std::min(QThread::idealThreadCount(), count));
+
+    QAtomicInt next(0);
+    std::vector<StageThread*> threads;
+    for (int t = 1; t < numThreads; ++t) {
+        threads.push_back(new StageThread(this, job, &next));
+        threads.back()->start();
+    }
+    runStage(job, &next);
+    for (unsigned int t = 0; t < threads.size(); ++t) {
+        threads[t]->wait();
+        delete threads[t];
+    }
+}
+
+void VideoProcessor::runStage(MagnifyJob *job, QAtomicInt *next)
+{
+    const int count = job->stage == MagnifyJob::DECOMPOSE
+            ? job->frames.size() : job->sources.size();
+    int i;
+    while ((i = next->fetchAndAddOrdered(1)) < count) {
+        if (job->stage == MagnifyJob::DECOMPOSE)
+            decompose(job, i);
+        else
+            reconstruct(job, i);
+    }
+}
+
+/**
+ * decompose	-	bands of the active pyramid levels of a frame
+ *
+ * A Laplacian band is its Gaussian level less the next one up; the
+ * Gaussian pyramid stops at the coarsest level needed.
+ *
+ * @param job	-	bands[level][i] is set for the active levels
+ * @param i		-	frame of the chunk
+ */
+void VideoProcessor::decompose(MagnifyJob *job, int i)
+{
+    const int top = job->active.empty() ? 0 : job->active.back();
+    const int last = spatialType == LAPLACIAN ? std::min(top + 1, levels) : top;
+
+    std::vector<cv::Mat> gauss(last + 1);
+    job->frames[i].convertTo(gauss[0], CV_32FC3, 1.0 / 255.0);
+    for (int l = 0; l < last; ++l)
+        cv::pyrDown(gauss[l], gauss[l + 1], job->sizes[l + 1]);
+
+    for (unsigned int a = 0; a < job->active.size(); ++a) {
+        const int l = job->active[a];
+        std::vector<cv::Mat> &bands = job->bands[l];
+        if (spatialType == GAUSSIAN || l == levels) {
+            bands[i] = gauss[l];
+        } else {
+            cv::Mat up;
+            cv::pyrUp(gauss[l + 1], up, job->sizes[l]);
+            cv::subtract(gauss[l], up, bands[i]);
+        }
+    }
+}
+
+/**
+ * reconstruct	-	magnify a frame with its filtered bands
+ *
+ * From the coarsest active level down, the amplified bands are summed and
+ * brought up a level at a time; the chrominance is attenuated as soon as
+ * every band is in, at the coarsest size it can be.
+ *
+ * @param job	-	out[i] is set
+ * @param i		-	frame of the chunk
+ */
+void VideoProcessor::reconstruct(MagnifyJob *job, int i)
+{
+    if (job->active.empty()) {
+        job->out[i] = job->sources[i];
+        return;
+    }
+
+    cv::Mat motion, up;
+    const int top = job->active.back(), bottom = job->active.front();
+    for (int l = top; l >= 0; --l) {
+        if (l < top) {
+            cv::pyrUp(motion, up, job->sizes[l]);
+            cv::swap(motion, up);
+        }
+        if (l >= bottom && amplification(l) != 0.f)
+            amplify(job->filtered[l][i], motion, l);
+        if (l == bottom) {
+            attenuate(motion, up);
+            cv::swap(motion, up);
+        }
+    }
+
+    // back to 8 bits onto the source frame
+    cv::addWeighted(motion, 255.0, job->sources[i], 1.0, 0.0, job->out[i],
+                    CV_8U);
+}
+
+/**
+ * writeProcessed	-	write a processed frame
+ *
+ * @param frame	-	the frame, to the output if one is set and to the
+ *                  temp video otherwise
+ */
+void VideoProcessor::writeProcessed(cv::Mat &frame)
+{
+    if (outputFile.length() != 0 && (extension.length() || writer.isOpened()))
+        writeNextFrame(frame);
+    else
+        tempWriter.write(frame);
+}
+
 /**
  * revertVideo	-	revert playing
  *
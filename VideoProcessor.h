@@ -27,10 +27,25 @@
 #include <vector>
 #include <QObject>
 #include <QDateTime>
+#include <QAtomicInt>
+#include <QElapsedTimer>
 #include <vector>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include "FrameCache.h"
+#include "TemporalFilter.h"
+
+// how the current or last playIt() kept up with the frame rate
+struct PlaybackStats
+{
+    long presented;     // frames shown
+    long late;          // shown more than half a frame after their time
+    long dropped;       // skipped to catch up
+    double fps;         // frames shown per second
+    double decodeMs;    // average time to get a frame from the cache
+    double presentMs;   // average time to show a frame
+};
 
 class VideoProcessor : public QObject 
 {
@@ -61,8 +76,8 @@ public:
     // get the current playing progress
     long getNumberOfPlayedFrames();
 
-    // get the video capture
-    cv::VideoCapture *getClonedCapture();
+    // get the decoded-frame cache shared by every frame consumer
+    FrameCache *getFrameCache();
 
     // return the size of the video frame
     cv::Size getFrameSize();
@@ -111,6 +126,9 @@ public:
     // play the frames of the sequence
     void playIt();
 
+    // statistics of the current or last play
+    PlaybackStats getPlaybackStats() const;
+
     // pause the frames of the sequence
     void pauseIt();
 
@@ -132,11 +150,11 @@ public:
     // close the video
     void close();
 
-    // motion magnification
-    void motionMagnify();
+    // motion magnification, false if it did not get to the end
+    bool motionMagnify();
 
-    // color magnification
-    void colorMagnify();
+    // color magnification, false if it did not get to the end
+    bool colorMagnify();
 
     // write the processed result
     void writeOutput();
@@ -161,8 +179,12 @@ signals:
 
 private:
 
-    // the OpenCV video capture object
+    // the OpenCV video capture object, only queried for properties
     cv::VideoCapture capture;
+    // all frames are read through this cache
+    FrameCache cache;
+    // index of the frame getNextFrame() returns
+    long framePos;
 
     // is video play looped
     bool _loop;
@@ -182,8 +204,6 @@ private:
     long curPos;
     // current index for output images
     int curIndex;
-    // current level of pyramid
-    int curLevel;
     // number of digits in output image filename
     int digits;
     // extension of output images
@@ -219,9 +239,17 @@ private:
     // all temp files queue
     std::vector<std::string> tempFileList;
 
-    // low pass filters for IIR
-    std::vector<cv::Mat> lowpass1;
-    std::vector<cv::Mat> lowpass2;
+    // spatial decomposition of the magnification
+    enum SpatialType { LAPLACIAN, GAUSSIAN };
+    SpatialType spatialType;
+    // temporal band-pass of each pyramid level, streamed
+    std::vector<TemporalFilter> temporal;
+    // frames read and magnified at a time
+    int chunkSize;
+    // frames of history of the ideal band-pass
+    int idealWindow;
+    // of the current or last play
+    PlaybackStats playStats;
 
     // recalculate the number of frames in video
     // normally doesn't need it unless getLength()
@@ -235,20 +263,46 @@ private:
     // by default the same parameters to the input video
     bool createTemp(double framerate=0.0, bool isColor=true);
 
-    // amplify motion
-    void amplify(const cv::Mat &src, cv::Mat &dst);
+    // the frames of a chunk through the stages of the magnification
+    struct MagnifyJob;
+    class StageThread;
+    class DecodeThread;
+    class EncodeThread;
+
+    // amplification of the band of pyramid level, 0 the finest
+    float amplification(int level) const;
+
+    // add the band src of pyramid level, amplified, to dst
+    void amplify(const cv::Mat &src, cv::Mat &dst, int level) const;
+
+    // attenuate I, Q channels of a BGR image
+    void attenuate(cv::Mat &src, cv::Mat &dst) const;
+
+    // magnify the temporal band of every frame, chunk by chunk
+    bool streamMagnify(const std::string &message);
+
+    // run the stage of job over its frames on a thread per core
+    void runFrames(MagnifyJob *job, int count);
+    void runStage(MagnifyJob *job, QAtomicInt *next);
 
-    // attenuate I, Q channels
-    void attenuate(cv::Mat &src, cv::Mat &dst);
+    // pyramid levels of frame i of the job, and back
+    void decompose(MagnifyJob *job, int i);
+    void reconstruct(MagnifyJob *job, int i);
 
-    // concat images into a large Mat
-    void concat(const std::vector<cv::Mat> &frames, cv::Mat &dst);
+    // frames decoded ahead of playIt() on a thread of their own
+    struct PlaybackRing;
+    class PlaybackThread;
+    void playbackDecode(PlaybackRing *ring);
 
-    // de-concat the concatnate image into frames
-    void deConcat(const cv::Mat &src, const cv::Size &frameSize, std::vector<cv::Mat> &frames);
+    // the stages of writeOutput(), each on its own thread
+    struct ExportJob;
+    class ExportThread;
+    void exportDecode(ExportJob *job);
+    void exportEncode(ExportJob *job);
 
-    // create an ideal bandpass processor
-    void createIdealBandpassFilter(cv::Mat &filter, double fl, double fh, double rate);
+    // write a processed frame to the output, or to the temp video if
+    // there is none
+    void writeProcessed(cv::Mat &frame);
 };
 
 #endif // VIDEOPROCESSOR_H
@@ -1,9 +1,11 @@
 #ifndef FRAMEVIEWER_H
 #define FRAMEVIEWER_H
 #include <QGLWidget>
+#include <QGLBuffer>
 #include "jl_vectors.h"
 #include "RotoscopeModule.h"
 #include "DrawModule.h"
+#include "FrameCache.h"
 
 class RotoscopeModule;
 class DrawModule;
@@ -16,8 +18,12 @@ public:
     DrawModule *draw;
 
     FrameViewer(QWidget *parent = 0);
-    void showFrame(long index, QImage &frame);
-    void setUpModules(cv::VideoCapture *capture, int videoLength);
+    ~FrameViewer();
+    // show a decoded frame, BGR as it comes from the video; it is only
+    // referenced until the next paint uploads it
+    void showFrame(long index, const cv::Mat &frame);
+    void showFrame(long index);
+    void setUpModules(FrameCache *frames, int videoLength);
     void changeModules(InterModule *module);
 
 protected:
@@ -33,14 +39,24 @@ protected:
 private:
     float _zoom;
     Vec2f _center;
-    QImage _glback;
-    int _backDlist;
-    void createDlist();
+    // the frame is drawn from a texture of its own size; a new one waits in
+    // _frame for paintGL() to upload it
+    cv::Mat _frame;
+    bool _newFrame;
+    GLuint _texture;
+    int _texW, _texH;
+    // frames are copied into the two pixel buffers in turn and uploaded
+    // from there, so a copy never waits for the upload before it; both are
+    // 0 without pixel buffer support
+    QGLBuffer *_pbo[2];
+    int _nextPbo;
+    void uploadFrame();
     void myGlLoadIdentity();
     void resetZoom();
     void zoomUpdateGL();
 
     InterModule* _module;
+    FrameCache* _frames;
 };
 
 #endif // FRAMEVIEWER_H
@@ -0,0 +1,352 @@
+// npr-track: keyframe-to-keyframe spline tracking without the GUI.
+//
+// Loads a video and a project saved by NPR-2015, .nprp or text .roto,
+// tracks the curves between keyframes (paths marked fixed) and writes the
+// tracked project in the same format, strokes and all, and optionally a
+// matte per frame.  No GL context is created, so any
+// number of these can run side by side on a render node; they may share
+// the pyramid cache directory.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <QCoreApplication>
+#include <QDir>
+#include "RotoTracker.h"
+#include "RotoProject.h"
+#include "ProjectFile.h"
+#include "MatteRaster.h"
+#include "Preconditioner.h"
+
+struct Span
+{
+    int a, b;
+};
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: npr-track video project [options]\n"
+            "  --span a b     track from keyframe a to keyframe b, may be\n"
+            "                 repeated; every pair of consecutive keyframes\n"
+            "                 by default\n"
+            "  --out file     tracked project, project.tracked by default, or\n"
+            "                 name.tracked.nprp for name.nprp; a .roto file\n"
+            "                 is written as text, without the strokes\n"
+            "  --mattes dir   write dir/matteNNNNN.png for the tracked frames\n"
+            "  --raw-mattes file\n"
+            "                 write the tracked frames' mattes to file as 8-bit\n"
+            "                 width x height frames, one after the other\n"
+            "  --interp       interpolate in-betweens again where they exist\n"
+            "  --all-levels   solve every pyramid level to the fixed\n"
+            "                 tolerances instead of stopping early\n"
+            "  --window n     track spans longer than n frames n frames at a\n"
+            "                 time, 0 for the whole span at once (default);\n"
+            "                 faster on long spans but less accurate, since\n"
+            "                 each window's end is held to the interpolation\n"
+            "  --threads n    worker threads, one per core by default\n"
+            "  --verbose      print every step of the spline solves\n"
+            "tracking settings, the GUI's defaults otherwise:\n"
+            "  --levels n     pyramid levels\n"
+            "  --subsampling n\n"
+            "                 between pyramid levels\n"
+            "  --no-image     do not track the colour of the image\n"
+            "  --no-edges     do not track edges\n"
+            "  --edge-weight w\n"
+            "  --smooth w0 w1 w2\n"
+            "                 weights of the 0th, 1st and 2nd derivatives\n"
+            "                 in time of the in-betweens\n"
+            "  --shape w      weight of keeping the shape of the keyframes\n"
+            "  --no-pin-last  let the last frame of a span move\n"
+            "  --precond p    none, hb, jacobi or ic\n"
+            "  --cache dir    keep the pyramids in dir and reuse them, none by\n"
+            "                 default; nothing is ever deleted from dir\n"
+            "  --memory MB    soft limit on the memory taken by pyramids\n");
+}
+
+static bool precondition(const char *name, int *precond)
+{
+    static const char *names[] = { "none", "hb", "jacobi", "ic" };
+    static const int values[] = { KLT_PRECOND_NONE, KLT_PRECOND_HB,
+            KLT_PRECOND_BLOCK_JACOBI, KLT_PRECOND_IC };
+    for (int i = 0; i < 4; ++i)
+        if (!strcmp(name, names[i]))
+        {
+            *precond = values[i];
+            return true;
+        }
+    return false;
+}
+
+// fixed paths of a frame by label
+static std::map<int, RotoPath*> keyPaths(RotoCurves *rc)
+{
+    std::map<int, RotoPath*> res;
+    RotoPathList::const_iterator c;
+    for (c = rc->begin(); c != rc->end(); ++c)
+    {
+        if ((*c)->fixed())
+            res[(*c)->xmlLabel()] = *c;
+    }
+    return res;
+}
+
+// queue the tracks of one span.  Paths already linked from a to b through
+// in-betweens are tracked from those; keyframes of the same label with
+// nothing in between are linked and interpolated first.
+static int queueSpan(RotoTracker *tracker, RotoCurves *curves, const Span &s,
+        const KLT_TrackingContext *tc, bool interp)
+{
+    std::map<int, RotoPath*> aKeys = keyPaths(curves + s.a);
+    std::map<int, RotoPath*> bKeys = keyPaths(curves + s.b);
+    PathV linked, unlinked;
+
+    std::map<int, RotoPath*>::const_iterator k;
+    for (k = bKeys.begin(); k != bKeys.end(); ++k)
+    {
+        std::map<int, RotoPath*>::const_iterator ka = aKeys.find(k->first);
+        if (ka == aKeys.end())
+            continue;
+        RotoPath *aPath = ka->second, *bPath = k->second;
+
+        RotoPath *p = bPath;
+        int f;
+        for (f = s.b; f > s.a && p; --f)
+            p = p->prevC();
+        if (p == aPath)
+            linked.push_back(bPath);
+        else if (!aPath->nextC() && !bPath->prevC()
+                && aPath->getNumSegs() == bPath->getNumSegs())
+        {
+            bPath->setPrevC(aPath);
+            unlinked.push_back(bPath);
+        }
+        else
+            printf("label %d: frames %d and %d do not match, skipped\n",
+                    k->first, s.a, s.b);
+    }
+
+    if (!linked.empty())
+        tracker->track(linked, s.a, s.b, tc, interp, true);
+    if (!unlinked.empty())
+        tracker->track(unlinked, s.a, s.b, tc, true, false);
+    return linked.size() + unlinked.size();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    if (argc < 3)
+    {
+        usage();
+        return 2;
+    }
+
+    std::string videoName = argv[1], projectName = argv[2];
+    std::string outName;
+    QString matteDir, rawMattes, cacheDir;
+    bool setCache = false, interp = false, allLevels = false;
+    int threads = 0, memoryMB = 0, window = 0;
+    std::vector<Span> spans;
+    KLT_TrackingContext tc;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const bool more = i + 1 < argc;
+        if (!strcmp(argv[i], "--span") && i + 2 < argc)
+        {
+            Span s;
+            s.a = atoi(argv[++i]);
+            s.b = atoi(argv[++i]);
+            spans.push_back(s);
+        }
+        else if (!strcmp(argv[i], "--out") && more)
+            outName = argv[++i];
+        else if (!strcmp(argv[i], "--mattes") && more)
+            matteDir = argv[++i];
+        else if (!strcmp(argv[i], "--raw-mattes") && more)
+            rawMattes = argv[++i];
+        else if (!strcmp(argv[i], "--interp"))
+            interp = true;
+        else if (!strcmp(argv[i], "--all-levels"))
+            allLevels = true;
+        else if (!strcmp(argv[i], "--window") && more)
+            window = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && more)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--verbose"))
+            tc.verbose = true;
+        else if (!strcmp(argv[i], "--cache") && more)
+        {
+            cacheDir = argv[++i];
+            setCache = true;
+        }
+        else if (!strcmp(argv[i], "--memory") && more)
+            memoryMB = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--levels") && more)
+            tc.nPyramidLevels = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--subsampling") && more)
+            tc.subsampling = std::max(2, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--no-image"))
+            tc.useImage = false;
+        else if (!strcmp(argv[i], "--no-edges"))
+            tc.useEdges = false;
+        else if (!strcmp(argv[i], "--edge-weight") && more)
+            tc.edgeWeight = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--smooth") && i + 3 < argc)
+        {
+            tc.smooth0Deriv = atof(argv[++i]);
+            tc.smooth1Deriv = atof(argv[++i]);
+            tc.smooth2Deriv = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--shape") && more)
+            tc.shape2Deriv = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--no-pin-last"))
+            tc.pinLast = false;
+        else if (!strcmp(argv[i], "--precond") && more
+                && precondition(argv[i + 1], &tc.preconditioner))
+            ++i;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    FrameCache frames;
+    if (!frames.open(videoName))
+    {
+        fprintf(stderr, "%s: cannot open video\n", videoName.c_str());
+        return 1;
+    }
+    const int length = frames.getLength();
+
+    // the strokes are read only to be written back
+    const QString projectFile = QString::fromLocal8Bit(projectName.c_str());
+    const bool binary = ProjectFile::isProjectFile(projectFile);
+    RotoCurves *curves = new RotoCurves[length + 1];
+    DrawCurves *draws = new DrawCurves[length + 1];
+    RotoProjectInfo info;
+    ProjectFile project;
+    bool ok;
+    if (binary)
+    {
+        ok = project.open(projectFile, &info) && info.frames <= length;
+        while (ok && project.loadSome(64, curves, draws))
+            ;
+    }
+    else
+        ok = loadRotoProject(projectName, curves, length, &info);
+    if (!ok)
+    {
+        fprintf(stderr, "%s: cannot read project\n", projectName.c_str());
+        delete[] curves;
+        delete[] draws;
+        return 1;
+    }
+    if (outName.empty())
+    {
+        outName = projectName + ".tracked";
+        if (binary && projectFile.endsWith(".nprp"))
+            outName = projectName.substr(0, projectName.size() - 5)
+                    + ".tracked.nprp";
+    }
+
+    if (spans.empty())
+    {
+        int prev = -1;
+        for (int f = 0; f < length; ++f)
+        {
+            if (keyPaths(curves + f).empty())
+                continue;
+            if (prev >= 0)
+            {
+                Span s;
+                s.a = prev;
+                s.b = f;
+                spans.push_back(s);
+            }
+            prev = f;
+        }
+    }
+
+    tc.adaptiveLevels = !allLevels;
+    int first = length, last = -1;
+    RotoTracker *tracker = new RotoTracker(&frames, curves, threads);
+    tracker->setMaskSize(info.width, info.height);
+    tracker->setWindow(window, std::max(1, window / 4));
+    if (setCache)
+        tracker->scheduler()->setCacheDirectory(cacheDir);
+    if (memoryMB > 0)
+        tracker->scheduler()->setMemoryBudget(size_t(memoryMB) << 20);
+
+    // every span is queued before waiting so the workers overlap them
+    for (unsigned int i = 0; i < spans.size(); ++i)
+    {
+        const Span &s = spans[i];
+        if (s.a < 0 || s.b >= length || s.b - s.a < 2)
+        {
+            printf("span %d %d: too short or out of the video, skipped\n",
+                    s.a, s.b);
+            continue;
+        }
+        if (queueSpan(tracker, curves, s, &tc, interp) > 0)
+        {
+            first = std::min(first, s.a);
+            last = std::max(last, s.b);
+        }
+    }
+    tracker->wait();
+
+    const std::vector<RotoTracker::LevelTotal> &levels =
+            tracker->levelTotals();
+    if (!levels.empty())
+        printf("level  solved  skipped    steps  rejected  cg iters       ms\n");
+    for (unsigned int i = 0; i < levels.size(); ++i)
+    {
+        const RotoTracker::LevelTotal &t = levels[i];
+        printf("%5d  %6d  %7d  %7d  %8d  %8d  %7ld\n", t.level, t.solved,
+                t.skipped, t.steps, t.rejected, t.cgIterations, t.msecs);
+    }
+    delete tracker;
+
+    info.frames = length;
+    const QString outFile = QString::fromLocal8Bit(outName.c_str());
+    if (outFile.endsWith(".roto") || (!binary && !outFile.endsWith(".nprp")))
+        ok = saveRotoProject(outName, curves, info);
+    else
+        ok = project.save(outFile, curves, draws, info);
+    if (!ok)
+    {
+        fprintf(stderr, "%s: cannot write project\n", outName.c_str());
+        delete[] curves;
+        delete[] draws;
+        return 1;
+    }
+
+    if (!matteDir.isEmpty())
+    {
+        QDir().mkpath(matteDir);
+        if (!writeMattes(curves, first, last, info.width, info.height,
+                matteDir, MATTE_PNG, threads))
+            fprintf(stderr, "%s: cannot write mattes\n",
+                    matteDir.toLocal8Bit().constData());
+    }
+    if (!rawMattes.isEmpty())
+    {
+        if (!writeMattes(curves, first, last, info.width, info.height,
+                rawMattes, MATTE_RAW, threads))
+            fprintf(stderr, "%s: cannot write mattes\n",
+                    rawMattes.toLocal8Bit().constData());
+        else
+            printf("%s: frames %d to %d, %d x %d\n",
+                    rawMattes.toLocal8Bit().constData(), first, last,
+                    info.width, info.height);
+    }
+    delete[] curves;
+    delete[] draws;
+    return 0;
+}
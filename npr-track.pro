@@ -0,0 +1,94 @@
+#-------------------------------------------------
+#
+# npr-track: headless keyframe tracking of saved
+# roto projects, for batch runs on render nodes
+#
+#-------------------------------------------------
+
+# no widgets; the roto and draw sources still call GL for drawing, so
+# libGL and QtOpenGL are linked, but no context is ever created
+QT       += core gui opengl
+
+TARGET = npr-track
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += KLT roto
+
+SOURCES += \
+    npr-track.cpp \
+    RotoTracker.cpp \
+    RotoProject.cpp \
+    ProjectFile.cpp \
+    FrameCache.cpp \
+    TrackScheduler.cpp \
+    KLT/BezSpline.cpp \
+    KLT/ContCorr.cpp \
+    KLT/MultiSplineData.cpp \
+    roto/AbstractPath.cpp \
+    roto/GeigerCorresponder.cpp \
+    roto/RotoCorresponder.cpp \
+    roto/RotoPath.cpp \
+    roto/RotoRegion.cpp \
+    roto/TrackGraph.cpp \
+    roto/FitCurves.c \
+    roto/GGVecLib.c \
+    roto/RotoCurves.cpp \
+    roto/RotoIndex.cpp \
+    roto/MatteRaster.cpp \
+    roto/DrawPath.cpp \
+    roto/Stroke.cpp \
+    roto/Bitmap.cpp \
+    roto/Texture.cpp \
+    roto/DrawContCorr.cpp \
+    roto/DrawCorresponder.cpp \
+    roto/DrawCurves.cpp \
+    roto/StrokeBatch.cpp \
+    KLT/Error.c \
+    KLT/MySparseMat.cpp \
+    KLT/LinearSolver.cpp \
+    KLT/KLT.cpp \
+    KLT/Keeper.cpp \
+    KLT/MultiKeeper.cpp \
+    KLT/Kernels.cpp \
+    KLT/Convolve.cpp \
+    KLT/PyramidCache.cpp \
+    KLT/PackedPyramid.cpp \
+    KLT/klt_util.cpp \
+    KLT/Pyramid.cpp \
+    KLT/kltSpline.cpp \
+    KLT/HB_Sweep.cpp \
+    KLT/SplineKeeper.cpp \
+    KLT/ObsCache.cpp \
+    KLT/HB_OneCurve.cpp \
+    KLT/MultiDiagMatrix.cpp \
+    KLT/DiagMatrix.cpp \
+    KLT/Preconditioner.cpp
+
+HEADERS  += \
+    RotoTracker.h \
+    RotoProject.h \
+    ProjectFile.h \
+    FrameCache.h \
+    TrackScheduler.h \
+    roto/MatteRaster.h
+
+unix {
+    LIBS   += -lGL -lGLU
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv
+}
+
+win32 {
+INCLUDEPATH += \
+        D:\OpenCV-2.4.9\build\include \
+        D:\boost_1_58_0
+LIBS += -LD:\OpenCV-2.4.9\build\x64\vc12\lib \
+        -L"D:\boost_1_58_0\lib64-msvc-12.0" \
+        -lopencv_core249d \
+        -lopencv_highgui249d \
+        -lopencv_imgproc249d \
+        -lopencv_calib3d249d \
+        -lopengl32 -lglu32
+}
@@ -26,6 +26,7 @@ AbstractPath::AbstractPath()
 {
     _tangents = NULL;
     _inMotion = false;
+    _ptrDoc[0] = _ptrDoc[1] = -1;
 }
 
 AbstractPath::AbstractPath(const AbstractPath& other) :
@@ -33,6 +34,7 @@ AbstractPath::AbstractPath(const AbstractPath& other) :
 {
     _tangents = NULL;
     _inMotion = false;
+    _ptrDoc[0] = _ptrDoc[1] = -1;
 }
 
 AbstractPath::~AbstractPath()
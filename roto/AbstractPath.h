@@ -101,7 +101,7 @@ private:
 protected:
 
     // pointer documentation
-    int _ptrDoc[2]; // frame number, num in list
+    int _ptrDoc[2]; // frame number, num in list; -1 until documented
 
     static void writeNullPtr(FILE* fp);
     static void writeNullPtr(QDataStream* fp);
@@ -36,6 +36,20 @@ DrawContCorr::DrawContCorr(int *corrs, RotoPath** corrPtrs, int n) :
 
 }
 
+DrawContCorr::DrawContCorr(const float *t, RotoPath** corrPtrs, int n) :
+        _n(n)
+{
+    _t = new float[_n];
+    _ptrs = new RotoPath*[_n];
+    memcpy(_t, t, _n * sizeof(float));
+    memcpy(_ptrs, corrPtrs, _n * sizeof(RotoPath*));
+    for (int i = 0; i < _n; ++i)
+    {
+        assert (_ptrs[i]);
+        _rotoset.insert(_ptrs[i]);
+    }
+}
+
 DrawContCorr::DrawContCorr()
 {
     _t = NULL;
@@ -92,14 +106,14 @@ bool DrawContCorr::nextRotosExist() const
     return true;
 }
 
-float DrawContCorr::getSampleRotoT(const int i)
+float DrawContCorr::getSampleRotoT(const int i) const
 {
     assert(_t && _ptrs && _n > 0);
     assert(i >= 0 && i < _n);
     return _t[i];
 }
 
-RotoPath* DrawContCorr::getSampleRoto(const int i)
+RotoPath* DrawContCorr::getSampleRoto(const int i) const
 {
     assert(_t && _ptrs && _n > 0);
     assert(i >= 0 && i < _n);
@@ -35,6 +35,8 @@ class DrawContCorr
 public:
 
     DrawContCorr(int *corrs, RotoPath** corrPtrs, int n);
+    // sample i at t[i] on corrPtrs[i]
+    DrawContCorr(const float *t, RotoPath** corrPtrs, int n);
 
     DrawContCorr();
 
@@ -48,9 +50,14 @@ public:
 
     bool nextRotosExist() const; // checks if rotoset has valid _nextC's
 
-    float getSampleRotoT(const int i);
+    float getSampleRotoT(const int i) const;
     //float getRotoT(const float t);
-    RotoPath* getSampleRoto(const int i);
+    RotoPath* getSampleRoto(const int i) const;
+
+    int getNumSamples() const
+    {
+        return _n;
+    }
 
 private:
 
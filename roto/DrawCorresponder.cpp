@@ -19,10 +19,12 @@
 
  */
 
+#include <float.h>
+#include <algorithm>
+#include <QThread>
+#include <QAtomicInt>
 #include "DrawCorresponder.h"
 
-#define GRAPH(a,b) _graph[(b)*_w+(a)]
-
 #define GC_1 1.
 #define GC_2 .2
 //#define GC_3 1.
@@ -32,137 +34,186 @@
 
 DrawCorresponder::DrawCorresponder(const AbstractPath* X, RotoCurves* rotos,
         const int imw, const int imh) :
-        _X(X), _rotos(rotos)
+        _X(X), _rotos(rotos), _last(-1), _myInf(DBL_MAX / 10.), _cost(0)
 {
-
-    int i, j;
-    _h = 0;
+    int i, j, bi, bj;
     RotoPathList::const_iterator c;
     for (c = rotos->begin(); c != rotos->end(); ++c)
-        _h += (*c)->getNumElements();
-
-    _rptrs = new RotoPath *[_h];
-    _intmap = new map<RotoPath*, int>();
+        for (i = 0; i < (*c)->getNumElements(); i++)
+        {
+            _first.push_back(_locs.size() - i);
+            _locs.push_back((*c)->getElement(i));
+            _rptrs.push_back(*c);
+        }
+    _h = _locs.size();
+    _w = _X->getNumElements();
 
-    _bw = imw / _BSIZE_ + 1;
-    _bh = imh / _BSIZE_ + 1;
-    _buckets = new DynArray<int, 4> [_bw * _bh];
+    const int bw = imw / _BSIZE_ + 1, bh = imh / _BSIZE_ + 1;
+    std::vector<Vec2i> buckLocs(_h);
+    std::vector<std::vector<int> > buckets(bw * bh);
+    for (j = 0; j < _h; j++)
+    {
+        buckLocs[j].Set((int) (_locs[j].x() / _FBSIZE_),
+                (int) (_locs[j].y() / _FBSIZE_));
+        buckLocs[j].Clamp(0, bw - 1, bh - 1);
+        buckets[buckLocs[j].y() * bw + buckLocs[j].x()].push_back(j);
+    }
 
-    j = 0;
-    Vec2f loc;
-    Vec2i buckLoc;
-    for (c = rotos->begin(); c != rotos->end(); ++c)
+    // the samples within two buckets of j, which is also the set of samples
+    // j is within two buckets of
+    _candOff.resize(_h + 1);
+    for (j = 0; j < _h; j++)
     {
-        _intmap->insert(make_pair((*c), j));
-        for (i = 0; i < (*c)->getNumElements(); i++, j++)
-        {
-            loc = (*c)->getElement(i);
-            buckLoc.Set((int) (loc.x() / _FBSIZE_), (int) (loc.y() / _FBSIZE_));
-            buckLoc.Clamp(0, _bw - 1, _bh - 1);
-            _buckets[buckLoc.y() * _bw + buckLoc.x()].add(j);
-            _rptrs[j] = (*c);
-        }
+        _candOff[j] = _cands.size();
+        const Vec2i& b = buckLocs[j];
+        for (bj = MAX(b.y() - 2, 0); bj <= MIN(bh - 1, b.y() + 2); bj++)
+            for (bi = MAX(b.x() - 2, 0); bi <= MIN(bw - 1, b.x() + 2); bi++)
+            {
+                const std::vector<int>& bucket = buckets[bj * bw + bi];
+                _cands.insert(_cands.end(), bucket.begin(), bucket.end());
+            }
     }
+    _candOff[_h] = _cands.size();
 
-    _w = _X->getNumElements();
-    _graph = new GC_Node[_w * _h];
+    _bptr.resize(_w * _h);
 }
 
 DrawCorresponder::~DrawCorresponder()
 {
-    delete[] _rptrs;
-    delete[] _graph;
-    delete[] _buckets;
-    delete _intmap;
 }
 
 void DrawCorresponder::getSolution(int* xints, RotoPath** ptrs) const
 {
-    int i, bptr;
-    //int w = _w, h = _h;
-
-    double minCost = DBL_MAX;
-    int iMinCost = -1;
-    for (i = 0; i < _h; i++)
-        if (GRAPH(_w-1,i)._cost < minCost)
-        {
-            minCost = GRAPH(_w-1,i)._cost;
-            iMinCost = i;
-        }
-
-    bptr = iMinCost;
-    i = _w - 1;
-
-    while (i > -1)
+    int i, bptr = _last;
+    for (i = _w - 1; i > -1; i--)
     {
         assert(bptr > -1 && bptr < _h);
-        xints[i] = bptr - (*_intmap)[_rptrs[bptr]];
+        xints[i] = bptr - _first[bptr];
         ptrs[i] = _rptrs[bptr];
         assert(xints[i] < ptrs[i]->getNumElements());
-        bptr = GRAPH(i,bptr)._bptr;
-        i--;
+        bptr = _bptr[i * _h + bptr];
     }
 }
 
+// The first sample of X costs only its distance.  Each later cell tries its
+// candidates in order, skipping those whose cost before the link, plus the
+// least the link can cost, already loses to the best so far; the choice,
+// ties included, is that of trying them all.
 double DrawCorresponder::calculate()
 {
-    _myInf = DBL_MAX / 10.; // to avoid overflow
-    int i, j, k, bi, bj, bp, buckindex;
-    Vec2f jLoc;
-    Vec2i buckLoc;
+    int i, j, k, c;
+    std::vector<double> prev(_h), cur(_h);
+    for (j = 0; j < _h; j++)
+    {
+        prev[j] = internalCost(0, j);
+        _bptr[j] = j;
+    }
 
-    double minCost, cost, internCost;
+    double minCost, cost, internCost, lower, link;
     int iminCost;
-    for (i = 0; i < _w; i++)
+    for (i = 1; i < _w; i++)
+    {
+        int* bptr = &_bptr[i * _h];
+        const Vec2f xp = _X->getElement(i - 1);
         for (j = 0; j < _h; j++)
         {
-
-            minCost = _myInf;
-            iminCost = -1;
-
             internCost = internalCost(i, j);
-            //offset = (_h-1)*_w;
-            jLoc = _rptrs[j]->getElement(j - (*_intmap)[_rptrs[j]]);
-            buckLoc.Set((int) (jLoc.x() / _FBSIZE_),
-                    (int) (jLoc.y() / _FBSIZE_));
-            buckLoc.Clamp(0, _bw - 1, _bh - 1);
-            // _buckets[buckLoc.y()*_bw + buckLoc.x()].add(j);
-
-            //for (k = _h-1; k>-1; k--, offset-=_w) { // matching (i,j) and (i-1,k)
-
-            for (bj = MAX(buckLoc.y() - 2, 0);
-                    bj <= MIN(_bh - 1, buckLoc.y() + 2); bj++)
-                for (bi = MAX(buckLoc.x() - 2, 0);
-                        bi <= MIN(_bw - 1, buckLoc.x() + 2); bi++)
+            const RotoPath* rp = _rptrs[j];
+            // linkCost(i, j, i - 1, k) is |dj - y(k) + x(i-1)|, plus 20
+            // between paths
+            const Vec2f dj(_locs[j], _X->getElement(i));
+            iminCost = -1;
+            // staying on j is always a candidate; its cost is what the
+            // others have to beat, ties going to the first in order
+            minCost = prev[j] + linkCost(i, j, i - 1, j) + internCost;
+            for (c = _candOff[j]; c < _candOff[j + 1]; c++)
+            {
+                k = _cands[c]; // matching (i,j) and (i-1,k)
+                lower = prev[k] + (_rptrs[k] != rp ? 20. : 0.) + internCost;
+                if (lower > minCost || (iminCost != -1 && lower >= minCost))
+                    continue;
+                Vec2f D(dj);
+                D -= _locs[k];
+                D += xp;
+                link = D.Len();
+                if (_rptrs[k] != rp)
+                    link += 20.;
+                cost = prev[k] + link + internCost;
+                if (cost < minCost || (iminCost == -1 && cost == minCost))
                 {
-                    buckindex = bj * _bw + bi;
-                    for (bp = 0; bp < _buckets[buckindex].getNumElements();
-                            bp++)
-                    {
-                        k = _buckets[buckindex].getElement(bp); // matching (i,j) and (i-1,k)
-                        //cost = _graph[offset+i-1]._cost + linkCost(i,j,i-1,k) + internCost;
-                        cost = GRAPH(i-1,k)._cost + linkCost(i,j,i-1,k) + internCost; // SPEED: GRAPH sucks
-                        if (cost < minCost)
-                        {
-                            minCost = cost;
-                            iminCost = k;
-                        }
-                    }
+                    minCost = cost;
+                    iminCost = k;
                 }
+            }
 
-            assert(iminCost != -1 && iminCost < _h);
-            GRAPH(i,j)._cost = minCost;
-            GRAPH(i,j)._bptr = iminCost;
+            assert(iminCost != -1);
+            cur[j] = minCost;
+            bptr[j] = iminCost;
         }
+        prev.swap(cur);
+    }
 
-    minCost = DBL_MAX;
+    _cost = DBL_MAX;
     for (j = 0; j < _h; j++)
-        if (GRAPH(_w-1,j)._cost < minCost)
-        minCost = GRAPH(_w-1,j)._cost;
+        if (prev[j] < _cost)
+        {
+            _cost = prev[j];
+            _last = j;
+        }
 
-    assert(minCost < _myInf);
-    return minCost;
+    assert(_cost < _myInf);
+    return _cost;
+}
+
+bool DrawCorresponder::larger(const DrawCorresponder* a,
+        const DrawCorresponder* b)
+{
+    return double(a->_w) * a->_h > double(b->_w) * b->_h;
+}
 
+class DC_BatchThread: public QThread
+{
+public:
+    DC_BatchThread(const std::vector<DrawCorresponder*>* batch,
+            QAtomicInt* next) :
+            _batch(batch), _next(next)
+    {
+    }
+    virtual void run()
+    {
+        int i;
+        while ((i = _next->fetchAndAddOrdered(1)) < (int) _batch->size())
+            (*_batch)[i]->calculate();
+    }
+private:
+    const std::vector<DrawCorresponder*>* _batch;
+    QAtomicInt* _next;
+};
+
+void DrawCorresponder::calculateBatch(
+        const std::vector<DrawCorresponder*>& batch, int numThreads)
+{
+    if (numThreads <= 0)
+        numThreads = QThread::idealThreadCount();
+    numThreads = MAX(1, MIN(numThreads, (int) batch.size()));
+
+    // the largest first, so a long one does not start last
+    std::vector<DrawCorresponder*> order(batch);
+    std::stable_sort(order.begin(), order.end(), larger);
+
+    QAtomicInt next(0);
+    std::vector<DC_BatchThread*> threads;
+    for (int t = 1; t < numThreads; ++t)
+    {
+        threads.push_back(new DC_BatchThread(&order, &next));
+        threads.back()->start();
+    }
+    DC_BatchThread(&order, &next).run();
+    for (unsigned int t = 0; t < threads.size(); ++t)
+    {
+        threads[t]->wait();
+        delete threads[t];
+    }
 }
 
 double DrawCorresponder::linkCost(const int i, const int j, const int ip,
@@ -172,9 +223,8 @@ double DrawCorresponder::linkCost(const int i, const int j, const int ip,
         return 0;
     double cost = 0;
 
-    Vec2f D(_rptrs[j]->getElement(j - (*_intmap)[_rptrs[j]]),
-            _X->getElement(i));
-    D -= _rptrs[jp]->getElement(jp - (*_intmap)[_rptrs[jp]]);
+    Vec2f D(_locs[j], _X->getElement(i));
+    D -= _locs[jp];
     D += _X->getElement(ip);
     cost += /*GC_1 **/D.Len();
 
@@ -196,9 +246,7 @@ double DrawCorresponder::internalCost(const int i, const int j) const
     //shit = MIN(1,MAX(-1,shit)); // since vecs are floats...
     //cost = GC_3 * acos(shit);
 
-    cost = GC_2
-            * _X->getElement(i).distanceTo(
-                    _rptrs[j]->getElement(j - (*_intmap)[_rptrs[j]]));
+    cost = GC_2 * _X->getElement(i).distanceTo(_locs[j]);
 
     return cost;
 }
@@ -25,13 +25,18 @@
 #ifdef __APPLE__
 using namespace std;
 #endif
+#include <vector>
 #include "RotoCurves.h"
-#include "GC_Node.h"
-#include <map>
 #ifdef __APPLE__
 #define _X _X
 #endif
 
+// Dynamic program matching each sample i of the stroke X to a sample j of
+// any roto path of the frame.  (i,j) may follow (i-1,k) only when k lies
+// within two buckets of j, so the candidates of every j are listed once, in
+// the order the buckets are scanned, and the samples are copied out of the
+// paths.  Only the back pointers of the whole graph are kept, and the costs
+// of two columns.
 class DrawCorresponder
 {
 
@@ -45,19 +50,27 @@ public:
 
     double calculate();
 
+    // calculate() every corresponder of batch on up to numThreads threads,
+    // 0 for one per core.  The strokes and roto paths must not change
+    // meanwhile.
+    static void calculateBatch(const std::vector<DrawCorresponder*>& batch,
+            int numThreads = 0);
+
 private:
 
     double internalCost(const int i, const int j) const;
     double linkCost(const int i, const int j, const int ip, const int jp) const;
+    static bool larger(const DrawCorresponder* a, const DrawCorresponder* b);
 
     const AbstractPath* _X;
     const RotoCurves* _rotos;
-    RotoPath** _rptrs;
-    int _w, _h, _bw, _bh;
-    GC_Node* _graph;
-    map<RotoPath*, int>* _intmap;
-    mutable double _myInf;
-    DynArray<int, 4>* _buckets;
+    std::vector<RotoPath*> _rptrs;
+    std::vector<Vec2f> _locs;        // of sample j
+    std::vector<int> _first;         // sample j of element 0 of _rptrs[j]
+    std::vector<int> _cands, _candOff; // of j, _candOff[j].._candOff[j+1]
+    std::vector<int> _bptr;          // of (i,j), at i*_h+j
+    int _w, _h, _last;               // _last: j of the last column
+    double _myInf, _cost;
 };
 
 #endif
@@ -38,7 +38,25 @@ DrawCurves::DrawCurves()
 void DrawCurves::renderAllPaths(const int renderMode)
 {
     DrawPath* curr;
+
+    // fills of propagated paths are left for the first time they are drawn
+    _paths.SetIterationHead();
+    while ((curr = _paths.IterateNext()) != NULL)
+        curr->calculateDeferredFill();
     _paths.SetIterationHead();
+
+    // picking needs a name on each path, so only drawing is batched
+    GLint glMode;
+    glGetIntegerv(GL_RENDER_MODE, &glMode);
+    if (glMode == GL_RENDER && (renderMode == 0 || renderMode == 1))
+    {
+        _strokes.begin();
+        while ((curr = _paths.IterateNext()) != NULL)
+            _strokes.add(curr);
+        _strokes.draw(renderMode);
+        return;
+    }
+
     int name = 0;
     while ((curr = _paths.IterateNext()) != NULL)
     {
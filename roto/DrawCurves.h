@@ -4,6 +4,7 @@
 #include <QDataStream>
 #include "LList.h"
 #include "DrawPath.h"
+#include "StrokeBatch.h"
 //#include "drawPatch.h"
 
 class DrawPath;
@@ -85,6 +86,7 @@ private:
     //LList<DrawPatch> _patches;
 
     int _frame;
+    StrokeBatch _strokes;
     //DrawPatch *_activePatch;
 };
 
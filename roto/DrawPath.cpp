@@ -20,6 +20,7 @@
  */
 
 #include <float.h>
+#include <QAtomicInt>
 #include "DrawPath.h"
 #include "DrawCorresponder.h"
 
@@ -54,7 +55,9 @@ DrawPath::DrawPath() :
     //_corrNum = -1;
     _filled = false;
     _dFillList = 0;
-    _dStrokeList = 0;
+    _fillDeferred = false;
+    _strokeTexture = 0;
+    _strokeStamp = 0;
     _thicknessOffset = 0;
     _fixed = true;
     _shouldBe = NULL;
@@ -76,7 +79,9 @@ DrawPath::DrawPath(const DrawPath& other) :
     _stroke = other._stroke;
     _filled = other._filled;
     _dFillList = 0;
-    _dStrokeList = 0;
+    _fillDeferred = false;
+    _strokeTexture = 0;
+    _strokeStamp = 0;
     _thicknessOffset = other._thicknessOffset;
     _nextFrame = _prevFrame = NULL;
     _fixed = other._fixed;
@@ -125,19 +130,24 @@ void DrawPath::render(const int rmode, bool useAlpha) const
         glTranslatef(_motion.x(), _motion.y(), 0);
     }
 
-    if (_dFillList != 0 && _filled && normal) // fill display list
-    {
-        glColor4f(_fillColor.r(), _fillColor.g(), _fillColor.b(), _alpha_);
-        glCallList (_dFillList);
-    }
+    if (normal)
+        renderFill(useAlpha);
 
     // stroke color !
-    if (_dStrokeList != 0 && normal) // stroke display list
+    if (!_strokeTris.empty() && normal) // tessellated stroke
     {
         glColor4f(_strokeColor.r(), _strokeColor.g(), _strokeColor.b(),
         _alpha_);
 
-        glCallList (_dStrokeList);
+        GLboolean textured = glIsEnabled(GL_TEXTURE_2D);
+        if (_strokeTexture)
+        {
+            glBindTexture(GL_TEXTURE_2D, _strokeTexture);
+            glEnable(GL_TEXTURE_2D);
+        }
+        Stroke::drawVertices(&_strokeTris[0], 0, _strokeTris.size());
+        if (!textured)
+            glDisable(GL_TEXTURE_2D);
     }
     else if (_stroke && normal)        // hertzmann stroke
     {
@@ -175,6 +185,15 @@ void DrawPath::render(const int rmode, bool useAlpha) const
 
 }
 
+void DrawPath::renderFill(bool useAlpha) const
+{
+    if (_dFillList != 0 && _filled) // fill display list
+    {
+        glColor4f(_fillColor.r(), _fillColor.g(), _fillColor.b(), _alpha_);
+        glCallList (_dFillList);
+    }
+}
+
 void DrawPath::renderRecent() const
 {
     int i = getNumElements();
@@ -558,29 +577,29 @@ void fuckCombine(GLdouble coords[3], GLdouble* vd[4], GLfloat weight[4],
     //assert(0);
 }
 
+// stamps of stroke tessellations, never 0
+static QAtomicInt strokeStamps(0);
+
 void DrawPath::calculateStrokeDisplayList()
 {
     if (!_stroke)
         return;
 
-    glColor3f(_strokeColor.r(), _strokeColor.g(), _strokeColor.b());
+    GLubyte rgb[3] =
+    { GLubyte(HCOLOR(_strokeColor.r())), GLubyte(HCOLOR(_strokeColor.g())),
+            GLubyte(HCOLOR(_strokeColor.b())) };
 
-    if (_dStrokeList == 0)
-        _dStrokeList = glGenLists(1);
-    assert(glGetError() == GL_NO_ERROR);
-    assert(_dStrokeList != 0);
-
-    glNewList(_dStrokeList, GL_COMPILE);
     _stroke->toffset() = _thicknessOffset;
 
-    _stroke->render();
-    glEndList();
-
-    assert(glGetError() == GL_NO_ERROR);
+    _strokeTris.clear();
+    _stroke->tessellate(rgb, _strokeTris);
+    _strokeTexture = _stroke->useTexture() ? _stroke->textureName() : 0;
+    _strokeStamp = strokeStamps.fetchAndAddOrdered(1) + 1;
 }
 
 void DrawPath::calculateFillDisplayList()
 {
+    _fillDeferred = false;
     if (!_filled)
         return;
     if (getNumElements() < 3)
@@ -648,6 +667,24 @@ void DrawPath::freshenAppearance()
     calculateFillDisplayList();
 }
 
+void DrawPath::setLook(const Vec3f& strokeColor, bool filled,
+        const Vec3f& fillColor, float thicknessOffset)
+{
+    _strokeColor = strokeColor;
+    _filled = filled;
+    _fillColor = fillColor;
+    _thicknessOffset = thicknessOffset;
+    _fillDeferred = _filled;
+}
+
+void DrawPath::freshenStroke()
+{
+    if (_stroke)
+        _stroke->toffset() = _thicknessOffset;
+    calculateStrokeDisplayList();
+    _fillDeferred = _filled;
+}
+
 /*
  void DrawPath::setStrokeRadius(const float a) {
  if (!_stroke) return;
@@ -793,6 +830,30 @@ bool DrawPath::correspondRoto2(RotoCurves* rc, const int w, const int h)
     DrawCorresponder* dcorer = new DrawCorresponder(this, rc, w, h);
     double score = dcorer->calculate();
     printf("correspondence score %f\n", score);
+    takeCorrespondence(dcorer);
+    delete dcorer;
+    return true;
+}
+
+void DrawPath::correspondRotos(const vector<DrawPath*>& paths,
+        RotoCurves* rc, const int w, const int h)
+{
+    if (rc->getNumCurves() == 0 || paths.empty())
+        return;
+
+    vector<DrawCorresponder*> dcorers;
+    for (unsigned int i = 0; i < paths.size(); ++i)
+        dcorers.push_back(new DrawCorresponder(paths[i], rc, w, h));
+    DrawCorresponder::calculateBatch(dcorers);
+    for (unsigned int i = 0; i < paths.size(); ++i)
+    {
+        paths[i]->takeCorrespondence(dcorers[i]);
+        delete dcorers[i];
+    }
+}
+
+void DrawPath::takeCorrespondence(const DrawCorresponder* dcorer)
+{
     //assert(!_corrs);
     int* corrs = new int[getNumElements()];
     RotoPath** corrsPtr = new RotoPath*[getNumElements()];
@@ -812,9 +873,6 @@ bool DrawPath::correspondRoto2(RotoCurves* rc, const int w, const int h)
     }
     printf("attached to %d rotoCurves in all\n", numRotos);
     //delete rotos;
-
-    delete dcorer;
-    return true;
 }
 
 void DrawPath::offsetRig(const float rT, RotoPath* corrRoto, const Vec3f P)
@@ -834,6 +892,21 @@ void DrawPath::offsetRig(const float rT, RotoPath* corrRoto, const Vec3f P)
 
 }
 
+void DrawPath::offsetRig(const vector<Vec3f>& P)
+{
+    assert(_corrRoto && _shouldBe);
+    for (unsigned int i = 0; i < P.size(); i++)
+        offsetRig(_corrRoto->getSampleRotoT(i), _corrRoto->getSampleRoto(i),
+                P[i]);
+}
+
+void DrawPath::getRig(vector<Vec3f>& P) const
+{
+    P.resize(getNumElements());
+    for (int i = 0; i < getNumElements(); i++)
+        getP(i, P[i]);
+}
+
 void DrawPath::getP(const int i, Vec3f& res) const
 {
     Vec2f U, V;
@@ -850,34 +923,24 @@ void DrawPath::getP(const int i, Vec3f& res) const
 
 }
 
+// B's correspondence is A's carried forward, so sample i of B is on
+// A_prime->nextC() at A_prime->getNextT(A_prime_t)
 void DrawPath::fillForwardInterpolatedCurve(DrawPath* B, const DrawPath* A)
+{
+    fillForwardCorr(B, A);
+    vector<Vec3f> P;
+    A->getRig(P);
+    B->offsetRig(P);
+}
+
+void DrawPath::fillForwardCorr(DrawPath* B, const DrawPath* A)
 {
     B->initHertzStroke();
-    float A_prime_t, B_prime_t;
-    RotoPath *A_prime, *B_prime;
-    Vec3f P;
-    int i = 0;
     assert(!B->getShouldBe());
     B->_shouldBe = new AbstractPath();
 
     B->_corrRoto = new DrawContCorr();
     A->_corrRoto->fillForward(B->_corrRoto);
-
-    //const RotoPath* curr;
-    while (i < A->getNumElements())
-    {
-
-        A_prime = A->_corrRoto->getSampleRoto(i);
-        A_prime_t = A->_corrRoto->getSampleRotoT(i);
-        A->getP(i, P);
-        B_prime_t = A_prime->getNextT(A_prime_t); //A->_corrRoto->getSampleRotoT(i);
-        B_prime = A_prime->nextC();
-        assert(B_prime);
-        B->offsetRig(B_prime_t, B_prime, P);
-
-        i++;
-    }
-
 }
 
 void DrawPath::fillBackwardInterpolatedCurve(DrawPath* B, const DrawPath* A)
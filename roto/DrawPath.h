@@ -43,6 +43,7 @@ typedef Vec2f DrawPoint; // can later make this more sophisticated
 class RotoCurves;
 class RotoPath;
 class DrawContCorr;
+class DrawCorresponder;
 
 #define HCOLOR(a) (int(a*255.))
 
@@ -72,6 +73,19 @@ public:
     {
         return _strokeColor;
     }
+    Vec3f getFillColor() const
+    {
+        return _fillColor;
+    }
+    float getThicknessOffset() const
+    {
+        return _thicknessOffset;
+    }
+
+    // the look as read back from a project, without GL: the fill is built
+    // by calculateDeferredFill()
+    void setLook(const Vec3f& strokeColor, bool filled,
+            const Vec3f& fillColor, float thicknessOffset);
 
     static void setCurrTexture(int i);
     /* for textures */
@@ -91,6 +105,7 @@ public:
     void fair();
 
     void render(const int rmode, bool useAlpha = true) const;
+    void renderFill(bool useAlpha = true) const;
     void renderCorr() const;
     void renderSelected() const;
     void renderRecent() const;
@@ -99,6 +114,9 @@ public:
 
     //bool correspondRoto(RotoCurves* rc);
     bool correspondRoto2(RotoCurves* rc, const int w, const int h);
+    // correspondRoto2() of every path, the corresponders solved together
+    static void correspondRotos(const vector<DrawPath*>& paths,
+            RotoCurves* rc, const int w, const int h);
 
     void vacateRotoCorr();
     bool corrToRoto() const
@@ -119,6 +137,7 @@ public:
 
     void getP(const int i, Vec3f& res) const; // location in coordinate frame
     // of corrRoto at i (which is index of this)
+    void getRig(vector<Vec3f>& P) const; // getP of every element
 
     /*
      RotoPath* getRotoCorr(const int i, int& outi) const {
@@ -131,6 +150,12 @@ public:
     {
         return _corrRoto;
     }
+    // takes c, one sample per element
+    void setCorrRoto(DrawContCorr* c)
+    {
+        delete _corrRoto;
+        _corrRoto = c;
+    }
 
     double distToLast2(const Vec2f& loc) const;
 
@@ -155,6 +180,8 @@ public:
 
     //void rigFrom(RotoPath* rp, const int numPoints);
     void offsetRig(const float rT, RotoPath* corrRoto, const Vec3f P);
+    // offsetRig of P[i] along the roto curves of the correspondence
+    void offsetRig(const vector<Vec3f>& P);
     void empty();
 
     DrawPath* nextC()
@@ -186,14 +213,48 @@ public:
 
     void setUniformThickness(const float t);
 
+    // tessellates the stroke into strokeTriangles(); needs no GL context
     void calculateStrokeDisplayList();
     void calculateFillDisplayList();
     void freshenAppearance();
 
+    // freshenAppearance() without GL: the fill is only marked, and built by
+    // calculateDeferredFill() on the GUI thread when the path is drawn
+    void freshenStroke();
+    void calculateDeferredFill()
+    {
+        if (_fillDeferred)
+            calculateFillDisplayList();
+    }
+
+    // the stroke as of the last calculateStrokeDisplayList(), GL_TRIANGLES
+    // in the stroke color, and the texture to draw them with, 0 for none.
+    // The stamp is new every time they are recalculated.
+    const vector<StrokeVertex>& strokeTriangles() const
+    {
+        return _strokeTris;
+    }
+    GLuint strokeTexture() const
+    {
+        return _strokeTexture;
+    }
+    unsigned int strokeStamp() const
+    {
+        return _strokeStamp;
+    }
+    bool inMotion() const
+    {
+        return _inMotion;
+    }
+
     Bboxf2D calcBbox() const;
 
     void interpolateForwards(int frame);
     static void fillForwardInterpolatedCurve(DrawPath* B, const DrawPath* A);
+    // the part of fillForwardInterpolatedCurve that needs A: B gets its
+    // stroke and the correspondence one frame on from A's, and is then
+    // placed by B->offsetRig() of A's rig
+    static void fillForwardCorr(DrawPath* B, const DrawPath* A);
     static void fillBackwardInterpolatedCurve(DrawPath* B, const DrawPath* A);
     static void fillBiInterpolatedCurve(DrawPath* D0, DrawPath* D1,
             DrawPath *Dnew, double t, int *D0_T0_T1_i, RotoPath** D0_T0_T1_p,
@@ -262,6 +323,8 @@ public:
 
 private:
 
+    void takeCorrespondence(const DrawCorresponder* dcorer);
+
     //void sample5(Vec2f* here) const;
 
     //RotoPath* _corrRoto;
@@ -277,7 +340,11 @@ private:
     bool _filled;
     Vec3f _fillColor;
     float _thicknessOffset;
-    GLuint _dFillList, _dStrokeList;
+    GLuint _dFillList;
+    bool _fillDeferred;
+    vector<StrokeVertex> _strokeTris;
+    GLuint _strokeTexture;
+    unsigned int _strokeStamp;
     DynArray<float, 100> _thick;
 
     // skq
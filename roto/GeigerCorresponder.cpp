@@ -20,22 +20,64 @@
  */
 
 #include <float.h>
+#include <algorithm>
+#include <QThread>
+#include <QAtomicInt>
 #include "GeigerCorresponder.h"
-#define GRAPH(a,b) _graph[(b)*_w+(a)]
 
 #define GC_1 1.
 #define GC_2 1.
 #define GC_3 1.
 
 GeigerCorresponder::GeigerCorresponder(AbstractPath* X, AbstractPath* Y) :
-        _X(X), _Y(Y)
+        _X(X), _Y(Y), _cost(0)
 {
     assert(X && Y);
     _w = _X->getNumElements();
     _h = _Y->getNumElements();
-    _graph = new GC_Node[_w * _h];
     _maxJump = (int) ceil(3 * double(_h) / double(_w));
     printf("max jump %d\n", _maxJump);
+    buildBand();
+}
+
+// cells further than .3 from the diagonal are never matched
+bool GeigerCorresponder::inBand(const int i, const int j) const
+{
+    double dia = fabs(double(i) / double(_w - 1) - double(j) / double(_h - 1));
+    return !(dia > .3);
+}
+
+void GeigerCorresponder::buildBand()
+{
+    _lo.resize(_w);
+    _hi.resize(_w);
+    _off.resize(_w);
+
+    // the match starts at (0,0)
+    _lo[0] = _hi[0] = 0;
+    _off[0] = 0;
+    int i, size = 1;
+    for (i = 1; i < _w; ++i)
+    {
+        double t = double(i) / double(_w - 1);
+        int lo = MAX(0, (int) ceil((t - .3) * (_h - 1)));
+        int hi = MIN(_h - 1, (int) floor((t + .3) * (_h - 1)));
+        // settle rounding against the exact test
+        while (lo > 0 && inBand(i, lo - 1))
+            --lo;
+        while (lo < _h && !inBand(i, lo))
+            ++lo;
+        hi = MAX(hi, lo - 1);
+        while (hi < _h - 1 && inBand(i, hi + 1))
+            ++hi;
+        while (hi >= lo && !inBand(i, hi))
+            --hi;
+        _lo[i] = lo;
+        _hi[i] = hi;
+        _off[i] = size;
+        size += hi - lo + 1;
+    }
+    _graph = new GC_Node[size];
 }
 
 void GeigerCorresponder::getSolution(int* xints) const
@@ -47,61 +89,176 @@ void GeigerCorresponder::getSolution(int* xints) const
     {
         assert(bptr > -1);
         xints[i] = bptr;
-        bptr = GRAPH(i,bptr)._bptr;
+        if (i > 0)
+            bptr = node(i, bptr)._bptr;
         i--;
     }
     printf("\n");
 
 }
 
-// SPEED: if we stay only using internalCost, we can speed this up:
-// compile for each column a column that stores minimum i-1 cost for this
-// j (and that index), use this.  n^3 -> n^2 algorithm.
+// Cost of the match along the diagonal, summed as calculate() does, or
+// _myInf if it is not a valid match.  Costs never decrease along a match,
+// so no cell of the best one costs more than this.
+double GeigerCorresponder::diagonalCost() const
+{
+    double cost = 0;
+    int i, j, jp = 0;
+    for (i = 1; i < _w; i++, jp = j)
+    {
+        j = (int) floor(double(i) * (_h - 1) / (_w - 1) + .5);
+        if (!inBand(i, j) || j - jp > _maxJump + 1)
+            return _myInf;
+        cost = cost + linkCost(i, j, i - 1, jp) + internalCost(i, j);
+    }
+    return cost;
+}
+
+// The best match is found in two sweeps.  The first only looks at a few
+// rows either side of the diagonal; whatever it finds is a valid match, and
+// no cell of the best one costs more, so the second sweep over the whole
+// band skips every cell bound to cost more than that.
 double GeigerCorresponder::calculate()
 {
     _myInf = DBL_MAX / 10.; // to avoid overflow
-
-    int i, j, k;
     _graph[0]._cost = 0;
-    for (j = 1; j < _h; j++)
-        GRAPH(0,j)._cost = _myInf;
 
-    double minCost, cost, internCost;
+    double bound = diagonalCost();
+    const int r = _maxJump + 1;
+    std::vector<int> lo(_w), hi(_w);
+    for (int i = 0; i < _w; i++)
+    {
+        int c = (int) floor(double(i) * (_h - 1) / MAX(_w - 1, 1) + .5);
+        lo[i] = MAX(_lo[i], c - r);
+        hi[i] = MIN(_hi[i], c + r);
+    }
+    if (lo[_w - 1] <= hi[_w - 1] && hi[_w - 1] == _h - 1)
+        bound = MIN(bound, sweep(lo, hi, bound));
+
+    sweep(_lo, _hi, bound);
+    _cost = _hi[_w - 1] == _h - 1 ? node(_w - 1, _h - 1)._cost : _myInf;
+    assert(_cost < _myInf);
+    return _cost;
+}
+
+// Cell (i,j) comes from (i-1,k), j - _maxJump - 1 <= k <= j, over rows
+// lo[i]..hi[i] of each column.  The jumps are tried from the shortest, as
+// the dense scan did, and the scan stops once the window minimum of the
+// previous column plus minLinkCost() of the next jump cannot beat the best
+// so far, which leaves the choice unchanged.  Cells bound to cost more than
+// bound are left unreachable without evaluating them.  Returns the cost of
+// the last cell, _myInf if it is not reached.
+double GeigerCorresponder::sweep(const std::vector<int>& lo,
+        const std::vector<int>& hi, const double bound)
+{
+    int i, j, k;
+    double minCost, cost, internCost, winMin;
     int iminCost;
+    std::vector<double> minLink(_maxJump + 2);
+    for (k = 0; k < _maxJump + 2; k++)
+        minLink[k] = minLinkCost(k);
+    // below[k - klo] is the least cost of (i-1,klo..k)
+    std::vector<double> below(_maxJump + 2);
     for (i = 1; i < _w; i++)
-        for (j = 0; j < _h; j++)
+    {
+        const int plo = lo[i - 1], phi = hi[i - 1];
+        // prev[k] is (i-1,k)
+        const GC_Node* prev = _graph + _off[i - 1] - _lo[i - 1];
+        GC_Node* cur = _graph + _off[i] - _lo[i];
+        for (j = lo[i]; j <= hi[i]; j++)
         {
+            const int klo = MAX(j - _maxJump - 1, plo), khi = MIN(j, phi);
+            winMin = _myInf;
+            for (k = klo; k <= khi; k++)
+                below[k - klo] = winMin = MIN(winMin, prev[k]._cost);
 
-            double dia = fabs(
-                    double(i) / double(_w - 1) - double(j) / double(_h - 1));
-            if (dia > .3)
+            GC_Node& n = cur[j];
+            if (winMin >= _myInf || winMin > bound
+                    || winMin + (internCost = internalCost(i, j)) > bound)
             {
-                GRAPH(i,j)._cost = _myInf;
+                n._cost = _myInf; // unreachable
+                n._bptr = -1;
                 continue;
             }
 
             minCost = DBL_MAX;
             iminCost = -1;
 
-            internCost = internalCost(i, j);
-            for (k = j; k > -1; k--) // matching (i,j) and (i-1,k)
+            for (k = khi; k >= klo; k--) // matching (i,j) and (i-1,k)
             {
-                cost = GRAPH(i-1,k)._cost + linkCost(i,j,i-1,k) + internCost;
+                if (iminCost != -1 && j > k && below[k - klo]
+                        + minLink[j - k] + internCost >= minCost)
+                    break;
+                cost = prev[k]._cost + linkCost(i, j, i - 1, k) + internCost;
                 if (cost < minCost)
                 {
                     minCost = cost;
                     iminCost = k;
                 }
-                if (j-k > _maxJump)
-                break;
             }
 
             assert(iminCost != -1);
-            GRAPH(i,j)._cost = minCost;
-            GRAPH(i,j)._bptr = iminCost;
+            n._cost = minCost > bound ? _myInf : minCost;
+            n._bptr = iminCost;
         }
-    assert(minCost < _myInf);
-    return GRAPH(_w-1, _h-1)._cost;
+    }
+    return hi[_w - 1] == _h - 1 ? node(_w - 1, _h - 1)._cost : _myInf;
+}
+
+int GeigerCorresponder::bandSize() const
+{
+    return _off[_w - 1] + _hi[_w - 1] - _lo[_w - 1] + 1;
+}
+
+bool GeigerCorresponder::largerBand(const GeigerCorresponder* a,
+        const GeigerCorresponder* b)
+{
+    return a->bandSize() > b->bandSize();
+}
+
+class GC_BatchThread: public QThread
+{
+public:
+    GC_BatchThread(const std::vector<GeigerCorresponder*>* batch,
+            QAtomicInt* next) :
+            _batch(batch), _next(next)
+    {
+    }
+    virtual void run()
+    {
+        int i;
+        while ((i = _next->fetchAndAddOrdered(1)) < (int) _batch->size())
+            (*_batch)[i]->calculate();
+    }
+private:
+    const std::vector<GeigerCorresponder*>* _batch;
+    QAtomicInt* _next;
+};
+
+void GeigerCorresponder::calculateBatch(
+        const std::vector<GeigerCorresponder*>& batch, int numThreads)
+{
+    if (numThreads <= 0)
+        numThreads = QThread::idealThreadCount();
+    numThreads = MAX(1, MIN(numThreads, (int) batch.size()));
+
+    // the largest first, so a long one does not start last
+    std::vector<GeigerCorresponder*> order(batch);
+    std::stable_sort(order.begin(), order.end(), largerBand);
+
+    QAtomicInt next(0);
+    std::vector<GC_BatchThread*> threads;
+    for (int t = 1; t < numThreads; ++t)
+    {
+        threads.push_back(new GC_BatchThread(&order, &next));
+        threads.back()->start();
+    }
+    GC_BatchThread(&order, &next).run();
+    for (unsigned int t = 0; t < threads.size(); ++t)
+    {
+        threads[t]->wait();
+        delete threads[t];
+    }
 }
 
 double GeigerCorresponder::linkCost(const int i, const int j, const int ip,
@@ -121,6 +278,11 @@ double GeigerCorresponder::linkCost(const int i, const int j, const int ip,
     return cost;
 }
 
+double GeigerCorresponder::minLinkCost(const int jump) const
+{
+    return jump == 0 ? 10. : 0.;
+}
+
 double GeigerCorresponder::internalCost(const int i, const int j) const
 {
     double cost; //,shit;
@@ -22,6 +22,7 @@
 #ifndef GEIGERCORRESPONDER_H
 #define GEIGERCORRESPONDER_H
 
+#include <vector>
 #include "dynarray.h"
 #include "jl_vectors.h"
 #include "AbstractPath.h"
@@ -31,6 +32,13 @@
 #define _Y _Y
 #endif
 
+// Dynamic program matching each sample i of X to a sample j of Y, j never
+// decreasing along X.  Only the diagonal band of (i,j) the match may pass
+// through is stored, column by column.  The scan over the jumps into a cell
+// ends once the running minimum of the previous column plus minLinkCost()
+// cannot do better, and cells bound to cost more than a match found near
+// the diagonal are not evaluated at all.  Solutions are those of the dense
+// graph.
 class GeigerCorresponder
 {
 
@@ -47,6 +55,18 @@ public:
 
     double calculate();
 
+    // cost of the last calculate()
+    double cost() const
+    {
+        return _cost;
+    }
+
+    // calculate() every corresponder of batch on up to numThreads threads,
+    // 0 for one per core.  They may share paths, which must not change
+    // meanwhile.
+    static void calculateBatch(const std::vector<GeigerCorresponder*>& batch,
+            int numThreads = 0);
+
 protected:
 
     virtual double linkCost(const int i, const int j, const int ip,
@@ -54,11 +74,38 @@ protected:
 
     virtual double internalCost(const int i, const int j) const;
 
+    // lower bound of linkCost() over steps of jump = j - jp rows, it must
+    // not decrease with jump for jump > 0
+    virtual double minLinkCost(const int jump) const;
+
+    GC_Node& node(const int i, const int j)
+    {
+        assert(j >= _lo[i] && j <= _hi[i]);
+        return _graph[_off[i] + j - _lo[i]];
+    }
+    const GC_Node& node(const int i, const int j) const
+    {
+        assert(j >= _lo[i] && j <= _hi[i]);
+        return _graph[_off[i] + j - _lo[i]];
+    }
+
     AbstractPath *_X, *_Y;
     int _w, _h;
-    GC_Node* _graph;
-    double _myInf;
+    GC_Node* _graph;                // band cells, column after column
+    std::vector<int> _lo, _hi, _off; // rows and first cell of column i
+    double _myInf, _cost;
     int _maxJump;
+
+private:
+
+    bool inBand(const int i, const int j) const;
+    void buildBand();
+    double diagonalCost() const;
+    double sweep(const std::vector<int>& lo, const std::vector<int>& hi,
+            const double bound);
+    int bandSize() const;
+    static bool largerBand(const GeigerCorresponder* a,
+            const GeigerCorresponder* b);
 };
 
 #endif
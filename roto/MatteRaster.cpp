@@ -0,0 +1,293 @@
+/*
+
+ Copyright (C) 2004, Aseem Agarwala, roto@agarwala.org
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or (at
+ your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ USA
+
+ */
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <QAtomicInt>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QThread>
+#include "MatteRaster.h"
+#include "RotoCurves.h"
+
+MatteRaster::MatteRaster(int w, int h) :
+        _w(w), _h(h), _stride(w + 2), _acc((w + 2) * h, 0.f),
+        _first(h, w + 2), _last(h, -1)
+{
+}
+
+void MatteRaster::clear()
+{
+    for (int y = 0; y < _h; ++y)
+    {
+        if (_first[y] <= _last[y])
+            std::fill(&_acc[y * _stride + _first[y]],
+                    &_acc[y * _stride + _last[y]] + 1, 0.f);
+        _first[y] = _stride;
+        _last[y] = -1;
+    }
+}
+
+void MatteRaster::addPolygon(const std::vector<Vec2f>& pts)
+{
+    const int n = pts.size();
+    for (int i = 0, j = n - 1; i < n; j = i++)
+        addLine(pts[j].x(), pts[j].y(), pts[i].x(), pts[i].y());
+}
+
+// Left of the image an edge still winds every pixel of its rows, so it is
+// moved onto x = 0; right of it, it winds none and lands in the two spare
+// cells of the row.
+void MatteRaster::addLine(float x0, float y0, float x1, float y1)
+{
+    if (y0 == y1)
+        return;
+    const float sides[2] = { 0.f, float(_w) };
+    for (int s = 0; s < 2; ++s)
+    {
+        const float sx = sides[s];
+        if ((x0 < sx) != (x1 < sx) && x0 != sx && x1 != sx)
+        {
+            const float ys = y0 + (sx - x0) * (y1 - y0) / (x1 - x0);
+            addLine(x0, y0, sx, ys);
+            addLine(sx, ys, x1, y1);
+            return;
+        }
+    }
+    drawLine(MAX(0.f, MIN(float(_w), x0)), y0, MAX(0.f, MIN(float(_w), x1)),
+            y1);
+}
+
+// Row by row, the part of the edge in the row covers a trapezoid of each
+// pixel it passes; the area right of the edge goes into the pixel it is in
+// and what is left of the row's dy into the next one, so the running sum
+// counts dy for every pixel wholly to the right.
+void MatteRaster::drawLine(float x0, float y0, float x1, float y1)
+{
+    float dir = 1.f;
+    if (y0 > y1)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        dir = -1.f;
+    }
+    const float dxdy = (x1 - x0) / (y1 - y0), xmax = float(_w);
+    float x = x0;
+    int y = (int) floor(y0);
+    if (y < 0)
+    {
+        x -= y0 * dxdy;
+        y = 0;
+    }
+    const int yend = MIN(_h, (int) ceil(y1));
+    for (; y < yend; ++y)
+    {
+        float* row = &_acc[y * _stride];
+        const float dy = MIN(float(y + 1), y1) - MAX(float(y), y0);
+        const float xnext = MAX(0.f, MIN(xmax, x + dxdy * dy));
+        const float d = dy * dir;
+        const float xa = MIN(x, xnext), xb = MAX(x, xnext);
+        const float xaf = floor(xa), xbc = ceil(xb);
+        const int xai = (int) xaf, xbi = (int) xbc;
+        _first[y] = MIN(_first[y], xai);
+        _last[y] = MAX(_last[y], MAX(xbi, xai + 1));
+        if (xbi <= xai + 1)
+        {
+            // within one pixel, split at the middle of the edge
+            const float xm = .5f * (x + xnext) - xaf;
+            row[xai] += d - d * xm;
+            row[xai + 1] += d * xm;
+        }
+        else
+        {
+            const float s = 1.f / (xb - xa);
+            const float fa = xa - xaf, fb = xb - xbc + 1.f;
+            const float a0 = .5f * s * (1.f - fa) * (1.f - fa);
+            const float am = .5f * s * fb * fb;
+            row[xai] += d * a0;
+            if (xbi == xai + 2)
+                row[xai + 1] += d * (1.f - a0 - am);
+            else
+            {
+                const float a1 = s * (1.5f - fa);
+                row[xai + 1] += d * (a1 - a0);
+                for (int xi = xai + 2; xi < xbi - 1; ++xi)
+                    row[xi] += d * s;
+                const float a2 = a1 + (xbi - xai - 3) * s;
+                row[xbi - 1] += d * (1.f - a2 - am);
+            }
+            row[xbi] += d * am;
+        }
+        x = xnext;
+    }
+}
+
+// even-odd: winding area 0..1 is coverage, 1..2 a hole
+static inline unsigned char coverage(const float acc)
+{
+    float a = fabsf(acc);
+    a -= 2.f * floorf(.5f * a);
+    if (a > 1.f)
+        a = 2.f - a;
+    return (unsigned char) (a * 255.f + .5f);
+}
+
+// Only the cells edges touched change the sum; left of them it is 0 and
+// right of them it holds the last value.
+void MatteRaster::resolve(unsigned char* out) const
+{
+    for (int y = 0; y < _h; ++y, out += _w)
+    {
+        const float* row = &_acc[y * _stride];
+        const int x0 = MIN(_first[y], _w), x1 = MIN(_last[y] + 1, _w);
+        memset(out, 0, x0);
+        float acc = 0.f;
+        int x;
+        for (x = x0; x < x1; ++x)
+        {
+            acc += row[x];
+            out[x] = coverage(acc);
+        }
+        if (x < _w)
+            memset(out + x, coverage(acc), _w - x);
+    }
+}
+
+namespace
+{
+
+struct MatteJob
+{
+    const RotoCurves* curves;
+    int first, last, w, h;
+    QString path;
+    MatteFormat format;
+    QFile raw;
+    QMutex rawMutex;
+    QAtomicInt next;
+};
+
+class MatteThread: public QThread
+{
+public:
+    MatteThread(MatteJob* job) :
+            _job(job), _failed(0)
+    {
+    }
+    virtual void run();
+    int failed() const
+    {
+        return _failed;
+    }
+private:
+    bool write(int frame, const unsigned char* matte);
+    MatteJob* _job;
+    int _failed;
+};
+
+void MatteThread::run()
+{
+    MatteRaster raster(_job->w, _job->h);
+    std::vector<unsigned char> matte(_job->w * _job->h);
+    std::vector<std::vector<Vec2f> > loops;
+    int f;
+    while ((f = _job->first + _job->next.fetchAndAddOrdered(1)) <= _job->last)
+    {
+        loops.clear();
+        _job->curves[f].traceOutlines(&loops);
+        raster.clear();
+        for (unsigned int i = 0; i < loops.size(); ++i)
+            raster.addPolygon(loops[i]);
+        raster.resolve(&matte[0]);
+        if (!write(f, &matte[0]))
+            ++_failed;
+    }
+}
+
+bool MatteThread::write(int frame, const unsigned char* matte)
+{
+    const int w = _job->w, h = _job->h;
+    if (_job->format == MATTE_RAW)
+    {
+        QMutexLocker lock(&_job->rawMutex);
+        const qint64 size = qint64(w) * h;
+        return _job->raw.seek((frame - _job->first) * size)
+                && _job->raw.write((const char*) matte, size) == size;
+    }
+
+    QImage im(w, h, QImage::Format_Indexed8);
+    QVector<QRgb> grey(256);
+    for (int i = 0; i < 256; ++i)
+        grey[i] = qRgb(i, i, i);
+    im.setColorTable(grey);
+    for (int y = 0; y < h; ++y)
+        memcpy(im.scanLine(y), matte + y * w, w);
+    QString name = QString("%1/matte%2.png").arg(_job->path).arg(frame, 5, 10,
+            QChar('0'));
+    return im.save(name, "PNG");
+}
+
+} // namespace
+
+bool writeMattes(const RotoCurves* curves, int first, int last, int w, int h,
+        const QString& path, MatteFormat format, int numThreads)
+{
+    if (last < first)
+        return true;
+
+    MatteJob job;
+    job.curves = curves;
+    job.first = first;
+    job.last = last;
+    job.w = w;
+    job.h = h;
+    job.path = path;
+    job.format = format;
+    if (format == MATTE_RAW)
+    {
+        job.raw.setFileName(path);
+        if (!job.raw.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+    }
+
+    if (numThreads <= 0)
+        numThreads = QThread::idealThreadCount();
+    numThreads = MAX(1, MIN(numThreads, last - first + 1));
+
+    std::vector<MatteThread*> threads;
+    for (int t = 1; t < numThreads; ++t)
+    {
+        threads.push_back(new MatteThread(&job));
+        threads.back()->start();
+    }
+    MatteThread self(&job);
+    self.run();
+    int failed = self.failed();
+    for (unsigned int t = 0; t < threads.size(); ++t)
+    {
+        threads[t]->wait();
+        failed += threads[t]->failed();
+        delete threads[t];
+    }
+    return failed == 0;
+}
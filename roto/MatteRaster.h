@@ -0,0 +1,87 @@
+/*
+
+ Copyright (C) 2004, Aseem Agarwala, roto@agarwala.org
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or (at
+ your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ USA
+
+ */
+
+#ifndef MATTERASTER_H
+#define MATTERASTER_H
+
+#include <vector>
+#include <QString>
+#include "jl_vectors.h"
+
+class RotoCurves;
+
+// Anti-aliased fill of closed polygons on the CPU, without GL.
+//
+// Every edge adds the exact area it covers in each pixel of the rows it
+// crosses, signed by its direction, into one float per pixel; a running
+// sum along each row then gives the winding area of every pixel.  Folding
+// that into 0..1 fills even-odd, as the GL tessellator and QPainter's
+// OddEvenFill do.  Coordinates are image pixels, y down, and may fall
+// outside the image.
+class MatteRaster
+{
+public:
+
+    MatteRaster(int w, int h);
+
+    int width() const
+    {
+        return _w;
+    }
+    int height() const
+    {
+        return _h;
+    }
+
+    void clear();
+
+    // closed polygon, the last point joins the first
+    void addPolygon(const std::vector<Vec2f>& pts);
+
+    // coverage 0..255 of the polygons added since clear(), _w * _h bytes
+    // row after row
+    void resolve(unsigned char* out) const;
+
+private:
+
+    void addLine(float x0, float y0, float x1, float y1);
+    void drawLine(float x0, float y0, float x1, float y1);
+
+    int _w, _h, _stride;
+    std::vector<float> _acc; // _stride per row, the last two catch x >= _w
+    std::vector<int> _first, _last; // cells of each row edges touched
+};
+
+enum MatteFormat
+{
+    MATTE_PNG, // dir/matteNNNNN.png
+    MATTE_RAW  // one file, w * h bytes per frame from first on
+};
+
+// Mattes of frames first..last of curves, the closed outlines of
+// traceOutlines() filled white on black, w x h.  Frames are traced and
+// filled on up to numThreads threads, 0 for one per core; the curves must
+// not change meanwhile.  path is a directory for MATTE_PNG and a file for
+// MATTE_RAW.  False if anything could not be written.
+bool writeMattes(const RotoCurves* curves, int first, int last, int w, int h,
+        const QString& path, MatteFormat format, int numThreads = 0);
+
+#endif // MATTERASTER_H
@@ -38,6 +38,12 @@ double RotoCorresponder::linkCost(const int i, const int j, const int ip,
     return cost;
 }
 
+// the distance term is never negative
+double RotoCorresponder::minLinkCost(const int jump) const
+{
+    return jump * jump + (jump == 0 ? 3. : 0.);
+}
+
 double RotoCorresponder::internalCost(const int i, const int j) const
 {
     //printf("right on\n");
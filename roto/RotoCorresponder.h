@@ -38,6 +38,8 @@ protected:
 
     double internalCost(const int i, const int j) const;
 
+    double minLinkCost(const int jump) const;
+
 };
 
 #endif
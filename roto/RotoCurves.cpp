@@ -21,6 +21,9 @@
 
 #include <stdio.h>
 #include <float.h>
+#include <string.h>
+#include <set>
+#include <math.h>
 #include "RotoCurves.h"
 #include <QImage>
 #include <iostream>
@@ -65,6 +68,69 @@ void RotoCurves::saveRotoXML(std::ofstream& fp, int frame) const
     fp << ">" << std::endl;
 }
 
+bool RotoCurves::loadRotoXML(std::ifstream& fp, int* frame)
+{
+    std::string tok;
+    int numPaths, i, label;
+    if (!(fp >> tok) || tok != "<RotoFrame:" || !(fp >> *frame >> numPaths))
+        return false;
+    setFrame(*frame);
+
+    for (i = 0; i < numPaths; ++i)
+    {
+        if (!(fp >> tok) || tok != "<Track:" || !(fp >> tok)
+                || sscanf(tok.c_str(), "{label%d}", &label) != 1)
+            return false;
+        bool fixed = false;
+        if (!(fp >> tok))
+            return false;
+        if (tok == "fixed")
+        {
+            fixed = true;
+            fp >> tok;
+        }
+        float x, y;
+        if (tok != "M" || !(fp >> x >> y))
+            return false;
+
+        std::vector<Vec2f> ctrls(1, Vec2f(x, y));
+        while ((fp >> tok) && tok == "B")
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                if (!(fp >> x >> y))
+                    return false;
+                ctrls.push_back(Vec2f(x, y));
+            }
+        }
+        if (tok != ">" || ctrls.size() < 4)
+            return false;
+
+        addPathFromCtrls(ctrls, fixed)->setXMLLabel(label);
+    }
+    return (fp >> tok) && tok == ">";
+}
+
+RotoPath* RotoCurves::addPathFromCtrls(const std::vector<Vec2f>& ctrls,
+        bool fixed)
+{
+    RotoPath* rp = new RotoPath();
+    addPath(rp);
+    rp->startManualCreation();
+    for (unsigned int i = 0; i < ctrls.size(); ++i)
+        rp->addCtrl(ctrls[i]);
+
+    rp->startFinishManualCreation();
+    setupJoints(rp);
+    rp->finishManualCreation();
+    if (!fixed)
+    {
+        rp->setFixed(false);
+        rp->buildTouched(false);
+    }
+    return rp;
+}
+
 void RotoCurves::clearXMLLabels()
 {
     RotoPathList::iterator c;
@@ -156,7 +222,7 @@ void RotoCurves::documentSelf()
 void RotoCurves::addNPaths(const int n)
 {
     for (int i = 0; i < n; i++)
-        _paths.push_back(new RotoPath());
+        addPath(new RotoPath());
     //_paths.AddToTail(new RotoPath());
 }
 
@@ -231,94 +297,79 @@ void RotoCurves::renderFreePaths(bool showTrackPoints)
     }
 }
 
-RotoPath* RotoCurves::pickPrimitive(const int x, const int y)
-{
-    //printf("picking\n");
-    GLint viewport[4];
-    GLdouble projection[16];
-    GLuint selectBuf[100];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    glGetDoublev(GL_PROJECTION_MATRIX, projection);
-    glSelectBuffer(100, selectBuf);
-    glRenderMode (GL_SELECT);
-    glInitNames();
-
-    glMatrixMode (GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    gluPickMatrix(x, AbstractPath::_globalh - y, 10., 10., viewport);
-    glMultMatrixd(projection);
-    glMatrixMode (GL_MODELVIEW);
-
-    renderAllPaths(false);
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glFlush();
-
-    int hits = glRenderMode(GL_RENDER);
-    //printf("%d hits\n",hits);
-    if (hits == 0)
-        return NULL;
-    int maxHit = selectBuf[3];
-    for (int i = 1; i < hits; i++)
+// squared distance from p to the line from a to b
+static double distToLine2(const Vec2f& p, const Vec2f& a, const Vec2f& b)
+{
+    float dx = b.x() - a.x(), dy = b.y() - a.y();
+    float len2 = dx * dx + dy * dy;
+    float t = 0;
+    if (len2 > 0)
+        t = MAX(0.f, MIN(1.f, ((p.x() - a.x()) * dx + (p.y() - a.y()) * dy) / len2));
+    float ex = a.x() + t * dx - p.x(), ey = a.y() + t * dy - p.y();
+    return ex * ex + ey * ey;
+}
+
+// true if loc is within radius of what RotoPath::render draws of rp: its
+// controls, and its polyline or, while it has no samples, its segments
+static bool pathHit(RotoPath* rp, const Vec2f& loc, const float radius)
+{
+    const double r2 = radius * radius;
+    const BezSpline* bez = rp->getBez();
+    int i, which;
+    if (bez && bez->distanceToCtrls2(loc, &which) <= r2)
+        return true;
+
+    const int ne = rp->getNumElements();
+    if (ne == 1)
+        return rp->getPointerToElement(0)->distanceTo2(loc) <= r2;
+    for (i = 0; i + 1 < ne; ++i)
+        if (distToLine2(loc, *rp->getPointerToElement(i),
+                *rp->getPointerToElement(i + 1)) <= r2)
+            return true;
+    if (ne > 0 || !bez)
+        return false;
+
+    // 25 lines a segment, as glEvalMesh1 draws them
+    const int n = ((bez->numCtrls() - 1) / 3) * 3 + 1;
+    for (i = 0; i + 3 < n; i += 3)
     {
-        if (selectBuf[3 + 4 * i] > (unsigned) maxHit)
+        const Vec2f &p0 = *bez->getCtrl(i), &p1 = *bez->getCtrl(i + 1),
+                &p2 = *bez->getCtrl(i + 2), &p3 = *bez->getCtrl(i + 3);
+        Vec2f prev = p0;
+        for (int k = 1; k <= 25; ++k)
         {
-            maxHit = selectBuf[3 + 4 * i];
+            float t = k / 25.f, s = 1 - t;
+            float b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t,
+                    b3 = t * t * t;
+            Vec2f curr(b0 * p0.x() + b1 * p1.x() + b2 * p2.x() + b3 * p3.x(),
+                    b0 * p0.y() + b1 * p1.y() + b2 * p2.y() + b3 * p3.y());
+            if (distToLine2(loc, prev, curr) <= r2)
+                return true;
+            prev = curr;
         }
     }
+    return false;
+}
 
-    return getCurve(maxHit);
-    //_paths.SetIterationHead();
-    //printf("selected path\n");
-    //return _paths.IterateForward(maxHit);
-}
-
-RotoPath* RotoCurves::pickFreePrimitive(const int x, const int y)
-{
-    printf("picking\n");
-    GLint viewport[4];
-    GLdouble projection[16];
-    GLuint selectBuf[100];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    glGetDoublev(GL_PROJECTION_MATRIX, projection);
-    glSelectBuffer(100, selectBuf);
-    glRenderMode (GL_SELECT);
-    glInitNames();
-
-    glMatrixMode (GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    gluPickMatrix(x, AbstractPath::_globalh - y, 10., 10., viewport);
-    glMultMatrixd(projection);
-    glMatrixMode (GL_MODELVIEW);
-
-    renderFreePaths(false);
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glFlush();
-
-    int hits = glRenderMode(GL_RENDER);
-    printf("%d hits\n", hits);
-    if (hits == 0)
-        return NULL;
-    unsigned int maxHit = selectBuf[3];
-    for (int i = 1; i < hits; i++)
-    {
-        if (selectBuf[3 + 4 * i] > maxHit)
-        {
-            maxHit = selectBuf[3 + 4 * i];
-        }
-    }
+RotoPath* RotoCurves::pickPrimitive(const Vec2f& loc, const float radius)
+{
+    // the last one drawn is on top
+    std::vector<RotoPath*> hits;
+    _index.query(loc, radius, &hits);
+    for (int i = int(hits.size()) - 1; i >= 0; --i)
+        if (pathHit(hits[i], loc, radius))
+            return hits[i];
+    return NULL;
+}
 
-    //_paths.SetIterationHead();
-    //printf("selected path\n");
-    //return _paths.IterateForward(maxHit);
-    return getCurve(maxHit);
+RotoPath* RotoCurves::pickFreePrimitive(const Vec2f& loc, const float radius)
+{
+    std::vector<RotoPath*> hits;
+    _index.query(loc, radius, &hits);
+    for (int i = int(hits.size()) - 1; i >= 0; --i)
+        if (!hits[i]->nextC() && pathHit(hits[i], loc, radius))
+            return hits[i];
+    return NULL;
 }
 
 Vec2i RotoCurves::calcStat()
@@ -399,10 +450,12 @@ void RotoCurves::setupJoints(RotoPath* rp)
 void RotoCurves::setupJointsOneSide(RotoPath* rp, int side)
 {
 
+    // a joint moves the end by up to sqrt(_J_DIST_), so look twice as far
     double tmp;
-    RotoPathList::iterator c;
-    unsigned _paths_size = _paths.size();
-    for (c = _paths.begin(); c != _paths.end(); ++c)
+    std::vector<RotoPath*> hits;
+    std::vector<RotoPath*>::iterator c;
+    _index.query(rp->getEnd(side), 2 * sqrtf(_J_DIST_), &hits);
+    for (c = hits.begin(); c != hits.end(); ++c)
     {
         RotoPath *c_paths = *c;
         if (c_paths == rp)
@@ -487,8 +540,10 @@ RotoPath* RotoCurves::distanceToEnds2(const Vec2f& loc, int& whichEnd)
     double minDist = DBL_MAX, tmp;
     RotoPath* res;
     int resSide;
-    RotoPathList::iterator c;
-    for (c = _paths.begin(); c != _paths.end(); ++c)
+    std::vector<RotoPath*> hits;
+    std::vector<RotoPath*>::iterator c;
+    _index.query(loc, sqrtf(10), &hits);
+    for (c = hits.begin(); c != hits.end(); ++c)
     {
         //while ((curr=getNextCurve()) != NULL) {
         tmp = (*c)->distanceToSide2(loc, 1);
@@ -557,8 +612,10 @@ RotoPath* RotoCurves::distanceToCtrls2(const Vec2f& loc, int* whichControl)
 {
     double minDist = DBL_MAX, tmp;
     RotoPath* res;
-    RotoPathList::iterator c;
-    for (c = _paths.begin(); c != _paths.end(); ++c)
+    std::vector<RotoPath*> hits;
+    std::vector<RotoPath*>::iterator c;
+    _index.query(loc, sqrtf(10), &hits);
+    for (c = hits.begin(); c != hits.end(); ++c)
     {
         //  while ((curr=getNextCurve()) != NULL) {
         const std::vector<Vec2f>& ctrls = (*c)->getBez()->getControls();
@@ -584,11 +641,12 @@ RotoPath* RotoCurves::distanceToCtrls2(const Vec2f& loc, int* whichControl)
 void RotoCurves::addPath(RotoPath* newPath)
 {
     _paths.push_back(newPath);
+    _index.add(newPath);
 }
 
 void RotoCurves::deleteTail()
 {
-    delete *(_paths.end());
+    delete _paths.back();
     _paths.pop_back();
 }
 
@@ -598,6 +656,7 @@ void RotoCurves::splitCurve(RotoPath* rp, const int ctrl)
     // remove rp
     //_paths.RemoveNode(rp, 0);
     _paths.remove(rp);
+    _index.remove(rp);
     // TODO: should elegantly handle roto correspondences (split them),
     // and or propagate change to other moments in time
 
@@ -621,9 +680,11 @@ RotoPath* RotoCurves::pickSplineSegment(const Vec2f loc, float& t)
     // STUB
     double minDist = DBL_MAX, dist;
     RotoPath* res;
-    RotoPathList::const_iterator c;
+    std::vector<RotoPath*> hits;
+    std::vector<RotoPath*>::const_iterator c;
     DSample sample;
-    for (c = _paths.begin(); c != _paths.end(); ++c)
+    _index.query(loc, 5, &hits);
+    for (c = hits.begin(); c != hits.end(); ++c)
     {
         dist = (*c)->distToSplineSamples2(loc, sample);
         if (dist < minDist)
@@ -712,3 +773,84 @@ void RotoCurves::calcLerp()
         (*c)->calcLerp();
     }
 }
+
+// samples of rp from the side entered at up to, not including, the other end
+static void appendOutline(const RotoPath* rp, const int enterSide,
+        const int samplesPerSeg, std::vector<Vec2f>* pts)
+{
+    const BezSpline* bez = rp->getBez();
+    const int numSegs = bez->numSegs(), n = numSegs * samplesPerSeg;
+    for (int k = 0; k < n; ++k)
+    {
+        const int i = enterSide == 0 ? k : n - k;
+        int seg = i / samplesPerSeg;
+        float t = float(i % samplesPerSeg) / samplesPerSeg;
+        if (seg == numSegs)
+        {
+            seg = numSegs - 1;
+            t = 1.f;
+        }
+        const Vec2f* p = bez->getCtrl(3 * seg);
+        const float s = 1.f - t;
+        const float b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t,
+                b3 = t * t * t;
+        pts->push_back(Vec2f(
+                b0 * p[0].x() + b1 * p[1].x() + b2 * p[2].x() + b3 * p[3].x(),
+                b0 * p[0].y() + b1 * p[1].y() + b2 * p[2].y()
+                        + b3 * p[3].y()));
+    }
+}
+
+void RotoCurves::traceOutlines(std::vector<std::vector<Vec2f> >* loops,
+        const int samplesPerSeg) const
+{
+    std::set<const RotoPath*> used;
+    RotoPathList::const_iterator c;
+    for (c = _paths.begin(); c != _paths.end(); ++c)
+    {
+        const RotoPath* start = *c;
+        if (used.count(start))
+            continue;
+
+        // walk the joints from the end of start until they come back to
+        // its beginning
+        std::vector<Vec2f> loop;
+        std::set<const RotoPath*> chain;
+        const RotoPath* rp = start;
+        int side = 0; // side rp is entered at
+        bool closed = false;
+        while (true)
+        {
+            appendOutline(rp, side, samplesPerSeg, &loop);
+            chain.insert(rp);
+
+            const Joints& js = rp->joints(1 - side);
+            const Joint* next = NULL;
+            Joints::const_iterator j;
+            for (j = js.begin(); j != js.end(); ++j)
+            {
+                if (j->_rp == start && j->_side == 0)
+                    closed = true;
+                else if (!next && !chain.count(j->_rp) && !used.count(j->_rp))
+                    next = &*j;
+            }
+
+            // a loop drawn as one path has no joint to itself
+            const BezSpline* bez = start->getBez();
+            if (rp == start && !closed
+                    && bez->distanceToEnd2(bez->getEnd(0), 1) < _J_DIST_)
+                closed = true;
+
+            if (closed || !next)
+                break;
+            rp = next->_rp;
+            side = next->_side;
+        }
+
+        if (closed && loop.size() >= 3)
+        {
+            loops->push_back(loop);
+            used.insert(chain.begin(), chain.end());
+        }
+    }
+}
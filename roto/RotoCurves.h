@@ -26,6 +26,7 @@
 #include <deque>
 #include "RotoPath.h"
 #include "RotoRegion.h"
+#include "RotoIndex.h"
 
 class RotoRegion;
 class RotoPath;
@@ -73,7 +74,19 @@ public:
 
     void saveMatte(int w, int h) const;
 
+    // closed outlines of the paths joined end to end into loops, sampled
+    // samplesPerSeg times per bezier segment.  Open chains are skipped.
+    void traceOutlines(std::vector<std::vector<Vec2f> >* loops,
+            const int samplesPerSeg = 16) const;
+
     void saveRotoXML(std::ofstream& fp, int frame) const;
+    // reads one <RotoFrame: ...> block as written by saveRotoXML, paths
+    // come back with their joints and labels but unlinked in time.  False
+    // on a malformed block.
+    bool loadRotoXML(std::ifstream& fp, int* frame);
+    // a path through the bezier controls ctrls, 3k + 1 of them, joined to
+    // the paths already here
+    RotoPath* addPathFromCtrls(const std::vector<Vec2f>& ctrls, bool fixed);
     void clearXMLLabels();
     void createXMLLabels(int& labelNum);
 
@@ -92,8 +105,10 @@ public:
 
     void addNPaths(const int i);
 
-    RotoPath* pickPrimitive(const int x, const int y);
-    RotoPath* pickFreePrimitive(const int x, const int y);
+    // the path drawn on top within radius of loc, as RotoPath::render
+    // draws it; free ones are those with no nextC()
+    RotoPath* pickPrimitive(const Vec2f& loc, const float radius);
+    RotoPath* pickFreePrimitive(const Vec2f& loc, const float radius);
 
     RotoPath* pickSplineSegment(const Vec2f loc, float& t);
 
@@ -131,6 +146,7 @@ private:
     RotoPathList _paths;
     int _frame;
     std::deque<RotoRegion*> _regions; // from bottom to top
+    RotoIndex _index; // of _paths, in the same order
 };
 
 #endif
@@ -0,0 +1,201 @@
+/*
+
+ Copyright (C) 2004, Aseem Agarwala, roto@agarwala.org
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or (at
+ your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ USA
+
+ */
+
+#include "RotoIndex.h"
+#include <math.h>
+#include <algorithm>
+#include "RotoPath.h"
+
+#define INDEX_CELL 32.f
+#define INDEX_BUCKETS 1024
+
+RotoIndex::RotoIndex()
+    : _seq(0)
+    , _queries(0)
+{
+}
+
+RotoIndex::~RotoIndex()
+{
+    std::map<const RotoPath*, Entry*>::iterator it;
+    for (it = _entries.begin(); it != _entries.end(); ++it)
+    {
+        it->second->path->setIndex(NULL);
+        delete it->second;
+    }
+}
+
+void RotoIndex::add(RotoPath* path)
+{
+    Entry*& e = _entries[path];
+    if (e)
+        return;
+    e = new Entry;
+    e->path = path;
+    e->seq = _seq++;
+    e->seen = 0;
+    e->dirty = true;
+    _dirty.push_back(e);
+    path->setIndex(this);
+}
+
+void RotoIndex::remove(RotoPath* path)
+{
+    std::map<const RotoPath*, Entry*>::iterator it = _entries.find(path);
+    if (it == _entries.end())
+        return;
+    Entry* e = it->second;
+    if (e->dirty)
+        _dirty.erase(std::find(_dirty.begin(), _dirty.end(), e));
+    unbucket(e);
+    delete e;
+    _entries.erase(it);
+    path->setIndex(NULL);
+}
+
+void RotoIndex::touch(const RotoPath* path)
+{
+    std::map<const RotoPath*, Entry*>::iterator it = _entries.find(path);
+    if (it != _entries.end() && !it->second->dirty)
+    {
+        it->second->dirty = true;
+        _dirty.push_back(it->second);
+    }
+}
+
+void RotoIndex::query(const Vec2f& loc, const float radius,
+        std::vector<RotoPath*>* hits)
+{
+    for (unsigned int i = 0; i < _dirty.size(); ++i)
+    {
+        unbucket(_dirty[i]);
+        insert(_dirty[i]);
+        _dirty[i]->dirty = false;
+    }
+    _dirty.clear();
+
+    hits->clear();
+    if (_buckets.empty())
+        return;
+
+    Bboxf2D box;
+    box.setToPoint(loc);
+    box.includePoint(loc.x() - radius, loc.y() - radius);
+    box.includePoint(loc.x() + radius, loc.y() + radius);
+
+    std::vector<int> buckets;
+    cellBuckets(box, &buckets);
+
+    ++_queries;
+    std::vector<std::pair<unsigned int, RotoPath*> > found;
+    for (unsigned int b = 0; b < buckets.size(); ++b)
+    {
+        const std::vector<Entry*>& bucket = _buckets[buckets[b]];
+        for (unsigned int i = 0; i < bucket.size(); ++i)
+        {
+            Entry* e = bucket[i];
+            if (e->seen == _queries)
+                continue;
+            e->seen = _queries;
+            for (unsigned int s = 0; s < e->segs.size(); ++s)
+                if (e->segs[s].intersect(box))
+                {
+                    found.push_back(std::make_pair(e->seq, e->path));
+                    break;
+                }
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    for (unsigned int i = 0; i < found.size(); ++i)
+        hits->push_back(found[i].second);
+}
+
+void RotoIndex::insert(Entry* e)
+{
+    // a segment is ctrls 3k..3k+3; while a path is being drawn it may end
+    // part way through one, and a lone control is a segment of its own
+    e->segs.clear();
+    const BezSpline* bez = e->path->getBez();
+    const int n = bez ? bez->numCtrls() : 0;
+    for (int i = 0; i < n; i += 3)
+    {
+        Bboxf2D box;
+        box.setToPoint(*bez->getCtrl(i));
+        for (int j = i + 1; j <= i + 3 && j < n; ++j)
+            box.includePoint(*bez->getCtrl(j));
+        e->segs.push_back(box);
+        if (i + 3 >= n - 1)
+            break;
+    }
+    if (e->segs.empty())
+        return;
+
+    e->buckets.clear();
+    for (unsigned int s = 0; s < e->segs.size(); ++s)
+        cellBuckets(e->segs[s], &e->buckets);
+    std::sort(e->buckets.begin(), e->buckets.end());
+    e->buckets.erase(std::unique(e->buckets.begin(), e->buckets.end()),
+            e->buckets.end());
+
+    if (_buckets.empty())
+        _buckets.resize(INDEX_BUCKETS);
+    for (unsigned int b = 0; b < e->buckets.size(); ++b)
+        _buckets[e->buckets[b]].push_back(e);
+}
+
+void RotoIndex::unbucket(Entry* e)
+{
+    for (unsigned int b = 0; b < e->buckets.size(); ++b)
+    {
+        std::vector<Entry*>& bucket = _buckets[e->buckets[b]];
+        std::vector<Entry*>::iterator it = std::find(bucket.begin(),
+                bucket.end(), e);
+        *it = bucket.back();
+        bucket.pop_back();
+    }
+    e->buckets.clear();
+}
+
+// appends the buckets of the cells box covers, possibly more than once
+void RotoIndex::cellBuckets(const Bboxf2D& box, std::vector<int>* buckets) const
+{
+    const int x0 = (int) floorf(box.lower.x() / INDEX_CELL);
+    const int y0 = (int) floorf(box.lower.y() / INDEX_CELL);
+    const int x1 = (int) floorf(box.upper.x() / INDEX_CELL);
+    const int y1 = (int) floorf(box.upper.y() / INDEX_CELL);
+
+    // a box this big touches most buckets anyway
+    if (double(x1 - x0 + 1) * double(y1 - y0 + 1) >= INDEX_BUCKETS)
+    {
+        for (int b = 0; b < INDEX_BUCKETS; ++b)
+            buckets->push_back(b);
+        return;
+    }
+
+    for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x)
+        {
+            unsigned int h = (unsigned int) x * 73856093u
+                    ^ (unsigned int) y * 19349663u;
+            buckets->push_back(h % INDEX_BUCKETS);
+        }
+}
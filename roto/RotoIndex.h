@@ -0,0 +1,85 @@
+/*
+
+ Copyright (C) 2004, Aseem Agarwala, roto@agarwala.org
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or (at
+ your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ USA
+
+ */
+
+#ifndef ROTOINDEX_H
+#define ROTOINDEX_H
+
+#include <map>
+#include <vector>
+#include "Bboxf2D.h"
+
+class RotoPath;
+
+// Uniform grid over the roto paths of a frame, for picking and for the
+// nearest control, end and sample queries of RotoCurves.
+//
+// Every bezier segment of a path goes in the cells covered by the bounding
+// box of its four controls; the segment, and the samples and polyline made
+// from it, lie inside that box.  Cells are hashed into a fixed number of
+// buckets, allocated on the first insert, so the grid needs no bounds and a
+// collision only costs a box test.  A path added to the index tells it when
+// its controls change, and the next query puts back only those paths.
+class RotoIndex
+{
+public:
+
+    RotoIndex();
+    ~RotoIndex();
+
+    // paths must be added in the order of the list they are kept in, as
+    // RotoCurves appends them; a deleted path removes itself
+    void add(RotoPath* path);
+    void remove(RotoPath* path);
+
+    // called by path when its controls change
+    void touch(const RotoPath* path);
+
+    // the paths with a segment box within radius of loc, in the order they
+    // were added
+    void query(const Vec2f& loc, const float radius,
+            std::vector<RotoPath*>* hits);
+
+private:
+
+    RotoIndex(const RotoIndex&);
+    RotoIndex& operator=(const RotoIndex&);
+
+    struct Entry
+    {
+        RotoPath* path;
+        unsigned int seq;               // order added
+        std::vector<Bboxf2D> segs;
+        std::vector<int> buckets;       // each once
+        unsigned int seen;
+        bool dirty;
+    };
+
+    void insert(Entry* e);
+    void unbucket(Entry* e);
+    void cellBuckets(const Bboxf2D& box, std::vector<int>* buckets) const;
+
+    std::map<const RotoPath*, Entry*> _entries;
+    std::vector<Entry*> _dirty;
+    std::vector<std::vector<Entry*> > _buckets;
+    unsigned int _seq, _queries;
+};
+
+#endif // ROTOINDEX_H
@@ -27,6 +27,7 @@
 #include <GL/gl.h>
 #endif
 #include "RotoPath.h"
+#include "RotoIndex.h"
 #include "GraphicsGems.h"
 #include <iostream>
 #include <fstream>
@@ -96,10 +97,13 @@ void RotoPath::mutualInit()
     _xmlLabel = -1;
     _regions[0] = _regions[1] = NULL;
     _trimapWidth = 6; // G!
+    _index = NULL;
 }
 
 RotoPath::~RotoPath()
 {
+    if (_index)
+        _index->remove(this);
     //if (_nextCoors) delete[] _nextCoors;
     //if (_prevCoors) delete[] _prevCoors;
     if (_nextCont)
@@ -169,23 +173,39 @@ void RotoPath::clearPrevCorrespondence()
 
 void RotoPath::calculateBackCorrs()
 {
-    assert (_prevFrame);
-    RotoCorresponder* myCoor = new RotoCorresponder(_prevFrame, this);
-    myCoor->calculate();
-    int* discreteCorrs = new int[_prevFrame->getNumElements()];
-    myCoor->getSolution(discreteCorrs);
-    assert(!_prevFrame->_nextCont);
-    _prevFrame->_nextCont = new ContCorr(_prevFrame->_bez, _bez, discreteCorrs);
-    delete myCoor;
-    delete[] discreteCorrs;
-
-    myCoor = new RotoCorresponder(this, _prevFrame);
-    myCoor->calculate();
-    discreteCorrs = new int[getNumElements()];
-    myCoor->getSolution(discreteCorrs);
-    _prevCont = new ContCorr(_bez, _prevFrame->_bez, discreteCorrs);
-    delete myCoor;
-    delete[] discreteCorrs;
+    calculateBackCorrs(PathV(1, this));
+}
+
+void RotoPath::calculateBackCorrs(const PathV& paths, int numThreads)
+{
+    // both directions of each path, forward at 2 * i
+    std::vector<GeigerCorresponder*> coors;
+    PathV::const_iterator c;
+    for (c = paths.begin(); c != paths.end(); ++c)
+    {
+        assert((*c)->_prevFrame);
+        coors.push_back(new RotoCorresponder((*c)->_prevFrame, *c));
+        coors.push_back(new RotoCorresponder(*c, (*c)->_prevFrame));
+    }
+    GeigerCorresponder::calculateBatch(coors, numThreads);
+
+    int i = 0;
+    for (c = paths.begin(); c != paths.end(); ++c)
+    {
+        RotoPath *rp = *c, *prev = rp->_prevFrame;
+        int* discreteCorrs = new int[prev->getNumElements()];
+        coors[i]->getSolution(discreteCorrs);
+        assert(!prev->_nextCont);
+        prev->_nextCont = new ContCorr(prev->_bez, rp->_bez, discreteCorrs);
+        delete coors[i++];
+        delete[] discreteCorrs;
+
+        discreteCorrs = new int[rp->getNumElements()];
+        coors[i]->getSolution(discreteCorrs);
+        rp->_prevCont = new ContCorr(rp->_bez, prev->_bez, discreteCorrs);
+        delete coors[i++];
+        delete[] discreteCorrs;
+    }
 }
 
 void RotoPath::startPrevCorrespondence(RotoPath* prevC)
@@ -748,7 +768,7 @@ void RotoPath::translateSelected(const Vec2f& delta)
     SplineSampleIterator c2 = transformSelectedSampleIterator();
     for (; !c2.end(); ++c2)
         c2.sample()._loc += delta;
-
+    markIndexDirty();
 }
 
 void RotoPath::rotateSelectedAbout(float dtheta, const Vec2f center)
@@ -774,6 +794,7 @@ void RotoPath::rotateSelectedAbout(float dtheta, const Vec2f center)
         rotp += center;
         c2.sample()._loc = rotp;
     }
+    markIndexDirty();
 }
 
 void RotoPath::uniformScaleSelectedAbout(float mag, const Vec2f& center)
@@ -800,6 +821,7 @@ void RotoPath::uniformScaleSelectedAbout(float mag, const Vec2f& center)
         p += center;
         c2.sample()._loc = p;
     }
+    markIndexDirty();
 
 }
 
@@ -910,6 +932,8 @@ void RotoPath::saveXML(std::ofstream& fp) const
 {
     assert(_bez && _xmlLabel != -1);
     fp << "<Track: {label" << _xmlLabel << "} ";
+    if (_fixed)
+        fp << "fixed ";
     int numSegs = _bez->numSegs();
     const Vec2f* v = _bez->getCtrl(0);
     fp << "M " << v->x() << " " << v->y() << " ";
@@ -1801,6 +1825,7 @@ void RotoPath::fillFromBez()
         _tangents[i].Normalize();
     }
     _samplingDirty = false;
+    markIndexDirty();
 }
 
 void RotoPath::handleNewBezCtrls()
@@ -1881,6 +1906,7 @@ void RotoPath::addCtrl(const Vec2f& v)
 {
     assert (_bez);
     _bez->addCtrl(v);
+    markIndexDirty();
 }
 
 void RotoPath::startManualCreation()
@@ -2001,6 +2027,13 @@ void RotoPath::translate(const Vec2f& delta)
 {
     AbstractPath::translate(delta);
     _bez->translate(delta);
+    markIndexDirty();
+}
+
+void RotoPath::markIndexDirty()
+{
+    if (_index)
+        _index->touch(this);
 }
 
 RotoPathPair RotoPath::split(const int c)
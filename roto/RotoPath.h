@@ -24,6 +24,7 @@ class TrackGraph;
 class SplineCtrlIterator;
 class SplineSampleIterator;
 class RotoRegion;
+class RotoIndex;
 
 typedef std::vector<RotoPath*> PathV;
 typedef std::pair<RotoPath*, RotoPath*> RotoPathPair;
@@ -99,6 +100,7 @@ public:
     {
         assert(_bez && _bez->numCtrls() > 0);
         _bez->setEnd(c, side);
+        markIndexDirty();
     }
     double distanceToSide2(const Vec2f pt, const int side) const
     {
@@ -124,6 +126,7 @@ public:
     {
         assert(_bez);
         _bez->setControl(c, i);
+        markIndexDirty();
     }
     void translate(const Vec2f& delta);
 
@@ -240,11 +243,23 @@ public:
     {
         _xmlLabel = -1;
     }
+    int xmlLabel() const
+    {
+        return _xmlLabel;
+    }
+    void setXMLLabel(const int label)
+    {
+        _xmlLabel = label;
+    }
 
     void notifyDrawDelete(DrawPath* dp);
 
     void calculateBackCorrs(); // calculates bi-directional correspondence between _prevFrame and this
 
+    // calculateBackCorrs() of every path, the corresponders solved together
+    // on up to numThreads threads, 0 for one per core
+    static void calculateBackCorrs(const PathV& paths, int numThreads = 0);
+
     void handleCorrForw(RotoPath* other);
 
     void goBezier(const float tolSqr, const int* numSamples);
@@ -465,6 +480,14 @@ public:
         _trimapWidth = i;
     }
 
+    // the index of the RotoCurves holding this path, told of every change
+    // to the controls
+    void setIndex(RotoIndex* index)
+    {
+        _index = index;
+    }
+    void markIndexDirty();
+
     //int *_prevCoors, *_nextCoors; // should be nondecreasing
 
     BezSpline* _bez;
@@ -510,6 +533,8 @@ private:
 
     RotoRegion* _regions[2]; // TODO: write to file!
 
+    RotoIndex* _index;
+
     std::list<int> _transformSelected; // ranges (segments), maintained sorted
 };
 
@@ -20,6 +20,7 @@
  */
 
 #include "RotoRegion.h"
+#include "MatteRaster.h"
 
 RotoRegion::RotoRegion(const PathV& v)
 {
@@ -114,6 +115,8 @@ void RotoRegion::calculateMask()
     }
 
     GLdouble *v = new GLdouble[numPoints * 3];
+    std::vector<Vec2f> outline;
+    outline.reserve(numPoints);
     Vec2f loc;
     Vec2f endPt;
     int gi, l;
@@ -134,6 +137,7 @@ void RotoRegion::calculateMask()
                 v[gi] = loc.x();
                 v[gi + 1] = loc.y();
                 v[gi + 2] = 0;
+                outline.push_back(loc);
                 printf("Right: %f %f\n", loc.x(), loc.y());
                 if ((*c)->_bez->getDiscreteCount() - 1 == i)
                     endPt = loc;
@@ -148,6 +152,7 @@ void RotoRegion::calculateMask()
                 v[gi] = loc.x();
                 v[gi + 1] = loc.y();
                 v[gi + 2] = 0;
+                outline.push_back(loc);
                 printf("Left: %f %f\n", loc.x(), loc.y());
                 if (i == 0)
                     endPt = loc;
@@ -156,18 +161,9 @@ void RotoRegion::calculateMask()
 
     }
 
-    // render tesselated version, make it render into stencil buffer but fail depth test
-    // then, read stencil buffer into mask
+    // tesselated version for render()
     assert(glGetError() == GL_NO_ERROR);
-    glEnable (GL_STENCIL_TEST);
-    glEnable (GL_DEPTH_TEST);
-    glClear(GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glStencilFunc(GL_ALWAYS, 1, 0x1);
-    glStencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
-    glDepthFunc (GL_NEVER);
-    assert(glGetError() == GL_NO_ERROR);
-
-    glNewList(_listNum, GL_COMPILE_AND_EXECUTE);
+    glNewList(_listNum, GL_COMPILE);
 
     GLUtesselator* tobj = gluNewTess();
     gluTessCallback(tobj, GLU_TESS_VERTEX, (GLvoid (*)()) &glVertex3dv);gluTessCallback
@@ -191,20 +187,13 @@ gluTessBeginPolygon	(tobj, NULL);
     assert(glGetError() == GL_NO_ERROR);
     delete[] v;
 
-    glReadPixels(0, 0, _w, _h, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, _mask);
-
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-
-    // flip the stencil upside down
-    int j = 0, bj = _h - 1;
-    while (j < bj)
-    {
-        for (i = 0; i < _w; ++i)
-            std::swap(_mask[j * _w + i], _mask[bj * _w + i]);
-        ++j;
-        --bj;
-    }
+    // filled on the CPU, so no stencil buffer is needed; a pixel is in when
+    // at least half of it is covered
+    MatteRaster raster(_w, _h);
+    raster.addPolygon(outline);
+    raster.resolve(_mask);
+    for (i = 0; i < _w * _h; ++i)
+        _mask[i] = _mask[i] >= 128;
 
     /*
      QImage im (_w, _h, 32);
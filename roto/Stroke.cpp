@@ -21,6 +21,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
 
 #include "Stroke.h"
 //#include "main.h"
@@ -34,7 +36,8 @@ const double Stroke::MEAN_FILTER[3] =
 
 Stroke::Stroke()
 {
-    _limit = _temp = NULL;
+    _limit = NULL;
+    _stripHead = _stripTail = 0;
     _computed = false;
     _stripComputed = false;
 
@@ -98,7 +101,8 @@ Stroke::Stroke()
  */
 Stroke::Stroke(float radius, GLuint color, StrokeNumT n)
 {
-    _limit = _temp = NULL;
+    _limit = NULL;
+    _stripHead = _stripTail = 0;
     _computed = false;
     _stripComputed = false;
 
@@ -135,7 +139,8 @@ Stroke::Stroke(int cx, int cy, float radius, GLubyte r, GLubyte g, GLubyte b,
 {
     _control.push_back(PointR(cx, cy, radius));
 
-    _limit = _temp = NULL;
+    _limit = NULL;
+    _stripHead = _stripTail = 0;
     _computed = false;
     _stripComputed = false;
 
@@ -171,7 +176,8 @@ Stroke::Stroke(int cx, int cy, float radius, GLuint color, StrokeNumT n)
 {
     _control.push_back(PointR(cx, cy, radius));
 
-    _limit = _temp = NULL;
+    _limit = NULL;
+    _stripHead = _stripTail = 0;
     _computed = false;
     _stripComputed = false;
 
@@ -206,7 +212,8 @@ Stroke::Stroke(const vector<PointR> & control, float radius, GLuint color,
         StrokeNumT n) :
         _control(control)
 {
-    _limit = _temp = NULL;
+    _limit = NULL;
+    _stripHead = _stripTail = 0;
     _computed = false;
     _stripComputed = false;
 
@@ -241,7 +248,8 @@ Stroke::Stroke(const vector<PointR> & control, float radius, GLuint color,
 Stroke::Stroke(const Stroke& s)
 {
     _control = s._control;
-    _limit = _temp = NULL;
+    _limit = NULL;
+    _stripHead = _stripTail = 0;
     _computed = false;
     _stripComputed = false;
 
@@ -279,7 +287,8 @@ Stroke::Stroke(const Stroke& s)
 Stroke& Stroke::operator=(const Stroke& s)
 {
     _control = s._control;
-    _limit = _temp = NULL;
+    _limit = NULL;
+    _stripHead = _stripTail = 0;
     _computed = false;
     _stripComputed = false;
 
@@ -313,22 +322,17 @@ Stroke& Stroke::operator=(const Stroke& s)
     return *this;
 }
 
+// the limit curve and strips stay, to be updated from the control points
+// added next
 void Stroke::clear()
 {
     _computed = false;
     _stripComputed = false;
     _control.erase(_control.begin(), _control.end());
-    if (_limit != NULL)
-        _limit->erase(_limit->begin(), _limit->end());
 }
 
 Stroke::~Stroke()
 {
-    if (_limit != NULL)
-        delete _limit;
-
-    if (_temp != NULL)
-        delete _temp;
 }
 
 void Stroke::addControlPoint(float x, float y, float r)
@@ -667,9 +671,224 @@ void Stroke::setUniformRadius(const float t)
 {
     for (vector<PointR>::iterator c = _limit->begin(); c != _limit->end(); ++c)
         c->r = t;
+
+    // the limit no longer follows from the control points
+    _subdivided.clear();
+    _stripHead = _stripTail = 0;
+    _stripComputed = false;
+}
+
+// makes v, which held n0 elements, hold n; the first head and the last tail
+// stay, the ones in between are left to be computed again
+template<class T>
+static void spliceMiddle(vector<T> & v, int n, int head, int tail)
+{
+    const int n0 = v.size();
+    if (n > n0)
+        v.insert(v.begin() + (n0 - tail), n - n0, T());
+    else if (n < n0)
+        v.erase(v.begin() + (n - tail), v.begin() + (n0 - tail));
+}
+
+// unit vector across a -> b, false if they are the same point
+static inline bool across(const PointR & a, const PointR & b, float & dx,
+        float & dy)
+{
+    dx = b.y - a.y;
+    dy = a.x - b.x;
+
+    float mag = sqrt(dx * dx + dy * dy);
+
+    if (mag != 0)
+    {
+        dx /= mag;
+        dy /= mag;
+    }
+    return dx != 0.0 || dy != 0.0;
+}
+
+// the length textureU[k] adds to textureU[k - 1]; the first segment counts
+// twice
+static inline float textureStep(const vector<PointR> & curve, int k)
+{
+    const int n = curve.size();
+    const PointR & p0 = curve[k == 1 ? 0 : (k == n ? n - 2 : k - 2)];
+    const PointR & p1 = curve[k == 1 ? 1 : (k == n ? n - 1 : k - 1)];
+    return sqrt((p1.x - p0.x) * (p1.x - p0.x) + (p1.y - p0.y) * (p1.y - p0.y));
+}
+
+/* the strip points at curve point i, across the curve there; the middle
+ ones are about the point before */
+void Stroke::stripPointsAt(const vector<PointR> & curve, int i,
+        const float * left_offsets, const float * right_offsets)
+{
+    const int n = curve.size();
+
+    int a = i - 1, b = i + 1, jitter = i - 1;
+    if (i == 0)
+    {
+        a = jitter = 0;
+        b = 1;
+    }
+    else if (i == n - 1)
+    {
+        a = n - 2;
+        b = jitter = n - 1;
+    }
+    const PointR & p0 = (i == n - 1) ? curve[b] : curve[a];
+
+    float dx, dy;
+    across(curve[a], curve[b], dx, dy);
+
+    float jitter_left = 0, jitter_right = 0;
+    if (left_offsets)
+    {
+        jitter_left = left_offsets[jitter];
+        jitter_right = right_offsets[jitter];
+    }
+
+    const float r = MAX(0, p0.r + _tOffset);
+
+    right_inner[i] = Point(p0.x + jitter_right * dx + RAMP_FACTOR * r * dx,
+            p0.y + jitter_right * dy + RAMP_FACTOR * r * dy);
+    right_outer[i] = Point(p0.x + jitter_right * dx + RAMP_FACTOR_TWO * r * dx,
+            p0.y + jitter_right * dy + RAMP_FACTOR_TWO * r * dy);
+    left_inner[i] = Point(p0.x - jitter_left * dx - RAMP_FACTOR * r * dx,
+            p0.y - jitter_left * dy - RAMP_FACTOR * r * dy);
+    left_outer[i] = Point(p0.x - jitter_left * dx - RAMP_FACTOR_TWO * r * dx,
+            p0.y - jitter_left * dy - RAMP_FACTOR_TWO * r * dy);
+}
+
+/* both caps, once textureU is done */
+void Stroke::computeCaps(const vector<PointR> & curve, float * cap1_offsets,
+        float * cap2_offsets)
+{
+    const int n = curve.size();
+
+    // always keep track of the last set of dx,dy that !=0
+    // so we can tell the direction of the stroke even if there is
+    // a pause in stroke movement
+    float dirDX = 0.0;
+    float dirDY = -1.0;
+    float dx, dy;
+
+    if (across(curve[0], curve[1], dx, dy) && finite(dx) && finite(dy))
+    {
+        dirDX = dx;
+        dirDY = dy;
+    }
+
+    computeCapPoints(curve[0], dirDX, dirDY, cap1_offsets, 0);
+    startCap.textureU = textureU.front();
+
+    // the end cap goes the way of the last segment, or of the last
+    // direction along the curve
+    bool found = across(curve[n - 2], curve[n - 1], dx, dy) && finite(dx)
+            && finite(dy);
+    for (int i = n - 2; !found && i >= 1; i--)
+    {
+        found = across(curve[i - 1], curve[i + 1], dx, dy);
+    }
+    if (found)
+    {
+        dirDX = dx;
+        dirDY = dy;
+    }
+
+    computeCapPoints(curve[n - 1], dirDX, dirDY, cap2_offsets, 1);
+    endCap.textureU = textureU.back();
 }
 
 void Stroke::computeStripPoints(const vector<PointR> *curve)
+{
+    updateStripPoints(curve, 0, 0);
+}
+
+/* computes the strip points of curve, whose first head and last tail points
+ are those of the curve they were last computed from; only the strip points
+ and textureU entries that depend on the other points are computed again */
+void Stroke::updateStripPoints(const vector<PointR> *curve, int head,
+        int tail)
+{
+    assert(curve != NULL);
+
+    const int n = curve->size();
+    const int n0 = left_inner.size();
+
+    float ratio = ((float) _texture_width) / (float) _texture_height;
+    ratio /= _texture_radius;
+
+    const bool paperTexture = _useTexture && (_textureType == paper);
+    const bool strokeTexture = _useTexture && _textureType == stroke;
+    const int texture = paperTexture ? 1 : (strokeTexture ? 2 : 0);
+
+    head = MIN(head, MIN(n, n0));
+    tail = MIN(tail, MIN(n, n0) - head);
+
+    // paper textures jitter the strips at random every time
+    const bool incremental = head + tail > 0 && n >= 3 && n0 >= 3
+            && !paperTexture && _stripTOffset == _tOffset
+            && _stripRatio == ratio && _stripTexture == texture;
+
+    _stripTOffset = _tOffset;
+    _stripRatio = ratio;
+    _stripTexture = texture;
+    _stripHead = _stripTail = INT_MAX;
+    _stripComputed = true;
+
+    if (!incremental)
+    {
+        computeAllStripPoints(*curve, ratio);
+        return;
+    }
+
+    // make sure the new points are finite
+    for (int i = head; i < n - tail; i++)
+    {
+        assert(finite((*curve)[i].x) && finite((*curve)[i].y));
+    }
+
+    const int first = MAX(0, head - 1), keep = MAX(0, tail - 1);
+    spliceMiddle(left_inner, n, first, keep);
+    spliceMiddle(left_outer, n, first, keep);
+    spliceMiddle(right_inner, n, first, keep);
+    spliceMiddle(right_outer, n, first, keep);
+    for (int i = first; i < n - keep; i++)
+    {
+        stripPointsAt(*curve, i, NULL, NULL);
+    }
+
+    if (head == 0)
+    {
+        PointR p0 = (*curve)[0];
+        _ufreq = 1.0 / (2.0 * (float) p0.r * ratio);
+        textureU[0] = _ufreq * p0.r;
+    }
+
+    if (strokeTexture)
+    {
+        // entries kept at the start, and at the end, where only the sum
+        // before them has changed
+        const int u0 = head >= 2 ? head + 1 : head;
+        const int u1 = head > 0 ? keep : 0;
+        const float before = u1 > 0 ? textureU[n0 - u1] : 0;
+
+        spliceMiddle(textureU, n + 1, u0, u1);
+        for (int k = MAX(1, u0); k < n + 1 - u1; k++)
+        {
+            textureU[k] = textureU[k - 1] + _ufreq * textureStep(*curve, k);
+        }
+        const float shift = textureU[n - u1] - before;
+        for (int k = n + 1 - u1; k <= n; k++)
+        {
+            textureU[k] += shift;
+        }
+    }
+
+    computeCaps(*curve, NULL, NULL);
+}
+
+void Stroke::computeAllStripPoints(const vector<PointR> & curve, float ratio)
 {
 
     left_inner.clear();
@@ -678,19 +897,25 @@ void Stroke::computeStripPoints(const vector<PointR> *curve)
     right_outer.clear();
     textureU.clear();
 
-    if (curve->empty())
+    // no caps either for less than two points
+    inner_cap1.clear();
+    outer_cap1.clear();
+    inner_cap2.clear();
+    outer_cap2.clear();
+
+    if (curve.empty())
     {
-        _stripComputed = true;
         return;
 
     }
 
+    const int n = curve.size();
+
     // make sure all points are finite
-    //int length = curve->size() ;
-    for (int i = 0; i < curve->size(); i++)
+    for (int i = 0; i < n; i++)
     {
 
-        PointR p = (*curve)[i];
+        PointR p = curve[i];
 
         if (!finite(p.x))
         {
@@ -704,16 +929,11 @@ void Stroke::computeStripPoints(const vector<PointR> *curve)
         }
     }
 
-    // get a list of random offsets to use to jitter the line.
-    // MOVE THIS INTO THE IF STATEMENT...
-    float ratio = ((float) _texture_width) / (float) _texture_height;
-    ratio /= _texture_radius;
-
-    float* left_offsets_buffer = new float[curve->size()];
-    float* right_offsets_buffer = new float[curve->size()];
+    float* left_offsets_buffer = new float[n];
+    float* right_offsets_buffer = new float[n];
 
-    float* left_offsets = new float[curve->size()];
-    float* right_offsets = new float[curve->size()];
+    float* left_offsets = new float[n];
+    float* right_offsets = new float[n];
 
     // random jitters for the caps
     // the first and last jitters of the caps semi circle
@@ -725,16 +945,17 @@ void Stroke::computeStripPoints(const vector<PointR> *curve)
     float* cap1_offsets_buffer = new float[NUM_SLICES - 1];
     float* cap2_offsets_buffer = new float[NUM_SLICES - 1];
 
-    if (_useTexture && (_textureType == paper))
+    const bool paperTexture = _useTexture && (_textureType == paper);
+
+    // a single point has no strips to jitter
+    if (paperTexture && n > 1)
     {
 
-        makeRandomArray(left_offsets_buffer, curve->size());
-        makeRandomArray(right_offsets_buffer, curve->size());
+        makeRandomArray(left_offsets_buffer, n);
+        makeRandomArray(right_offsets_buffer, n);
 
-        blendArray(left_offsets, left_offsets_buffer, curve->size(),
-                curve->size(), 0);
-        blendArray(right_offsets, right_offsets_buffer, curve->size(),
-                curve->size(), 0);
+        blendArray(left_offsets, left_offsets_buffer, n, n, 0);
+        blendArray(right_offsets, right_offsets_buffer, n, n, 0);
 
         if (_cap)
         {
@@ -754,17 +975,16 @@ void Stroke::computeStripPoints(const vector<PointR> *curve)
             right_offsets[0] = 0.5 * right_offsets[1]
                     + 0.5 * cap1_offsets[NUM_SLICES - 2];
 
-            left_offsets[curve->size() - 1] = 0.5
-                    * left_offsets[curve->size() - 2]
+            left_offsets[n - 1] = 0.5 * left_offsets[n - 2]
                     + 0.5 * cap2_offsets[NUM_SLICES - 2];
-            right_offsets[curve->size() - 1] = 0.5
-                    * right_offsets[curve->size() - 2] + 0.5 * cap2_offsets[0];
+            right_offsets[n - 1] = 0.5 * right_offsets[n - 2]
+                    + 0.5 * cap2_offsets[0];
 
             cap1_offsets[0] = left_offsets[0];
             cap1_offsets[NUM_SLICES] = right_offsets[0];
 
-            cap2_offsets[0] = left_offsets[curve->size() - 1];
-            cap2_offsets[NUM_SLICES] = right_offsets[curve->size() - 1];
+            cap2_offsets[0] = left_offsets[n - 1];
+            cap2_offsets[NUM_SLICES] = right_offsets[n - 1];
 
         }
 
@@ -775,368 +995,87 @@ void Stroke::computeStripPoints(const vector<PointR> *curve)
     delete[] cap1_offsets_buffer;
     delete[] cap2_offsets_buffer;
 
-    /* save all the points need to calculated the blended sides */
-
-    assert(curve != NULL);
-
-    float dx, dy, mag;
-    float jitter_left, jitter_right;
-    PointR p0;
-    PointR p1;
-    PointR p2;
-
-    // always keep track of the last set of dx,dy that !=0
-    // so we can tell the direction of the stroke even if there is
-    // a pause in stroke movement
-    float dirDX = 0.0;
-    float dirDY = -1.0;
-
-    if (curve->size() == 0)
-    {
-        return;
-    }
-
-    p0 = (*curve)[0];
+    PointR p0 = curve[0];
 
     _ufreq = 1.0 / (2.0 * (float) p0.r * ratio);
-    float cur_textureU = _ufreq * p0.r;
-    textureU.push_back(cur_textureU);
+    textureU.push_back(_ufreq * p0.r);
 
-    if (curve->size() == 1)
+    if (n == 1)
     {
         if (_cap)
             drawDisc(p0.x, p0.y, depth(), p0.r);  //radius());
-
-        delete[] left_offsets;
-        delete[] right_offsets;
-        delete[] cap1_offsets;
-        delete[] cap2_offsets;
-
-        _stripComputed = true;
-        return;
-    }
-
-    // curve->size is at least 2
-    p1 = (*curve)[1];
-
-    dx = p1.y - p0.y;
-    dy = p0.x - p1.x;
-
-    mag = sqrt(dx * dx + dy * dy);
-
-    if (mag != 0)
-    {
-        dx /= mag;
-        dy /= mag;
-    }
-    // last changed direction
-    if ((dx != 0.0 || dy != 0.0) && finite(dx) && finite(dy))
-    {
-
-        dirDX = dx;
-        dirDY = dy;
-    }
-
-    // compute the start cap
-    computeCapPoints(p0, dirDX, dirDY, cap1_offsets, 0);
-    startCap.textureU = cur_textureU;
-
-    // compute the triangle strip
-    float X2, Y2, X1, Y1, tmpX, tmpY;
-
-    if (_useTexture && _textureType == paper)
-    {
-        jitter_left = left_offsets[0];
-        jitter_right = right_offsets[0];
-    }
-
-    if (_useTexture && _textureType == stroke)
-    {
-        float dist = sqrt(
-                (p1.x - p0.x) * (p1.x - p0.x) + (p1.y - p0.y) * (p1.y - p0.y));
-        cur_textureU += _ufreq * dist;
-
-        textureU.push_back(cur_textureU);
-    }
-
-    if (_useTexture && _textureType == paper)
-    {
-        X2 = p0.x + jitter_right * dx
-                + RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dx;
-        Y2 = p0.y + jitter_right * dy
-                + RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dy;
-
-        tmpX = p0.x + jitter_right * dx
-                + RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dx;
-        tmpY = p0.y + jitter_right * dy
-                + RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dy;
-
-        right_outer.push_back(Point(tmpX, tmpY));
-
-    }
-    else
-    {
-        X2 = p0.x + RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dx;
-        Y2 = p0.y + RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dy;
-
-        tmpX = p0.x + RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dx;
-        tmpY = p0.y + RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dy;
-
-        right_outer.push_back(Point(tmpX, tmpY));
-
-    }
-
-    right_inner.push_back(Point(X2, Y2));
-
-    if (_useTexture && _textureType == paper)
-    {
-
-        X1 = p0.x - jitter_left * dx
-                - RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dx;
-        Y1 = p0.y - jitter_left * dy
-                - RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dy;
-
-        tmpX = p0.x - jitter_left * dx
-                - RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dx;
-        tmpY = p0.y - jitter_left * dy
-                - RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dy;
-
-        left_outer.push_back(Point(tmpX, tmpY));
-
     }
     else
     {
-
-        X1 = p0.x - RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dx;
-        Y1 = p0.y - RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dy;
-
-        tmpX = p0.x - RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dx;
-        tmpY = p0.y - RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dy;
-
-        left_outer.push_back(Point(tmpX, tmpY));
-    }
-
-    left_inner.push_back(Point(X1, Y1));
-
-    // computing strip points
-    for (unsigned int i = 1; i < curve->size() - 1; i++)
-    {
-        p0 = (*curve)[i - 1];
-        p2 = (*curve)[i + 1];
-
-        float jitter_left, jitter_right;
-
-        if (_useTexture && _textureType == paper)
-        {
-            jitter_left = left_offsets[i - 1];
-            jitter_right = right_offsets[i - 1];
-        }
-
-        dx = p2.y - p0.y;
-        dy = p0.x - p2.x;
-
-        mag = sqrt(dx * dx + dy * dy);
-
-        if (mag != 0)
-        {
-            dx /= mag;
-            dy /= mag;
-        }
-
-        if (dx != 0.0 || dy != 0.0)
+        left_inner.resize(n);
+        left_outer.resize(n);
+        right_inner.resize(n);
+        right_outer.resize(n);
+        for (int i = 0; i < n; i++)
         {
-            dirDX = dx;
-            dirDY = dy;
+            stripPointsAt(curve, i, paperTexture ? left_offsets : NULL,
+                    paperTexture ? right_offsets : NULL);
         }
 
-        // textureU
         if (_useTexture && _textureType == stroke)
         {
-            p1 = (*curve)[i];
-            float dist = sqrt(
-                    (p1.x - p0.x) * (p1.x - p0.x)
-                            + (p1.y - p0.y) * (p1.y - p0.y));
-            cur_textureU += _ufreq * dist;
-
-            textureU.push_back(cur_textureU);
-
-        }
-
-        if (_useTexture && (_textureType == paper))
-        {
-
-            X2 = p0.x + jitter_right * dx
-                    + RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dx;
-            Y2 = p0.y + jitter_right * dy
-                    + RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dy;
-            right_outer.push_back(
-                    Point(
-                            p0.x + jitter_right * dx
-                                    + RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset)
-                                            * dx,
-                            p0.y + jitter_right * dy
-                                    + RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset)
-                                            * dy));
-        }
-        else
-        {
-
-            X2 = p0.x + RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dx;
-            Y2 = p0.y + RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dy;
-            right_outer.push_back(
-                    Point(p0.x + RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dx,
-                            p0.y
-                                    + RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset)
-                                            * dy));
-        }
-        right_inner.push_back(Point(X2, Y2));
-
-        if (_useTexture && _textureType == paper)
-        {
-
-            X1 = p0.x - jitter_left * dx
-                    - RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dx;
-            Y1 = p0.y - jitter_left * dy
-                    - RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dy;
-            left_outer.push_back(
-                    Point(
-                            p0.x - jitter_left * dx
-                                    - RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset)
-                                            * dx,
-                            p0.y - jitter_left * dy
-                                    - RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset)
-                                            * dy));
-        }
-        else
-        {
-
-            X1 = p0.x - RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dx;
-            Y1 = p0.y - RAMP_FACTOR * MAX(0, p0.r + _tOffset) * dy;
-            left_outer.push_back(
-                    Point(p0.x - RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset) * dx,
-                            p0.y
-                                    - RAMP_FACTOR_TWO * MAX(0, p0.r + _tOffset)
-                                            * dy));
+            for (int k = 1; k <= n; k++)
+            {
+                textureU.push_back(
+                        textureU.back() + _ufreq * textureStep(curve, k));
+            }
         }
-        left_inner.push_back(Point(X1, Y1)); // save this point
-    }
-
-    p0 = (*curve)[curve->size() - 2];
-    p1 = (*curve)[curve->size() - 1];
-
-    // textureU
-    if (_useTexture && _textureType == stroke)
-    {
-
-        float dist = sqrt(
-                (p1.x - p0.x) * (p1.x - p0.x) + (p1.y - p0.y) * (p1.y - p0.y));
-        cur_textureU += _ufreq * dist;
-        textureU.push_back(cur_textureU);
-    }
 
-    if (_useTexture && _textureType == paper)
-    {
-        jitter_right = right_offsets[curve->size() - 1];
-        jitter_left = left_offsets[curve->size() - 1];
+        computeCaps(curve, cap1_offsets, cap2_offsets);
     }
 
-    dx = p1.y - p0.y;
-    dy = p0.x - p1.x;
-
-    mag = sqrt(dx * dx + dy * dy);
+    delete[] left_offsets;
+    delete[] right_offsets;
+    delete[] cap1_offsets;
+    delete[] cap2_offsets;
 
-    if (mag != 0)
-    {
-        dx /= mag;
-        dy /= mag;
-    }
-
-    if ((dx != 0.0 || dy != 0.0) && finite(dx) && finite(dy))
-    {
-        dirDX = dx;
-        dirDY = dy;
-    }
-
-    if (_useTexture && _textureType == paper)
-    {
-        X2 = p1.x + jitter_right * dx
-                + RAMP_FACTOR * MAX(0, p1.r + _tOffset) * dx;
-        Y2 = p1.y + jitter_right * dy
-                + RAMP_FACTOR * MAX(0, p1.r + _tOffset) * dy;
-        right_outer.push_back(
-                Point(
-                        p1.x + jitter_right * dx
-                                + RAMP_FACTOR_TWO * MAX(0, p1.r + _tOffset)
-                                        * dx,
-                        p1.y + jitter_right * dy
-                                + RAMP_FACTOR_TWO * MAX(0, p1.r + _tOffset)
-                                        * dy));
-    }
-    else
-    {
-        X2 = p1.x + RAMP_FACTOR * MAX(0, p1.r + _tOffset) * dx;
-        Y2 = p1.y + RAMP_FACTOR * MAX(0, p1.r + _tOffset) * dy;
-        right_outer.push_back(
-                Point(p1.x + RAMP_FACTOR_TWO * MAX(0, p1.r + _tOffset) * dx,
-                        p1.y + RAMP_FACTOR_TWO * MAX(0, p1.r + _tOffset) * dy));
-    }
+}
 
-    right_inner.push_back(Point(X2, Y2));
+// texture coordinates 0, 0 unless a texture is on
+static inline StrokeVertex strokeVertex(float x, float y, float z, float u,
+        float v, const GLubyte rgb[3], GLubyte alpha)
+{
+    StrokeVertex s;
+    s.x = x;
+    s.y = y;
+    s.z = z;
+    s.u = u;
+    s.v = v;
+    s.rgba[0] = rgb[0];
+    s.rgba[1] = rgb[1];
+    s.rgba[2] = rgb[2];
+    s.rgba[3] = alpha;
+    return s;
+}
 
-    if (_useTexture && _textureType == paper)
-    {
-        X1 = p1.x - jitter_left * dx
-                - RAMP_FACTOR * MAX(0, p1.r + _tOffset) * dx;
-        Y1 = p1.y - jitter_left * dy
-                - RAMP_FACTOR * MAX(0, p1.r + _tOffset) * dy;
-        left_outer.push_back(
-                Point(
-                        p1.x - jitter_left * dx
-                                - RAMP_FACTOR_TWO * MAX(0, p1.r + _tOffset)
-                                        * dx,
-                        p1.y - jitter_left * dy
-                                - RAMP_FACTOR_TWO * MAX(0, p1.r + _tOffset)
-                                        * dy));
-    }
-    else
+// the triangles of a triangle strip
+static void appendStrip(const vector<StrokeVertex> & strip,
+        vector<StrokeVertex> & out)
+{
+    for (unsigned int i = 2; i < strip.size(); i++)
     {
-        X1 = p1.x - RAMP_FACTOR * MAX(0, p1.r + _tOffset) * dx;
-        Y1 = p1.y - RAMP_FACTOR * MAX(0, p1.r + _tOffset) * dy;
-        left_outer.push_back(
-                Point(p1.x - RAMP_FACTOR_TWO * MAX(0, p1.r + _tOffset) * dx,
-                        p1.y - RAMP_FACTOR_TWO * MAX(0, p1.r + _tOffset) * dy));
+        out.push_back(strip[i - 2]);
+        out.push_back(strip[i - 1]);
+        out.push_back(strip[i]);
     }
-
-    left_inner.push_back(Point(X1, Y1));
-
-    // compute end cap points
-    computeCapPoints(p1, dirDX, dirDY, cap2_offsets, 1);
-    endCap.textureU = cur_textureU;
-
-    _stripComputed = true;
-
 }
 
-void Stroke::drawTriangleStrip(Strip strip)
+void Stroke::stripTriangles(Strip strip, const GLubyte rgb[3],
+        vector<StrokeVertex> & out) const
 {
 
-    vector<Point>::iterator left_itr;
-    vector<Point>::iterator right_itr;
-    vector<Point>::iterator end;
-
-    GLboolean blended = glIsEnabled(GL_BLEND);
-
-    float left_alpha;
-    float right_alpha;
+    const vector<Point> * left = NULL;
+    const vector<Point> * right = NULL;
 
     const float z = depth();
-    float curve_length;
 
-    float textureX1;      // the left edge of the texture;
-    float textureX2;      // the right edge of the texture ;
-    vector<float>::iterator textureU_itr = textureU.begin(); // for stroke texture
-
-    float X1, Y1, X2, Y2;
+    float textureX1 = 0;      // the left edge of the texture;
+    float textureX2 = 0;      // the right edge of the texture ;
 
     if (left_outer.size() <= 0 || left_inner.size() <= 0
             || right_inner.size() <= 0 || right_outer.size() <= 0)
@@ -1146,24 +1085,16 @@ void Stroke::drawTriangleStrip(Strip strip)
         return;
     }
 
-    float cur_color[4];
-    glGetFloatv(GL_CURRENT_COLOR, cur_color);
-
     switch (strip)
     {
 
     case __left:
 
-        left_itr = left_outer.begin();
-        right_itr = left_inner.begin();
-        end = left_outer.end();
+        left = &left_outer;
+        right = &left_inner;
 
-        curve_length = left_outer.size();
         assert(left_outer.size() == left_inner.size());
 
-        left_alpha = 1.0;  // G!
-        right_alpha = 1.0;
-
         textureX2 = 0.5 - _texture_radius * 0.5;
         textureX1 = 0.5 - _texture_radius * 0.25;
 
@@ -1171,16 +1102,11 @@ void Stroke::drawTriangleStrip(Strip strip)
 
     case __middle:
 
-        left_itr = left_inner.begin();
-        right_itr = right_inner.begin();
-        end = left_inner.end();
+        left = &left_inner;
+        right = &right_inner;
 
-        curve_length = left_inner.size();
         assert(left_inner.size() == right_inner.size());
 
-        left_alpha = 1.0;
-        right_alpha = 1.0;
-
         textureX2 = 0.5 - _texture_radius * 0.25;
         textureX1 = 0.5 + _texture_radius * 0.25;
 
@@ -1188,16 +1114,11 @@ void Stroke::drawTriangleStrip(Strip strip)
 
     case __right:
 
-        left_itr = right_inner.begin();
-        right_itr = right_outer.begin();
-        end = right_inner.end();
+        left = &right_inner;
+        right = &right_outer;
 
-        curve_length = right_outer.size();
         assert(right_outer.size() == right_inner.size());
 
-        left_alpha = 1.0;
-        right_alpha = 1.0; // G! 0
-
         textureX2 = 0.5 + _texture_radius * 0.25;
         textureX1 = 0.5 + _texture_radius * 0.5;
 
@@ -1205,143 +1126,78 @@ void Stroke::drawTriangleStrip(Strip strip)
 
     }
 
-    //glEnable( GL_BLEND ) ;  //G!
-
-    glBegin (GL_TRIANGLE_STRIP);
-
-    X2 = left_itr->x;
-    Y2 = left_itr->y;
-
-    left_itr++;
-    glColor4f(cur_color[0], cur_color[1], cur_color[2], left_alpha);
-
-    if (_useTexture)
-    {
-
-        if (_textureType == paper)
-        {
-            glTexCoord2f(X2 / _texture_width, Y2 / _texture_height);
-        }
-        else
-        {
-            if (_textureType == stroke)
-            {
-                glTexCoord2f(*textureU_itr, textureX2);
-            }
-        }
-    }
-
-    glVertex3f(X2, Y2, z);
-
-    X1 = right_itr->x;
-    Y1 = right_itr->y;
-    right_itr++;
-
-    glColor4f(cur_color[0], cur_color[1], cur_color[2], right_alpha);
-
-    if (_useTexture)
-    {
-        if (_textureType == paper)
-        {
-            glTexCoord2f(X1 / _texture_width, Y1 / _texture_height);
-        }
-        else
-        {
-            if (_textureType == stroke)
-            {
-                glTexCoord2f(*textureU_itr, textureX1);
-            }
-        }
-    }
-
-    glVertex3f(X1, Y1, z);
-
-    if (_textureType == stroke && _useTexture)
-    {
-        textureU_itr++;
-    }
-
-    while (left_itr != end)
+    // both sides are opaque, the ramp of the edges is in the texture
+    vector<StrokeVertex> points;
+    points.reserve(2 * left->size());
+    for (unsigned int i = 0; i < left->size(); i++)
     {
+        const Point & X2 = (*left)[i];
+        const Point & X1 = (*right)[i];
+        float u2 = 0, v2 = 0, u1 = 0, v1 = 0;
 
-        X2 = left_itr->x;
-        Y2 = left_itr->y;
-
-        left_itr++;
-        glColor4f(cur_color[0], cur_color[1], cur_color[2], left_alpha);
         if (_useTexture)
         {
             if (_textureType == paper)
             {
-                glTexCoord2f(X2 / _texture_width, Y2 / _texture_height);
+                u2 = X2.x / _texture_width;
+                v2 = X2.y / _texture_height;
+                u1 = X1.x / _texture_width;
+                v1 = X1.y / _texture_height;
             }
-            else
+            else if (_textureType == stroke)
             {
-                if (_textureType == stroke)
-                {
-                    glTexCoord2f(*textureU_itr, textureX2);
-                    // glTexCoord2f( textureX2, *textureU_itr );
-                }
+                u2 = u1 = textureU[i];
+                v2 = textureX2;
+                v1 = textureX1;
             }
         }
 
-        glVertex3f(X2, Y2, z);
-
-        X1 = right_itr->x;
-        Y1 = right_itr->y;
+        points.push_back(strokeVertex(X2.x, X2.y, z, u2, v2, rgb, 255));
+        points.push_back(strokeVertex(X1.x, X1.y, z, u1, v1, rgb, 255));
+    }
 
-        right_itr++;
-        glColor4f(cur_color[0], cur_color[1], cur_color[2], right_alpha);
+    appendStrip(points, out);
 
-        if (_useTexture)
-        {
-            if (_textureType == paper)
-            {
-                glTexCoord2f(X1 / _texture_width, Y1 / _texture_height);
-            }
-            else
-            {
-                if (_textureType == stroke)
-                {
+}
 
-                    glTexCoord2f(*textureU_itr, textureX1);
-                }
-            }
-        }
+/* draws triangles of the stroke */
+void Stroke::scanConvert(const vector<StrokeVertex> & triangles)
+{
 
-        glVertex3f(X1, Y1, z);
-        if (_useTexture && _textureType == stroke)
-        {
-            textureU_itr++;
-        }
+    GLboolean text2D_enabled = glIsEnabled(GL_TEXTURE_2D);
 
-    }
+    if (_useTexture)
+    {
 
-    glEnd();
+        glBindTexture(GL_TEXTURE_2D, _textureName);
+        glEnable (GL_TEXTURE_2D);
 
-    glColor4f(cur_color[0], cur_color[1], cur_color[2], cur_color[3]);
+    }
 
-    if (!blended)
+    if (!triangles.empty())
     {
-        glDisable (GL_BLEND);
+        drawVertices(&triangles[0], 0, triangles.size());
     }
 
-    assert(!glGetError());
+    if (!text2D_enabled)
+    {
+        glDisable (GL_TEXTURE_2D);
+    }
 
 }
 
-/* draws the stroke */
-void Stroke::scanConvert()
+void Stroke::tessellate(const GLubyte rgb[3], vector<StrokeVertex> & out)
 {
-
-    GLboolean text2D_enabled = glIsEnabled(GL_TEXTURE_2D);
-
-    if (_useTexture)
+    if (!_computed)
     {
+        computeLimitCurve();
+    }
 
-        glBindTexture(GL_TEXTURE_2D, _textureName);
-        glEnable (GL_TEXTURE_2D);
+    // a thickness change moves every strip point
+    if (!_stripComputed || _tOffset != _stripTOffset)
+    {
 
+        updateStripPoints(_limit, _stripHead, _stripTail);
     }
 
     //  _cap= false;
@@ -1349,25 +1205,39 @@ void Stroke::scanConvert()
 
     if (_cap)
     {
-        drawCap(startCap, inner_cap1, outer_cap1, 0);
+        capTriangles(startCap, inner_cap1, outer_cap1, 0, rgb, out);
     }
 
-    drawTriangleStrip (__middle);
+    stripTriangles(__middle, rgb, out);
 
-    drawTriangleStrip (__right);
+    stripTriangles(__right, rgb, out);
 
-    drawTriangleStrip (__left);
+    stripTriangles(__left, rgb, out);
 
     if (_cap)
     {
-        drawCap(endCap, inner_cap2, outer_cap2, 1);
-    }
-
-    if (!text2D_enabled)
-    {
-        glDisable (GL_TEXTURE_2D);
+        capTriangles(endCap, inner_cap2, outer_cap2, 1, rgb, out);
     }
+}
 
+/* vertices first..first + count - 1 of v as GL_TRIANGLES; v is NULL when
+ they are in the bound GL_ARRAY_BUFFER */
+void Stroke::drawVertices(const StrokeVertex * v, int first, int count)
+{
+    const char * base = (const char *) v;
+
+    glPushClientAttrib (GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnableClientState (GL_VERTEX_ARRAY);
+    glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState (GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(StrokeVertex),
+            base + offsetof(StrokeVertex, x));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(StrokeVertex),
+            base + offsetof(StrokeVertex, u));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(StrokeVertex),
+            base + offsetof(StrokeVertex, rgba));
+    glDrawArrays(GL_TRIANGLES, first, count);
+    glPopClientAttrib();
 }
 
 void Stroke::drawControlPolygon()
@@ -1392,18 +1262,18 @@ void Stroke::render()
 
     glGetFloatv(GL_CURRENT_COLOR, cur_color);
 
-    if (!_computed)
+    GLubyte rgb[3];
+    for (int i = 0; i < 3; i++)
     {
-        computeLimitCurve();
+        rgb[i] = GLubyte(MAX(0.f, MIN(1.f, cur_color[i])) * 255 + 0.5);
     }
 
-    if (!_stripComputed)
-    {
+    vector<StrokeVertex> triangles;
+    tessellate(rgb, triangles);
+    scanConvert(triangles);
 
-        computeStripPoints (_limit);
-    }
-
-    scanConvert();
+    // the color array leaves the current color undefined
+    glColor4fv(cur_color);
 }
 
 float Stroke::arcLength()
@@ -1441,7 +1311,7 @@ float Stroke::arcLength()
     return length;
 }
 
-void Stroke::subdivideCubicBSpline(vector<PointR> * inputCurve,
+void Stroke::subdivideCubicBSpline(const vector<PointR> * inputCurve,
         vector<PointR> * outputCurve)
 {
     outputCurve->erase(outputCurve->begin(), outputCurve->end());
@@ -1551,7 +1421,7 @@ void Stroke::subdivideCubicBSpline(vector<PointR> * inputCurve,
  }
  */
 
-void Stroke::subdivide(vector<PointR> * inputCurve,
+void Stroke::subdivide(const vector<PointR> * inputCurve,
         vector<PointR> * outputCurve)
 {
     subdivideCubicBSpline(inputCurve, outputCurve);
@@ -1574,41 +1444,116 @@ void Stroke::subdivide(vector<PointR> * inputCurve,
      */
 }
 
-void Stroke::computeLimitCurve()
+/* the point j of the subdivision of in */
+static inline PointR subdivisionPoint(const vector<PointR> & in, int j)
 {
+    const int m = in.size();
+    const int i = j / 2;
+
+    if (j == 0)
+        return in[0];
+    if (j == 2 * m - 2)
+        return in[m - 1];
+    if (j % 2)
+        return (in[i] + in[i + 1]) / 2;
+    return (in[i - 1] + in[i] * 6 + in[i + 1]) / 8;
+}
 
-    if (_limit == NULL)
-        _limit = new vector<PointR>();
-
-    if (_temp == NULL)
-        _temp = new vector<PointR>();
-
-    subdivide(&_control, _limit);
+/* subdivides in into out again, when only the first head and the last
+ tail points of in are those out was subdivided from; on return they are
+ the points of out that stayed */
+void Stroke::resubdivide(const vector<PointR> & in, vector<PointR> & out,
+        int & head, int & tail)
+{
+    const int m = in.size();
 
-    if (_extendLength && _control.size() > 1)
+    // the ends of curves of less than 3 points are subdivided differently
+    if (m < 3 || out.size() < 5 || head + tail == 0)
     {
-        PointR & p0 = _control[0];
-        PointR & p1 = _control[1];
+        subdivideCubicBSpline(&in, &out);
+        head = tail = 0;
+        return;
+    }
+
+    // a point of out depends on the one or two points of in on either side
+    const int n = 2 * m - 1;
+    head = MAX(0, 2 * head - 2);
+    tail = MAX(0, 2 * tail - 2);
+    spliceMiddle(out, n, head, tail);
+    for (int j = head; j < n - tail; j++)
+        out[j] = subdivisionPoint(in, j);
+}
 
-        PointR v = p0 - p1;
-        v.normalize();
-        v = v * _radius;
-        _limit->insert(_limit->begin(), p0 + v);
+/* the number of points a and b have the same at the start, and then at the
+ end */
+static void matchEnds(const vector<PointR> & a, const vector<PointR> & b,
+        int & head, int & tail)
+{
+    const int n = MIN(a.size(), b.size());
+    head = tail = 0;
+    while (head < n && a[head] == b[head])
+        head++;
+    while (head + tail < n && a[a.size() - 1 - tail] == b[b.size() - 1 - tail])
+        tail++;
+}
 
-        PointR &pn_1 = _control[_control.size() - 2];
-        PointR &pn = _control[_control.size() - 1];
+void Stroke::computeLimitCurve()
+{
+    const unsigned int levels = 1 + 2 * (_numLevels / 2);
 
-        v = pn - pn_1;
-        v.normalize();
-        v = v * _radius;
-        _limit->push_back(pn + v);
+    // control points that are the same as the last time at either end
+    int head = 0, tail = 0;
+    bool moved = true;
+    if (_subdivisions.size() == levels && !_extendLength)
+    {
+        matchEnds(_subdivided, _control, head, tail);
+        moved = head < (int) _control.size()
+                || _subdivided.size() != _control.size();
     }
+    else
+        _subdivisions.resize(levels);
 
-    for (int i = 0; i < _numLevels / 2; i++)
+    if (moved)
     {
-        subdivide(_limit, _temp);
-        subdivide(_temp, _limit);
+        const vector<PointR> * in = &_control;
+        for (unsigned int l = 0; l < levels; l++)
+        {
+            resubdivide(*in, _subdivisions[l], head, tail);
+            in = &_subdivisions[l];
+
+            if (l == 0 && _extendLength && _control.size() > 1)
+            {
+                PointR & p0 = _control[0];
+                PointR & p1 = _control[1];
+
+                PointR v = p0 - p1;
+                v.normalize();
+                v = v * _radius;
+                _subdivisions[0].insert(_subdivisions[0].begin(), p0 + v);
+
+                PointR &pn_1 = _control[_control.size() - 2];
+                PointR &pn = _control[_control.size() - 1];
+
+                v = pn - pn_1;
+                v.normalize();
+                v = v * _radius;
+                _subdivisions[0].push_back(pn + v);
+            }
+        }
+
+        // the extended ends do not follow from the control points alone,
+        // so they are done over next time
+        if (_extendLength)
+            _subdivided.clear();
+        else
+            _subdivided = _control;
     }
+    else
+        head = tail = INT_MAX;
+
+    _limit = &_subdivisions.back();
+    _stripHead = MIN(_stripHead, head);
+    _stripTail = MIN(_stripTail, tail);
 
     _computed = true;
 }
@@ -1742,22 +1687,16 @@ void Stroke::blendArray(float arrOut[], float arrIn[], int sizeOut, int sizeIn,
 
 }
 
-void Stroke::drawCap(const _CapData & cap, vector<Point> & inner_points,
-        vector<Point> & outer_points, bool orientation)
+void Stroke::capTriangles(const _CapData & cap,
+        const vector<Point> & inner_points, const vector<Point> & outer_points,
+        bool orientation, const GLubyte rgb[3],
+        vector<StrokeVertex> & out) const
 {
 
-    PointR p0 = cap.p0;
-
-    //float textureR ;
-    float cur_color[4];
-    glGetFloatv(GL_CURRENT_COLOR, cur_color);
-
-    glColor4f(cur_color[0], cur_color[1], cur_color[2], 1.0);
-    GLboolean blended;
-    glGetBooleanv(GL_BLEND, &blended);
+    const PointR & p0 = cap.p0;
+    const float z = _depth;
 
     float texturePos = -1.0;
-    vector<float>::iterator textureU_itr;
 
     if (_textureType == stroke && textureU.size() > 0)
     {
@@ -1769,167 +1708,82 @@ void Stroke::drawCap(const _CapData & cap, vector<Point> & inner_points,
         else
         {
             // drawing the end cap
-            textureU_itr = textureU.end();
-            textureU_itr--;
-            texturePos = *textureU_itr;
+            texturePos = textureU.back();
         }
     }
 
-    glPushMatrix();
-    glTranslatef(p0.x, p0.y, _depth);
-
-    vector<Point>::iterator inner = inner_points.begin();
-    vector<Point>::iterator outer;
-    vector<Point>::iterator inner_end = inner_points.end();
-    vector<Point>::iterator outer_end = outer_points.end();
-    vector<Point>::iterator cap_inner, cap_outer;
-
-    if (orientation == 0)
-    {
-        cap_inner = startCapTexture_inner.begin();
-        cap_outer = startCapTexture_outer.begin();
-    }
-    else
-    {
-        cap_inner = endCapTexture_inner.begin();
-        cap_outer = endCapTexture_outer.begin();
-    }
+    const vector<Point> & cap_inner =
+            orientation == 0 ? startCapTexture_inner : endCapTexture_inner;
+    const vector<Point> & cap_outer =
+            orientation == 0 ? startCapTexture_outer : endCapTexture_outer;
 
-    glBegin (GL_TRIANGLE_FAN);
+    const bool paperTexture = _useTexture && _textureType == paper;
+    const bool strokeTexture = _useTexture && _textureType == stroke;
 
-    if (_useTexture)
+    // the cap points are relative to p0
+    vector<StrokeVertex> inner;
+    inner.reserve(inner_points.size());
+    for (unsigned int i = 0; i < inner_points.size(); i++)
     {
-
-        if (_textureType == paper)
+        const float x = p0.x + inner_points[i].x;
+        const float y = p0.y + inner_points[i].y;
+        float u = 0, v = 0;
+        if (paperTexture)
         {
-            glTexCoord2f(p0.x / _texture_width, p0.y / _texture_height);
-
+            u = x / _texture_width;
+            v = y / _texture_height;
         }
-        else if (_textureType == stroke)
+        else if (strokeTexture)
         {
-
-            // stroke texture
-            glTexCoord2f(texturePos, 0.5);
-
+            u = cap_inner[i].x;
+            v = cap_inner[i].y;
         }
+        inner.push_back(strokeVertex(x, y, z, u, v, rgb, 255));
     }
 
-    glVertex3i(0, 0, 0);
-
-    while (inner != inner_end)
+    // opaque fan around p0
+    StrokeVertex centre = strokeVertex(p0.x, p0.y, z, 0, 0, rgb, 255);
+    if (paperTexture)
     {
-
-        if (_useTexture)
-        {
-
-            if (_textureType == paper)
-            {
-                glTexCoord2f((p0.x + inner->x) / _texture_width,
-                        (p0.y + inner->y) / _texture_height);
-            }
-            else
-            {
-                if (_textureType == stroke)
-                {
-
-                    // stroke texture
-                    //glTexCoord2f(textureU + _ufreq * p0.r * (-sin(i*M_PI/NUM_SLICES)+1)/2, (-cos(i*M_PI/NUM_SLICES)+1)/2 )
-                    //	    glTexCoord2f(cap_inner->x, cap_inner->y);
-                    glTexCoord2f(cap_inner->x, cap_inner->y);
-                    cap_inner++;
-                }
-            }
-        }
-
-        glVertex3f(inner->x, inner->y, 0);
-        inner++;
-
+        centre.u = p0.x / _texture_width;
+        centre.v = p0.y / _texture_height;
     }
-    glEnd();
-
-    if (orientation == 0)
+    else if (strokeTexture)
     {
-        cap_inner = startCapTexture_inner.begin();
+        // stroke texture
+        centre.u = texturePos;
+        centre.v = 0.5;
     }
-    else
+
+    for (unsigned int i = 1; i < inner.size(); i++)
     {
-        cap_inner = endCapTexture_inner.begin();
+        out.push_back(centre);
+        out.push_back(inner[i - 1]);
+        out.push_back(inner[i]);
     }
 
-    inner = inner_points.begin();
-    outer = outer_points.begin();
-
-    glBegin (GL_TRIANGLE_STRIP);
-
-    while (outer != outer_end && inner != inner_end)
+    // then a strip fading out from the inner to the outer points
+    vector<StrokeVertex> ring;
+    const unsigned int n = MIN(inner_points.size(), outer_points.size());
+    ring.reserve(2 * n);
+    for (unsigned int i = 0; i < n; i++)
     {
-
-        // inner point
-        glColor4f(cur_color[0], cur_color[1], cur_color[2], 1.0);
-        if (_useTexture)
+        const float x = p0.x + outer_points[i].x;
+        const float y = p0.y + outer_points[i].y;
+        float u = 0, v = 0;
+        if (paperTexture)
         {
-
-            if (_textureType == paper)
-            {
-                glTexCoord2f((p0.x + inner->x) / _texture_width,
-                        (p0.y + inner->y) / _texture_height);
-            }
-            else if (_textureType == stroke)
-            {
-
-                glTexCoord2f(cap_inner->x, cap_inner->y);
-                cap_inner++;
-            }
+            u = x / _texture_width;
+            v = y / _texture_height;
         }
-        glVertex3f(inner->x, inner->y, 0);
-
-        glColor4f(cur_color[0], cur_color[1], cur_color[2], 0.0);
-        // outer point
-        if (_useTexture)
+        else if (strokeTexture)
         {
-            if (_textureType == paper)
-            {
-                glTexCoord2f((p0.x + outer->x) / _texture_width,
-                        (p0.y + outer->y) / _texture_height);
-            }
-            else if (_textureType == stroke)
-            {
-
-                glTexCoord2f(cap_outer->x, cap_outer->y);
-                cap_outer++;
-            }
+            u = cap_outer[i].x;
+            v = cap_outer[i].y;
         }
-
-        glVertex3f(outer->x, outer->y, 0);
-
-        outer++;
-        inner++;
+        ring.push_back(inner[i]);
+        ring.push_back(strokeVertex(x, y, z, u, v, rgb, 0));
     }
-    glEnd();
-
-    /**********
-
-     glColor4f(1.0, 0.0, 0.0, 1.0) ;
-     glPointSize(4.0);
-
-     // debug
-     inner = inner_points.begin();
-     outer = outer_points.begin();
-     glBegin(GL_POINTS) ;
-     while ( inner != inner_end ) {
-     glVertex3f( inner->x, inner->y, 0);
-     glVertex3f( outer->x, outer->y, 0);
-
-     inner++ ;
-     outer++ ;
-
-     }
-
-     glEnd() ;
-
-     ***********/
-
-    glPopMatrix();
-    glColor4f(cur_color[0], cur_color[1], cur_color[2], cur_color[3]);
+    appendStrip(ring, out);
 
 }
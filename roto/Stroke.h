@@ -62,17 +62,28 @@ enum Strip
     __left, __middle, __right
 };
 
+// one vertex of the triangles of a stroke, laid out for vertex arrays
+struct StrokeVertex
+{
+    GLfloat x, y, z;
+    GLfloat u, v;
+    GLubyte rgba[4];
+};
+
 class Stroke
 {
 private:
     // control polygon
     vector<PointR> _control;
 
-    // limit curve
+    // limit curve, the last of _subdivisions
     vector<PointR> * _limit;
 
-    // temporary data for subdivision
-    vector<PointR> * _temp;
+    // each subdivision of the control polygon in turn, and the control
+    // polygon they were computed from; an edit is subdivided again only
+    // where it changed the control points
+    vector<vector<PointR> > _subdivisions;
+    vector<PointR> _subdivided;
 
     // points that define the triangle strips to draw.
     // there are 3 adjacent triangle strips in total.
@@ -106,6 +117,12 @@ private:
     // have the triangle strip points been computed ?
     bool _stripComputed;
 
+    // points of the limit curve at either end that have not changed since
+    // the strip points were computed, and what the strips were computed with
+    int _stripHead, _stripTail;
+    float _stripTOffset, _stripRatio;
+    int _stripTexture;
+
     // number of subdivision levels to use
     int _numLevels;
 
@@ -146,18 +163,31 @@ private:
 
     //  void discPoint(float x,float y,void (*drawPoint)(int x,int y));
 
-    void drawCap(const _CapData & cap, vector<Point> & inner_points,
-            vector<Point> & outer_points, bool orientation);
+    void capTriangles(const _CapData & cap,
+            const vector<Point> & inner_points,
+            const vector<Point> & outer_points, bool orientation,
+            const GLubyte rgb[3], vector<StrokeVertex> & out) const;
 
-    void subdivideCubicBSpline(vector<PointR> * inputCurve,
+    void subdivideCubicBSpline(const vector<PointR> * inputCurve,
             vector<PointR> * outputCurve);
     void subdivideFourPoint(vector<PointR> * inputCurve,
             vector<PointR> * outputCurve);
-    void subdivide(vector<PointR> * inputCurve, vector<PointR> * outputCurve);
+    void subdivide(const vector<PointR> * inputCurve,
+            vector<PointR> * outputCurve);
+    void resubdivide(const vector<PointR> & in, vector<PointR> & out,
+            int & head, int & tail);
     void computeLimitCurve();
-    void scanConvert();
 
-    void drawTriangleStrip(Strip strip);
+    void updateStripPoints(const vector<PointR> *curve, int head, int tail);
+    void computeAllStripPoints(const vector<PointR> & curve, float ratio);
+    void stripPointsAt(const vector<PointR> & curve, int i,
+            const float * left_offsets, const float * right_offsets);
+    void computeCaps(const vector<PointR> & curve, float * cap1_offsets,
+            float * cap2_offsets);
+    void scanConvert(const vector<StrokeVertex> & triangles);
+
+    void stripTriangles(Strip strip, const GLubyte rgb[3],
+            vector<StrokeVertex> & out) const;
 
     //  void computeCapPoints ( float cap1_offsets[] , float cap2_offsets, int size ) ;
     void computeCapPoints(PointR p0, float dx, float dy, float* cap_offsets,
@@ -281,6 +311,10 @@ public:
     {
         return _textureName;
     }
+    GLuint textureName() const
+    {
+        return _textureName;
+    }
     Texture_Type & textureType()
     {
         return _textureType;
@@ -308,6 +342,11 @@ public:
     void render();
     void print(FILE * fp = stdout);
 
+    // appends the caps and strips render() draws, as GL_TRIANGLES in color
+    // rgb; needs no GL context, so the triangles can be kept and drawn later
+    void tessellate(const GLubyte rgb[3], vector<StrokeVertex> & out);
+    static void drawVertices(const StrokeVertex * v, int first, int count);
+
     void computeStripPoints(const vector<PointR> *curve);
 
     // Aseem
@@ -0,0 +1,158 @@
+/*
+
+ Copyright (C) 2004, Aseem Agarwala, roto@agarwala.org
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or (at
+ your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ USA
+
+ */
+
+#include <algorithm>
+#include "StrokeBatch.h"
+#include "DrawPath.h"
+
+StrokeBatch::StrokeBatch() :
+        _count(0), _buffer(QGLBuffer::VertexBuffer), _triedBuffer(false),
+        _capacity(0)
+{
+}
+
+void StrokeBatch::begin()
+{
+    _slots.clear();
+    _runs.clear();
+    _count = 0;
+}
+
+void StrokeBatch::add(const DrawPath* dp)
+{
+    const int count = dp->strokeTriangles().size();
+    if (count == 0 || dp->inMotion())
+    {
+        Run r = { dp, true, 0, 0, 0 };
+        _runs.push_back(r);
+        return;
+    }
+
+    Slot s = { dp, dp->strokeStamp(), _count, count };
+    _slots.push_back(s);
+    _count += count;
+
+    const GLuint texture = dp->strokeTexture();
+    if (dp->filled() || _runs.empty() || _runs.back().alone
+            || _runs.back().texture != texture)
+    {
+        Run r = { dp->filled() ? dp : NULL, false, texture, s.first, count };
+        _runs.push_back(r);
+    }
+    else
+        _runs.back().count += count;
+}
+
+void StrokeBatch::draw(const int rmode)
+{
+    upload();
+
+    const GLboolean textured = glIsEnabled(GL_TEXTURE_2D);
+    const bool useBuffer = _buffer.isCreated();
+    const StrokeVertex* base = useBuffer || _vertices.empty() ? NULL
+            : &_vertices[0];
+
+    for (unsigned int i = 0; i < _runs.size(); i++)
+    {
+        const Run& r = _runs[i];
+        if (r.alone)
+        {
+            r.path->render(rmode);
+            continue;
+        }
+
+        if (r.path)
+            r.path->renderFill();
+        if (r.texture)
+        {
+            glBindTexture(GL_TEXTURE_2D, r.texture);
+            glEnable(GL_TEXTURE_2D);
+        }
+        else if (!textured)
+            glDisable(GL_TEXTURE_2D);
+
+        // paths drawn alone use client arrays, so the buffer is only bound
+        // around the runs
+        if (useBuffer)
+            _buffer.bind();
+        Stroke::drawVertices(base, r.first, r.count);
+        if (useBuffer)
+            _buffer.release();
+    }
+
+    if (!textured)
+        glDisable(GL_TEXTURE_2D);
+}
+
+void StrokeBatch::upload()
+{
+    if (!_triedBuffer)
+    {
+        _triedBuffer = true;
+        if (_buffer.create())
+            _buffer.setUsagePattern(QGLBuffer::DynamicDraw);
+    }
+    const bool useBuffer = _buffer.isCreated();
+
+    bool same = _slots.size() == _uploaded.size();
+    for (unsigned int i = 0; same && i < _slots.size(); i++)
+        same = _slots[i].path == _uploaded[i].path
+                && _slots[i].count == _uploaded[i].count;
+
+    if (useBuffer)
+        _buffer.bind();
+    if (same)
+    {
+        // the stamps are never reused, so an equal one is the same stroke
+        for (unsigned int i = 0; i < _slots.size(); i++)
+        {
+            if (_slots[i].stamp != _uploaded[i].stamp)
+                write(_slots[i]);
+        }
+    }
+    else
+    {
+        if (useBuffer && _count > _capacity)
+        {
+            // some room to grow as strokes are drawn on the frame
+            _capacity = _count + _count / 4;
+            _buffer.allocate(_capacity * sizeof(StrokeVertex));
+        }
+        else if (!useBuffer)
+            _vertices.resize(_count);
+        for (unsigned int i = 0; i < _slots.size(); i++)
+            write(_slots[i]);
+    }
+    if (useBuffer)
+        _buffer.release();
+
+    _uploaded = _slots;
+}
+
+void StrokeBatch::write(const Slot& s)
+{
+    const std::vector<StrokeVertex>& tris = s.path->strokeTriangles();
+    if (_buffer.isCreated())
+        _buffer.write(s.first * sizeof(StrokeVertex), &tris[0],
+                s.count * sizeof(StrokeVertex));
+    else
+        std::copy(tris.begin(), tris.end(), _vertices.begin() + s.first);
+}
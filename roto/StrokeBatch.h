@@ -0,0 +1,87 @@
+/*
+
+ Copyright (C) 2004, Aseem Agarwala, roto@agarwala.org
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or (at
+ your option) any later version.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ USA
+
+ */
+
+#ifndef STROKEBATCH_H
+#define STROKEBATCH_H
+
+#include <vector>
+#include <QGLBuffer>
+#include "Stroke.h"
+
+class DrawPath;
+
+// Draws the strokes of a frame's paths out of one vertex buffer.
+//
+// The paths are added in drawing order every time the frame is drawn.
+// Strokes that follow each other with the same texture go out in one
+// glDrawArrays; a filled path starts a new run so its fill still covers the
+// strokes under it, and a path being dragged or without a tessellated
+// stroke is drawn by itself.  The buffer keeps what it was last drawn with:
+// when the same strokes come in the same order, only those tessellated
+// again since are written, otherwise it is filled again from the triangles
+// the paths keep.  Without buffer objects the vertices are drawn from
+// client memory.
+class StrokeBatch
+{
+public:
+
+    StrokeBatch();
+
+    void begin();
+    void add(const DrawPath* dp);
+
+    // draws the paths added since begin(), rmode as for DrawPath::render
+    void draw(const int rmode);
+
+private:
+
+    // a stroke in the buffer
+    struct Slot
+    {
+        const DrawPath* path;
+        unsigned int stamp;
+        int first, count;
+    };
+
+    // vertices first..first + count - 1 with texture, 0 for none.  path
+    // is drawn by itself if alone, otherwise its fill goes first if any.
+    struct Run
+    {
+        const DrawPath* path;
+        bool alone;
+        GLuint texture;
+        int first, count;
+    };
+
+    void upload();
+    void write(const Slot& s);
+
+    std::vector<Slot> _slots, _uploaded;
+    std::vector<Run> _runs;
+    int _count; // vertices in _slots
+
+    QGLBuffer _buffer;
+    bool _triedBuffer;
+    int _capacity; // vertices _buffer has room for
+    std::vector<StrokeVertex> _vertices; // without _buffer
+};
+
+#endif // STROKEBATCH_H
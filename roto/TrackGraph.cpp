@@ -331,6 +331,27 @@ void TrackGraph::buildBackReconcileJoints(int bFrame, int aFrame)
     RotoPath::buildBackReconcileJoints(_paths, bFrame, aFrame);
 }
 
+TrackGraph* TrackGraph::earlier(const int frames) const
+{
+    assert(_key0paths.empty());
+    TrackGraph* res = new TrackGraph(*this);
+    int i;
+    uint j;
+    for (i = 0; i < frames; ++i) // loop over time
+        for (j = 0; j < res->_paths.size(); ++j) // loop over curves
+        {
+            assert(res->_paths[j]->prevC());
+            res->_paths[j] = res->_paths[j]->prevC();
+
+            JointRecord& jr = res->_joints[j];
+            if (jr.fixer[0] != NULL)
+                jr.fixer[0] = jr.fixer[0]->prevC();
+            if (jr.fixer[1] != NULL)
+                jr.fixer[1] = jr.fixer[1]->prevC();
+        }
+    return res;
+}
+
 void TrackGraph::buildMulti(MultiSplineData* mts)
 {
     if (_key0paths.size() == 0)
@@ -503,3 +524,31 @@ void TrackGraph::copyLocs(MultiSplineData* mt)
     } // c
 
 }
+
+void TrackGraph::copyControls(const MultiSplineData* mt, const ZVec& ctrls)
+{
+    int c, t, n, numEm, i = 0;
+    RotoPath *curr;
+
+    for (c = 0; c < mt->_nCurves; ++c)
+    {
+        curr = _key0paths[c]->nextC();
+        for (t = 1; t < mt->_numFrames; ++t)
+        {
+            numEm = curr->getNumControls();
+            assert(i + numEm <= (int) ctrls.size());
+            for (n = 0; n < numEm; ++n)
+                if (curr->getCtrlRef(n) != ctrls[i + n])
+                    break;
+            if (n < numEm)
+            {
+                for (n = 0; n < numEm; ++n)
+                    curr->setControl(ctrls[i + n], n);
+                curr->handleNewBezCtrls();
+            }
+            i += numEm;
+            curr = curr->nextC();
+        } // t
+    } // c
+    assert(i == (int) ctrls.size());
+}
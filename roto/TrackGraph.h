@@ -89,12 +89,19 @@ public:
 
     void buildMulti(MultiSplineData* mts);
 
+    // the same curves, frames earlier; for tracking the part of the span
+    // ending there.  Only before buildMulti().
+    TrackGraph* earlier(const int frames) const;
+
     void clear();
 
     void buildBackReconcileJoints(int bFrame, int aFrame);
 
     //void copyLocs(MultiTrackData* mt);
     void copyLocs(MultiSplineData* mt);
+    // in-betweens from MultiSplineData::newControls() while mt is being
+    // solved, only the paths whose controls moved are resampled
+    void copyControls(const MultiSplineData* mt, const ZVec& ctrls);
 
     const PathV& getKey0Paths() const
     {
@@ -0,0 +1,218 @@
+/*********************************************************************
+ * CorresponderBench.cpp
+ *
+ * Checks the banded RotoCorresponder against the original dense dynamic
+ * program (kept below as reference, with the same costs) on random path
+ * pairs: both must find the same cost and the same match, ties included.
+ * Then times the two on a few sizes, and calculateBatch() against solving
+ * the same corresponders one after the other.
+ *
+ *   CorresponderBench [pairs]
+ *********************************************************************/
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <QTime>
+#include "RotoCorresponder.h"
+
+/* ------------- reference: the original dense dynamic program ------------- */
+
+class DenseCorresponder: public RotoCorresponder
+{
+public:
+
+    DenseCorresponder(AbstractPath* X, AbstractPath* Y) :
+            RotoCorresponder(X, Y)
+    {
+    }
+
+    double denseCalculate(int* xints) const
+    {
+        std::vector<GC_Node> graph(_w * _h);
+#define GRAPH(a,b) graph[(b)*_w+(a)]
+        const double myInf = DBL_MAX / 10.;
+
+        int i, j, k;
+        graph[0]._cost = 0;
+        for (j = 1; j < _h; j++)
+            GRAPH(0,j)._cost = myInf;
+
+        double minCost, cost, internCost;
+        int iminCost;
+        for (i = 1; i < _w; i++)
+            for (j = 0; j < _h; j++)
+            {
+                double dia = fabs(
+                        double(i) / double(_w - 1) - double(j) / double(_h - 1));
+                if (dia > .3)
+                {
+                    GRAPH(i,j)._cost = myInf;
+                    continue;
+                }
+
+                minCost = DBL_MAX;
+                iminCost = -1;
+
+                internCost = internalCost(i, j);
+                for (k = j; k > -1; k--) // matching (i,j) and (i-1,k)
+                {
+                    cost = GRAPH(i-1,k)._cost + linkCost(i, j, i - 1, k)
+                            + internCost;
+                    if (cost < minCost)
+                    {
+                        minCost = cost;
+                        iminCost = k;
+                    }
+                    if (j - k > _maxJump)
+                        break;
+                }
+
+                assert(iminCost != -1);
+                GRAPH(i,j)._cost = minCost;
+                GRAPH(i,j)._bptr = iminCost;
+            }
+
+        int bptr = _h - 1;
+        for (i = _w - 1; i > -1; i--)
+        {
+            xints[i] = bptr;
+            bptr = GRAPH(i,bptr)._bptr;
+        }
+        return GRAPH(_w-1, _h-1)._cost;
+#undef GRAPH
+    }
+};
+
+/* ------------------------------------------------------------------------- */
+
+// a wobbly open curve of n samples about a pixel apart
+static AbstractPath* randomPath(const int n, const float phase)
+{
+    AbstractPath* p = new AbstractPath();
+    float x = 0, y = 0, a = phase;
+    for (int i = 0; i < n; ++i)
+    {
+        p->add(Vec2f(x, y));
+        a += (rand() % 200 - 100) / 1000.f;
+        x += cosf(a);
+        y += sinf(a);
+    }
+    return p;
+}
+
+// the same curve moved, resampled to n samples and jittered
+static AbstractPath* movedPath(const AbstractPath* from, const int n)
+{
+    AbstractPath* p = new AbstractPath();
+    const int m = from->getNumElements();
+    const float dx = float(rand() % 20), dy = float(rand() % 20);
+    for (int i = 0; i < n; ++i)
+    {
+        const float t = float(i) * (m - 1) / (n - 1);
+        const int k = MIN(int(t), m - 2);
+        const float u = t - k;
+        Vec2f a = from->getElement(k), b = from->getElement(k + 1);
+        p->add(Vec2f(a.x() + u * (b.x() - a.x()) + dx
+                + (rand() % 100) / 100.f, a.y() + u * (b.y() - a.y()) + dy
+                + (rand() % 100) / 100.f));
+    }
+    return p;
+}
+
+static bool check(const int w, const int h)
+{
+    AbstractPath* X = randomPath(w, float(rand() % 628) / 100.f);
+    AbstractPath* Y = movedPath(X, h);
+    DenseCorresponder dense(X, Y);
+    RotoCorresponder banded(X, Y);
+    std::vector<int> a(w), b(w);
+    const double ca = dense.denseCalculate(&a[0]);
+    const double cb = banded.calculate();
+    banded.getSolution(&b[0]);
+    delete X;
+    delete Y;
+    if (ca == cb && a == b)
+        return true;
+    printf("%dx%d: dense %.9g, banded %.9g, matches %s\n", w, h, ca, cb,
+            a == b ? "agree" : "DIFFER");
+    return false;
+}
+
+static void timeSize(const int w, const int h)
+{
+    AbstractPath* X = randomPath(w, 0.f);
+    AbstractPath* Y = movedPath(X, h);
+    std::vector<int> sol(w);
+    QTime t;
+
+    DenseCorresponder dense(X, Y);
+    t.start();
+    dense.denseCalculate(&sol[0]);
+    const int td = t.elapsed();
+
+    RotoCorresponder banded(X, Y);
+    t.restart();
+    banded.calculate();
+    const int tb = t.elapsed();
+
+    printf("%5dx%-5d dense %6d ms  banded %6d ms\n", w, h, td, tb);
+    delete X;
+    delete Y;
+}
+
+// both directions of n path pairs between two frames, as
+// RotoPath::calculateBackCorrs(paths) solves them
+static void timeBatch(const int n, const int len)
+{
+    std::vector<AbstractPath*> paths;
+    std::vector<GeigerCorresponder*> coors;
+    for (int i = 0; i < n; ++i)
+    {
+        AbstractPath* X = randomPath(len + rand() % len, 0.f);
+        AbstractPath* Y = movedPath(X, len + rand() % len);
+        paths.push_back(X);
+        paths.push_back(Y);
+        coors.push_back(new RotoCorresponder(X, Y));
+        coors.push_back(new RotoCorresponder(Y, X));
+    }
+
+    QTime t;
+    t.start();
+    GeigerCorresponder::calculateBatch(coors, 1);
+    const int one = t.elapsed();
+    t.restart();
+    GeigerCorresponder::calculateBatch(coors);
+    const int all = t.elapsed();
+    printf("%d paths of %d-%d samples: one thread %d ms, batch %d ms\n", n,
+            len, 2 * len - 1, one, all);
+
+    for (unsigned int i = 0; i < coors.size(); ++i)
+        delete coors[i];
+    for (unsigned int i = 0; i < paths.size(); ++i)
+        delete paths[i];
+}
+
+int main(int argc, char** argv)
+{
+    int pairs = 200, i, bad = 0;
+    if (argc == 2)
+        pairs = atoi(argv[1]);
+
+    srand(1);
+    for (i = 0; i < pairs; ++i)
+    {
+        const int w = 5 + rand() % 300, h = 5 + rand() % 300;
+        if (!check(w, h))
+            ++bad;
+    }
+    printf("%d random pairs, %d differ\n", pairs, bad);
+
+    timeSize(300, 1500);
+    timeSize(2000, 2000);
+    timeSize(2000, 2100);
+    timeBatch(40, 400);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Check and benchmark of the banded roto
+# corresponder against the dense original
+#
+#-------------------------------------------------
+
+# AbstractPath still calls GL for drawing, so libGL is linked, but no
+# context is ever created
+TARGET = CorresponderBench
+TEMPLATE = app
+QT += core gui
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += .. ../.. ../../KLT
+
+SOURCES += \
+    CorresponderBench.cpp \
+    ../AbstractPath.cpp \
+    ../GeigerCorresponder.cpp \
+    ../RotoCorresponder.cpp \
+    ../FitCurves.c \
+    ../GGVecLib.c
+
+HEADERS += \
+    ../AbstractPath.h \
+    ../GeigerCorresponder.h \
+    ../RotoCorresponder.h
+
+unix {
+    LIBS   += -lGL -lGLU
+}
+
+win32 {
+    LIBS += -lopengl32 -lglu32
+}
@@ -0,0 +1,240 @@
+/*********************************************************************
+ * DrawCorresponderBench.cpp
+ *
+ * Checks DrawCorresponder against the original dense dynamic program
+ * (kept below as reference, with the same costs) on random strokes over
+ * a frame of random roto circles: both must find the same cost and the
+ * same match, ties included.  Then times the two on a dense stroke, and
+ * calculateBatch() against solving the same strokes one after the other.
+ *
+ *   DrawCorresponderBench [strokes]
+ *********************************************************************/
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <QTime>
+#include "DrawCorresponder.h"
+#include "GC_Node.h"
+
+#define W 1280
+#define H 720
+#define KAPPA 0.5523f
+
+/* ------------- reference: the original dense dynamic program ------------- */
+
+// samples of every path of rc, in order, and the buckets they fall in
+struct DenseDraw
+{
+    std::vector<Vec2f> locs;
+    std::vector<RotoPath*> ptrs;
+    std::vector<int> first;
+    int bw, bh;
+    std::vector<std::vector<int> > buckets;
+
+    DenseDraw(RotoCurves* rc)
+    {
+        RotoPathList::const_iterator c;
+        for (c = rc->begin(); c != rc->end(); ++c)
+            for (int i = 0; i < (*c)->getNumElements(); i++)
+            {
+                first.push_back(locs.size() - i);
+                locs.push_back((*c)->getElement(i));
+                ptrs.push_back(*c);
+            }
+        bw = W / 12 + 1;
+        bh = H / 12 + 1;
+        buckets.resize(bw * bh);
+        for (unsigned int j = 0; j < locs.size(); j++)
+        {
+            Vec2i b = bucket(j);
+            buckets[b.y() * bw + b.x()].push_back(j);
+        }
+    }
+
+    Vec2i bucket(const int j) const
+    {
+        Vec2i b((int) (locs[j].x() / 12.), (int) (locs[j].y() / 12.));
+        b.Clamp(0, bw - 1, bh - 1);
+        return b;
+    }
+
+    double linkCost(const AbstractPath* X, const int i, const int j,
+            const int ip, const int jp) const
+    {
+        Vec2f D(locs[j], X->getElement(i));
+        D -= locs[jp];
+        D += X->getElement(ip);
+        double cost = D.Len();
+        if (ptrs[j] != ptrs[jp])
+            cost += 20.;
+        return cost;
+    }
+
+    double internalCost(const AbstractPath* X, const int i, const int j) const
+    {
+        return .2 * X->getElement(i).distanceTo(locs[j]);
+    }
+
+    // the first column costs its distance only
+    double solve(const AbstractPath* X, int* xints, RotoPath** rptrs) const
+    {
+        const int w = X->getNumElements(), h = locs.size();
+        std::vector<GC_Node> graph(w * h);
+#define GRAPH(a,b) graph[(b)*w+(a)]
+        int i, j, k, bi, bj, bp;
+        for (j = 0; j < h; j++)
+            GRAPH(0,j)._cost = internalCost(X, 0, j);
+        for (i = 1; i < w; i++)
+            for (j = 0; j < h; j++)
+            {
+                double minCost = DBL_MAX / 10., cost;
+                int iminCost = -1;
+                const double internCost = internalCost(X, i, j);
+                const Vec2i b = bucket(j);
+                for (bj = MAX(b.y() - 2, 0); bj <= MIN(bh - 1, b.y() + 2); bj++)
+                    for (bi = MAX(b.x() - 2, 0);
+                            bi <= MIN(bw - 1, b.x() + 2); bi++)
+                    {
+                        const std::vector<int>& bk = buckets[bj * bw + bi];
+                        for (bp = 0; bp < (int) bk.size(); bp++)
+                        {
+                            k = bk[bp];
+                            cost = GRAPH(i-1,k)._cost
+                                    + linkCost(X, i, j, i - 1, k) + internCost;
+                            if (cost < minCost)
+                            {
+                                minCost = cost;
+                                iminCost = k;
+                            }
+                        }
+                    }
+                GRAPH(i,j)._cost = minCost;
+                GRAPH(i,j)._bptr = iminCost;
+            }
+
+        double minCost = DBL_MAX;
+        int bptr = -1;
+        for (j = 0; j < h; j++)
+            if (GRAPH(w-1,j)._cost < minCost)
+            {
+                minCost = GRAPH(w-1,j)._cost;
+                bptr = j;
+            }
+        for (i = w - 1; i > -1; i--)
+        {
+            xints[i] = bptr - first[bptr];
+            rptrs[i] = ptrs[bptr];
+            bptr = GRAPH(i,bptr)._bptr;
+        }
+        return minCost;
+#undef GRAPH
+    }
+};
+
+/* ------------------------------------------------------------------------- */
+
+// a circle of four segments around (cx, cy)
+static std::vector<Vec2f> circle(const float cx, const float cy,
+        const float r)
+{
+    static const float pts[13][2] = { { 1, 0 }, { 1, KAPPA }, { KAPPA, 1 },
+            { 0, 1 }, { -KAPPA, 1 }, { -1, KAPPA }, { -1, 0 }, { -1, -KAPPA },
+            { -KAPPA, -1 }, { 0, -1 }, { KAPPA, -1 }, { 1, -KAPPA }, { 1, 0 } };
+    std::vector<Vec2f> ctrls(13);
+    for (int i = 0; i < 13; ++i)
+        ctrls[i].Set(cx + r * pts[i][0], cy + r * pts[i][1]);
+    return ctrls;
+}
+
+// a wobbly stroke of n samples about two pixels apart, somewhere in the
+// frame
+static AbstractPath* randomStroke(const int n)
+{
+    AbstractPath* p = new AbstractPath();
+    float x = 200 + rand() % (W - 400), y = 200 + rand() % (H - 400);
+    float a = (rand() % 628) / 100.f;
+    for (int i = 0; i < n; ++i)
+    {
+        p->add(Vec2f(x, y));
+        a += (rand() % 200 - 100) / 1000.f;
+        x = MAX(0.f, MIN(W - 1.f, x + 2 * cosf(a)));
+        y = MAX(0.f, MIN(H - 1.f, y + 2 * sinf(a)));
+    }
+    return p;
+}
+
+static bool check(RotoCurves* rc, const DenseDraw& dense, const int n)
+{
+    AbstractPath* X = randomStroke(n);
+    std::vector<int> a(n), b(n);
+    std::vector<RotoPath*> pa(n), pb(n);
+    const double ca = dense.solve(X, &a[0], &pa[0]);
+    DrawCorresponder dc(X, rc, W, H);
+    const double cb = dc.calculate();
+    dc.getSolution(&b[0], &pb[0]);
+    delete X;
+    if (ca == cb && a == b && pa == pb)
+        return true;
+    printf("%d samples: dense %.9g, listed %.9g, matches %s\n", n, ca, cb,
+            a == b && pa == pb ? "agree" : "DIFFER");
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    int strokes = 100, i, bad = 0;
+    if (argc == 2)
+        strokes = atoi(argv[1]);
+
+    srand(1);
+    RotoCurves rc;
+    for (i = 0; i < 20; ++i)
+        rc.addPathFromCtrls(circle(100 + rand() % (W - 200),
+                100 + rand() % (H - 200), 30 + rand() % 70), true);
+    DenseDraw dense(&rc);
+    printf("%d roto paths, %d samples\n", rc.getNumCurves(),
+            (int) dense.locs.size());
+
+    for (i = 0; i < strokes; ++i)
+        if (!check(&rc, dense, 5 + rand() % 200))
+            ++bad;
+    printf("%d random strokes, %d differ\n", strokes, bad);
+
+    QTime t;
+    {
+        AbstractPath* X = randomStroke(600);
+        std::vector<int> xints(600);
+        std::vector<RotoPath*> ptrs(600);
+        t.start();
+        dense.solve(X, &xints[0], &ptrs[0]);
+        const int td = t.elapsed();
+        DrawCorresponder dc(X, &rc, W, H);
+        t.restart();
+        dc.calculate();
+        printf("600 samples: dense %d ms, listed %d ms\n", td, t.elapsed());
+        delete X;
+    }
+
+    std::vector<AbstractPath*> batchX;
+    std::vector<DrawCorresponder*> batch;
+    for (i = 0; i < 32; ++i)
+    {
+        batchX.push_back(randomStroke(200 + rand() % 200));
+        batch.push_back(new DrawCorresponder(batchX.back(), &rc, W, H));
+    }
+    t.restart();
+    DrawCorresponder::calculateBatch(batch, 1);
+    const int one = t.elapsed();
+    t.restart();
+    DrawCorresponder::calculateBatch(batch);
+    printf("32 strokes: one thread %d ms, batch %d ms\n", one, t.elapsed());
+    for (i = 0; i < (int) batch.size(); ++i)
+    {
+        delete batch[i];
+        delete batchX[i];
+    }
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+/*********************************************************************
+ * ProjectFileBench.cpp
+ *
+ * Round trip of the binary project file on a long synthetic project:
+ * every frame has a few roto paths linked across time and a draw stroke
+ * corresponded to one of them.
+ *   save, open, read every frame, save again    the two files must be
+ *                                               the same bytes
+ *   change a frame, save into the open file     read back, it must be
+ *                                               the same as the curves
+ *   damage a record, open and save elsewhere    the record must come
+ *                                               back as it was
+ * and the time of each step.
+ *
+ *   ProjectFileBench [frames paths]
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <QFile>
+#include <QTime>
+#include "ProjectFile.h"
+
+#define RADIUS 40.f
+#define KAPPA 0.5523f
+#define STROKE 8
+
+// a circle of four segments around (cx, cy)
+static std::vector<Vec2f> circle(const float cx, const float cy)
+{
+    static const float pts[13][2] = { { 1, 0 }, { 1, KAPPA }, { KAPPA, 1 },
+            { 0, 1 }, { -KAPPA, 1 }, { -1, KAPPA }, { -1, 0 }, { -1, -KAPPA },
+            { -KAPPA, -1 }, { 0, -1 }, { KAPPA, -1 }, { 1, -KAPPA }, { 1, 0 } };
+    std::vector<Vec2f> ctrls(13);
+    for (int i = 0; i < 13; ++i)
+        ctrls[i].Set(cx + RADIUS * pts[i][0], cy + RADIUS * pts[i][1]);
+    return ctrls;
+}
+
+// a stroke along the top of rp, corresponded to it
+static DrawPath* makeStroke(RotoPath* rp, const float cx, const float cy)
+{
+    DrawPath* dp = new DrawPath();
+    dp->setLook(Vec3f(1, 0, 0), false, Vec3f(0, 0, 0), 0);
+    dp->initHertzStroke();
+    float t[STROKE];
+    RotoPath* ptrs[STROKE];
+    for (int j = 0; j < STROKE; ++j)
+    {
+        dp->addVertex(cx - RADIUS + j * 2 * RADIUS / (STROKE - 1), cy - RADIUS,
+                1.f);
+        t[j] = j / float(STROKE - 1);
+        ptrs[j] = rp;
+    }
+    dp->setCorrRoto(new DrawContCorr(t, ptrs, STROKE));
+    rp->addCorrDraw(dp);
+    dp->freshenStroke();
+    return dp;
+}
+
+static bool sameFiles(const char* a, const char* b)
+{
+    QFile fa(a), fb(b);
+    return fa.open(QIODevice::ReadOnly) && fb.open(QIODevice::ReadOnly)
+            && fa.readAll() == fb.readAll();
+}
+
+// every frame of fileName into new curves, false if any is damaged
+static bool readAll(const char* fileName, const RotoProjectInfo& info,
+        RotoCurves** roto, DrawCurves** draw, int* openMs, int* readMs)
+{
+    *roto = new RotoCurves[info.frames + 1];
+    *draw = new DrawCurves[info.frames + 1];
+    ProjectFile pf;
+    RotoProjectInfo read;
+    QTime t;
+    t.start();
+    if (!pf.open(fileName, &read) || read.frames != info.frames
+            || read.width != info.width || read.height != info.height)
+        return false;
+    *openMs = t.elapsed();
+    t.restart();
+    bool ok = true;
+    for (int f = 0; f < info.frames; ++f)
+        ok = pf.loadFrame(f, *roto, *draw) && ok;
+    *readMs = t.elapsed();
+    return ok;
+}
+
+// save through a new ProjectFile, which writes the whole file
+static bool saveAll(const char* fileName, RotoCurves* roto, DrawCurves* draw,
+        const RotoProjectInfo& info, int* ms)
+{
+    ProjectFile pf;
+    QTime t;
+    t.start();
+    const bool ok = pf.save(fileName, roto, draw, info);
+    *ms = t.elapsed();
+    return ok;
+}
+
+// the draw paths of a frame that are linked and corresponded as made
+static bool linked(RotoCurves* roto, DrawCurves* draw, const int f)
+{
+    DrawPath* dp;
+    int n = 0;
+    draw[f].startDrawPathIterator();
+    while ((dp = draw[f].IterateNext()) != NULL)
+    {
+        const std::set<RotoPath*>& rotos = dp->getRotoSet();
+        RotoPath* rp = *roto[f].begin();
+        if (rotos.size() != 1 || *rotos.begin() != rp
+                || !rp->getCorrDraws()->count(dp)
+                || (f > 0 && (!dp->prevC() || !rp->prevC())))
+            return false;
+        ++n;
+    }
+    return n == 1;
+}
+
+int main(int argc, char** argv)
+{
+    RotoProjectInfo info;
+    info.width = 1280;
+    info.height = 720;
+    info.frames = 3000;
+    int paths = 4, f, p, ms, openMs, readMs;
+    if (argc == 3)
+    {
+        info.frames = atoi(argv[1]);
+        paths = std::max(2, atoi(argv[2]));
+    }
+
+    // circles drifting right, each linked to the one before
+    RotoCurves* roto = new RotoCurves[info.frames + 1];
+    DrawCurves* draw = new DrawCurves[info.frames + 1];
+    std::vector<RotoPath*> prev(paths, (RotoPath*) NULL);
+    DrawPath* prevD = NULL;
+    for (f = 0; f < info.frames; ++f)
+    {
+        for (p = 0; p < paths; ++p)
+        {
+            const float cx = 60.f + 120.f * p + 0.01f * f, cy = 360.f;
+            RotoPath* rp = roto[f].addPathFromCtrls(circle(cx, cy),
+                    f % 10 == 0);
+            if (prev[p])
+            {
+                prev[p]->setNextC(rp);
+                prev[p]->buildINextCorrs();
+                rp->setPrevC(prev[p]);
+                rp->buildIPrevCorrs();
+            }
+            prev[p] = rp;
+            if (p == 0)
+            {
+                DrawPath* dp = makeStroke(rp, cx, cy);
+                draw[f].addPath(dp);
+                if (prevD)
+                {
+                    prevD->setNextC(dp);
+                    dp->setPrevC(prevD);
+                }
+                prevD = dp;
+            }
+        }
+    }
+    printf("%d frames, %d paths and a stroke each\n", info.frames, paths);
+
+    int bad = 0;
+    if (!saveAll("bench_a.nprp", roto, draw, info, &ms))
+    {
+        printf("could not write bench_a.nprp\n");
+        return 1;
+    }
+    printf("save        %6d ms  %lld bytes\n", ms,
+            (long long) QFile("bench_a.nprp").size());
+
+    // read back, written again
+    RotoCurves* roto2;
+    DrawCurves* draw2;
+    if (!readAll("bench_a.nprp", info, &roto2, &draw2, &openMs, &readMs))
+        ++bad;
+    printf("open        %6d ms\nread all    %6d ms\n", openMs, readMs);
+    for (f = 0; f < info.frames; ++f)
+        if (!linked(roto2, draw2, f))
+        {
+            printf("frame %d: not linked or corresponded as saved\n", f);
+            ++bad;
+            break;
+        }
+    saveAll("bench_b.nprp", roto2, draw2, info, &ms);
+    const bool same = sameFiles("bench_a.nprp", "bench_b.nprp");
+    printf("round trip  %s\n", same ? "same bytes" : "DIFFER");
+    bad += !same;
+
+    // one frame changed, saved into the open file
+    {
+        ProjectFile pf;
+        RotoProjectInfo read;
+        pf.open("bench_b.nprp", &read);
+        RotoCurves* roto3 = new RotoCurves[info.frames + 1];
+        DrawCurves* draw3 = new DrawCurves[info.frames + 1];
+        while (pf.loadSome(info.frames, roto3, draw3))
+            ;
+        // a path without a stroke on it
+        const int k = info.frames / 2;
+        roto3[k].deletePath(roto3[k].getCurve(paths - 1));
+        QTime t;
+        t.start();
+        pf.save("bench_b.nprp", roto3, draw3, info);
+        printf("save 1 frame %5d ms  %lld bytes\n", t.elapsed(),
+                (long long) QFile("bench_b.nprp").size());
+        saveAll("bench_c.nprp", roto3, draw3, info, &ms);
+        delete[] roto3;
+        delete[] draw3;
+    }
+    RotoCurves* roto4;
+    DrawCurves* draw4;
+    if (!readAll("bench_b.nprp", info, &roto4, &draw4, &openMs, &readMs))
+        ++bad;
+    saveAll("bench_d.nprp", roto4, draw4, info, &ms);
+    const bool appended = sameFiles("bench_c.nprp", "bench_d.nprp");
+    printf("incremental %s\n", appended ? "same curves" : "DIFFER");
+    bad += !appended;
+
+    // a record with too many draw paths for its size: readAll() must fail
+    // on it after reading its roto paths and drop them, and the record be
+    // saved back as it was
+    ProjectFileHeader h;
+    std::vector<ProjectFileEntry> table(info.frames);
+    std::vector<char> record;
+    const int k = info.frames / 3;
+    {
+        QFile fc("bench_c.nprp");
+        fc.open(QIODevice::ReadWrite);
+        fc.read((char*) &h, sizeof(h));
+        fc.seek(h.table);
+        fc.read((char*) &table[0], info.frames * sizeof(ProjectFileEntry));
+        record.resize(table[k].size);
+        fc.seek(table[k].offset);
+        fc.read(&record[0], record.size());
+        // the count of draw paths follows the roto paths
+        const int huge = 1 << 20;
+        memcpy(&record[sizeof(int)
+                + paths * (3 * sizeof(int) + 13 * 2 * sizeof(float))], &huge,
+                sizeof(int));
+        fc.seek(table[k].offset);
+        fc.write(&record[0], record.size());
+    }
+    RotoCurves* roto5;
+    DrawCurves* draw5;
+    const bool damaged = !readAll("bench_c.nprp", info, &roto5, &draw5,
+            &openMs, &readMs);
+    const bool dropped = roto5[k].getNumCurves() == 0
+            && draw5[k].getNumCurves() == 0;
+    saveAll("bench_e.nprp", roto5, draw5, info, &ms);
+    bool kept = false;
+    {
+        QFile fe("bench_e.nprp");
+        ProjectFileHeader he;
+        ProjectFileEntry e;
+        std::vector<char> back(record.size());
+        kept = fe.open(QIODevice::ReadOnly)
+                && fe.read((char*) &he, sizeof(he)) == sizeof(he)
+                && fe.seek(he.table + k * sizeof(e))
+                && fe.read((char*) &e, sizeof(e)) == sizeof(e)
+                && e.size == (qint64) record.size() && fe.seek(e.offset)
+                && fe.read(&back[0], back.size()) == (qint64) back.size()
+                && back == record;
+    }
+    printf("damaged     %s, %s, %s\n", damaged ? "found" : "NOT FOUND",
+            dropped ? "nothing read" : "PART READ",
+            kept ? "kept" : "NOT KEPT");
+    bad += !damaged + !dropped + !kept;
+
+    delete[] roto;
+    delete[] draw;
+    delete[] roto2;
+    delete[] draw2;
+    delete[] roto4;
+    delete[] draw4;
+    delete[] roto5;
+    delete[] draw5;
+    return bad ? 1 : 0;
+}
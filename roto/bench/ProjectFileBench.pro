@@ -0,0 +1,84 @@
+#-------------------------------------------------
+#
+# Round trip and timing of the binary project
+# file on a long synthetic project
+#
+#-------------------------------------------------
+
+# the roto and draw sources still call GL for drawing, so libGL is
+# linked, but no context is ever created
+TARGET = ProjectFileBench
+TEMPLATE = app
+QT += core gui opengl
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += .. ../.. ../../KLT
+
+SOURCES += \
+    ProjectFileBench.cpp \
+    ../../ProjectFile.cpp \
+    ../../KLT/BezSpline.cpp \
+    ../../KLT/ContCorr.cpp \
+    ../../KLT/MultiSplineData.cpp \
+    ../AbstractPath.cpp \
+    ../GeigerCorresponder.cpp \
+    ../RotoCorresponder.cpp \
+    ../RotoPath.cpp \
+    ../RotoRegion.cpp \
+    ../TrackGraph.cpp \
+    ../FitCurves.c \
+    ../GGVecLib.c \
+    ../RotoCurves.cpp \
+    ../RotoIndex.cpp \
+    ../MatteRaster.cpp \
+    ../DrawPath.cpp \
+    ../Stroke.cpp \
+    ../Bitmap.cpp \
+    ../Texture.cpp \
+    ../DrawContCorr.cpp \
+    ../DrawCorresponder.cpp \
+    ../DrawCurves.cpp \
+    ../StrokeBatch.cpp \
+    ../../KLT/Error.c \
+    ../../KLT/MySparseMat.cpp \
+    ../../KLT/LinearSolver.cpp \
+    ../../KLT/KLT.cpp \
+    ../../KLT/Keeper.cpp \
+    ../../KLT/MultiKeeper.cpp \
+    ../../KLT/Kernels.cpp \
+    ../../KLT/Convolve.cpp \
+    ../../KLT/PyramidCache.cpp \
+    ../../KLT/PackedPyramid.cpp \
+    ../../KLT/klt_util.cpp \
+    ../../KLT/Pyramid.cpp \
+    ../../KLT/kltSpline.cpp \
+    ../../KLT/HB_Sweep.cpp \
+    ../../KLT/SplineKeeper.cpp \
+    ../../KLT/ObsCache.cpp \
+    ../../KLT/HB_OneCurve.cpp \
+    ../../KLT/MultiDiagMatrix.cpp \
+    ../../KLT/DiagMatrix.cpp \
+    ../../KLT/Preconditioner.cpp
+
+HEADERS += \
+    ../../ProjectFile.h
+
+unix {
+    LIBS   += -lGL -lGLU
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv
+}
+
+win32 {
+INCLUDEPATH += \
+        D:\OpenCV-2.4.9\build\include \
+        D:\boost_1_58_0
+LIBS += -LD:\OpenCV-2.4.9\build\x64\vc12\lib \
+        -L"D:\boost_1_58_0\lib64-msvc-12.0" \
+        -lopencv_core249d \
+        -lopencv_highgui249d \
+        -lopencv_imgproc249d \
+        -lopencv_calib3d249d \
+        -lopengl32 -lglu32
+}